@@ -0,0 +1,233 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/cc/training/all_reduce.h"
+
+#include <algorithm>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+
+namespace {
+
+// chunks[i][c] is chunk c of the data of device i.  All the devices have the
+// same number of equal-sized chunks.
+typedef std::vector<std::vector<Output>> DeviceChunks;
+
+bool IsPowerOfTwo(int n) { return n > 0 && (n & (n - 1)) == 0; }
+
+// Flattens "input" and pads it with zeros, so that it splits into
+// "num_chunks" chunks of the same size.
+std::vector<Output> SplitInput(const Scope& scope, const Output& input,
+                               int num_chunks) {
+  Output flat = ops::Reshape(scope, input, {-1});
+  auto size = ops::Size(scope, input);
+  auto padded_size = ops::Mul(
+      scope, ops::Div(scope, ops::Add(scope, size, num_chunks - 1), num_chunks),
+      num_chunks);
+  auto zero = ops::Cast(scope, ops::Const(scope, 0), input.type());
+  Output padding = ops::Fill(
+      scope, ops::ExpandDims(scope, ops::Sub(scope, padded_size, size), 0),
+      zero);
+  auto padded = ops::Concat(scope, {flat, padding}, 0);
+  return ops::Split(scope, 0, padded, num_chunks).output;
+}
+
+// Inverse of SplitInput: returns the concatenation of "chunks" with the
+// shape of "input".
+Output JoinOutput(const Scope& scope, const Output& input,
+                  const std::vector<Output>& chunks) {
+  auto padded = ops::Concat(scope, chunks, 0);
+  auto flat = ops::Slice(scope, padded, {0},
+                         ops::ExpandDims(scope, ops::Size(scope, input), 0));
+  return ops::Reshape(scope, flat, ops::Shape(scope, input));
+}
+
+// Returns the sum of chunk c of all the devices, which has been computed on
+// device i, divided by the number of devices if needed.
+Output FinishReduction(const std::vector<Scope>& scopes,
+                       const AllReduceOptions& options, int i,
+                       const Output& sum) {
+  if (options.reduction != AllReduceOptions::MEAN) {
+    return sum;
+  }
+  const Scope& scope = scopes[i];
+  auto num_devices = ops::Cast(
+      scope, ops::Const(scope, static_cast<int>(scopes.size())), sum.type());
+  return ops::Div(scope, sum, num_devices);
+}
+
+// Chunk c is reduced along the ring starting with device c % N, and the
+// result is passed along the ring once more to reach all the devices.  As
+// the chunks start on different devices, every device sends one chunk to
+// its successor at each step, and with several chunks per device the steps
+// of different chunks are pipelined.
+void RingAllReduce(const std::vector<Scope>& scopes,
+                   const AllReduceOptions& options, DeviceChunks* chunks) {
+  const int num_devices = scopes.size();
+  const int num_chunks = (*chunks)[0].size();
+  for (int c = 0; c < num_chunks; ++c) {
+    const int first = c % num_devices;
+    // Reduce-scatter.
+    Output sum = (*chunks)[first][c];
+    int i = first;
+    for (int step = 1; step < num_devices; ++step) {
+      i = (i + 1) % num_devices;
+      sum = ops::Add(scopes[i], sum, (*chunks)[i][c]);
+    }
+    (*chunks)[i][c] = FinishReduction(scopes, options, i, sum);
+    // All-gather.
+    for (int step = 1; step < num_devices; ++step) {
+      const int prev = i;
+      i = (i + 1) % num_devices;
+      (*chunks)[i][c] = ops::Identity(scopes[i], (*chunks)[prev][c]);
+    }
+  }
+}
+
+// At each step of the reduce-scatter phase, device i exchanges half of the
+// chunks it is still reducing with device i ^ distance, and keeps reducing
+// the other half, so that after log2(N) steps each device holds the result
+// for 1/N of the chunks.  The all-gather phase reverses the exchanges.
+void HalvingDoublingAllReduce(const std::vector<Scope>& scopes,
+                              const AllReduceOptions& options,
+                              DeviceChunks* chunks) {
+  const int num_devices = scopes.size();
+  const int num_chunks = (*chunks)[0].size();
+  // Device i is responsible for chunks [begin[i], end[i]).
+  std::vector<int> begin(num_devices, 0);
+  std::vector<int> end(num_devices, num_chunks);
+
+  // Reduce-scatter.
+  for (int distance = num_devices / 2; distance >= 1; distance /= 2) {
+    DeviceChunks next = *chunks;
+    for (int i = 0; i < num_devices; ++i) {
+      const int peer = i ^ distance;
+      const int mid = (begin[i] + end[i]) / 2;
+      if (i & distance) {
+        begin[i] = mid;
+      } else {
+        end[i] = mid;
+      }
+      for (int c = begin[i]; c < end[i]; ++c) {
+        next[i][c] = ops::Add(scopes[i], (*chunks)[i][c], (*chunks)[peer][c]);
+      }
+    }
+    chunks->swap(next);
+  }
+  for (int i = 0; i < num_devices; ++i) {
+    for (int c = begin[i]; c < end[i]; ++c) {
+      (*chunks)[i][c] = FinishReduction(scopes, options, i, (*chunks)[i][c]);
+    }
+  }
+
+  // All-gather.
+  for (int distance = 1; distance < num_devices; distance *= 2) {
+    DeviceChunks next = *chunks;
+    std::vector<int> next_begin = begin;
+    std::vector<int> next_end = end;
+    for (int i = 0; i < num_devices; ++i) {
+      const int peer = i ^ distance;
+      for (int c = begin[peer]; c < end[peer]; ++c) {
+        next[i][c] = ops::Identity(scopes[i], (*chunks)[peer][c]);
+      }
+      next_begin[i] = std::min(begin[i], begin[peer]);
+      next_end[i] = std::max(end[i], end[peer]);
+    }
+    chunks->swap(next);
+    begin.swap(next_begin);
+    end.swap(next_end);
+  }
+}
+
+}  // namespace
+
+Status AllReduce(const Scope& scope, const std::vector<Output>& inputs,
+                 const AllReduceOptions& options,
+                 std::vector<Output>* outputs) {
+  const int num_devices = inputs.size();
+  if (num_devices == 0) {
+    return errors::InvalidArgument("AllReduce needs at least one input");
+  }
+  if (options.num_subchunks < 1) {
+    return errors::InvalidArgument("AllReduce needs num_subchunks >= 1, got ",
+                                   options.num_subchunks);
+  }
+  if (options.algorithm == AllReduceOptions::RECURSIVE_HALVING_DOUBLING &&
+      !IsPowerOfTwo(num_devices)) {
+    return errors::InvalidArgument(
+        "Recursive halving-doubling AllReduce needs a power of 2 devices, got ",
+        num_devices);
+  }
+  const DataType dtype = inputs[0].type();
+  switch (dtype) {
+    case DT_HALF:
+    case DT_FLOAT:
+    case DT_DOUBLE:
+    case DT_INT32:
+    case DT_INT64:
+      break;
+    default:
+      return errors::InvalidArgument("AllReduce does not support ",
+                                     DataTypeString(dtype));
+  }
+
+  // The ops of each device are created in a scope placed on the device.
+  Scope all_reduce = scope.NewSubScope("AllReduce");
+  std::vector<Scope> scopes;
+  for (int i = 0; i < num_devices; ++i) {
+    const Output& input = inputs[i];
+    if (input.type() != dtype) {
+      return errors::InvalidArgument(
+          "AllReduce inputs must have the same dtype, got ",
+          DataTypeString(dtype), " and ", DataTypeString(input.type()));
+    }
+    const string& device = input.node()->def().device();
+    if (device.empty()) {
+      return errors::InvalidArgument("AllReduce input ", input.name(),
+                                     " is not assigned to a device");
+    }
+    scopes.push_back(all_reduce.NewSubScope(strings::StrCat("device_", i))
+                         .WithDevice(device));
+  }
+
+  outputs->clear();
+  if (num_devices == 1) {
+    outputs->push_back(ops::Identity(scopes[0], inputs[0]));
+    return scope.status();
+  }
+
+  const int num_chunks = num_devices * options.num_subchunks;
+  DeviceChunks chunks;
+  for (int i = 0; i < num_devices; ++i) {
+    chunks.push_back(SplitInput(scopes[i], inputs[i], num_chunks));
+  }
+  TF_RETURN_IF_ERROR(scope.status());
+  if (options.algorithm == AllReduceOptions::RING) {
+    RingAllReduce(scopes, options, &chunks);
+  } else {
+    HalvingDoublingAllReduce(scopes, options, &chunks);
+  }
+  for (int i = 0; i < num_devices; ++i) {
+    outputs->push_back(JoinOutput(scopes[i], inputs[i], chunks[i]));
+  }
+  return scope.status();
+}
+
+}  // namespace tensorflow
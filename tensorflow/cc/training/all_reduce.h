@@ -0,0 +1,72 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_CC_TRAINING_ALL_REDUCE_H_
+#define THIRD_PARTY_TENSORFLOW_CC_TRAINING_ALL_REDUCE_H_
+
+#include <vector>
+
+#include "tensorflow/cc/framework/ops.h"
+#include "tensorflow/cc/framework/scope.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+
+/// Options for AllReduce.
+struct AllReduceOptions {
+  enum Algorithm {
+    /// Each device sends and receives 2 * (N - 1) / N of the data, in
+    /// 2 * (N - 1) steps.  Works for any number of devices N.
+    RING,
+    /// Each device sends and receives the same amount of data as with RING,
+    /// but in 2 * log2(N) steps.  The number of devices must be a power of 2.
+    RECURSIVE_HALVING_DOUBLING,
+  };
+  enum Reduction { SUM, MEAN };
+
+  Algorithm algorithm = RING;
+  /// MEAN divides the sum by the number of devices, which truncates for
+  /// integer types.
+  Reduction reduction = SUM;
+  /// The data of each device is split into this many chunks per device, and
+  /// the chunks are reduced independently, so that the transfer of one chunk
+  /// overlaps with the transfer and the addition of the others.
+  int num_subchunks = 1;
+};
+
+/// Adds to the graph of `scope` the ops that all-reduce `inputs`. Each input
+/// must have a device assigned to it, e.g. through Scope::WithDevice. The
+/// inputs must also all have the same shape and a dtype of half, float, double,
+/// int32 or int64. On success, `outputs` holds the reduced value for each input
+/// in the same order, and each output is placed on the device of its input.
+///
+/// The reduction only uses ordinary ops placed on the devices of the inputs,
+/// so the data sent between the devices of different tasks goes over the
+/// usual Send/Recv transport between workers. This makes it suitable for
+/// synchronous data-parallel training on CPU clusters without parameter
+/// servers.
+///
+/// Example:
+///
+///     std::vector<Output> grads;  // One per task, each on /task:i/cpu:0.
+///     std::vector<Output> summed;
+///     TF_CHECK_OK(AllReduce(scope, grads, AllReduceOptions(), &summed));
+Status AllReduce(const Scope& scope, const std::vector<Output>& inputs,
+                 const AllReduceOptions& options,
+                 std::vector<Output>* outputs);
+
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_CC_TRAINING_ALL_REDUCE_H_
@@ -0,0 +1,227 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/cc/training/all_reduce.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/cc/client/client_session.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the tensor of "shape" whose elements are "scale" * [1, 2, ...].
+template <typename T>
+Tensor Iota(const TensorShape& shape, int scale) {
+  Tensor t(DataTypeToEnum<T>::value, shape);
+  auto flat = t.flat<T>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = static_cast<T>(scale * (i + 1));
+  }
+  return t;
+}
+
+// All-reduces Iota(shape, i + 1) placed on devices[i] for each device, and
+// checks that every device gets Iota(shape, expected_scale).
+template <typename T>
+void TestAllReduce(const SessionOptions& session_options,
+                   const std::vector<string>& devices,
+                   const TensorShape& shape, const AllReduceOptions& options,
+                   int expected_scale) {
+  // Keeps the constant inputs from being folded into the outputs.
+  SessionOptions unoptimized = session_options;
+  unoptimized.config.mutable_graph_options()
+      ->mutable_optimizer_options()
+      ->set_opt_level(OptimizerOptions::L0);
+  Scope root = Scope::NewRootScope();
+  std::vector<Output> inputs;
+  for (int i = 0; i < devices.size(); ++i) {
+    inputs.push_back(ops::Const(root.WithDevice(devices[i]),
+                                Input::Initializer(Iota<T>(shape, i + 1))));
+  }
+  std::vector<Output> reduced;
+  TF_ASSERT_OK(AllReduce(root, inputs, options, &reduced));
+  ASSERT_EQ(devices.size(), reduced.size());
+  for (int i = 0; i < devices.size(); ++i) {
+    EXPECT_EQ(devices[i], reduced[i].node()->def().device());
+  }
+
+  ClientSession session(root, unoptimized);
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session.Run(reduced, &outputs));
+  const Tensor expected = Iota<T>(shape, expected_scale);
+  for (const Tensor& output : outputs) {
+    test::ExpectTensorEqual<T>(expected, output);
+  }
+}
+
+AllReduceOptions Options(AllReduceOptions::Algorithm algorithm,
+                         AllReduceOptions::Reduction reduction,
+                         int num_subchunks) {
+  AllReduceOptions options;
+  options.algorithm = algorithm;
+  options.reduction = reduction;
+  options.num_subchunks = num_subchunks;
+  return options;
+}
+
+class AllReduceTest : public ::testing::Test {
+ protected:
+  AllReduceTest() {
+    (*session_options_.config.mutable_device_count())["CPU"] = 4;
+  }
+
+  // Returns the names of the first "n" local CPU devices.
+  static std::vector<string> Devices(int n) {
+    std::vector<string> devices;
+    for (int i = 0; i < n; ++i) {
+      devices.push_back(strings::StrCat("/cpu:", i));
+    }
+    return devices;
+  }
+
+  SessionOptions session_options_;
+};
+
+TEST_F(AllReduceTest, Ring) {
+  for (int num_devices = 1; num_devices <= 4; ++num_devices) {
+    for (int num_subchunks : {1, 3}) {
+      // 1 + 2 + ... + num_devices
+      const int sum = num_devices * (num_devices + 1) / 2;
+      TestAllReduce<float>(
+          session_options_, Devices(num_devices), TensorShape({2, 5}),
+          Options(AllReduceOptions::RING, AllReduceOptions::SUM, num_subchunks),
+          sum);
+    }
+  }
+}
+
+TEST_F(AllReduceTest, RecursiveHalvingDoubling) {
+  for (int num_devices : {1, 2, 4}) {
+    for (int num_subchunks : {1, 2}) {
+      const int sum = num_devices * (num_devices + 1) / 2;
+      TestAllReduce<float>(
+          session_options_, Devices(num_devices), TensorShape({7}),
+          Options(AllReduceOptions::RECURSIVE_HALVING_DOUBLING,
+                  AllReduceOptions::SUM, num_subchunks),
+          sum);
+    }
+  }
+}
+
+TEST_F(AllReduceTest, Mean) {
+  // The sum of 1 to 3 is divisible by 3, so the mean is exact.
+  TestAllReduce<float>(
+      session_options_, Devices(3), TensorShape({4, 4}),
+      Options(AllReduceOptions::RING, AllReduceOptions::MEAN, 2), 2);
+  TestAllReduce<int32>(
+      session_options_, Devices(3), TensorShape({5}),
+      Options(AllReduceOptions::RING, AllReduceOptions::MEAN, 1), 2);
+  // 1 + 2 + 3 + 4 = 10 is not, and the mean of integers is truncated.
+  TestAllReduce<int64>(session_options_, Devices(4), TensorShape({1}),
+                       Options(AllReduceOptions::RECURSIVE_HALVING_DOUBLING,
+                               AllReduceOptions::MEAN, 1),
+                       2);
+}
+
+TEST_F(AllReduceTest, DataTypes) {
+  const AllReduceOptions options;
+  TestAllReduce<Eigen::half>(session_options_, Devices(2), TensorShape({6}),
+                             options, 3);
+  TestAllReduce<double>(session_options_, Devices(3), TensorShape({6}),
+                        options, 6);
+  TestAllReduce<int32>(session_options_, Devices(4), TensorShape({2, 2}),
+                       options, 10);
+  TestAllReduce<int64>(session_options_, Devices(4), TensorShape({2, 2}),
+                       options, 10);
+}
+
+TEST_F(AllReduceTest, SmallTensors) {
+  // Fewer elements than chunks, and no elements at all.
+  for (const TensorShape& shape :
+       {TensorShape({}), TensorShape({2}), TensorShape({0, 3})}) {
+    TestAllReduce<float>(
+        session_options_, Devices(4), shape,
+        Options(AllReduceOptions::RING, AllReduceOptions::SUM, 2), 10);
+  }
+}
+
+TEST_F(AllReduceTest, InvalidInputs) {
+  Scope root = Scope::NewRootScope();
+  auto a = ops::Const(root.WithDevice("/cpu:0"), {1.0f, 2.0f});
+  auto b = ops::Const(root.WithDevice("/cpu:1"), {1.0f, 2.0f});
+  auto c = ops::Const(root.WithDevice("/cpu:2"), {1.0f, 2.0f});
+  std::vector<Output> outputs;
+  AllReduceOptions options;
+
+  EXPECT_FALSE(AllReduce(root, {}, options, &outputs).ok());
+
+  options.num_subchunks = 0;
+  EXPECT_FALSE(AllReduce(root, {a, b}, options, &outputs).ok());
+
+  options = AllReduceOptions();
+  options.algorithm = AllReduceOptions::RECURSIVE_HALVING_DOUBLING;
+  EXPECT_FALSE(AllReduce(root, {a, b, c}, options, &outputs).ok());
+
+  options = AllReduceOptions();
+  auto no_device = ops::Const(root, {1.0f, 2.0f});
+  EXPECT_FALSE(AllReduce(root, {a, no_device}, options, &outputs).ok());
+
+  auto int_input = ops::Const(root.WithDevice("/cpu:1"), {1, 2});
+  EXPECT_FALSE(AllReduce(root, {a, int_input}, options, &outputs).ok());
+
+  auto bool_a = ops::Const(root.WithDevice("/cpu:0"), {true});
+  auto bool_b = ops::Const(root.WithDevice("/cpu:1"), {false});
+  EXPECT_FALSE(AllReduce(root, {bool_a, bool_b}, options, &outputs).ok());
+}
+
+TEST(AllReduceGrpcTest, ReducesAcrossTasks) {
+  SessionOptions session_options;
+  (*session_options.config.mutable_device_count())["CPU"] = 1;
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_ASSERT_OK(
+      test::TestCluster::MakeTestCluster(session_options, 4, &cluster));
+  session_options.target = cluster->targets()[0];
+  std::vector<string> devices;
+  for (const DeviceAttributes& device : cluster->devices()) {
+    devices.push_back(device.name());
+  }
+  ASSERT_EQ(4, devices.size());
+
+  TestAllReduce<float>(
+      session_options, devices, TensorShape({100, 10}),
+      Options(AllReduceOptions::RING, AllReduceOptions::SUM, 4), 10);
+  TestAllReduce<int32>(
+      session_options, {devices[0], devices[1], devices[2]},
+      TensorShape({33}),
+      Options(AllReduceOptions::RING, AllReduceOptions::MEAN, 1), 2);
+  TestAllReduce<float>(session_options, devices, TensorShape({1000}),
+                       Options(AllReduceOptions::RECURSIVE_HALVING_DOUBLING,
+                               AllReduceOptions::SUM, 2),
+                       10);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,430 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/batching_session.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+
+namespace {
+
+// A Run() call that waits to be run as part of a batch.  Owned by the
+// calling thread, which blocks until the batch has run.
+struct BatchTask {
+  // The feeds of the call, sorted by name.
+  std::vector<std::pair<string, Tensor>> inputs;
+
+  // The number of examples, i.e. the 0th dimension of every feed.
+  int64 size = 0;
+
+  std::vector<Tensor>* outputs = nullptr;
+  Status status;
+  // Set if the batch turned out not to be batchable, in which case the
+  // call runs alone once notified.
+  bool rerun_alone = false;
+  Notification done;
+};
+
+// The calls that are run together in one step.
+struct Batch {
+  std::vector<BatchTask*> tasks;
+  int64 size = 0;
+
+  // Set once no more calls may join the batch.
+  bool closed = false;
+};
+
+// Whether the calls with one signature may be batched, which depends on
+// whether their fetches have one row per example.  This is learned from the
+// first call, which runs alone; the calls made meanwhile run alone as well.
+enum class Batchable { kUnknown, kProbing, kYes, kNo };
+
+// The calls with one signature that wait for their batch to be run.  The
+// first call of a batch is its leader: it waits for the batch to fill up or
+// time out, runs it, and hands the results to the other calls.
+struct BatchQueue {
+  mutex mu;
+  condition_variable cv;
+  std::shared_ptr<Batch> open GUARDED_BY(mu);
+  Batchable batchable GUARDED_BY(mu) = Batchable::kUnknown;
+};
+
+// Returns true if each of "fetches" has "size" rows.
+bool HasOneRowPerExample(const std::vector<Tensor>& fetches, int64 size) {
+  for (const Tensor& fetch : fetches) {
+    if (fetch.dims() == 0 || fetch.dim_size(0) != size) return false;
+  }
+  return true;
+}
+
+class BatchingSession : public Session {
+ public:
+  BatchingSession(const BatchingSessionOptions& options,
+                  std::unique_ptr<Session> wrapped)
+      : options_(options), wrapped_(std::move(wrapped)) {}
+
+  ~BatchingSession() override {}
+
+  Status Create(const GraphDef& graph) override {
+    return wrapped_->Create(graph);
+  }
+  Status Extend(const GraphDef& graph) override {
+    return wrapped_->Extend(graph);
+  }
+  Status Create(const RunOptions& run_options,
+                const GraphDef& graph) override {
+    return wrapped_->Create(run_options, graph);
+  }
+  Status Extend(const RunOptions& run_options,
+                const GraphDef& graph) override {
+    return wrapped_->Extend(run_options, graph);
+  }
+  Status Close(const RunOptions& run_options) override {
+    return wrapped_->Close(run_options);
+  }
+  Status Close() override { return wrapped_->Close(); }
+
+  Status Run(const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_tensor_names,
+             const std::vector<string>& target_node_names,
+             std::vector<Tensor>* outputs) override {
+    return Run(RunOptions(), inputs, output_tensor_names, target_node_names,
+               outputs, nullptr);
+  }
+
+  Status Run(const RunOptions& run_options,
+             const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_tensor_names,
+             const std::vector<string>& target_node_names,
+             std::vector<Tensor>* outputs, RunMetadata* run_metadata) override;
+
+  Status PRunSetup(const std::vector<string>& input_names,
+                   const std::vector<string>& output_names,
+                   const std::vector<string>& target_nodes,
+                   string* handle) override {
+    return wrapped_->PRunSetup(input_names, output_names, target_nodes,
+                               handle);
+  }
+
+  Status PRun(const string& handle,
+              const std::vector<std::pair<string, Tensor>>& inputs,
+              const std::vector<string>& output_names,
+              std::vector<Tensor>* outputs) override {
+    return wrapped_->PRun(handle, inputs, output_names, outputs);
+  }
+
+ private:
+  // Returns the queue for calls with "signature".
+  BatchQueue* GetQueue(const string& signature);
+
+  // Returns the size "batch_size" is padded to.
+  int64 PaddedBatchSize(int64 batch_size) const;
+
+  // Runs all the calls of "batch" in one step and notifies them.  If a
+  // fetch does not have one row per example, marks "queue" as unbatchable
+  // and has the calls run alone instead.
+  void RunBatch(const RunOptions& run_options,
+                const std::vector<string>& output_tensor_names,
+                const std::vector<string>& target_node_names, BatchQueue* queue,
+                Batch* batch);
+
+  const BatchingSessionOptions options_;
+  std::unique_ptr<Session> wrapped_;
+
+  mutex mu_;
+  std::unordered_map<string, std::unique_ptr<BatchQueue>> queues_
+      GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BatchingSession);
+};
+
+Status BatchingSession::Run(
+    const RunOptions& run_options,
+    const std::vector<std::pair<string, Tensor>>& inputs,
+    const std::vector<string>& output_tensor_names,
+    const std::vector<string>& target_node_names, std::vector<Tensor>* outputs,
+    RunMetadata* run_metadata) {
+  if (inputs.empty() || run_metadata != nullptr ||
+      run_options.trace_level() != RunOptions::NO_TRACE) {
+    return wrapped_->Run(run_options, inputs, output_tensor_names,
+                         target_node_names, outputs, run_metadata);
+  }
+
+  // Calls that feed the same tensors in a different order share a batch.
+  BatchTask task;
+  task.inputs = inputs;
+  std::sort(task.inputs.begin(), task.inputs.end(),
+            [](const std::pair<string, Tensor>& a,
+               const std::pair<string, Tensor>& b) {
+              return a.first < b.first;
+            });
+
+  // The signature covers the feeds' names, types and per-example shapes, so
+  // that the feeds of all the calls of a batch can be concatenated.
+  string signature;
+  int64 size = -1;
+  for (const auto& input : task.inputs) {
+    const Tensor& t = input.second;
+    if (t.dims() == 0) {
+      return wrapped_->Run(run_options, inputs, output_tensor_names,
+                           target_node_names, outputs, run_metadata);
+    }
+    if (size < 0) {
+      size = t.dim_size(0);
+    } else if (t.dim_size(0) != size) {
+      // Some feed, e.g. a vocabulary, is not per example.
+      return wrapped_->Run(run_options, inputs, output_tensor_names,
+                           target_node_names, outputs, run_metadata);
+    }
+    TensorShape example_shape = t.shape();
+    example_shape.RemoveDim(0);
+    strings::StrAppend(&signature, input.first, ":",
+                       DataTypeString(t.dtype()), example_shape.DebugString(),
+                       ";");
+  }
+  if (size == 0 || size > options_.max_batch_size) {
+    return wrapped_->Run(run_options, inputs, output_tensor_names,
+                         target_node_names, outputs, run_metadata);
+  }
+  strings::StrAppend(&signature, "->",
+                     str_util::Join(output_tensor_names, ","), "/",
+                     str_util::Join(target_node_names, ","), "/",
+                     run_options.SerializeAsString());
+  task.size = size;
+  task.outputs = outputs;
+
+  BatchQueue* queue = GetQueue(signature);
+  bool run_alone = false;
+  bool probe = false;
+  {
+    mutex_lock l(queue->mu);
+    if (queue->batchable == Batchable::kUnknown) {
+      queue->batchable = Batchable::kProbing;
+      probe = true;
+    }
+    run_alone = (queue->batchable != Batchable::kYes);
+  }
+  if (run_alone) {
+    std::vector<Tensor> alone_outputs;
+    Status s = wrapped_->Run(run_options, inputs, output_tensor_names,
+                             target_node_names, &alone_outputs, run_metadata);
+    if (probe) {
+      mutex_lock l(queue->mu);
+      if (!s.ok()) {
+        queue->batchable = Batchable::kUnknown;
+      } else if (HasOneRowPerExample(alone_outputs, size)) {
+        queue->batchable = Batchable::kYes;
+      } else {
+        queue->batchable = Batchable::kNo;
+      }
+    }
+    if (outputs != nullptr) *outputs = std::move(alone_outputs);
+    return s;
+  }
+
+  std::shared_ptr<Batch> batch;
+  bool is_leader = false;
+  {
+    mutex_lock l(queue->mu);
+    if (queue->open != nullptr &&
+        queue->open->size + size > options_.max_batch_size) {
+      // Run the open batch now; this call starts the next one.
+      queue->open->closed = true;
+      queue->open = nullptr;
+      queue->cv.notify_all();
+    }
+    if (queue->open == nullptr) {
+      queue->open = std::make_shared<Batch>();
+      is_leader = true;
+    }
+    batch = queue->open;
+    batch->tasks.push_back(&task);
+    batch->size += size;
+    if (batch->size == options_.max_batch_size) {
+      batch->closed = true;
+      queue->open = nullptr;
+      queue->cv.notify_all();
+    }
+  }
+
+  if (!is_leader) {
+    task.done.WaitForNotification();
+  } else {
+    {
+      mutex_lock l(queue->mu);
+      const uint64 deadline =
+          options_.env->NowMicros() + options_.batch_timeout_micros;
+      while (!batch->closed) {
+        const uint64 now = options_.env->NowMicros();
+        if (now >= deadline) break;
+        WaitForMilliseconds(&l, &queue->cv, (deadline - now + 999) / 1000);
+      }
+      if (queue->open == batch) {
+        queue->open = nullptr;
+      }
+      batch->closed = true;
+    }
+    RunBatch(run_options, output_tensor_names, target_node_names, queue,
+             batch.get());
+  }
+  if (task.rerun_alone) {
+    return wrapped_->Run(run_options, inputs, output_tensor_names,
+                         target_node_names, outputs, nullptr);
+  }
+  return task.status;
+}
+
+BatchQueue* BatchingSession::GetQueue(const string& signature) {
+  mutex_lock l(mu_);
+  std::unique_ptr<BatchQueue>& queue = queues_[signature];
+  if (queue == nullptr) {
+    queue.reset(new BatchQueue);
+  }
+  return queue.get();
+}
+
+int64 BatchingSession::PaddedBatchSize(int64 batch_size) const {
+  for (int allowed : options_.allowed_batch_sizes) {
+    if (allowed >= batch_size) return allowed;
+  }
+  return batch_size;
+}
+
+void BatchingSession::RunBatch(const RunOptions& run_options,
+                               const std::vector<string>& output_tensor_names,
+                               const std::vector<string>& target_node_names,
+                               BatchQueue* queue, Batch* batch) {
+  const std::vector<BatchTask*>& tasks = batch->tasks;
+  const int64 padded_size = PaddedBatchSize(batch->size);
+  const int64 padding = padded_size - batch->size;
+  Status s;
+
+  // Concatenate the feeds, padding with copies of the first example.
+  const int num_inputs = tasks[0]->inputs.size();
+  std::vector<std::pair<string, Tensor>> batched_inputs(num_inputs);
+  for (int i = 0; i < num_inputs && s.ok(); ++i) {
+    std::vector<Tensor> parts;
+    parts.reserve(tasks.size() + padding);
+    for (const BatchTask* task : tasks) {
+      parts.push_back(task->inputs[i].second);
+    }
+    if (padding > 0) {
+      const Tensor first_example = parts[0].Slice(0, 1);
+      parts.insert(parts.end(), padding, first_example);
+    }
+    batched_inputs[i].first = tasks[0]->inputs[i].first;
+    s = tensor::Concat(parts, &batched_inputs[i].second);
+  }
+
+  std::vector<Tensor> batched_outputs;
+  if (s.ok()) {
+    s = wrapped_->Run(run_options, batched_inputs, output_tensor_names,
+                      target_node_names, &batched_outputs, nullptr);
+  }
+
+  // Split every fetch back into one piece per call.
+  std::vector<int64> sizes;
+  sizes.reserve(tasks.size() + 1);
+  for (const BatchTask* task : tasks) {
+    sizes.push_back(task->size);
+    if (task->outputs != nullptr) task->outputs->clear();
+  }
+  if (padding > 0) sizes.push_back(padding);
+  if (s.ok() && !HasOneRowPerExample(batched_outputs, padded_size)) {
+    // The probe misjudged a fetch, e.g. one of shape [1], as having one row
+    // per example.  The calls of this batch, and those that follow, are run
+    // alone.
+    VLOG(1) << "Fetches of a batch of " << padded_size
+            << " examples do not have one row per example; running the "
+            << tasks.size() << " calls alone";
+    {
+      mutex_lock l(queue->mu);
+      queue->batchable = Batchable::kNo;
+    }
+    for (BatchTask* task : tasks) {
+      task->rerun_alone = true;
+      task->done.Notify();
+    }
+    return;
+  }
+  for (size_t i = 0; i < batched_outputs.size() && s.ok(); ++i) {
+    std::vector<Tensor> pieces;
+    s = tensor::Split(batched_outputs[i], sizes, &pieces);
+    if (!s.ok()) break;
+    for (size_t j = 0; j < tasks.size(); ++j) {
+      if (tasks[j]->outputs != nullptr) {
+        tasks[j]->outputs->push_back(std::move(pieces[j]));
+      }
+    }
+  }
+
+  VLOG(2) << "Ran batch of " << tasks.size() << " calls with "
+          << batch->size << " examples padded to " << padded_size << ": " << s;
+  for (BatchTask* task : tasks) {
+    task->status = s;
+    task->done.Notify();
+  }
+}
+
+}  // namespace
+
+Status NewBatchingSession(const BatchingSessionOptions& options,
+                          std::unique_ptr<Session> session,
+                          std::unique_ptr<Session>* batching_session) {
+  if (options.max_batch_size <= 0) {
+    return errors::InvalidArgument("max_batch_size must be positive, got ",
+                                   options.max_batch_size);
+  }
+  if (options.batch_timeout_micros < 0) {
+    return errors::InvalidArgument(
+        "batch_timeout_micros must not be negative, got ",
+        options.batch_timeout_micros);
+  }
+  if (!options.allowed_batch_sizes.empty()) {
+    int prev = 0;
+    for (int allowed : options.allowed_batch_sizes) {
+      if (allowed <= prev) {
+        return errors::InvalidArgument(
+            "allowed_batch_sizes must be positive and strictly increasing");
+      }
+      prev = allowed;
+    }
+    if (prev != options.max_batch_size) {
+      return errors::InvalidArgument(
+          "The last entry of allowed_batch_sizes (", prev,
+          ") must equal max_batch_size (", options.max_batch_size, ")");
+    }
+  }
+  batching_session->reset(new BatchingSession(options, std::move(session)));
+  return Status::OK();
+}
+
+}  // namespace tensorflow
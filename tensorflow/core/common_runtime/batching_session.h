@@ -0,0 +1,75 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_BATCHING_SESSION_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_BATCHING_SESSION_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+
+struct BatchingSessionOptions {
+  // The largest number of examples (the sum of the 0th dimensions of the
+  // requests' feeds) that is run in one step.  A request that is larger than
+  // this on its own is run unbatched.
+  int max_batch_size = 32;
+
+  // How long the first request of a batch waits for more requests to join
+  // it before the batch is run, in microseconds.
+  int64 batch_timeout_micros = 1000;
+
+  // If non-empty, the batch sizes the wrapped session is run with, in
+  // increasing order.  A batch is padded up to the smallest allowed size
+  // that holds it, by repeating its first example, so that the graph sees
+  // only a few distinct shapes.  The last element must equal
+  // max_batch_size.
+  std::vector<int> allowed_batch_sizes;
+
+  // Used to read the clock and wait for timeouts.  Not owned.
+  Env* env = Env::Default();
+};
+
+// Creates a session that runs the concurrent Run() calls made on it in
+// batches.  Calls that feed and fetch the same tensors and run the same
+// targets are queued together; their feeds are concatenated along the 0th
+// dimension, the wrapped session is run once, and every fetched tensor is
+// split along its 0th dimension and returned to the callers.
+//
+// A call is only batched if all its feeds have at least one dimension and
+// the same 0th dimension, which is the number of examples in the call.  The
+// first call with given feeds, fetches and targets runs alone, and the later
+// ones are only batched if all its fetches had one row per example;
+// otherwise, e.g. if it fetches a scalar, they all run alone.  If a batch
+// then has a fetch without one row per example, its calls are run again
+// alone, as are the later ones.  Calls without feeds, with scalar feeds or
+// feeds with different 0th dimensions, or which request RunMetadata or
+// tracing, are passed through to the wrapped session unchanged, as are
+// partial runs.
+//
+// Takes ownership of "session".  On success, the caller owns
+// "*batching_session".
+Status NewBatchingSession(const BatchingSessionOptions& options,
+                          std::unique_ptr<Session> session,
+                          std::unique_ptr<Session>* batching_session);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_BATCHING_SESSION_H_
@@ -0,0 +1,290 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/batching_session.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+// Forwards to a real session and records the number of rows fed to each
+// step.
+class RecordingSession : public Session {
+ public:
+  explicit RecordingSession(Session* wrapped) : wrapped_(wrapped) {}
+
+  Status Create(const GraphDef& graph) override {
+    return wrapped_->Create(graph);
+  }
+  Status Extend(const GraphDef& graph) override {
+    return wrapped_->Extend(graph);
+  }
+  Status Close() override { return wrapped_->Close(); }
+
+  Status Run(const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_tensor_names,
+             const std::vector<string>& target_node_names,
+             std::vector<Tensor>* outputs) override {
+    return Run(RunOptions(), inputs, output_tensor_names, target_node_names,
+               outputs, nullptr);
+  }
+
+  Status Run(const RunOptions& run_options,
+             const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_tensor_names,
+             const std::vector<string>& target_node_names,
+             std::vector<Tensor>* outputs, RunMetadata* run_metadata) override {
+    {
+      mutex_lock l(mu_);
+      step_sizes_.push_back(inputs.empty() ? 0 : inputs[0].second.dim_size(0));
+    }
+    return wrapped_->Run(run_options, inputs, output_tensor_names,
+                         target_node_names, outputs, run_metadata);
+  }
+
+  std::vector<int64> step_sizes() {
+    mutex_lock l(mu_);
+    return step_sizes_;
+  }
+
+ private:
+  std::unique_ptr<Session> wrapped_;
+  mutex mu_;
+  std::vector<int64> step_sizes_ GUARDED_BY(mu_);
+};
+
+class BatchingSessionTest : public ::testing::Test {
+ protected:
+  // Creates batching_session_ running y = -x, with x of shape [?, 2], and
+  // holding a scalar z and a vector w of shape [1].
+  void Initialize(const BatchingSessionOptions& options) {
+    Graph graph(OpRegistry::Global());
+    Tensor x_tensor(DT_FLOAT, TensorShape({1, 2}));
+    test::FillValues<float>(&x_tensor, {0, 0});
+    Node* x = test::graph::Constant(&graph, x_tensor);
+    x_ = x->name();
+    Node* y = test::graph::Unary(&graph, "Neg", x);
+    y_ = strings::StrCat(y->name(), ":0");
+    Tensor z_tensor(DT_FLOAT, TensorShape({}));
+    z_tensor.scalar<float>()() = 42;
+    Node* z = test::graph::Constant(&graph, z_tensor);
+    z_ = strings::StrCat(z->name(), ":0");
+    Node* w = test::graph::Constant(&graph, test::AsTensor<float>({7}));
+    w_ = strings::StrCat(w->name(), ":0");
+    GraphDef def;
+    test::graph::ToGraphDef(&graph, &def);
+
+    recording_ = new RecordingSession(NewSession(SessionOptions()));
+    TF_ASSERT_OK(NewBatchingSession(
+        options, std::unique_ptr<Session>(recording_), &batching_session_));
+    TF_ASSERT_OK(batching_session_->Create(def));
+  }
+
+  // Feeds "rows" examples with value "value" and checks the result.
+  void RunAndCheck(int rows, float value) {
+    Tensor x(DT_FLOAT, TensorShape({rows, 2}));
+    x.flat<float>().setConstant(value);
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(batching_session_->Run({{x_, x}}, {y_}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    Tensor expected(DT_FLOAT, TensorShape({rows, 2}));
+    expected.flat<float>().setConstant(-value);
+    test::ExpectTensorEqual<float>(expected, outputs[0]);
+  }
+
+  string x_;
+  string y_;
+  string z_;
+  string w_;
+  RecordingSession* recording_ = nullptr;  // Owned by batching_session_.
+  std::unique_ptr<Session> batching_session_;
+};
+
+TEST_F(BatchingSessionTest, SingleCall) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 4;
+  options.batch_timeout_micros = 0;
+  Initialize(options);
+  RunAndCheck(3, 7.0);
+  EXPECT_EQ(std::vector<int64>({3}), recording_->step_sizes());
+}
+
+TEST_F(BatchingSessionTest, ConcurrentCallsAreBatched) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 4;
+  // Long enough for all the calls to join the first batch, which is run as
+  // soon as it is full.
+  options.batch_timeout_micros = 60 * 1000 * 1000;
+  Initialize(options);
+  // The first call runs alone.
+  RunAndCheck(2, 1.0);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 4);
+    for (int i = 0; i < 4; ++i) {
+      pool.Schedule([this, i]() { RunAndCheck(1, i); });
+    }
+  }
+  EXPECT_EQ(std::vector<int64>({2, 4}), recording_->step_sizes());
+}
+
+TEST_F(BatchingSessionTest, OverflowingCallStartsNewBatch) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 4;
+  options.batch_timeout_micros = 100 * 1000;
+  Initialize(options);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 2);
+    pool.Schedule([this]() { RunAndCheck(3, 1.0); });
+    pool.Schedule([this]() { RunAndCheck(2, 2.0); });
+  }
+  std::vector<int64> step_sizes = recording_->step_sizes();
+  std::sort(step_sizes.begin(), step_sizes.end());
+  EXPECT_EQ(std::vector<int64>({2, 3}), step_sizes);
+}
+
+TEST_F(BatchingSessionTest, PadsToAllowedBatchSize) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 8;
+  options.allowed_batch_sizes = {2, 4, 8};
+  options.batch_timeout_micros = 0;
+  Initialize(options);
+  // The first call runs alone, without padding.
+  RunAndCheck(3, 4.0);
+  RunAndCheck(3, 5.0);
+  RunAndCheck(1, 6.0);
+  EXPECT_EQ(std::vector<int64>({3, 4, 2}), recording_->step_sizes());
+}
+
+TEST_F(BatchingSessionTest, CallsFetchingScalarRunAlone) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 4;
+  options.batch_timeout_micros = 0;
+  Initialize(options);
+  for (int i = 0; i < 3; ++i) {
+    Tensor x(DT_FLOAT, TensorShape({1, 2}));
+    x.flat<float>().setConstant(i);
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(batching_session_->Run({{x_, x}}, {y_, z_}, {}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    EXPECT_EQ(42, outputs[1].scalar<float>()());
+  }
+  EXPECT_EQ(std::vector<int64>({1, 1, 1}), recording_->step_sizes());
+}
+
+TEST_F(BatchingSessionTest, BatchedCallWithoutOutputs) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 4;
+  options.batch_timeout_micros = 0;
+  Initialize(options);
+  RunAndCheck(1, 1.0);
+  Tensor x(DT_FLOAT, TensorShape({2, 2}));
+  x.flat<float>().setZero();
+  TF_EXPECT_OK(batching_session_->Run({{x_, x}}, {y_}, {}, nullptr));
+  EXPECT_EQ(std::vector<int64>({1, 2}), recording_->step_sizes());
+}
+
+TEST_F(BatchingSessionTest, LargeCallIsNotBatched) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 2;
+  options.batch_timeout_micros = 0;
+  Initialize(options);
+  RunAndCheck(5, 1.0);
+  EXPECT_EQ(std::vector<int64>({5}), recording_->step_sizes());
+}
+
+TEST_F(BatchingSessionTest, MisjudgedFetchRunsBatchAlone) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 2;
+  options.batch_timeout_micros = 60 * 1000 * 1000;
+  Initialize(options);
+  // The probe with one example takes w, of shape [1], for a per-example
+  // fetch.
+  auto run = [this](float value) {
+    Tensor x(DT_FLOAT, TensorShape({1, 2}));
+    x.flat<float>().setConstant(value);
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(batching_session_->Run({{x_, x}}, {y_, w_}, {}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({-value, -value}, {1, 2}), outputs[0]);
+    test::ExpectTensorEqual<float>(test::AsTensor<float>({7}), outputs[1]);
+  };
+  run(1.0);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 2);
+    pool.Schedule([&run]() { run(2.0); });
+    pool.Schedule([&run]() { run(3.0); });
+  }
+  // The batch was run again one call at a time, and so is the next call.
+  run(4.0);
+  EXPECT_EQ(std::vector<int64>({1, 2, 1, 1, 1}), recording_->step_sizes());
+}
+
+TEST_F(BatchingSessionTest, FeedsWithOtherRowCountsAreNotBatched) {
+  BatchingSessionOptions options;
+  options.max_batch_size = 4;
+  options.batch_timeout_micros = 0;
+  Initialize(options);
+  // z is fed a tensor that is not per example.
+  Tensor x(DT_FLOAT, TensorShape({1, 2}));
+  x.flat<float>().setConstant(1.0);
+  Tensor z(DT_FLOAT, TensorShape({5}));
+  z.flat<float>().setZero();
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(batching_session_->Run({{x_, x}, {z_, z}}, {y_}, {}, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({-1, -1}, {1, 2}),
+                                 outputs[0]);
+  EXPECT_EQ(std::vector<int64>({1}), recording_->step_sizes());
+}
+
+TEST(BatchingSessionOptionsTest, Validation) {
+  std::unique_ptr<Session> batching_session;
+  BatchingSessionOptions options;
+  options.max_batch_size = 0;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      NewBatchingSession(options, nullptr, &batching_session)));
+
+  options.max_batch_size = 8;
+  options.allowed_batch_sizes = {4, 2, 8};
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      NewBatchingSession(options, nullptr, &batching_session)));
+
+  options.allowed_batch_sizes = {2, 4};
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      NewBatchingSession(options, nullptr, &batching_session)));
+
+  options.allowed_batch_sizes = {2, 4, 8};
+  TF_EXPECT_OK(NewBatchingSession(options, nullptr, &batching_session));
+}
+
+}  // namespace
+}  // namespace tensorflow
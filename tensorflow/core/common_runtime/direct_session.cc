@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/direct_session.h"
 
+#include <algorithm>
 #include <atomic>
 #include <string>
 #include <vector>
@@ -55,6 +56,7 @@ limitations under the License.
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/device_name_utils.h"
 
@@ -103,6 +105,46 @@ thread::ThreadPool* GlobalThreadPool(const SessionOptions& options) {
   return thread_pool;
 }
 
+// Returns true if 'options' asks for NUMA-local inter-op thread-pools, and
+// the host has more than one NUMA node.
+bool UseNUMAThreadPools(const SessionOptions& options) {
+  return options.config.use_numa_affinity() &&
+         options.config.session_inter_op_thread_pool_size() == 0 &&
+         port::NUMAEnabled();
+}
+
+// Creates one inter-op thread-pool per NUMA node, with threads pinned to
+// that node.  inter_op_parallelism_threads, if set, is split evenly among
+// the nodes.
+std::vector<thread::ThreadPool*> NewNUMAThreadPools(
+    const SessionOptions& options) {
+  std::vector<thread::ThreadPool*> pools;
+  const int num_nodes = port::NUMANumNodes();
+  for (int node = 0; node < num_nodes; ++node) {
+    int32 num_threads = options.config.inter_op_parallelism_threads();
+    if (num_threads == 0) {
+      num_threads = port::NUMANumSchedulableCPUs(node);
+    } else {
+      num_threads = std::max(1, num_threads / num_nodes);
+    }
+    VLOG(1) << "Direct session inter op parallelism threads for NUMA node "
+            << node << ": " << num_threads;
+    ThreadOptions thread_options;
+    thread_options.numa_node = node;
+    pools.push_back(new thread::ThreadPool(options.env, thread_options,
+                                           strings::StrCat("Compute_numa", node),
+                                           num_threads));
+  }
+  return pools;
+}
+
+const std::vector<thread::ThreadPool*>& GlobalNUMAThreadPools(
+    const SessionOptions& options) {
+  static const std::vector<thread::ThreadPool*>* const thread_pools =
+      new std::vector<thread::ThreadPool*>(NewNUMAThreadPools(options));
+  return *thread_pools;
+}
+
 // TODO(vrv): Figure out how to unify the many different functions
 // that generate RendezvousKey, since many of them have to be
 // consistent with each other.
@@ -220,6 +262,15 @@ void DirectSession::SchedClosure(thread::ThreadPool* pool,
 #endif  // __ANDROID__
 }
 
+thread::ThreadPool* DirectSession::PoolForPartition(
+    thread::ThreadPool* pool, const PerPartitionExecutorsAndLib& item) const {
+  if (item.numa_node < 0 ||
+      item.numa_node >= static_cast<int>(numa_thread_pools_.size())) {
+    return pool;
+  }
+  return numa_thread_pools_[item.numa_node];
+}
+
 DirectSession::DirectSession(const SessionOptions& options,
                              const DeviceMgr* device_mgr,
                              DirectSessionFactory* const factory)
@@ -237,15 +288,25 @@ DirectSession::DirectSession(const SessionOptions& options,
     owns_thread_pools_ = true;
   } else if (options_.config.use_per_session_threads()) {
     thread_pools_.push_back(NewThreadPoolFromSessionOptions(options_));
+    if (UseNUMAThreadPools(options_)) {
+      numa_thread_pools_ = NewNUMAThreadPools(options_);
+    }
     owns_thread_pools_ = true;
   } else {
     thread_pools_.push_back(GlobalThreadPool(options));
+    if (UseNUMAThreadPools(options_)) {
+      numa_thread_pools_ = GlobalNUMAThreadPools(options_);
+    }
     owns_thread_pools_ = false;
   }
   // NOTE(mrry): We do not need to use a unique string for the session
   // handle, because DirectSession owns its devices. This may change
   // in future versions.
   session_handle_ = "direct";
+  if (!options_.config.graph_options().graph_cache_dir().empty()) {
+    graph_cache_.reset(new GraphCache(
+        options_.env, options_.config.graph_options().graph_cache_dir()));
+  }
   int devices_added = 0;
   if (options.config.log_device_placement()) {
     const string mapping_str = device_mgr_->DeviceMappingString();
@@ -284,6 +345,7 @@ DirectSession::~DirectSession() {
   delete cancellation_manager_;
   if (owns_thread_pools_) {
     for (auto* p : thread_pools_) delete p;
+    for (auto* p : numa_thread_pools_) delete p;
   }
 
   execution_state_.reset(nullptr);
@@ -305,6 +367,9 @@ Status DirectSession::MaybeInitializeExecutionState(
   SimpleGraphExecutionStateOptions options;
   options.device_set = &device_set_;
   options.session_options = &options_;
+  // With a graph cache, the full graph is only placed when a step misses
+  // the cache.
+  options.defer_base_graph = (graph_cache_ != nullptr);
   // TODO(mrry,suharshs): We explicitly copy `graph` so that
   // `MakeForBaseGraph()` can take ownership of its
   // contents. Previously this happened implicitly in calls to the
@@ -439,9 +504,6 @@ Status DirectSession::Run(const RunOptions& run_options,
 
   args.rendezvous = run_state.rendez;
   args.cancellation_manager = &step_cancellation_manager;
-  args.runner = [this, pool](Executor::Args::Closure c) {
-    SchedClosure(pool, std::move(c));
-  };
   args.session_state = &session_state_;
   args.tensor_store = &run_state.tensor_store;
   args.step_container = &run_state.step_container;
@@ -450,7 +512,9 @@ Status DirectSession::Run(const RunOptions& run_options,
   }
   args.sync_on_finish = true;
 
-  const bool do_trace = (run_options.trace_level() > RunOptions::NO_TRACE);
+  const bool do_trace = (run_options.trace_level() > RunOptions::NO_TRACE) &&
+                        ShouldTraceStep(run_options, args.step_id,
+                                        &trace_step_counter_);
 
   bool update_cost_model = false;
   if (options_.config.graph_options().build_cost_model() > 0) {
@@ -465,14 +529,14 @@ Status DirectSession::Run(const RunOptions& run_options,
     }
   }
   if (do_trace || update_cost_model) {
-    run_state.collector.reset(
-        new StepStatsCollector(run_metadata->mutable_step_stats()));
+    run_state.collector.reset(new StepStatsCollector(
+        run_metadata->mutable_step_stats(), true /* buffered */));
     args.stats_collector = run_state.collector.get();
   }
 
 #if GOOGLE_CUDA
   std::unique_ptr<GPUTracer> tracer;
-  if (run_options.trace_level() >= RunOptions::HARDWARE_TRACE) {
+  if (do_trace && run_options.trace_level() >= RunOptions::HARDWARE_TRACE) {
     tracer.reset(CreateGPUTracer());
     // tracer will be NULL on non-GPU platforms.
     // TODO(b/32704451): Don't just ignore the ::tensorflow::Status object!
@@ -498,6 +562,10 @@ Status DirectSession::Run(const RunOptions& run_options,
   }
 
   for (const auto& item : executors_and_keys->items) {
+    thread::ThreadPool* item_pool = PoolForPartition(pool, item);
+    args.runner = [this, item_pool](Executor::Args::Closure c) {
+      SchedClosure(item_pool, std::move(c));
+    };
     item.executor->RunAsync(args, barrier->Get());
   }
 
@@ -521,6 +589,10 @@ Status DirectSession::Run(const RunOptions& run_options,
   }
 #endif  // GOOGLE_CUDA
 
+  if (run_state.collector) {
+    run_state.collector->Finalize();
+  }
+
   {
     mutex_lock l(run_state.mu_);
     TF_RETURN_IF_ERROR(run_state.status);
@@ -623,9 +695,6 @@ Status DirectSession::PRunSetup(const std::vector<string>& input_names,
 
   args.rendezvous = run_state->rendez;
   args.cancellation_manager = cancellation_manager_;
-  args.runner = [this, pool](Executor::Args::Closure c) {
-    SchedClosure(pool, std::move(c));
-  };
   args.session_state = &session_state_;
   args.tensor_store = &run_state->tensor_store;
   args.step_container = &run_state->step_container;
@@ -640,6 +709,10 @@ Status DirectSession::PRunSetup(const std::vector<string>& input_names,
   }
 
   for (auto& item : executors_and_keys->items) {
+    thread::ThreadPool* item_pool = PoolForPartition(pool, item);
+    args.runner = [this, item_pool](Executor::Args::Closure c) {
+      SchedClosure(item_pool, std::move(c));
+    };
     item.executor->RunAsync(args, barrier->Get());
   }
 
@@ -982,8 +1055,44 @@ Status DirectSession::GetOrCreateExecutors(
   // The executor_lock_ is intentionally released while executor is
   // being created.
   std::unordered_map<string, std::unique_ptr<Graph>> graphs;
-  TF_RETURN_IF_ERROR(
-      CreateGraphs(options, &graphs, &ek->flib_def, run_state_args));
+
+  // Partial runs need the full graph and debugged runs rewrite the
+  // partitions, so neither uses the persistent graph cache.
+  string graph_cache_key;
+  bool graphs_from_cache = false;
+  if (graph_cache_ != nullptr && !run_state_args->is_partial_run &&
+      run_state_args->debugger_state == nullptr) {
+    {
+      mutex_lock l(graph_def_lock_);
+      graph_cache_key = GraphCache::ComputeKey(
+          execution_state_->original_graph_def(), options, devices_,
+          options_.config);
+    }
+    CachedPartitionGraphs cached;
+    Status s = graph_cache_->Lookup(graph_cache_key, &cached);
+    if (s.ok()) {
+      s = CreateGraphsFromCache(cached, &graphs, &ek->flib_def);
+      if (s.ok()) {
+        graphs_from_cache = true;
+        VLOG(1) << "Using cached graphs " << graph_cache_key;
+      } else {
+        graphs.clear();
+      }
+    }
+    if (!s.ok() && !errors::IsNotFound(s)) {
+      LOG(WARNING) << "Ignoring graph cache entry " << graph_cache_key << ": "
+                   << s;
+    }
+  }
+  if (!graphs_from_cache) {
+    TF_RETURN_IF_ERROR(
+        CreateGraphs(options, &graphs, &ek->flib_def, run_state_args));
+  }
+  std::unique_ptr<CachedPartitionGraphs> cache_entry;
+  if (!graph_cache_key.empty() && !graphs_from_cache) {
+    cache_entry.reset(new CachedPartitionGraphs);
+    cache_entry->set_key(graph_cache_key);
+  }
 
   if (run_state_args->is_partial_run) {
     ek->graph = std::move(run_state_args->graph);
@@ -1006,6 +1115,9 @@ Status DirectSession::GetOrCreateExecutors(
   const auto& optimizer_opts =
       options_.config.graph_options().optimizer_options();
   GraphOptimizer optimizer(optimizer_opts);
+  std::vector<LocalExecutorParams> executor_params;
+  executor_params.reserve(graphs.size());
+  bool straight_line = optimizer_opts.use_straight_line_executor();
   for (auto iter = graphs.begin(); iter != graphs.end(); ++iter) {
     const string& partition_name = iter->first;
     std::unique_ptr<Graph>& partition_graph = iter->second;
@@ -1016,6 +1128,7 @@ Status DirectSession::GetOrCreateExecutors(
 
     ek->items.resize(ek->items.size() + 1);
     auto* item = &(ek->items.back());
+    item->numa_node = device->attributes().locality().numa_node() - 1;
     item->flib.reset(NewFunctionLibraryRuntime(
         device_mgr_.get(), options_.env, device, graph_def_version,
         ek->flib_def.get(), optimizer_opts));
@@ -1048,7 +1161,15 @@ Status DirectSession::GetOrCreateExecutors(
     };
     params.node_outputs_cb = node_outputs_callback_;
 
-    optimizer.Optimize(lib, options_.env, device, &iter->second);
+    if (!graphs_from_cache) {
+      optimizer.Optimize(lib, options_.env, device, &iter->second);
+    }
+    if (cache_entry != nullptr) {
+      CachedPartitionGraphs::Partition* cached_partition =
+          cache_entry->add_partitions();
+      cached_partition->set_device(partition_name);
+      partition_graph->ToGraphDef(cached_partition->mutable_graph());
+    }
 
     // EXPERIMENTAL: tfdbg inserts debug nodes (i.e., probes) to the graph
     if (run_state_args->debugger_state) {
@@ -1059,12 +1180,56 @@ Status DirectSession::GetOrCreateExecutors(
     TF_RETURN_IF_ERROR(EnsureMemoryTypes(DeviceType(device->device_type()),
                                          device->name(),
                                          partition_graph.get()));
-    // NewLocalExecutor takes ownership of partition_graph.
+    if (straight_line && !IsStraightLineGraph(partition_graph.get())) {
+      straight_line = false;
+    }
+    executor_params.push_back(params);
+  }
+
+  if (cache_entry != nullptr) {
+    *cache_entry->mutable_library() = ek->flib_def->ToProto();
+    {
+      // Only the placements of the cached nodes are recorded, since the
+      // other placements of this session depend on its earlier runs.
+      mutex_lock l(graph_def_lock_);
+      for (const auto& partition : cache_entry->partitions()) {
+        for (const NodeDef& ndef : partition.graph().node()) {
+          auto iter = stateful_placements_.find(ndef.name());
+          if (iter != stateful_placements_.end()) {
+            (*cache_entry->mutable_stateful_placements())[iter->first] =
+                iter->second;
+          }
+        }
+      }
+    }
+    Status s = graph_cache_->Insert(graph_cache_key, *cache_entry);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to cache graphs " << graph_cache_key << ": " << s;
+    }
+  }
+
+  // If OptimizerOptions.use_straight_line_executor is set, the straight-line
+  // executor runs the step.  Dead tensors can only originate from
+  // control-flow nodes, and may cross partitions, so it is used only when no
+  // partition of the step contains control flow.
+  int partition_index = 0;
+  for (auto iter = graphs.begin(); iter != graphs.end(); ++iter) {
+    std::unique_ptr<Graph>& partition_graph = iter->second;
+    auto* item = &(ek->items[partition_index]);
+    const LocalExecutorParams& params = executor_params[partition_index];
+    ++partition_index;
+
+    // The new executor takes ownership of partition_graph.
     item->graph = partition_graph.get();
     item->executor = nullptr;
     Executor* executor;
-    TF_RETURN_IF_ERROR(
-        NewLocalExecutor(params, partition_graph.release(), &executor));
+    if (straight_line) {
+      TF_RETURN_IF_ERROR(NewStraightLineExecutor(
+          params, partition_graph.release(), &executor));
+    } else {
+      TF_RETURN_IF_ERROR(
+          NewLocalExecutor(params, partition_graph.release(), &executor));
+    }
     item->executor.reset(executor);
   }
 
@@ -1120,6 +1285,10 @@ Status DirectSession::CreateGraphs(
     execution_state = temp_exec_state_holder.get();
   } else {
     execution_state = execution_state_.get();
+    // The steps that hit the graph cache so far may have fixed the
+    // placement of stateful nodes.
+    TF_RETURN_IF_ERROR(
+        execution_state->InitBaseGraphIfDeferred(stateful_placements_));
     TF_RETURN_IF_ERROR(
         execution_state->BuildGraph(subgraph_options, &client_graph));
   }
@@ -1232,6 +1401,63 @@ Status DirectSession::CreateGraphs(
   return s;
 }
 
+Status DirectSession::CreateGraphsFromCache(
+    const CachedPartitionGraphs& cached,
+    std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+    std::unique_ptr<FunctionLibraryDefinition>* flib_def) {
+  std::unique_ptr<FunctionLibraryDefinition> cached_flib_def(
+      new FunctionLibraryDefinition(OpRegistry::Global(), cached.library()));
+  std::unordered_map<string, std::unique_ptr<Graph>> device_graphs;
+  for (const auto& partition : cached.partitions()) {
+    Device* d;
+    TF_RETURN_IF_ERROR(device_mgr_->LookupDevice(partition.device(), &d));
+    std::unique_ptr<Graph> device_graph(new Graph(cached_flib_def.get()));
+    GraphConstructorOptions device_opts;
+    // There are internal operations (e.g., send/recv) that we now allow.
+    device_opts.allow_internal_ops = true;
+    device_opts.expect_device_spec = true;
+    TF_RETURN_IF_ERROR(ConvertGraphDefToGraph(device_opts, partition.graph(),
+                                              device_graph.get()));
+    device_graphs.emplace(partition.device(), std::move(device_graph));
+  }
+
+  {
+    mutex_lock l(graph_def_lock_);
+    // The cached graphs may have been placed by another session. They are
+    // only used if their stateful nodes are where this session places them:
+    // where execution_state_ has placed the full graph, or, when placing
+    // pruned graphs or before the full graph has been placed, where earlier
+    // runs of this session have placed them.
+    const bool use_session_placements =
+        options_.config.graph_options().place_pruned_graph() ||
+        !execution_state_->base_graph_placed();
+    const std::unordered_map<string, string> placements =
+        use_session_placements ? stateful_placements_
+                               : execution_state_->GetStatefulPlacements();
+    for (const auto& placement_pair : cached.stateful_placements()) {
+      auto iter = placements.find(placement_pair.first);
+      if (iter != placements.end() && iter->second != placement_pair.second) {
+        return errors::FailedPrecondition(
+            "Cached assignment of ", placement_pair.first, " to ",
+            placement_pair.second, " does not match ", iter->second);
+      }
+    }
+    // Update our current state as CreateGraphs() does.
+    if (use_session_placements) {
+      for (const auto& placement_pair : cached.stateful_placements()) {
+        stateful_placements_.insert(
+            std::make_pair(placement_pair.first, placement_pair.second));
+      }
+    } else {
+      stateful_placements_ = placements;
+    }
+  }
+
+  *outputs = std::move(device_graphs);
+  *flib_def = std::move(cached_flib_def);
+  return Status::OK();
+}
+
 ::tensorflow::Status DirectSession::Reset(
     const std::vector<string>& containers) {
   device_mgr_->ClearContainers(containers);
@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/device_set.h"
 #include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/graph_cache.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/session_factory.h"
 #include "tensorflow/core/common_runtime/simple_graph_execution_state.h"
@@ -39,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/public/session.h"
@@ -110,6 +112,8 @@ class DirectSession : public Session {
     Graph* graph = nullptr;
     std::unique_ptr<FunctionLibraryRuntime> flib;
     std::unique_ptr<Executor> executor;
+    // The NUMA node of the partition's device, or port::kNUMANoAffinity.
+    int numa_node = port::kNUMANoAffinity;
   };
 
   // An ExecutorsAndKeys is created for a given set of feeds/fetches.
@@ -189,6 +193,15 @@ class DirectSession : public Session {
       std::unique_ptr<FunctionLibraryDefinition>* flib_def,
       RunStateArgs* run_state_args);
 
+  // Like CreateGraphs(), but builds the graphs from an entry of
+  // graph_cache_ instead of placing, partitioning and optimizing them.
+  // Returns FailedPrecondition, leaving the session unchanged, if the entry
+  // places a stateful node on another device than this session does.
+  ::tensorflow::Status CreateGraphsFromCache(
+      const CachedPartitionGraphs& cached,
+      std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+      std::unique_ptr<FunctionLibraryDefinition>* flib_def);
+
   ::tensorflow::Status ExtendLocked(const GraphDef& graph)
       EXCLUSIVE_LOCKS_REQUIRED(graph_def_lock_);
 
@@ -245,11 +258,19 @@ class DirectSession : public Session {
 
   // The thread-pools to use for running ops.
   std::vector<thread::ThreadPool*> thread_pools_;
+  // If ConfigProto.use_numa_affinity is set, one inter-op thread-pool per
+  // NUMA node, pinned to that node, used instead of thread_pools_[0] for
+  // partitions on that node's devices.
+  std::vector<thread::ThreadPool*> numa_thread_pools_;
   bool owns_thread_pools_ = false;
 
   // Schedules 'c' for execution on pool.
   void SchedClosure(thread::ThreadPool* pool, std::function<void()> c);
 
+  // Returns the pool that runs the ops of 'item' in a step that uses 'pool'.
+  thread::ThreadPool* PoolForPartition(
+      thread::ThreadPool* pool, const PerPartitionExecutorsAndLib& item) const;
+
   mutex executor_lock_;  // protects executors_
   // Holds mappings from signature to the executors that process
   // it. The reason for a level of indirection around mapped_type is
@@ -285,6 +306,10 @@ class DirectSession : public Session {
   // library; it copies and modifies the function library.
   std::unique_ptr<FunctionLibraryDefinition> flib_def_;
 
+  // If non-null, a persistent cache of the graphs built by CreateGraphs().
+  // See GraphOptions.graph_cache_dir.
+  std::unique_ptr<GraphCache> graph_cache_;
+
   // true if the Session has been Closed.
   mutex closed_lock_;
   bool closed_ GUARDED_BY(closed_lock_) = false;
@@ -293,6 +318,9 @@ class DirectSession : public Session {
   std::atomic<int64> edge_name_counter_ = {0};
   std::atomic<int64> handle_name_counter_ = {0};
 
+  // The number of steps that requested tracing.  Used for sampling.
+  std::atomic<int64> trace_step_counter_ = {0};
+
   // For generating step ids that are unique across all sessions.
   static std::atomic_int_fast64_t step_id_counter_;
 
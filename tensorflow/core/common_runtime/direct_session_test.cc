@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/optimization_registry.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -36,6 +37,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session.h"
@@ -45,6 +47,21 @@ limitations under the License.
 namespace tensorflow {
 namespace {
 
+// Counts the graphs that are about to be placed.
+class CountPlacementsPass : public GraphOptimizationPass {
+ public:
+  static int count_;
+  Status Run(const GraphOptimizationPassOptions& options) override {
+    ++count_;
+    return Status::OK();
+  }
+};
+
+int CountPlacementsPass::count_ = 0;
+
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::PRE_PLACEMENT, 0,
+                      CountPlacementsPass);
+
 Session* CreateSession() {
   SessionOptions options;
   (*options.config.mutable_device_count())["CPU"] = 2;
@@ -107,6 +124,108 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork) {
   EXPECT_FLOAT_EQ(5.0, mat(0, 0));
 }
 
+TEST_F(DirectSessionMinusAXTest, RunStraightLineExecutor) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.mutable_graph_options()
+      ->mutable_optimizer_options()
+      ->set_use_straight_line_executor(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  std::vector<std::pair<string, Tensor>> inputs;
+  std::vector<string> output_names = {y_ + ":0"};
+  std::vector<string> target_nodes = {y_neg_};
+  for (int i = 0; i < 2; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run(inputs, output_names, target_nodes, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(5.0, outputs[0].matrix<float>()(0, 0));
+  }
+}
+
+TEST_F(DirectSessionMinusAXTest, RunWithGraphCache) {
+  Initialize({3, 2, -1, 0});
+  const string cache_dir = io::JoinPath(testing::TmpDir(), "graph_cache");
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.mutable_graph_options()->set_graph_cache_dir(cache_dir);
+
+  auto run = [this, &options]() {
+    std::unique_ptr<Session> session(NewSession(options));
+    ASSERT_TRUE(session != nullptr);
+    TF_ASSERT_OK(session->Create(def_));
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {y_ + ":0"}, {y_neg_}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(5.0, outputs[0].matrix<float>()(0, 0));
+  };
+
+  // The first session populates the cache.
+  run();
+  std::vector<string> entries;
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir, &entries));
+  ASSERT_EQ(1, entries.size());
+  const string entry_path = io::JoinPath(cache_dir, entries[0]);
+  CachedPartitionGraphs cached;
+  TF_ASSERT_OK(ReadBinaryProto(Env::Default(), entry_path, &cached));
+  EXPECT_EQ(2, cached.partitions_size());
+
+  // The second session builds its executors from the cached entry, without
+  // placing any graph.
+  const int num_placements = CountPlacementsPass::count_;
+  run();
+  EXPECT_EQ(num_placements, CountPlacementsPass::count_);
+  entries.clear();
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir, &entries));
+  EXPECT_EQ(1, entries.size());
+
+  // A corrupt entry is ignored and rewritten.
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), entry_path, "garbage"));
+  run();
+  TF_ASSERT_OK(ReadBinaryProto(Env::Default(), entry_path, &cached));
+  EXPECT_EQ(2, cached.partitions_size());
+}
+
+TEST_F(DirectSessionMinusAXTest, GraphCacheKeyCoversPlacementOptions) {
+  Initialize({3, 2, -1, 0});
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "graph_cache_placement");
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.mutable_graph_options()->set_graph_cache_dir(cache_dir);
+
+  auto run = [this, &options]() {
+    std::unique_ptr<Session> session(NewSession(options));
+    ASSERT_TRUE(session != nullptr);
+    TF_ASSERT_OK(session->Create(def_));
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {y_ + ":0"}, {y_neg_}, &outputs));
+  };
+  auto num_entries = [&cache_dir]() {
+    std::vector<string> entries;
+    TF_CHECK_OK(Env::Default()->GetChildren(cache_dir, &entries));
+    return entries.size();
+  };
+
+  run();
+  EXPECT_EQ(1, num_entries());
+  // Each of the placement options gets its own entry.
+  options.config.set_allow_soft_placement(true);
+  run();
+  EXPECT_EQ(2, num_entries());
+  options.config.set_log_device_placement(true);
+  run();
+  EXPECT_EQ(3, num_entries());
+  options.config.add_device_filters("/job:localhost");
+  run();
+  EXPECT_EQ(4, num_entries());
+  run();
+  EXPECT_EQ(4, num_entries());
+}
+
 TEST_F(DirectSessionMinusAXTest, TestFeed) {
   Initialize({1, 2, 3, 4});
   std::unique_ptr<Session> session(CreateSession());
@@ -293,6 +412,40 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetworkWithOpts) {
   EXPECT_EQ(run_metadata.step_stats().dev_stats_size(), 2);
 }
 
+TEST_F(DirectSessionMinusAXTest, RunSampledTrace) {
+  Initialize({3, 2, -1, 0});
+  std::unique_ptr<Session> session(CreateSession());
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  RunOptions run_options;
+  run_options.set_trace_level(RunOptions::FULL_TRACE);
+  run_options.set_trace_every_n_steps(3);
+  int num_traced = 0;
+  for (int i = 0; i < 9; ++i) {
+    RunMetadata run_metadata;
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run(run_options, {}, {y_ + ":0"}, {y_neg_},
+                              &outputs, &run_metadata));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(5.0, outputs[0].matrix<float>()(0, 0));
+    if (run_metadata.step_stats().dev_stats_size() > 0) {
+      EXPECT_EQ(2, run_metadata.step_stats().dev_stats_size());
+      ++num_traced;
+    }
+  }
+  EXPECT_EQ(3, num_traced);
+
+  // A fraction of 0 disables the fraction test.
+  run_options.set_trace_every_n_steps(0);
+  run_options.set_trace_sample_fraction(0);
+  RunMetadata run_metadata;
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run(run_options, {}, {y_ + ":0"}, {y_neg_}, &outputs,
+                            &run_metadata));
+  EXPECT_EQ(2, run_metadata.step_stats().dev_stats_size());
+}
+
 TEST(DirectSessionTest, KeepsStateAcrossRunsOfSession) {
   GraphDef def;
   Graph g(OpRegistry::Global());
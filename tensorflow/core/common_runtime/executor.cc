@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/executor.h"
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <memory>
@@ -221,6 +222,12 @@ struct NodeItem {
   bool is_sink : 1;              // True iff IsSink(node)
   // True iff IsEnter(node) || IsExit(node) || IsNextIteration(node)
   bool is_enter_exit_or_next_iter : 1;
+  bool has_priority : 1;  // True iff node has a "_priority" attr
+
+  // The "_priority" attr of the node if has_priority. When several nodes
+  // become ready at once, those with the smallest priority are started
+  // first; see PartitionOptions::need_to_record_priorities.
+  int64 priority = 0;
 
   // Cached values of node->num_inputs() and node->num_outputs(), to
   // avoid levels of indirection.
@@ -417,6 +424,9 @@ class ExecutorImpl : public Executor {
   // A cached value of params_
   bool device_record_tensor_accesses_ = false;
 
+  // True iff some node has a "_priority" attr.
+  bool has_priorities_ = false;
+
   // Root nodes (with no in edges) that should form the initial ready queue
   std::vector<const Node*> root_nodes_;
 
@@ -654,6 +664,12 @@ Status ExecutorImpl::Initialize() {
     item->is_sink = IsSink(n);
     item->is_enter_exit_or_next_iter =
         (IsEnter(n) || IsExit(n) || IsNextIteration(n));
+    const AttrValue* priority = AttrSlice(n->def()).Find("_priority");
+    item->has_priority = (priority != nullptr);
+    if (item->has_priority) {
+      item->priority = priority->i();
+      has_priorities_ = true;
+    }
 
     // Compute the maximum values we'll store for this node in the
     // pending counts data structure, and allocate a handle in
@@ -779,100 +795,335 @@ Status InferAllocAttr(const Node* n, const Node* dst,
 // The state associated with one invocation of ExecutorImpl::Run.
 // ExecutorState dispatches nodes when they become ready and keeps
 // track of how many predecessors of a node have not done (pending_).
-class ExecutorState {
- public:
-  ExecutorState(const Executor::Args& args, ExecutorImpl* impl);
-  ~ExecutorState();
+// Either a tensor pointer (pass-by-reference) or a tensor (pass-by-value).
+// TODO(yuanbyu): A better way to do "has_value"?
+struct Entry {
+  Entry() {}
+  Entry(const Entry& other)
+      : ref(other.ref),
+        ref_mu(other.ref_mu),
+        has_value(other.has_value),
+        val_field_is_set(other.val_field_is_set),
+        alloc_attr(other.alloc_attr),
+        device_context(other.device_context) {
+    if (val_field_is_set) {
+      val.Init(*other.val);
+    }
+  }
+  ~Entry() {
+    if (val_field_is_set) val.Destroy();
+  }
 
-  void RunAsync(Executor::DoneCallback done);
+  Entry& operator=(const Entry& other) {
+    if (val_field_is_set) {
+      val.Destroy();
+    }
+    ref = other.ref;
+    ref_mu = other.ref_mu;
+    has_value = other.has_value;
+    val_field_is_set = other.val_field_is_set;
+    alloc_attr = other.alloc_attr;
+    device_context = other.device_context;
+    if (val_field_is_set) {
+      val.Init(*other.val);
+    }
+    return *this;
+  }
 
- private:
-  // Either a tensor pointer (pass-by-reference) or a tensor (pass-by-value).
-  // TODO(yuanbyu): A better way to do "has_value"?
-  struct Entry {
-    Entry() {}
-    Entry(const Entry& other)
-        : ref(other.ref),
-          ref_mu(other.ref_mu),
-          has_value(other.has_value),
-          val_field_is_set(other.val_field_is_set),
-          alloc_attr(other.alloc_attr),
-          device_context(other.device_context) {
-      if (val_field_is_set) {
-        val.Init(*other.val);
-      }
+  Entry& operator=(Entry&& other) {
+    if (val_field_is_set) {
+      val.Destroy();
     }
-    ~Entry() {
-      if (val_field_is_set) val.Destroy();
+    ref = other.ref;
+    ref_mu = other.ref_mu;
+    has_value = other.has_value;
+    val_field_is_set = other.val_field_is_set;
+    alloc_attr = other.alloc_attr;
+    device_context = other.device_context;
+    if (val_field_is_set) {
+      val.Init(std::move(*other.val));
     }
+    return *this;
+  }
 
-    Entry& operator=(const Entry& other) {
-      if (val_field_is_set) {
-        val.Destroy();
-      }
-      ref = other.ref;
-      ref_mu = other.ref_mu;
-      has_value = other.has_value;
-      val_field_is_set = other.val_field_is_set;
-      alloc_attr = other.alloc_attr;
-      device_context = other.device_context;
-      if (val_field_is_set) {
-        val.Init(*other.val);
-      }
-      return *this;
+  // Clears the <val> field.
+  void ClearVal() {
+    if (val_field_is_set) {
+      val.Destroy();
+      val_field_is_set = false;
+      has_value = false;
     }
+  }
 
-    Entry& operator=(Entry&& other) {
-      if (val_field_is_set) {
-        val.Destroy();
-      }
-      ref = other.ref;
-      ref_mu = other.ref_mu;
-      has_value = other.has_value;
-      val_field_is_set = other.val_field_is_set;
-      alloc_attr = other.alloc_attr;
-      device_context = other.device_context;
-      if (val_field_is_set) {
-        val.Init(std::move(*other.val));
+  // A tensor value, if val_field_is_set.
+  ManualConstructor<Tensor> val;
+
+  Tensor* ref = nullptr;    // A tensor reference.
+  mutex* ref_mu = nullptr;  // mutex for *ref if ref is not nullptr.
+
+  // Whether the value exists, either in <val> or <ref>.
+  bool has_value = false;
+
+  bool val_field_is_set = false;
+
+  // The attributes of the allocator that creates the tensor.
+  AllocatorAttributes alloc_attr;
+
+  // Every entry carries an optional DeviceContext containing
+  // Device-specific information about how the Tensor was produced.
+  DeviceContext* device_context = nullptr;
+};
+
+typedef gtl::InlinedVector<Entry, 4> EntryVector;
+
+// Clears the input entries of "item", which start at "first_input".
+void ClearInputs(const NodeItem& item, Entry* first_input) {
+  for (int i = 0; i < item.num_inputs; ++i) {
+    (first_input + i)->ClearVal();
+  }
+}
+
+// Before invoking item.kernel, fills in its "inputs" from the entries
+// starting at "first_input".  Sets "*is_input_dead" if a transfer node
+// has an input without a value.
+Status PrepareNodeInputs(const NodeItem& item, Entry* first_input,
+                         TensorValueVec* inputs,
+                         DeviceContextVec* input_device_contexts,
+                         AllocatorAttributeVec* input_alloc_attrs,
+                         bool* is_input_dead) {
+  const Node* node = item.node;
+
+  inputs->clear();
+  inputs->resize(item.num_inputs);
+  input_device_contexts->clear();
+  input_device_contexts->resize(item.num_inputs);
+  input_alloc_attrs->clear();
+  input_alloc_attrs->resize(item.num_inputs);
+
+  *is_input_dead = false;
+
+  bool is_merge = item.is_merge;
+  for (int i = 0; i < item.num_inputs; ++i) {
+    const bool expect_ref = IsRefType(item.input_type(i));
+    Entry* entry = first_input + i;
+    (*input_device_contexts)[i] = entry->device_context;
+    (*input_alloc_attrs)[i] = entry->alloc_attr;
+
+    // i-th input.
+    TensorValue* inp = &(*inputs)[i];
+
+    // Only merge and transfer nodes can have no-value inputs.
+    if (!entry->has_value) {
+      if (!is_merge) {
+        DCHECK(IsTransferNode(node));
+        DCHECK(!entry->val_field_is_set);
+        entry->has_value = true;
+        entry->val_field_is_set = true;
+        entry->val.Init(*kEmptyTensor);
+        inp->tensor = entry->val.get();
+        *is_input_dead = true;
       }
-      return *this;
+      continue;
     }
+    if (entry->ref == nullptr) {
+      if (expect_ref) {
+        return AttachDef(
+            errors::InvalidArgument(i, "-th input expects a ref type"),
+            item.kernel->def());
+      }
+      inp->tensor = entry->val.get();
+    } else {
+      if (!entry->ref->IsInitialized() && !IsInitializationOp(item.node)) {
+        return AttachDef(
+            errors::FailedPrecondition("Attempting to use uninitialized value ",
+                                       item.kernel->def().input(i)),
+            item.kernel->def());
+      }
+      if (expect_ref) {
+        inp->mutex_if_ref = entry->ref_mu;
+        inp->tensor = entry->ref;
+      } else {
+        // Automatically deref the tensor ref when the op expects a
+        // tensor but is given a ref to a tensor.  Need to deref it
+        // under the mutex.
+        {
+          mutex_lock l(*(entry->ref_mu));
+          DCHECK(!entry->val_field_is_set);
+          entry->val.Init(*entry->ref);
+          entry->val_field_is_set = true;
+        }
+        entry->ref = nullptr;
+        entry->ref_mu = nullptr;
 
-    // Clears the <val> field.
-    void ClearVal() {
-      if (val_field_is_set) {
-        val.Destroy();
-        val_field_is_set = false;
-        has_value = false;
+        inp->tensor = entry->val.get();
       }
     }
+  }
+  return Status::OK();
+}
+
+// After item.kernel computation is done, moves its outputs from "ctx" into
+// "outputs", tagging each with "device_context".  "node_outputs_cb", if not
+// null, is called for each output, and "log_memory" records them with
+// LogMemory.
+Status ProcessNodeOutputs(
+    const NodeItem& item, OpKernelContext* ctx, DeviceContext* device_context,
+    const Executor::Args::NodeOutputsCallback& node_outputs_cb,
+    bool log_memory, EntryVector* outputs, NodeExecStats* stats) {
+  const Node* node = item.node;
+  DCHECK_EQ(0, outputs->size());
+  outputs->resize(item.num_outputs);
 
-    // A tensor value, if val_field_is_set.
-    ManualConstructor<Tensor> val;
+  Status s = ctx->status();
+  if (!s.ok()) {
+    return AttachDef(s, item.kernel->def());
+  }
 
-    Tensor* ref = nullptr;    // A tensor reference.
-    mutex* ref_mu = nullptr;  // mutex for *ref if ref is not nullptr.
+  // Experimental: debugger (tfdb) access to intermediate node completion.
+  if (item.num_outputs == 0 && node_outputs_cb != nullptr) {
+    // If the node has no output, invoke the callback with output slot set to
+    // -1, signifying that this is a no-output node.
+    s.Update(node_outputs_cb(item.node->name(), -1, nullptr, false, ctx));
+  }
 
-    // Whether the value exists, either in <val> or <ref>.
-    bool has_value = false;
+  for (int i = 0; i < item.num_outputs; ++i) {
+    TensorValue val = ctx->release_output(i);
+    if (*ctx->is_output_dead() || val.tensor == nullptr) {
+      // Unless it's a Switch or a Recv, the node must produce a
+      // tensor value at i-th output.
+      if (!IsSwitch(node) && !IsRecv(node)) {
+        s.Update(errors::Internal("Missing ", i, "-th output from ",
+                                  SummarizeNodeDef(node->def())));
+      }
+    } else {
+      Entry* out = &((*outputs)[i]);
 
-    bool val_field_is_set = false;
+      // Set the device context of the output entry.
+      out->device_context = device_context;
 
-    // The attributes of the allocator that creates the tensor.
-    AllocatorAttributes alloc_attr;
+      // Set the allocator attributes of the output entry.
+      out->alloc_attr = ctx->output_alloc_attr(i);
 
-    // Every entry carries an optional DeviceContext containing
-    // Device-specific information about how the Tensor was produced.
-    DeviceContext* device_context = nullptr;
-  };
+      // Sanity check of output tensor types.
+      DataType dtype = val->dtype();
+      if (val.is_ref()) dtype = MakeRefType(dtype);
+      if (dtype == item.output_type(i)) {
+        if (stats && val.tensor->IsInitialized()) {
+          nodestats::SetOutput(stats, i, val.tensor);
+        }
+        if (val.is_ref()) {
+          out->has_value = true;
+          out->ref = val.tensor;
+          out->ref_mu = val.mutex_if_ref;
+          if (log_memory) {
+            Tensor to_log;
+            {
+              // Dereference the tensor under the lock.
+              mutex_lock l(*out->ref_mu);
+              to_log = *out->ref;
+            }
+            LogMemory::RecordTensorOutput(ctx->op_kernel().name(),
+                                          ctx->step_id(), i, to_log);
+          }
+
+          // Experimental: debugger (tfdb) access to intermediate node
+          // outputs.
+          if (node_outputs_cb != nullptr) {
+            s.Update(
+                node_outputs_cb(item.node->name(), i, out->ref, true, ctx));
+          }
+        } else {
+          // NOTE that std::move is used here, so val.tensor goes to
+          // uninitialized state (val.tensor->IsInitialized return false).
+          DCHECK(!out->val_field_is_set);
+          out->has_value = true;
+          out->val_field_is_set = true;
+          out->val.Init(std::move(*val.tensor));
+          if (log_memory) {
+            LogMemory::RecordTensorOutput(ctx->op_kernel().name(),
+                                          ctx->step_id(), i, *out->val);
+          }
+
+          // Experimental: debugger access to intermediate node outputs.
+          if (node_outputs_cb != nullptr) {
+            s.Update(node_outputs_cb(item.node->name(), i, out->val.get(),
+                                     false, ctx));
+          }
+        }
+      } else {
+        s.Update(errors::Internal("Output ", i, " of type ",
+                                  DataTypeString(dtype),
+                                  " does not match declared output type ",
+                                  DataTypeString(item.output_type(i)),
+                                  " for node ", SummarizeNodeDef(node->def())));
+      }
+    }
+    if (!val.is_ref()) {
+      // If OpKernelContext returns outputs via pass-by-value, we
+      // don't need this trouble.
+      delete val.tensor;
+    }
+  }
+  return s;
+}
+
+// State kept alive for executing an asynchronous node in another
+// thread.  NOTE: We need to make a copy of p.input,
+// p.input_device_contexts, and p.input_alloc_attrs for asynchronous
+// kernels because OpKernelContext methods like input_type(i) needs
+// the param points to valid input type vector. It's not an issue for
+// sync kernels because these vectors are kept on the stack.
+struct AsyncKernelState {
+  AsyncKernelState(const OpKernelContext::Params& p, const NodeItem* _item,
+                   Entry* _first_input, NodeExecStats* _stats)
+      : saved_inputs(*p.inputs),
+        saved_input_device_contexts(*p.input_device_contexts),
+        saved_input_alloc_attrs(*p.input_alloc_attrs),
+        params(p),
+        item(_item),
+        first_input(_first_input),
+        // ParamsButClearingEigenGPUDevice does equivalent of
+        //   params.eigen_gpu_device = nullptr;
+        ctx(ParamsButClearingEigenGPUDevice(&params), item->num_outputs),
+        stats(_stats) {
+    params.inputs = &saved_inputs;
+    params.input_device_contexts = &saved_input_device_contexts;
+    params.input_alloc_attrs = &saved_input_alloc_attrs;
+  }
+
+  TensorValueVec saved_inputs;
+  DeviceContextVec saved_input_device_contexts;
+  AllocatorAttributeVec saved_input_alloc_attrs;
+  OpKernelContext::Params params;
+  const NodeItem* item;
+  Entry* first_input;
+  OpKernelContext ctx;
+  NodeExecStats* stats;
+
+ private:
+  OpKernelContext::Params* ParamsButClearingEigenGPUDevice(
+      OpKernelContext::Params* p) {
+    // Ensure OpKernelContext constructor will make a new eigen GPU device if
+    // necessary.
+    p->eigen_gpu_device = nullptr;  // Force allocation
+    return p;
+  }
+};
+
+class ExecutorState {
+ public:
+  ExecutorState(const Executor::Args& args, ExecutorImpl* impl);
+  ~ExecutorState();
+
+  void RunAsync(Executor::DoneCallback done);
 
+ private:
   // Contains a value for [node->id()] for the device context assigned by the
   // device at the beginning of a step.
   DeviceContextMap device_context_map_;
 
   struct TaggedNode;
   typedef gtl::InlinedVector<TaggedNode, 8> TaggedNodeSeq;
-  typedef gtl::InlinedVector<Entry, 4> EntryVector;
 
   struct IterationState {
     explicit IterationState(const PendingCounts* pending_counts,
@@ -1233,13 +1484,6 @@ class ExecutorState {
   // Process a ready node in current thread.
   void Process(TaggedNode node, int64 scheduled_usec);
 
-  // Before invoking item->kernel, fills in its "inputs".
-  Status PrepareInputs(const NodeItem& item, Entry* first_input,
-                       TensorValueVec* inputs,
-                       DeviceContextVec* input_device_contexts,
-                       AllocatorAttributeVec* input_alloc_attrs,
-                       bool* is_input_dead);
-
   // After item->kernel computation is done, processes its outputs.
   Status ProcessOutputs(const NodeItem& item, OpKernelContext* ctx,
                         EntryVector* outputs, NodeExecStats* stats);
@@ -1441,48 +1685,14 @@ void ExecutorState::RunAsync(Executor::DoneCallback done) {
 }
 
 // State kept alive for executing an asynchronous node in another
-// thread.  NOTE: We need to make a copy of p.input,
-// p.input_device_contexts, and p.input_alloc_attrs for asynchronous
-// kernels because OpKernelContext methods like input_type(i) needs
-// the param points to valid input type vector. It's not an issue for
-// sync kernels because these vectors are kept on the stack.
-struct ExecutorState::AsyncState {
+// thread.
+struct ExecutorState::AsyncState : public AsyncKernelState {
   AsyncState(const OpKernelContext::Params& p, const TaggedNode& _tagged_node,
              const NodeItem* _item, Entry* _first_input, NodeExecStats* _stats)
-      : saved_inputs(*p.inputs),
-        saved_input_device_contexts(*p.input_device_contexts),
-        saved_input_alloc_attrs(*p.input_alloc_attrs),
-        params(p),
-        tagged_node(_tagged_node),
-        item(_item),
-        first_input(_first_input),
-        // ParamsButClearingEigenGPUDevice does equivalent of
-        //   params.eigen_gpu_device = nullptr;
-        ctx(ParamsButClearingEigenGPUDevice(&params), item->num_outputs),
-        stats(_stats) {
-    params.inputs = &saved_inputs;
-    params.input_device_contexts = &saved_input_device_contexts;
-    params.input_alloc_attrs = &saved_input_alloc_attrs;
-  }
+      : AsyncKernelState(p, _item, _first_input, _stats),
+        tagged_node(_tagged_node) {}
 
-  TensorValueVec saved_inputs;
-  DeviceContextVec saved_input_device_contexts;
-  AllocatorAttributeVec saved_input_alloc_attrs;
-  OpKernelContext::Params params;
   TaggedNode tagged_node;
-  const NodeItem* item;
-  Entry* first_input;
-  OpKernelContext ctx;
-  NodeExecStats* stats;
-
- private:
-  OpKernelContext::Params* ParamsButClearingEigenGPUDevice(
-      OpKernelContext::Params* p) {
-    // Ensure OpKernelContext constructor will make a new eigen GPU device if
-    // necessary.
-    p->eigen_gpu_device = nullptr;  // Force allocation
-    return p;
-  }
 };
 
 void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
@@ -1573,14 +1783,10 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
     } else {
       // Prepares inputs.
       bool is_input_dead = false;
-      s = PrepareInputs(item, first_input, &inputs, &input_device_contexts,
-                        &input_alloc_attrs, &is_input_dead);
+      s = PrepareNodeInputs(item, first_input, &inputs, &input_device_contexts,
+                            &input_alloc_attrs, &is_input_dead);
       if (!s.ok()) {
-        // Clear inputs.
-        int num_inputs = item.num_inputs;
-        for (int i = 0; i < num_inputs; ++i) {
-          (first_input + i)->ClearVal();
-        }
+        ClearInputs(item, first_input);
         MaybeMarkCompleted(input_frame, input_iter, id);
         // Continue to process the nodes in 'inline_ready'.
         completed = NodeDone(s, item.node, ready, stats, &inline_ready);
@@ -1615,11 +1821,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
           EntryVector outputs;
           Status s = ProcessOutputs(*state->item, &state->ctx, &outputs, stats);
           if (stats) nodestats::SetMemory(stats, &state->ctx);
-          // Clears inputs.
-          const int num_inputs = state->item->num_inputs;
-          for (int i = 0; i < num_inputs; ++i) {
-            (first_input + i)->ClearVal();
-          }
+          ClearInputs(*state->item, first_input);
           FrameState* input_frame = state->tagged_node.input_frame;
           const int64 input_iter = state->tagged_node.input_iter;
           const int id = state->tagged_node.node->id();
@@ -1663,11 +1865,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
     }
 
     if (!launched_asynchronously) {
-      // Clears inputs.
-      const int num_inputs = item.num_inputs;
-      for (int i = 0; i < num_inputs; ++i) {
-        (first_input + i)->ClearVal();
-      }
+      ClearInputs(item, first_input);
       MaybeMarkCompleted(input_frame, input_iter, id);
       // Propagates outputs.
       if (s.ok()) {
@@ -1691,192 +1889,22 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
   if (completed) Finish();
 }
 
-Status ExecutorState::PrepareInputs(const NodeItem& item, Entry* first_input,
-                                    TensorValueVec* inputs,
-                                    DeviceContextVec* input_device_contexts,
-                                    AllocatorAttributeVec* input_alloc_attrs,
-                                    bool* is_input_dead) {
-  const Node* node = item.node;
-
-  inputs->clear();
-  inputs->resize(item.num_inputs);
-  input_device_contexts->clear();
-  input_device_contexts->resize(item.num_inputs);
-  input_alloc_attrs->clear();
-  input_alloc_attrs->resize(item.num_inputs);
-
-  *is_input_dead = false;
-
-  bool is_merge = item.is_merge;
-  for (int i = 0; i < item.num_inputs; ++i) {
-    const bool expect_ref = IsRefType(item.input_type(i));
-    Entry* entry = first_input + i;
-    (*input_device_contexts)[i] = entry->device_context;
-    (*input_alloc_attrs)[i] = entry->alloc_attr;
-
-    // i-th input.
-    TensorValue* inp = &(*inputs)[i];
-
-    // Only merge and transfer nodes can have no-value inputs.
-    if (!entry->has_value) {
-      if (!is_merge) {
-        DCHECK(IsTransferNode(node));
-        DCHECK(!entry->val_field_is_set);
-        entry->has_value = true;
-        entry->val_field_is_set = true;
-        entry->val.Init(*kEmptyTensor);
-        inp->tensor = entry->val.get();
-        *is_input_dead = true;
-      }
-      continue;
-    }
-    if (entry->ref == nullptr) {
-      if (expect_ref) {
-        return AttachDef(
-            errors::InvalidArgument(i, "-th input expects a ref type"),
-            item.kernel->def());
-      }
-      inp->tensor = entry->val.get();
-    } else {
-      if (!entry->ref->IsInitialized() && !IsInitializationOp(item.node)) {
-        return AttachDef(
-            errors::FailedPrecondition("Attempting to use uninitialized value ",
-                                       item.kernel->def().input(i)),
-            item.kernel->def());
-      }
-      if (expect_ref) {
-        inp->mutex_if_ref = entry->ref_mu;
-        inp->tensor = entry->ref;
-      } else {
-        // Automatically deref the tensor ref when the op expects a
-        // tensor but is given a ref to a tensor.  Need to deref it
-        // under the mutex.
-        {
-          mutex_lock l(*(entry->ref_mu));
-          DCHECK(!entry->val_field_is_set);
-          entry->val.Init(*entry->ref);
-          entry->val_field_is_set = true;
-        }
-        entry->ref = nullptr;
-        entry->ref_mu = nullptr;
-
-        inp->tensor = entry->val.get();
-      }
-    }
-  }
-  return Status::OK();
-}
-
 Status ExecutorState::ProcessOutputs(const NodeItem& item, OpKernelContext* ctx,
                                      EntryVector* outputs,
                                      NodeExecStats* stats) {
-  const Node* node = item.node;
-  DCHECK_EQ(0, outputs->size());
-  outputs->resize(item.num_outputs);
-
-  Status s = ctx->status();
-  if (!s.ok()) {
-    s = AttachDef(s, item.kernel->def());
-    // TODO(misard) Replace with a finer-grain enabling flag once we
-    // add better optional debugging support.
-    if (vlog_ && VLOG_IS_ON(1)) {
-      LOG(WARNING) << this << " Compute status: " << s;
-      DumpState();
-    }
-    return s;
-  }
-
   // Get the device_context for this node id, if it exists.
   DeviceContext* device_context = nullptr;
-  if (node->id() < device_context_map_.size()) {
-    device_context = device_context_map_[node->id()];
-  }
-
-  // Experimental: debugger (tfdb) access to intermediate node completion.
-  if (item.num_outputs == 0 && impl_->params_.node_outputs_cb != nullptr) {
-    // If the node has no output, invoke the callback with output slot set to
-    // -1, signifying that this is a no-output node.
-    s.Update(impl_->params_.node_outputs_cb(item.node->name(), -1, nullptr,
-                                            false, ctx));
+  if (item.node->id() < device_context_map_.size()) {
+    device_context = device_context_map_[item.node->id()];
   }
-
-  for (int i = 0; i < item.num_outputs; ++i) {
-    TensorValue val = ctx->release_output(i);
-    if (*ctx->is_output_dead() || val.tensor == nullptr) {
-      // Unless it's a Switch or a Recv, the node must produce a
-      // tensor value at i-th output.
-      if (!IsSwitch(node) && !IsRecv(node)) {
-        s.Update(errors::Internal("Missing ", i, "-th output from ",
-                                  SummarizeNodeDef(node->def())));
-      }
-    } else {
-      Entry* out = &((*outputs)[i]);
-
-      // Set the device context of the output entry.
-      out->device_context = device_context;
-
-      // Set the allocator attributes of the output entry.
-      out->alloc_attr = ctx->output_alloc_attr(i);
-
-      // Sanity check of output tensor types.
-      DataType dtype = val->dtype();
-      if (val.is_ref()) dtype = MakeRefType(dtype);
-      if (dtype == item.output_type(i)) {
-        if (stats && val.tensor->IsInitialized()) {
-          nodestats::SetOutput(stats, i, val.tensor);
-        }
-        if (val.is_ref()) {
-          out->has_value = true;
-          out->ref = val.tensor;
-          out->ref_mu = val.mutex_if_ref;
-          if (log_memory_) {
-            Tensor to_log;
-            {
-              // Dereference the tensor under the lock.
-              mutex_lock l(*out->ref_mu);
-              to_log = *out->ref;
-            }
-            LogMemory::RecordTensorOutput(ctx->op_kernel().name(),
-                                          ctx->step_id(), i, to_log);
-          }
-
-          // Experimental: debugger (tfdb) access to intermediate node
-          // outputs.
-          if (impl_->params_.node_outputs_cb != nullptr) {
-            s.Update(impl_->params_.node_outputs_cb(item.node->name(), i,
-                                                    out->ref, true, ctx));
-          }
-        } else {
-          // NOTE that std::move is used here, so val.tensor goes to
-          // uninitialized state (val.tensor->IsInitialized return false).
-          DCHECK(!out->val_field_is_set);
-          out->has_value = true;
-          out->val_field_is_set = true;
-          out->val.Init(std::move(*val.tensor));
-          if (log_memory_) {
-            LogMemory::RecordTensorOutput(ctx->op_kernel().name(),
-                                          ctx->step_id(), i, *out->val);
-          }
-
-          // Experimental: debugger access to intermediate node outputs.
-          if (impl_->params_.node_outputs_cb != nullptr) {
-            s.Update(impl_->params_.node_outputs_cb(
-                item.node->name(), i, out->val.get(), false, ctx));
-          }
-        }
-      } else {
-        s.Update(errors::Internal("Output ", i, " of type ",
-                                  DataTypeString(dtype),
-                                  " does not match declared output type ",
-                                  DataTypeString(item.output_type(i)),
-                                  " for node ", SummarizeNodeDef(node->def())));
-      }
-    }
-    if (!val.is_ref()) {
-      // If OpKernelContext returns outputs via pass-by-value, we
-      // don't need this trouble.
-      delete val.tensor;
-    }
+  Status s = ProcessNodeOutputs(item, ctx, device_context,
+                                impl_->params_.node_outputs_cb, log_memory_,
+                                outputs, stats);
+  // TODO(misard) Replace with a finer-grain enabling flag once we
+  // add better optional debugging support.
+  if (!ctx->status().ok() && vlog_ && VLOG_IS_ON(1)) {
+    LOG(WARNING) << this << " Compute status: " << s;
+    DumpState();
   }
   return s;
 }
@@ -2037,20 +2065,39 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
                                   TaggedNodeReadyQueue* inline_ready) {
   if (ready.empty()) return;
 
+  const GraphView& gview = impl_->gview_;
+  // Start the nodes with a priority first, the most urgent ones first, and
+  // keep the order of the others. Both the thread pool and 'inline_ready'
+  // run the nodes in the order they are scheduled.
+  TaggedNodeSeq sorted;
+  const TaggedNodeSeq* nodes = &ready;
+  if (impl_->has_priorities_ && ready.size() > 1) {
+    sorted = ready;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [&gview](const TaggedNode& a, const TaggedNode& b) {
+                       const NodeItem& x = *gview.node(a.node->id());
+                       const NodeItem& y = *gview.node(b.node->id());
+                       if (x.has_priority != y.has_priority) {
+                         return x.has_priority;
+                       }
+                       return x.priority < y.priority;
+                     });
+    nodes = &sorted;
+  }
+
   int64 scheduled_usec = 0;
   if (stats_collector_) {
     scheduled_usec = nodestats::NowInUsec();
   }
   if (inline_ready == nullptr) {
     // Schedule to run all the ready ops in thread pool.
-    for (auto& tagged_node : ready) {
+    for (auto& tagged_node : *nodes) {
       runner_([=]() { Process(tagged_node, scheduled_usec); });
     }
     return;
   }
-  const GraphView& gview = impl_->gview_;
   const TaggedNode* curr_expensive_node = nullptr;
-  for (auto& tagged_node : ready) {
+  for (auto& tagged_node : *nodes) {
     const NodeItem& item = *gview.node(tagged_node.node->id());
     if (tagged_node.is_dead || !item.kernel_is_expensive) {
       // Inline this inexpensive node.
@@ -2555,6 +2602,542 @@ void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
   (new ExecutorState(args, this))->RunAsync(done);
 }
 
+// An Executor for graphs without control flow.
+//
+// When a graph has no Switch, Merge, Enter, Exit or NextIteration nodes,
+// every node runs exactly once per step and no tensor is ever dead, so the
+// frame/iteration bookkeeping and the dead-input tracking of ExecutorImpl
+// are unnecessary.  StraightLineExecutorImpl keeps a single atomic pending
+// count per node, which reaches zero when all its inputs are available;
+// nodes start as soon as that happens, exactly as ExecutorImpl schedules
+// them, so a _Recv or a blocking op may wait for a node that is further down
+// the graph.  Inputs live in a flat array of slots allocated once per step.
+class StraightLineExecutorImpl : public Executor {
+ public:
+  StraightLineExecutorImpl(const LocalExecutorParams& p, const Graph* g)
+      : params_(p), graph_(g), gview_() {
+    CHECK(p.create_kernel != nullptr);
+    CHECK(p.delete_kernel != nullptr);
+  }
+
+  ~StraightLineExecutorImpl() override {
+    for (int i = 0; i < graph_->num_node_ids(); i++) {
+      NodeItem* item = gview_.node(i);
+      if (item != nullptr) {
+        params_.delete_kernel(item->kernel);
+      }
+    }
+    delete graph_;
+  }
+
+  Status Initialize();
+
+  void RunAsync(const Args& args, DoneCallback done) override;
+
+ private:
+  friend class StraightLineExecutorState;
+
+  // Owned.
+  LocalExecutorParams params_;
+  const Graph* graph_;
+  GraphView gview_;
+
+  // A cached value of params_
+  bool device_record_tensor_accesses_ = false;
+
+  // The number of input slots of all nodes, i.e. the size of the per-step
+  // input array.  NodeItem::input_start indexes into that array.
+  int total_inputs_ = 0;
+
+  // The number of in-edges of each node, indexed by node id.
+  std::vector<int> initial_pending_;
+
+  // Nodes without in-edges.
+  std::vector<const NodeItem*> root_nodes_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StraightLineExecutorImpl);
+};
+
+Status StraightLineExecutorImpl::Initialize() {
+  gview_.Initialize(graph_);
+
+  device_record_tensor_accesses_ =
+      params_.device->RequiresRecordingAccessedTensors();
+
+  const int num_nodes = graph_->num_node_ids();
+  initial_pending_.resize(num_nodes, 0);
+  std::vector<int> pending(num_nodes, 0);
+  std::deque<const Node*> ready;
+  for (const Node* n : graph_->nodes()) {
+    if (n->IsControlFlow()) {
+      return errors::InvalidArgument(
+          "Straight-line executor does not support control flow node ",
+          n->name());
+    }
+    const int id = n->id();
+    NodeItem* item = gview_.node(id);
+    item->node = n;
+    item->input_start = total_inputs_;
+    total_inputs_ += n->num_inputs();
+
+    Status s = params_.create_kernel(n->def(), &item->kernel);
+    if (!s.ok()) {
+      item->kernel = nullptr;
+      s = AttachDef(s, n->def());
+      LOG(ERROR) << "Executor failed to create kernel. " << s;
+      return s;
+    }
+    CHECK(item->kernel);
+    item->kernel_is_expensive = item->kernel->IsExpensive();
+    item->kernel_is_async = (item->kernel->AsAsync() != nullptr);
+    item->is_merge = false;
+    item->is_enter = false;
+    item->is_exit = false;
+    item->is_control_trigger = IsControlTrigger(n);
+    item->is_sink = IsSink(n);
+    item->is_enter_exit_or_next_iter = false;
+
+    initial_pending_[id] = pending[id] = n->in_edges().size();
+    if (pending[id] == 0) {
+      root_nodes_.push_back(item);
+      ready.push_back(n);
+    }
+  }
+
+  // A cycle would leave its nodes pending forever.
+  int num_visited = 0;
+  while (!ready.empty()) {
+    const Node* n = ready.front();
+    ready.pop_front();
+    ++num_visited;
+    for (const Edge* e : n->out_edges()) {
+      if (--pending[e->dst()->id()] == 0) ready.push_back(e->dst());
+    }
+  }
+  if (num_visited != graph_->num_nodes()) {
+    return errors::InvalidArgument(
+        "Straight-line executor requires an acyclic graph");
+  }
+
+  return gview_.SetAllocAttrs(graph_, params_.device);
+}
+
+// The state associated with one invocation of
+// StraightLineExecutorImpl::Run.
+class StraightLineExecutorState {
+ public:
+  StraightLineExecutorState(const Executor::Args& args,
+                            StraightLineExecutorImpl* impl);
+  ~StraightLineExecutorState();
+
+  void RunAsync(Executor::DoneCallback done);
+
+ private:
+  typedef gtl::InlinedVector<const NodeItem*, 8> ReadyNodes;
+  typedef std::deque<const NodeItem*> ReadyQueue;
+
+  // Runs "item", and then the ready nodes that are cheap enough to run
+  // inline on this thread.
+  void Process(const NodeItem* item, int64 scheduled_usec);
+
+  Status ProcessOutputs(const NodeItem& item, OpKernelContext* ctx,
+                        EntryVector* outputs, NodeExecStats* stats);
+  // Moves the outputs of "item" into the input slots of its consumers, and
+  // appends those that became ready to "ready".
+  void PropagateOutputs(const NodeItem& item, EntryVector* outputs,
+                        ReadyNodes* ready);
+
+  // Records the status and stats of a finished node and schedules "ready".
+  // Returns true iff the step is done.  See ExecutorState::NodeDone.
+  bool NodeDone(const Status& s, const Node* node, const ReadyNodes& ready,
+                NodeExecStats* stats, ReadyQueue* inline_ready);
+
+  // Appends the cheap nodes of "ready" to "inline_ready" and dispatches the
+  // others to the runner.  If "inline_ready" is null, dispatches all of
+  // them.
+  void ScheduleReady(const ReadyNodes& ready, ReadyQueue* inline_ready);
+
+  void Finish();
+
+  const bool vlog_;  // true if VLOG_IS_ON(1). Used to check vlog cheaply.
+
+  // true if LogMemory::IsEnabled(). Used to check memory enabled cheaply.
+  const bool log_memory_;
+
+  int64 step_id_;
+  // Not owned.
+  Rendezvous* rendezvous_;
+  SessionState* session_state_;
+  TensorStore* tensor_store_;
+  ScopedStepContainer* step_container_;
+  StepStatsCollector* stats_collector_;
+  checkpoint::TensorSliceReaderCacheWrapper* slice_reader_cache_;
+  FunctionCallFrame* call_frame_;
+  const StraightLineExecutorImpl* impl_;
+  CancellationManager* cancellation_manager_;
+  Executor::Args::Runner runner_;
+  bool sync_on_finish_;
+
+  DeviceContextMap device_context_map_;
+
+  // input_tensors_[item->input_start + i] holds the i-th input of item.
+  // Each slot is written by the unique producer of the edge and cleared
+  // by the consumer, which only runs once all its inputs are written.
+  std::unique_ptr<Entry[]> input_tensors_;
+
+  // pending_[id] is the number of in-edges of node "id" whose source has
+  // not completed yet.
+  std::unique_ptr<std::atomic_int_fast32_t[]> pending_;
+
+  Executor::DoneCallback done_cb_;
+
+  // The number of nodes that are ready or running.
+  std::atomic_int_fast32_t num_outstanding_ops_;
+
+  // Set once a node has failed; the nodes that are already ready are
+  // skipped and no further node becomes ready.
+  std::atomic<bool> aborted_;
+
+  mutex mu_;
+  Status status_ GUARDED_BY(mu_);
+};
+
+StraightLineExecutorState::StraightLineExecutorState(
+    const Executor::Args& args, StraightLineExecutorImpl* impl)
+    : vlog_(VLOG_IS_ON(1)),
+      log_memory_(LogMemory::IsEnabled()),
+      step_id_(args.step_id),
+      rendezvous_(args.rendezvous),
+      session_state_(args.session_state),
+      tensor_store_(args.tensor_store),
+      step_container_(args.step_container),
+      stats_collector_(args.stats_collector),
+      slice_reader_cache_(new checkpoint::TensorSliceReaderCacheWrapper),
+      call_frame_(args.call_frame),
+      impl_(impl),
+      cancellation_manager_(args.cancellation_manager),
+      runner_(args.runner),
+      sync_on_finish_(args.sync_on_finish),
+      input_tensors_(new Entry[impl->total_inputs_]),
+      pending_(new std::atomic_int_fast32_t[impl->initial_pending_.size()]),
+      num_outstanding_ops_(0),
+      aborted_(false) {
+  for (size_t i = 0; i < impl->initial_pending_.size(); ++i) {
+    pending_[i] = impl->initial_pending_[i];
+  }
+}
+
+StraightLineExecutorState::~StraightLineExecutorState() {
+  for (auto it : device_context_map_) {
+    it->Unref();
+  }
+  delete slice_reader_cache_;
+}
+
+void StraightLineExecutorState::RunAsync(Executor::DoneCallback done) {
+  // Ask the device to fill in the device context map.
+  Device* device = impl_->params_.device;
+  Status fill_status =
+      device->FillContextMap(impl_->graph_, &device_context_map_);
+  if (!fill_status.ok()) {
+    delete this;
+    done(fill_status);
+    return;
+  }
+  const std::vector<const NodeItem*>& roots = impl_->root_nodes_;
+  if (roots.empty()) {
+    delete this;
+    done(Status::OK());
+    return;
+  }
+  done_cb_ = done;
+  num_outstanding_ops_ = roots.size();
+  // Schedule to run all the ready ops in thread pool.
+  ScheduleReady(ReadyNodes(roots.begin(), roots.end()), nullptr);
+}
+
+void StraightLineExecutorState::Process(const NodeItem* item,
+                                        int64 scheduled_usec) {
+  ReadyNodes ready;
+  ReadyQueue inline_ready;
+
+  // Parameters passed to OpKernel::Compute.
+  TensorValueVec inputs;
+  DeviceContextVec input_device_contexts;
+  AllocatorAttributeVec input_alloc_attrs;
+
+  OpKernelContext::Params params;
+  params.step_id = step_id_;
+  Device* device = impl_->params_.device;
+  params.device = device;
+  params.log_memory = log_memory_;
+  params.record_tensor_accesses = impl_->device_record_tensor_accesses_;
+  params.rendezvous = rendezvous_;
+  params.session_state = session_state_;
+  params.tensor_store = tensor_store_;
+  params.cancellation_manager = cancellation_manager_;
+  params.call_frame = call_frame_;
+  params.function_library = impl_->params_.function_library;
+  params.resource_manager = device->resource_manager();
+  params.step_container = step_container_;
+  params.slice_reader_cache = slice_reader_cache_;
+  params.inputs = &inputs;
+  params.input_device_contexts = &input_device_contexts;
+  params.input_alloc_attrs = &input_alloc_attrs;
+  params.runner = &runner_;
+  params.frame_iter = FrameAndIter(0, 0);
+  params.is_input_dead = false;
+
+  EntryVector outputs;
+  bool completed = false;
+  inline_ready.push_back(item);
+  while (!inline_ready.empty()) {
+    item = inline_ready.front();
+    inline_ready.pop_front();
+    const Node* node = item->node;
+    const int id = node->id();
+    ready.clear();
+
+    if (aborted_) {
+      // Some node of this step has failed already.
+      completed = NodeDone(Status::OK(), node, ready, nullptr, &inline_ready);
+      continue;
+    }
+
+    params.op_device_context = nullptr;
+    if (id < device_context_map_.size()) {
+      params.op_device_context = device_context_map_[id];
+    }
+
+    NodeExecStats* stats = nullptr;
+    if (stats_collector_) {
+      // track allocations if and only if we are collecting statistics
+      params.track_allocations = true;
+      stats = new NodeExecStats;
+      stats->set_node_name(node->name());
+      nodestats::SetScheduled(stats, scheduled_usec);
+      nodestats::SetAllStart(stats);
+    }
+
+    if (vlog_) {
+      VLOG(1) << "Process node: " << id << " step " << params.step_id << " "
+              << SummarizeNodeDef(node->def());
+    }
+
+    Entry* first_input = input_tensors_.get() + item->input_start;
+    outputs.clear();
+    bool is_input_dead = false;
+    Status s = PrepareNodeInputs(*item, first_input, &inputs,
+                                 &input_device_contexts, &input_alloc_attrs,
+                                 &is_input_dead);
+    if (!s.ok()) {
+      ClearInputs(*item, first_input);
+      completed = NodeDone(s, node, ready, stats, &inline_ready);
+      continue;
+    }
+
+    OpKernel* op_kernel = item->kernel;
+    params.op_kernel = op_kernel;
+    params.output_attr_array = item->output_attrs();
+
+    if (item->kernel_is_async) {
+      AsyncOpKernel* async = op_kernel->AsAsync();
+      DCHECK(async != nullptr);
+      AsyncKernelState* state =
+          new AsyncKernelState(params, item, first_input, stats);
+      auto done = [this, state]() {
+        Device* device = impl_->params_.device;
+        NodeExecStats* stats = state->stats;  // Shorthand
+        const NodeItem& item = *state->item;  // Shorthand
+        if (stats) nodestats::SetOpEnd(stats);
+        EntryVector outputs;
+        Status s = ProcessOutputs(item, &state->ctx, &outputs, stats);
+        if (stats) nodestats::SetMemory(stats, &state->ctx);
+        ClearInputs(item, state->first_input);
+        ReadyNodes ready;
+        if (s.ok()) PropagateOutputs(item, &outputs, &ready);
+        if (s.ok() && impl_->device_record_tensor_accesses_) {
+          TensorReferenceVector accessed;
+          state->ctx.retrieve_accessed_tensors(&accessed);
+          if (stats) nodestats::SetReferencedTensors(stats, accessed);
+          device->ConsumeListOfAccessedTensors(state->ctx.op_device_context(),
+                                               accessed);
+        }
+        // The ready nodes go to the runner, so that a chain of asynchronous
+        // kernels completing inline does not grow the stack.
+        const bool completed = NodeDone(s, item.node, ready, stats, nullptr);
+        delete state;
+        if (completed) Finish();
+      };
+      if (stats) nodestats::SetOpStart(stats);
+      device->ComputeAsync(async, &state->ctx, done);
+      continue;
+    }
+
+    OpKernelContext ctx(&params, item->num_outputs);
+    if (stats) nodestats::SetOpStart(stats);
+    device->Compute(CHECK_NOTNULL(op_kernel), &ctx);
+    if (stats) nodestats::SetOpEnd(stats);
+    s = ProcessOutputs(*item, &ctx, &outputs, stats);
+    if (stats) nodestats::SetMemory(stats, &ctx);
+    ClearInputs(*item, first_input);
+    if (s.ok()) PropagateOutputs(*item, &outputs, &ready);
+    if (s.ok() && impl_->device_record_tensor_accesses_) {
+      TensorReferenceVector accessed;
+      ctx.retrieve_accessed_tensors(&accessed);
+      if (stats) nodestats::SetReferencedTensors(stats, accessed);
+      device->ConsumeListOfAccessedTensors(ctx.op_device_context(), accessed);
+    }
+    if (stats) {
+      scheduled_usec = nodestats::NowInUsec();
+    }
+    completed = NodeDone(s, node, ready, stats, &inline_ready);
+  }
+
+  // This thread of computation is done if completed = true.
+  if (completed) Finish();
+}
+
+Status StraightLineExecutorState::ProcessOutputs(const NodeItem& item,
+                                                 OpKernelContext* ctx,
+                                                 EntryVector* outputs,
+                                                 NodeExecStats* stats) {
+  DeviceContext* device_context = nullptr;
+  if (item.node->id() < device_context_map_.size()) {
+    device_context = device_context_map_[item.node->id()];
+  }
+  return ProcessNodeOutputs(item, ctx, device_context,
+                            impl_->params_.node_outputs_cb, log_memory_,
+                            outputs, stats);
+}
+
+void StraightLineExecutorState::PropagateOutputs(const NodeItem& item,
+                                                 EntryVector* outputs,
+                                                 ReadyNodes* ready) {
+  const GraphView& gview = impl_->gview_;
+  const EdgeInfo* edges = item.output_edge_list();
+  for (int out_index = 0; out_index < item.num_output_edges; out_index++) {
+    const EdgeInfo& e = edges[out_index];
+    const int src_slot = e.output_slot;
+    const NodeItem* dst_item = gview.node(e.dst_id);
+    if (src_slot != Graph::kControlSlot && !dst_item->is_sink) {
+      Entry* dst = input_tensors_.get() + dst_item->input_start + e.input_slot;
+      if (e.is_last) {
+        *dst = std::move((*outputs)[src_slot]);
+      } else {
+        *dst = (*outputs)[src_slot];
+      }
+    }
+    // The decrement publishes the input written above to the thread that
+    // runs the consumer.
+    if (pending_[e.dst_id].fetch_sub(1) == 1) {
+      ready->push_back(dst_item);
+    }
+  }
+}
+
+bool StraightLineExecutorState::NodeDone(const Status& s, const Node* node,
+                                         const ReadyNodes& ready,
+                                         NodeExecStats* stats,
+                                         ReadyQueue* inline_ready) {
+  if (stats) {
+    nodestats::SetAllEnd(stats);
+    if (!SetTimelineLabel(node, stats)) {
+      // Only record non-transfer nodes.
+      stats_collector_->Save(impl_->params_.device->name(), stats);
+    } else {
+      delete stats;
+    }
+  }
+
+  bool abort_run = false;
+  if (!s.ok()) {
+    mutex_lock l(mu_);
+    if (status_.ok()) {
+      abort_run = true;
+      status_ = s;
+    }
+  }
+  if (abort_run) {
+    aborted_ = true;
+    TRACEPRINTF("StartAbort: %s", s.ToString().c_str());
+    if (rendezvous_) {
+      rendezvous_->StartAbort(s);
+    }
+    if (cancellation_manager_) {
+      cancellation_manager_->StartCancel();
+    }
+  }
+
+  bool completed = false;
+  const int ready_size = ready.size();
+  if (ready_size == 0 || !s.ok()) {
+    completed = (num_outstanding_ops_.fetch_sub(1) == 1);
+  } else if (ready_size > 1) {
+    num_outstanding_ops_.fetch_add(ready_size - 1, std::memory_order_relaxed);
+  }
+  if (s.ok()) {
+    ScheduleReady(ready, inline_ready);
+  }
+  return completed;
+}
+
+void StraightLineExecutorState::ScheduleReady(const ReadyNodes& ready,
+                                              ReadyQueue* inline_ready) {
+  if (ready.empty()) return;
+
+  int64 scheduled_usec = 0;
+  if (stats_collector_) {
+    scheduled_usec = nodestats::NowInUsec();
+  }
+  if (inline_ready == nullptr) {
+    for (const NodeItem* item : ready) {
+      runner_([=]() { Process(item, scheduled_usec); });
+    }
+    return;
+  }
+  const NodeItem* curr_expensive_node = nullptr;
+  for (const NodeItem* item : ready) {
+    if (!item->kernel_is_expensive) {
+      inline_ready->push_back(item);
+    } else {
+      if (curr_expensive_node) {
+        runner_([this, curr_expensive_node, scheduled_usec]() {
+          Process(curr_expensive_node, scheduled_usec);
+        });
+      }
+      curr_expensive_node = item;
+    }
+  }
+  if (curr_expensive_node) {
+    if (inline_ready->empty()) {
+      inline_ready->push_back(curr_expensive_node);
+    } else {
+      runner_([this, curr_expensive_node, scheduled_usec]() {
+        Process(curr_expensive_node, scheduled_usec);
+      });
+    }
+  }
+}
+
+void StraightLineExecutorState::Finish() {
+  mu_.lock();
+  auto status = status_;
+  auto done_cb = std::move(done_cb_);
+  auto runner = std::move(runner_);
+  mu_.unlock();
+  if (sync_on_finish_ && status.ok()) {
+    status = impl_->params_.device->Sync();
+  }
+  delete this;
+  CHECK(done_cb != nullptr);
+  runner([=]() { done_cb(status); });
+}
+
+void StraightLineExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
+  (new StraightLineExecutorState(args, this))->RunAsync(done);
+}
+
 }  // end namespace
 
 Status NewLocalExecutor(const LocalExecutorParams& params, const Graph* graph,
@@ -2580,4 +3163,23 @@ Status CreateNonCachedKernel(Device* device, FunctionLibraryRuntime* flib,
 
 void DeleteNonCachedKernel(OpKernel* kernel) { delete kernel; }
 
+bool IsStraightLineGraph(const Graph* graph) {
+  for (const Node* n : graph->nodes()) {
+    if (n->IsControlFlow()) return false;
+  }
+  return true;
+}
+
+Status NewStraightLineExecutor(const LocalExecutorParams& params,
+                               const Graph* graph, Executor** executor) {
+  StraightLineExecutorImpl* impl = new StraightLineExecutorImpl(params, graph);
+  Status s = impl->Initialize();
+  if (s.ok()) {
+    *executor = impl;
+  } else {
+    delete impl;
+  }
+  return s;
+}
+
 }  // end namespace tensorflow
@@ -145,6 +145,24 @@ struct LocalExecutorParams {
 ::tensorflow::Status NewLocalExecutor(const LocalExecutorParams& params,
                                       const Graph* graph, Executor** executor);
 
+// Returns true iff "graph" contains no control-flow nodes (Switch, Merge,
+// Enter, Exit or NextIteration).  If this holds for every partition of a
+// step, no tensor of that step can be dead.
+bool IsStraightLineGraph(const Graph* graph);
+
+// Like NewLocalExecutor(), but creates an executor specialized for graphs
+// without control flow.  It starts each node once all its inputs are
+// available, like the executor returned by NewLocalExecutor(), but keeps a
+// single pending count per node and does not track frames, iterations or
+// dead tensors.
+//
+// REQUIRES: IsStraightLineGraph(graph), and no tensor received by the graph
+// may be dead (i.e. the step contains no control flow in any partition).
+// Returns an error if "graph" contains control flow.
+::tensorflow::Status NewStraightLineExecutor(const LocalExecutorParams& params,
+                                             const Graph* graph,
+                                             Executor** executor);
+
 // A class to help run multiple executors in parallel and wait until
 // all of them are complete.
 //
@@ -0,0 +1,139 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/graph_cache.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Appends the serialization of "proto" to "*out".  Map fields are
+// serialized in key order, so equal protos always produce equal bytes.
+void AppendDeterministic(const protobuf::MessageLite& proto, string* out) {
+  string bytes;
+  {
+    protobuf::io::StringOutputStream stream(&bytes);
+    protobuf::io::CodedOutputStream coded(&stream);
+    coded.SetSerializationDeterministic(true);
+    proto.ByteSize();  // Caches the sizes of nested messages.
+    proto.SerializeWithCachedSizes(&coded);
+  }
+  strings::StrAppend(out, bytes.size(), ":", bytes);
+}
+
+void AppendSorted(std::vector<string> names, string* out) {
+  std::sort(names.begin(), names.end());
+  strings::StrAppend(out, names.size(), ":");
+  for (const string& name : names) {
+    strings::StrAppend(out, name.size(), ":", name);
+  }
+}
+
+}  // namespace
+
+GraphCache::GraphCache(Env* env, const string& dir) : env_(env), dir_(dir) {}
+
+/* static */
+string GraphCache::ComputeKey(const GraphDef& graph_def,
+                              const BuildGraphOptions& options,
+                              const std::vector<Device*>& devices,
+                              const ConfigProto& config) {
+  string buf;
+  strings::StrAppend(&buf, TF_VERSION_STRING, ";", TF_GRAPH_DEF_VERSION, ";");
+  AppendDeterministic(graph_def, &buf);
+  AppendSorted(options.feed_endpoints, &buf);
+  AppendSorted(options.fetch_endpoints, &buf);
+  AppendSorted(options.target_nodes, &buf);
+
+  // The incarnation is chosen randomly by each process, so it is left out.
+  std::vector<string> device_descs;
+  for (const Device* d : devices) {
+    const DeviceAttributes& attrs = d->attributes();
+    string desc = strings::StrCat(attrs.name(), ";", attrs.device_type(), ";",
+                                  attrs.memory_limit(), ";");
+    AppendDeterministic(attrs.locality(), &desc);
+    device_descs.push_back(desc);
+  }
+  AppendSorted(device_descs, &buf);
+
+  // The placer honors soft placement and logs the placement of each node,
+  // neither of which happens for cached graphs, so both are part of the key.
+  strings::StrAppend(&buf, config.allow_soft_placement(), ";",
+                     config.log_device_placement(), ";");
+  AppendSorted(std::vector<string>(config.device_filters().begin(),
+                                   config.device_filters().end()),
+               &buf);
+
+  // The location of the cache does not affect its contents.
+  GraphOptions key_options = config.graph_options();
+  key_options.clear_graph_cache_dir();
+  AppendDeterministic(key_options, &buf);
+
+  const Fprint128 fp = Fingerprint128(buf);
+  return strings::Printf("%016llx%016llx",
+                         static_cast<unsigned long long>(fp.high64),
+                         static_cast<unsigned long long>(fp.low64));
+}
+
+string GraphCache::EntryPath(const string& key) const {
+  return io::JoinPath(dir_, strings::StrCat(key, ".graphs"));
+}
+
+Status GraphCache::Lookup(const string& key,
+                          CachedPartitionGraphs* entry) const {
+  const string path = EntryPath(key);
+  if (!env_->FileExists(path).ok()) {
+    return errors::NotFound("No cached graphs for key ", key);
+  }
+  Status s = ReadBinaryProto(env_, path, entry);
+  if (!s.ok()) {
+    return errors::DataLoss("Failed to read cached graphs from ", path, ": ",
+                            s.error_message());
+  }
+  if (entry->key() != key) {
+    return errors::DataLoss("Cached graphs in ", path, " have key ",
+                            entry->key(), ", expected ", key);
+  }
+  return Status::OK();
+}
+
+Status GraphCache::Insert(const string& key,
+                          const CachedPartitionGraphs& entry) const {
+  if (!env_->FileExists(dir_).ok()) {
+    TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(dir_));
+  }
+  const string path = EntryPath(key);
+  const string tmp_path = strings::StrCat(path, ".tmp", env_->NowMicros(),
+                                          "_", random::New64());
+  TF_RETURN_IF_ERROR(WriteBinaryProto(env_, tmp_path, entry));
+  Status s = env_->RenameFile(tmp_path, path);
+  if (!s.ok()) {
+    env_->DeleteFile(tmp_path).IgnoreError();
+  }
+  return s;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,74 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_GRAPH_CACHE_H_
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/build_graph_options.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/graph_cache.pb.h"
+
+namespace tensorflow {
+
+// A persistent cache of the placed, partitioned and optimized graphs that a
+// session builds for one set of feeds, fetches and targets.  Entries are
+// stored one file per key under a directory, so several processes may share
+// the same cache.  See GraphOptions.graph_cache_dir.
+//
+// This class is thread-safe.
+class GraphCache {
+ public:
+  // Does not take ownership of "env".
+  GraphCache(Env* env, const string& dir);
+
+  // Returns the cache key for running "graph_def" with "options" on
+  // "devices" in a session configured by "config".  The key covers
+  // everything that affects placement, partitioning and optimization:
+  // the graph options, soft placement, device placement logging and the
+  // device filters, as well as the TensorFlow version.
+  static string ComputeKey(const GraphDef& graph_def,
+                           const BuildGraphOptions& options,
+                           const std::vector<Device*>& devices,
+                           const ConfigProto& config);
+
+  // Reads the entry for "key" into "*entry".  Returns NotFound if there is
+  // no such entry, and DataLoss if the entry cannot be parsed.
+  Status Lookup(const string& key, CachedPartitionGraphs* entry) const;
+
+  // Stores "entry" under "key", replacing any existing entry.  The entry is
+  // written to a temporary file first and then renamed, so that concurrent
+  // readers never observe a partially written entry.
+  Status Insert(const string& key, const CachedPartitionGraphs& entry) const;
+
+ private:
+  string EntryPath(const string& key) const;
+
+  Env* const env_;  // Not owned.
+  const string dir_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(GraphCache);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_GRAPH_CACHE_H_
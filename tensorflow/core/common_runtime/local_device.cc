@@ -16,12 +16,18 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/common_runtime/local_device.h"
+
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/common_runtime/eigen_thread_pool.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/cpu_feature_guard.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -31,17 +37,28 @@ namespace tensorflow {
 bool LocalDevice::use_global_threadpool_ = true;
 
 struct LocalDevice::EigenThreadPoolInfo {
-  EigenThreadPoolInfo(const SessionOptions& options) {
+  // If 'numa_node' is not port::kNUMANoAffinity, the worker threads are
+  // pinned to that node and default to one thread per core of the node.
+  EigenThreadPoolInfo(const SessionOptions& options, int numa_node) {
     int32 intra_op_parallelism_threads =
         options.config.intra_op_parallelism_threads();
     if (intra_op_parallelism_threads == 0) {
-      intra_op_parallelism_threads = port::NumSchedulableCPUs();
+      intra_op_parallelism_threads =
+          numa_node == port::kNUMANoAffinity
+              ? port::NumSchedulableCPUs()
+              : port::NUMANumSchedulableCPUs(numa_node);
     }
     VLOG(1) << "Local device intra op parallelism threads: "
             << intra_op_parallelism_threads;
+    ThreadOptions thread_options;
+    thread_options.numa_node = numa_node;
     eigen_worker_threads_.num_threads = intra_op_parallelism_threads;
     eigen_worker_threads_.workers = new thread::ThreadPool(
-        options.env, "Eigen", intra_op_parallelism_threads);
+        options.env, thread_options,
+        numa_node == port::kNUMANoAffinity
+            ? "Eigen"
+            : strings::StrCat("Eigen_numa", numa_node),
+        intra_op_parallelism_threads);
     eigen_threadpool_wrapper_.reset(
         new EigenThreadPoolWrapper(eigen_worker_threads_.workers));
     eigen_device_.reset(new Eigen::ThreadPoolDevice(
@@ -68,16 +85,33 @@ LocalDevice::LocalDevice(const SessionOptions& options,
   // best flags for performance.
   port::WarnAboutUnusedCPUFeatures();
   LocalDevice::EigenThreadPoolInfo* tp_info;
-  if (use_global_threadpool_) {
+  const int numa_node = attributes.locality().numa_node() - 1;
+  if (use_global_threadpool_ && numa_node != port::kNUMANoAffinity) {
+    // All ThreadPoolDevices bound to the same NUMA node share a single
+    // threadpool pinned to the cores of that node.
+    static mutex numa_mu(LINKER_INITIALIZED);
+    static std::vector<LocalDevice::EigenThreadPoolInfo*>* numa_tp_info =
+        new std::vector<LocalDevice::EigenThreadPoolInfo*>;
+    mutex_lock l(numa_mu);
+    if (numa_node >= static_cast<int>(numa_tp_info->size())) {
+      numa_tp_info->resize(numa_node + 1, nullptr);
+    }
+    if ((*numa_tp_info)[numa_node] == nullptr) {
+      (*numa_tp_info)[numa_node] =
+          new LocalDevice::EigenThreadPoolInfo(options, numa_node);
+    }
+    tp_info = (*numa_tp_info)[numa_node];
+  } else if (use_global_threadpool_) {
     // All ThreadPoolDevices in the process will use this single fixed
     // sized threadpool for numerical computations.
     static LocalDevice::EigenThreadPoolInfo* global_tp_info =
-        new LocalDevice::EigenThreadPoolInfo(options);
+        new LocalDevice::EigenThreadPoolInfo(options, port::kNUMANoAffinity);
     tp_info = global_tp_info;
   } else {
     // Each LocalDevice owns a separate ThreadPoolDevice for numerical
     // computations.
-    owned_tp_info_.reset(new LocalDevice::EigenThreadPoolInfo(options));
+    owned_tp_info_.reset(
+        new LocalDevice::EigenThreadPoolInfo(options, numa_node));
     tp_info = owned_tp_info_.get();
   }
   set_tensorflow_cpu_worker_threads(&tp_info->eigen_worker_threads_);
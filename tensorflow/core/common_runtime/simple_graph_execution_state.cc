@@ -46,6 +46,7 @@ SimpleGraphExecutionState::SimpleGraphExecutionState(
     : stateful_placements_(options.stateful_placements),
       device_set_(options.device_set),
       session_options_(options.session_options),
+      defer_base_graph_(options.defer_base_graph),
       costs_(true /*is_global*/),
       flib_def_(new FunctionLibraryDefinition(OpRegistry::Global(),
                                               graph_def->library())),
@@ -74,7 +75,8 @@ SimpleGraphExecutionState::~SimpleGraphExecutionState() {
   // TODO(mrry): Refactor InitBaseGraph() so that we don't have to
   // pass an empty BuildGraphOptions (that isn't going to be used when
   // place_pruned_graph is false).
-  if (!ret->session_options_->config.graph_options().place_pruned_graph()) {
+  if (!ret->session_options_->config.graph_options().place_pruned_graph() &&
+      !ret->defer_base_graph_) {
     TF_RETURN_IF_ERROR(ret->InitBaseGraph(BuildGraphOptions()));
   }
   *out_state = std::move(ret);
@@ -184,6 +186,7 @@ Status SimpleGraphExecutionState::Extend(
   combined_options.device_set = device_set_;
   combined_options.session_options = session_options_;
   combined_options.stateful_placements = stateful_placements_;
+  combined_options.defer_base_graph = defer_base_graph_;
 
   // NOTE(mrry): `gdef` is no longer valid after the constructor
   // executes.
@@ -192,7 +195,8 @@ Status SimpleGraphExecutionState::Extend(
 
   TF_RETURN_IF_ERROR(AddDefaultAttrsToGraphDef(
       &new_execution_state->original_graph_def_, *flib_def_.get(), 0));
-  if (!session_options_->config.graph_options().place_pruned_graph()) {
+  if (!session_options_->config.graph_options().place_pruned_graph() &&
+      !defer_base_graph_) {
     // TODO(mrry): Refactor InitBaseGraph() so that we don't have to
     // pass an empty BuildGraphOptions (that isn't going to be used
     // when place_pruned_graph is false).
@@ -227,6 +231,20 @@ void SimpleGraphExecutionState::RestoreStatefulNodes(Graph* graph) {
   }
 }
 
+Status SimpleGraphExecutionState::InitBaseGraphIfDeferred(
+    const std::unordered_map<string, string>& stateful_placements) {
+  if (graph_ != nullptr || !defer_base_graph_ ||
+      session_options_->config.graph_options().place_pruned_graph()) {
+    return Status::OK();
+  }
+  {
+    mutex_lock l(mu_);
+    stateful_placements_.insert(stateful_placements.begin(),
+                                stateful_placements.end());
+  }
+  return InitBaseGraph(BuildGraphOptions());
+}
+
 Status SimpleGraphExecutionState::InitBaseGraph(
     const BuildGraphOptions& options) {
   const GraphDef* graph_def = &original_graph_def_;
@@ -45,6 +45,10 @@ struct SimpleGraphExecutionStateOptions {
   // A map from node name to device name, representing the unchangeable
   // placement of stateful nodes.
   std::unordered_map<string, string> stateful_placements;
+  // If true, and place_pruned_graph is false, the full graph is not placed
+  // on creation but by InitBaseGraphIfDeferred(), so that a session that
+  // takes its graphs from elsewhere never runs the placer.
+  bool defer_base_graph = false;
 };
 
 // A SimpleClientGraph is simply a sub-graph of the full graph as induced by
@@ -133,6 +137,16 @@ class SimpleGraphExecutionState {
   Status BuildGraph(const BuildGraphOptions& options,
                     std::unique_ptr<SimpleClientGraph>* out);
 
+  // If the placement of the full graph was deferred (see
+  // SimpleGraphExecutionStateOptions::defer_base_graph) and has not been
+  // done yet, places it, keeping the nodes of "stateful_placements" on
+  // their devices.  Must not be called concurrently with BuildGraph().
+  Status InitBaseGraphIfDeferred(
+      const std::unordered_map<string, string>& stateful_placements);
+
+  // Returns true if the full graph has been placed.
+  bool base_graph_placed() const { return graph_ != nullptr; }
+
   // The graph returned by BuildGraph may contain only the pruned
   // graph, whereas some clients may want access to the full graph.
   const Graph* full_graph() {
@@ -172,13 +186,14 @@ class SimpleGraphExecutionState {
   // nodes can not be moved to a different device.  Maps node names to
   // device names.
   std::unordered_map<string, string> stateful_placements_;  // Immutable after
-                                                            // ctor.
+                                                            // placement.
   void SaveStatefulNodes(Graph* graph);
   void RestoreStatefulNodes(Graph* graph);
 
   GraphDef original_graph_def_;            // Immutable after ctor.
   const DeviceSet* device_set_;            // Not owned
   const SessionOptions* session_options_;  // Not owned
+  const bool defer_base_graph_;
 
   mutable mutex mu_;
   CostModel costs_ GUARDED_BY(mu_);
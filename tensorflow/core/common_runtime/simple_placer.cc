@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <memory>
 #include <set>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -262,6 +263,9 @@ class ColocationGraph {
     members_[node_root].device_name = device;
   }
 
+  // Returns the id of the root of 'node's colocation group.
+  int ColocationGroupRoot(const Node& node) { return FindRoot(node.id()); }
+
   // For the given node, subject to the constraints previously given
   // to this ColocationGraph, set its assigned_device_name. Returns OK
   // if a satisfying device can be found, otherwise an error.
@@ -608,6 +612,80 @@ bool IsGeneratorNode(const Node* node) {
          !IsRefType(node->output_type(0));
 }
 
+// Returns true if 'device' is bound to a NUMA node.
+bool IsNUMADevice(const Device* device) {
+  return device->attributes().locality().numa_node() > 0;
+}
+
+// Returns, for each node id in 'graph', the name of the device in
+// 'numa_devices' on which that node's part of the graph should run.  A part
+// is a weakly connected component of the graph in which the members of each
+// colocation group are also joined, so that e.g. each replica of a model
+// stays on one NUMA node.  A part goes to the NUMA device that one of its
+// nodes is assigned or pinned to, and otherwise to the next NUMA device in
+// turn.
+std::vector<string> NUMADevicesForNodes(
+    const Graph& graph, ColocationGraph* colocation_graph,
+    const std::vector<Device*>& numa_devices) {
+  std::vector<int> parent(graph.num_node_ids());
+  for (size_t i = 0; i < parent.size(); ++i) parent[i] = i;
+  auto find_root = [&parent](int id) {
+    while (parent[id] != id) {
+      parent[id] = parent[parent[id]];
+      id = parent[id];
+    }
+    return id;
+  };
+  for (Node* node : graph.nodes()) {
+    if (!node->IsOp()) continue;
+    parent[find_root(node->id())] =
+        find_root(colocation_graph->ColocationGroupRoot(*node));
+    for (const Edge* edge : node->in_edges()) {
+      if (!edge->src()->IsOp()) continue;
+      parent[find_root(edge->src()->id())] = find_root(node->id());
+    }
+  }
+
+  std::unordered_map<int, string> part_devices;
+  for (Node* node : graph.nodes()) {
+    if (!node->IsOp()) continue;
+    const int root = find_root(node->id());
+    if (part_devices.count(root) > 0) continue;
+    const DeviceNameUtils::ParsedName requested =
+        colocation_graph->DeviceForNode(*node);
+    const Device* match = nullptr;
+    int num_matches = 0;
+    for (const Device* device : numa_devices) {
+      if (node->assigned_device_name() == device->name()) {
+        match = device;
+        num_matches = 1;
+        break;
+      }
+      if (node->assigned_device_name().empty() &&
+          DeviceNameUtils::IsSpecification(requested, device->parsed_name())) {
+        match = device;
+        ++num_matches;
+      }
+    }
+    if (num_matches == 1) part_devices[root] = match->name();
+  }
+  int next_device = 0;
+  for (Node* node : graph.nodes()) {
+    if (!node->IsOp()) continue;
+    const int root = find_root(node->id());
+    if (part_devices.count(root) == 0) {
+      part_devices[root] =
+          numa_devices[next_device++ % numa_devices.size()]->name();
+    }
+  }
+
+  std::vector<string> result(graph.num_node_ids());
+  for (Node* node : graph.nodes()) {
+    if (node->IsOp()) result[node->id()] = part_devices[find_root(node->id())];
+  }
+  return result;
+}
+
 }  // namespace
 
 SimplePlacer::SimplePlacer(Graph* graph, const DeviceSet* devices,
@@ -707,6 +785,20 @@ Status SimplePlacer::Run() {
     }
   }
 
+  // If the session asked for NUMA affinity, find the NUMA-bound device for
+  // each part of the graph (Heuristic C below).
+  std::vector<string> numa_devices_for_nodes;
+  if (options_ != nullptr && options_->config.use_numa_affinity()) {
+    std::vector<Device*> numa_devices;
+    for (Device* device : devices_->devices()) {
+      if (IsNUMADevice(device)) numa_devices.push_back(device);
+    }
+    if (numa_devices.size() > 1) {
+      numa_devices_for_nodes =
+          NUMADevicesForNodes(*graph_, &colocation_graph, numa_devices);
+    }
+  }
+
   // 3. For each node, assign a device based on the constraints in the
   // disjoint node set.
   std::vector<Device*> devices;
@@ -757,6 +849,14 @@ Status SimplePlacer::Run() {
     // to perform good placement we can add an interface for this.
     string assigned_device = devices[0]->name();
 
+    // Heuristic C: if the node would go to a NUMA-bound CPU device, place
+    // it on the NUMA device chosen for its part of the graph instead, so
+    // that its inputs and outputs stay in that node's memory.
+    if (!numa_devices_for_nodes.empty() && IsNUMADevice(devices[0]) &&
+        CanAssignToDevice(numa_devices_for_nodes[node->id()], devices)) {
+      assigned_device = numa_devices_for_nodes[node->id()];
+    }
+
     // Heuristic B: If the node only operates on metadata, not data,
     // then it is desirable to place that metadata node with its
     // input.
@@ -790,6 +890,12 @@ Status SimplePlacer::Run() {
 
     string assigned_device = devices[0]->name();
 
+    // Heuristic C application.
+    if (!numa_devices_for_nodes.empty() && IsNUMADevice(devices[0]) &&
+        CanAssignToDevice(numa_devices_for_nodes[node->id()], devices)) {
+      assigned_device = numa_devices_for_nodes[node->id()];
+    }
+
     // Heuristic A application.
     if (IsGeneratorNode(node)) {
       const Node* output = (*node->out_edges().begin())->dst();
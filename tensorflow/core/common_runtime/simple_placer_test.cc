@@ -80,6 +80,15 @@ class FakeDevice : public Device {
     return std::unique_ptr<Device>(new FakeDevice(device_attributes));
   }
 
+  static std::unique_ptr<Device> MakeNUMACPU(const string& name,
+                                             int numa_node) {
+    DeviceAttributes device_attributes;
+    device_attributes.set_name(name);
+    device_attributes.set_device_type(DeviceType("FakeCPU").type());
+    device_attributes.mutable_locality()->set_numa_node(numa_node + 1);
+    return std::unique_ptr<Device>(new FakeDevice(device_attributes));
+  }
+
   static std::unique_ptr<Device> MakeGPU(const string& name) {
     DeviceAttributes device_attributes;
     device_attributes.set_name(name);
@@ -1297,5 +1306,64 @@ TEST_F(SimplePlacerTest, TestGeneratorNodeDoesntFollowNonColocatedConsumers) {
   EXPECT_DEVICE_TYPE(g, "in", "FakeGPU");
 }
 
+// Test that with NUMA affinity each connected part of the graph stays on
+// one NUMA-bound device: the one it is pinned to, or else the next in turn.
+TEST_F(SimplePlacerTest, TestNUMAAffinityKeepsPartsTogether) {
+  DeviceSet numa_devices;
+  for (int i = 0; i < 2; ++i) {
+    local_devices_.emplace_back(FakeDevice::MakeNUMACPU(
+        strings::StrCat("/job:a/replica:0/task:0/device:fakecpu:", i), i));
+    numa_devices.AddDevice(local_devices_.back().get());
+  }
+
+  Graph g(OpRegistry::Global());
+  {  // Scope for temporary variables used to construct g.
+    GraphDefBuilder b(GraphDefBuilder::kFailImmediately);
+    for (const string& part : {"a", "b"}) {
+      Node* input = ops::SourceOp(
+          "TestInput", b.opts().WithName(strings::StrCat("in_", part)));
+      ops::UnaryOp("TestRelu", ops::NodeOut(input, 0),
+                   b.opts().WithName(strings::StrCat("relu_", part)));
+    }
+    Node* input = ops::SourceOp("TestInput", b.opts().WithName("in_c"));
+    ops::UnaryOp("TestRelu", ops::NodeOut(input, 0),
+                 b.opts().WithName("relu_c").WithDevice("/device:fakecpu:1"));
+    TF_EXPECT_OK(BuildGraph(b, &g));
+  }
+
+  SessionOptions options;
+  options.config.set_use_numa_affinity(true);
+  TF_EXPECT_OK(Place(&g, &numa_devices, &options));
+  EXPECT_DEVICE_CONTAINS(g, "in_a", "/device:fakecpu:0");
+  EXPECT_DEVICE_CONTAINS(g, "relu_a", "/device:fakecpu:0");
+  EXPECT_DEVICE_CONTAINS(g, "in_b", "/device:fakecpu:1");
+  EXPECT_DEVICE_CONTAINS(g, "relu_b", "/device:fakecpu:1");
+  EXPECT_DEVICE_CONTAINS(g, "in_c", "/device:fakecpu:1");
+  EXPECT_DEVICE_CONTAINS(g, "relu_c", "/device:fakecpu:1");
+}
+
+// Test that without NUMA affinity unpinned nodes go to the first device.
+TEST_F(SimplePlacerTest, TestNoNUMAAffinityUsesFirstDevice) {
+  DeviceSet numa_devices;
+  for (int i = 0; i < 2; ++i) {
+    local_devices_.emplace_back(FakeDevice::MakeNUMACPU(
+        strings::StrCat("/job:a/replica:0/task:0/device:fakecpu:", i), i));
+    numa_devices.AddDevice(local_devices_.back().get());
+  }
+
+  Graph g(OpRegistry::Global());
+  {  // Scope for temporary variables used to construct g.
+    GraphDefBuilder b(GraphDefBuilder::kFailImmediately);
+    ops::SourceOp("TestInput", b.opts().WithName("in_a"));
+    ops::SourceOp("TestInput", b.opts().WithName("in_b"));
+    TF_EXPECT_OK(BuildGraph(b, &g));
+  }
+
+  SessionOptions options;
+  TF_EXPECT_OK(Place(&g, &numa_devices, &options));
+  EXPECT_DEVICE_CONTAINS(g, "in_a", "/device:fakecpu:0");
+  EXPECT_DEVICE_CONTAINS(g, "in_b", "/device:fakecpu:0");
+}
+
 }  // namespace
 }  // namespace tensorflow
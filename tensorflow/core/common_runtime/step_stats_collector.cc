@@ -14,16 +14,58 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/graph/costmodel.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/strings/scanner.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 
 namespace tensorflow {
 
-StepStatsCollector::StepStatsCollector(StepStats* ss) : step_stats_(ss) {}
+namespace {
+
+// Source of StepStatsCollector::id_.  Ids are never reused, unlike the
+// addresses of collectors, so a per-thread cache can not confuse a new
+// collector, or merged buffers, with the buffers it remembers.
+std::atomic<uint64> next_collector_id(1);
+
+}  // namespace
+
+// The stats saved by one thread into a buffered collector.  Only the owning
+// thread appends to it; Finalize() reads it after the step is done.
+struct StepStatsCollector::ThreadBuffer {
+  ThreadBuffer* next = nullptr;
+
+  // The devices seen by this thread.  There are only a few, so they are
+  // searched linearly, starting with the last one used.
+  std::vector<string> devices;
+  int last_device = -1;
+
+  // A ring of pairs of an index into "devices" and the owned stats.  Once
+  // it holds kMaxBufferedNodesPerThread stats, "oldest" is the slot that
+  // the next stats replace.
+  std::vector<std::pair<int, NodeExecStats*>> stats;
+  size_t oldest = 0;
+  int64 num_dropped = 0;
+};
+
+constexpr int StepStatsCollector::kMaxBufferedNodesPerThread;
+
+StepStatsCollector::StepStatsCollector(StepStats* ss, bool buffered)
+    : step_stats_(ss),
+      buffered_(buffered),
+      id_(next_collector_id.fetch_add(1, std::memory_order_relaxed)),
+      buffers_(nullptr) {}
+
+StepStatsCollector::~StepStatsCollector() { Finalize(); }
 
 static int ExtractGpuWithStreamAll(string device_name) {
   // Check if the device name matches the ".*gpu:(\\d+)/stream:all$" regexp,
@@ -89,6 +131,7 @@ void StepStatsCollector::BuildCostModel(
     CostModelManager* cost_model_manager,
     const std::unordered_map<string, const Graph*>& device_map) {
   mutex_lock lock(mu_);
+  FinalizeLocked();
 
   // Hardware stats for gpu are available under a fake device named
   // "gpu:<id>/stream::all.
@@ -205,8 +248,55 @@ void StepStatsCollector::BuildCostModel(
   }
 }
 
+StepStatsCollector::ThreadBuffer* StepStatsCollector::GetThreadBuffer() {
+  // A small direct-mapped cache, so that a thread that alternates between
+  // the nodes of a few concurrent steps keeps using the same buffers.
+  static constexpr int kCacheSize = 4;
+  struct CacheEntry {
+    uint64 id;
+    ThreadBuffer* buffer;
+  };
+  static thread_local CacheEntry cache[kCacheSize] = {};
+  const uint64 id = id_.load(std::memory_order_relaxed);
+  CacheEntry* entry = &cache[id % kCacheSize];
+  if (entry->id == id) return entry->buffer;
+
+  ThreadBuffer* buffer = new ThreadBuffer;
+  buffer->next = buffers_.load(std::memory_order_relaxed);
+  while (!buffers_.compare_exchange_weak(buffer->next, buffer,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+  }
+  entry->id = id;
+  entry->buffer = buffer;
+  return buffer;
+}
+
 void StepStatsCollector::Save(const string& device, NodeExecStats* nt) {
   VLOG(1) << "Save dev " << device << " nt " << nt;
+  if (buffered_) {
+    ThreadBuffer* buffer = GetThreadBuffer();
+    int index = buffer->last_device;
+    if (index < 0 || buffer->devices[index] != device) {
+      index = std::find(buffer->devices.begin(), buffer->devices.end(),
+                        device) -
+              buffer->devices.begin();
+      if (index == buffer->devices.size()) {
+        buffer->devices.push_back(device);
+      }
+      buffer->last_device = index;
+    }
+    if (buffer->stats.size() < kMaxBufferedNodesPerThread) {
+      buffer->stats.emplace_back(index, nt);
+    } else {
+      std::pair<int, NodeExecStats*>& slot = buffer->stats[buffer->oldest];
+      delete slot.second;
+      slot = std::make_pair(index, nt);
+      buffer->oldest = (buffer->oldest + 1) % buffer->stats.size();
+      ++buffer->num_dropped;
+    }
+    return;
+  }
   {
     mutex_lock l(mu_);
     if (!step_stats_ || collectedNodes >= kMaxCollectedNodes) {
@@ -234,9 +324,79 @@ void StepStatsCollector::Save(const string& device, NodeExecStats* nt) {
   delete nt;
 }
 
+void StepStatsCollector::Finalize() {
+  if (!buffered_) return;
+  mutex_lock l(mu_);
+  FinalizeLocked();
+}
+
+void StepStatsCollector::FinalizeLocked() {
+  if (!buffered_) return;
+  ThreadBuffer* buffer = buffers_.exchange(nullptr, std::memory_order_acquire);
+  std::unordered_map<string, DeviceStepStats*> device_stats;
+  if (step_stats_) {
+    for (auto& ds : *step_stats_->mutable_dev_stats()) {
+      device_stats[ds.device()] = &ds;
+    }
+  }
+  while (buffer != nullptr) {
+    if (buffer->num_dropped > 0) {
+      VLOG(1) << "Dropped the " << buffer->num_dropped
+              << " oldest stats of a thread.";
+    }
+    std::vector<DeviceStepStats*> dss(buffer->devices.size(), nullptr);
+    // Merge the ring from its oldest stats on.
+    for (size_t i = 0; i < buffer->stats.size(); ++i) {
+      const auto& index_and_stats =
+          buffer->stats[(buffer->oldest + i) % buffer->stats.size()];
+      NodeExecStats* nt = index_and_stats.second;
+      if (step_stats_ && collectedNodes < kMaxCollectedNodes) {
+        DeviceStepStats*& ds = dss[index_and_stats.first];
+        if (ds == nullptr) {
+          const string& device = buffer->devices[index_and_stats.first];
+          DeviceStepStats*& named_ds = device_stats[device];
+          if (named_ds == nullptr) {
+            named_ds = step_stats_->add_dev_stats();
+            named_ds->set_device(device);
+          }
+          ds = named_ds;
+        }
+        nt->Swap(ds->add_node_stats());
+        collectedNodes++;
+      }
+      delete nt;
+    }
+    ThreadBuffer* next = buffer->next;
+    delete buffer;
+    buffer = next;
+  }
+  id_.store(next_collector_id.fetch_add(1, std::memory_order_relaxed),
+            std::memory_order_relaxed);
+}
+
+bool ShouldTraceStep(const RunOptions& run_options, int64 step_id,
+                     std::atomic<int64>* trace_step_counter) {
+  if (run_options.trace_every_n_steps() > 0 &&
+      trace_step_counter->fetch_add(1, std::memory_order_relaxed) %
+              run_options.trace_every_n_steps() !=
+          0) {
+    return false;
+  }
+  const double fraction = run_options.trace_sample_fraction();
+  if (fraction > 0 && fraction < 1) {
+    // Step ids are consecutive, so hash them for a uniform sample without
+    // touching shared random state.
+    const uint64 h = Hash64(reinterpret_cast<const char*>(&step_id),
+                            sizeof(step_id), 0xDECAFCAFFE);
+    return h < static_cast<uint64>(fraction * 18446744073709551615.0);
+  }
+  return true;
+}
+
 void StepStatsCollector::Swap(StepStats* ss) {
   mutex_lock l(mu_);
   CHECK(step_stats_);
+  FinalizeLocked();
   ss->Swap(step_stats_);
   collectedNodes = 0;
 }
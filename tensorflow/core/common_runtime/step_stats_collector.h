@@ -15,7 +15,10 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_STEP_STATS_COLLECTOR_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_STEP_STATS_COLLECTOR_H_
 
+#include <atomic>
 #include <unordered_map>
+
+#include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
@@ -25,14 +28,27 @@ namespace tensorflow {
 class CostModelManager;
 class Graph;
 class NodeExecStats;
+class RunOptions;
 class StepStats;
 
 // StepStatsCollector manages the collection of a StepStats object.
 // The StepStats object holds multiple DeviceStats.
 // Each DeviceStats object holds multiple NodeExecStats.
+//
+// A buffered collector does not take a lock in Save(): every calling thread
+// appends to a buffer of its own, and the buffers are merged into the
+// StepStats object by Finalize() once the step is done.  This keeps the
+// cost of tracing a step low when many threads run its nodes.  Each buffer
+// is a ring of at most kMaxBufferedNodesPerThread stats, which keeps the
+// most recent ones.
 class StepStatsCollector {
  public:
-  explicit StepStatsCollector(StepStats* ss);
+  static constexpr int kMaxBufferedNodesPerThread = 1 << 16;
+
+  explicit StepStatsCollector(StepStats* ss, bool buffered = false);
+
+  // Calls Finalize().
+  ~StepStatsCollector();
 
   // BuildCostModel builds or updates a CostModel managed by cost_model_manager,
   // using the currently collected DeviceStats associated with the devices in
@@ -47,15 +63,43 @@ class StepStatsCollector {
   // Swap replaces the current step stats with ss.
   void Swap(StepStats* ss);
 
+  // Merges the stats buffered by Save() into the StepStats object.  Must not
+  // be called concurrently with Save().  BuildCostModel() and Swap() call it
+  // first.  A no-op for unbuffered collectors.
+  void Finalize();
+
  private:
+  struct ThreadBuffer;
+
+  // Returns the buffer of the calling thread, creating it if needed.
+  ThreadBuffer* GetThreadBuffer();
+
+  void FinalizeLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // TODO(suharshs): Make this configurable if its not possible to find a value
   //                 that works for all cases.
   const uint64 kMaxCollectedNodes = 1 << 20;
   mutex mu_;
   StepStats* step_stats_ GUARDED_BY(mu_);
   uint64 collectedNodes GUARDED_BY(mu_) = 0;
+
+  // Only used by buffered collectors.
+  const bool buffered_;
+  // Identifies the current buffers of this collector in per-thread caches.
+  // Changes whenever the buffers are merged.
+  std::atomic<uint64> id_;
+  std::atomic<ThreadBuffer*> buffers_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepStatsCollector);
 };
 
+// Returns true if a step with "step_id" whose "run_options" request tracing
+// is sampled for tracing by RunOptions.trace_every_n_steps and
+// RunOptions.trace_sample_fraction.  "*trace_step_counter" counts the steps
+// of a session that requested tracing.
+bool ShouldTraceStep(const RunOptions& run_options, int64 step_id,
+                     std::atomic<int64>* trace_step_counter);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_STEP_STATS_COLLECTOR_H_
@@ -0,0 +1,145 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_stats_collector.h"
+
+#include <map>
+
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace {
+
+NodeExecStats* MakeStats(const string& name) {
+  NodeExecStats* stats = new NodeExecStats;
+  stats->set_node_name(name);
+  return stats;
+}
+
+// Returns the number of saved stats per device.
+std::map<string, int> CountStats(const StepStats& step_stats) {
+  std::map<string, int> counts;
+  for (const auto& ds : step_stats.dev_stats()) {
+    counts[ds.device()] += ds.node_stats_size();
+  }
+  return counts;
+}
+
+TEST(StepStatsCollectorTest, Unbuffered) {
+  StepStats step_stats;
+  StepStatsCollector collector(&step_stats);
+  collector.Save("/cpu:0", MakeStats("a"));
+  collector.Save("/cpu:1", MakeStats("b"));
+  collector.Save("/cpu:0", MakeStats("c"));
+  // Visible without Finalize().
+  EXPECT_EQ((std::map<string, int>{{"/cpu:0", 2}, {"/cpu:1", 1}}),
+            CountStats(step_stats));
+}
+
+TEST(StepStatsCollectorTest, BufferedMergesOnFinalize) {
+  StepStats step_stats;
+  StepStatsCollector collector(&step_stats, true /* buffered */);
+  collector.Save("/cpu:0", MakeStats("a"));
+  collector.Save("/cpu:1", MakeStats("b"));
+  collector.Save("/cpu:0", MakeStats("c"));
+  EXPECT_EQ(0, step_stats.dev_stats_size());
+  collector.Finalize();
+  EXPECT_EQ((std::map<string, int>{{"/cpu:0", 2}, {"/cpu:1", 1}}),
+            CountStats(step_stats));
+
+  // The collector may be reused after Finalize().
+  collector.Save("/cpu:1", MakeStats("d"));
+  collector.Finalize();
+  EXPECT_EQ((std::map<string, int>{{"/cpu:0", 2}, {"/cpu:1", 2}}),
+            CountStats(step_stats));
+}
+
+TEST(StepStatsCollectorTest, BufferedManyThreads) {
+  const int kThreads = 8;
+  const int kSavesPerThread = 1000;
+  StepStats step_stats;
+  {
+    StepStatsCollector collector(&step_stats, true /* buffered */);
+    // A second collector used concurrently by the same threads.
+    StepStats other_stats;
+    StepStatsCollector other(&other_stats, true /* buffered */);
+    {
+      thread::ThreadPool pool(Env::Default(), "test", kThreads);
+      for (int t = 0; t < kThreads; ++t) {
+        pool.Schedule([&collector, &other, t]() {
+          for (int i = 0; i < kSavesPerThread; ++i) {
+            const string device = strings::StrCat("/cpu:", i % 2);
+            collector.Save(device, MakeStats(strings::StrCat(t, "_", i)));
+            other.Save(device, MakeStats("other"));
+          }
+        });
+      }
+    }
+    other.Finalize();
+    EXPECT_EQ(kThreads * kSavesPerThread,
+              CountStats(other_stats)["/cpu:0"] +
+                  CountStats(other_stats)["/cpu:1"]);
+    // "collector" is merged by its destructor.
+  }
+  EXPECT_EQ((std::map<string, int>{{"/cpu:0", kThreads * kSavesPerThread / 2},
+                                   {"/cpu:1", kThreads * kSavesPerThread / 2}}),
+            CountStats(step_stats));
+}
+
+TEST(StepStatsCollectorTest, BufferedKeepsMostRecentStatsPerThread) {
+  const int kCapacity = StepStatsCollector::kMaxBufferedNodesPerThread;
+  StepStats step_stats;
+  StepStatsCollector collector(&step_stats, true /* buffered */);
+  for (int i = 0; i < kCapacity + 10; ++i) {
+    collector.Save("/cpu:0", MakeStats(strings::StrCat(i)));
+  }
+  collector.Finalize();
+  ASSERT_EQ(1, step_stats.dev_stats_size());
+  const DeviceStepStats& ds = step_stats.dev_stats(0);
+  ASSERT_EQ(kCapacity, ds.node_stats_size());
+  // The 10 oldest stats were dropped, and the others keep their order.
+  EXPECT_EQ("10", ds.node_stats(0).node_name());
+  EXPECT_EQ(strings::StrCat(kCapacity + 9),
+            ds.node_stats(kCapacity - 1).node_name());
+}
+
+TEST(StepStatsCollectorTest, ShouldTraceStep) {
+  std::atomic<int64> counter(0);
+  RunOptions run_options;
+  EXPECT_TRUE(ShouldTraceStep(run_options, 1, &counter));
+
+  run_options.set_trace_every_n_steps(3);
+  int num_traced = 0;
+  for (int64 step_id = 0; step_id < 30; ++step_id) {
+    if (ShouldTraceStep(run_options, step_id, &counter)) ++num_traced;
+  }
+  EXPECT_EQ(10, num_traced);
+
+  run_options.set_trace_every_n_steps(0);
+  run_options.set_trace_sample_fraction(0.25);
+  num_traced = 0;
+  for (int64 step_id = 0; step_id < 10000; ++step_id) {
+    if (ShouldTraceStep(run_options, step_id, &counter)) ++num_traced;
+  }
+  EXPECT_NEAR(2500, num_traced, 250);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include <vector>
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -28,17 +29,31 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
  public:
   Status CreateDevices(const SessionOptions& options, const string& name_prefix,
                        std::vector<Device*>* devices) override {
-    // TODO(zhifengc/tucker): Figure out the number of available CPUs
-    // and/or NUMA configuration.
-    int n = 1;
+    // TODO(zhifengc/tucker): Figure out the number of available CPUs.
+    const bool use_numa =
+        options.config.use_numa_affinity() && port::NUMAEnabled();
+    int n = use_numa ? port::NUMANumNodes() : 1;
     auto iter = options.config.device_count().find("CPU");
     if (iter != options.config.device_count().end()) {
       n = iter->second;
     }
     for (int i = 0; i < n; i++) {
       string name = strings::StrCat(name_prefix, "/cpu:", i);
-      devices->push_back(new ThreadPoolDevice(
-          options, name, Bytes(256 << 20), DeviceLocality(), cpu_allocator()));
+      if (use_numa) {
+        // Spread the devices round-robin over the NUMA nodes, each with
+        // node-local threads and memory.
+        const int node = i % port::NUMANumNodes();
+        DeviceLocality locality;
+        locality.set_numa_node(node + 1);
+        devices->push_back(new ThreadPoolDevice(options, name,
+                                                Bytes(256 << 20), locality,
+                                                cpu_allocator(node)));
+      } else {
+        devices->push_back(new ThreadPoolDevice(options, name,
+                                                Bytes(256 << 20),
+                                                DeviceLocality(),
+                                                cpu_allocator()));
+      }
     }
 
     return Status::OK();
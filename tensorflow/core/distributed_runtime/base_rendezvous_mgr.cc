@@ -35,6 +35,21 @@ limitations under the License.
 
 namespace tensorflow {
 
+bool PushBufferLimit::TryReserve(int64 bytes) {
+  mutex_lock l(mu_);
+  if (used_bytes_ + bytes > max_bytes_) {
+    return false;
+  }
+  used_bytes_ += bytes;
+  return true;
+}
+
+void PushBufferLimit::Release(int64 bytes) {
+  mutex_lock l(mu_);
+  used_bytes_ -= bytes;
+  DCHECK_GE(used_bytes_, 0);
+}
+
 BaseRendezvousMgr::BaseRendezvousMgr(const WorkerEnv* env) : worker_env_(env) {}
 
 BaseRendezvousMgr::~BaseRendezvousMgr() {
@@ -49,12 +64,22 @@ Rendezvous* BaseRendezvousMgr::Find(int64 step_id) {
   return FindOrCreate(step_id);
 }
 
+namespace {
+// The number of cleaned up steps BaseRendezvousMgr remembers.
+const size_t kMaxFinishedSteps = 1024;
+}  // namespace
+
 BaseRemoteRendezvous* BaseRendezvousMgr::FindOrCreate(int64 step_id) {
   mutex_lock l(mu_);
   Table::iterator iter = table_.find(step_id);
   if (iter == table_.end()) {
     auto rr = Create(step_id, worker_env_);
     iter = table_.insert({step_id, rr}).first;
+    auto rejected = rejected_pushes_.find(step_id);
+    if (rejected != rejected_pushes_.end()) {
+      rr->AddRejectedPushes(rejected->second);
+      rejected_pushes_.erase(rejected);
+    }
   }
   iter->second->Ref();
   return iter->second;
@@ -96,6 +121,33 @@ Status BaseRendezvousMgr::RecvLocal(int64 step_id,
   return ret;
 }
 
+Status BaseRendezvousMgr::RecvPushedTensor(int64 step_id,
+                                           const Rendezvous::ParsedKey& parsed,
+                                           const Tensor& val, bool is_dead,
+                                           bool* accepted) {
+  *accepted = false;
+  BaseRemoteRendezvous* rendez = nullptr;
+  {
+    mutex_lock l(mu_);
+    Table::iterator iter = table_.find(step_id);
+    if (iter == table_.end()) {
+      // Either the step is over, or the sender runs ahead of the receiver
+      // and the step has not started here yet.  Buffering the tensor in a
+      // new rendezvous would keep it until CleanupAll() in the former case,
+      // so it stays with the sender in both.
+      if (finished_step_set_.count(step_id) == 0) {
+        rejected_pushes_[step_id].push_back(parsed.FullKey().ToString());
+      }
+      return Status::OK();
+    }
+    rendez = iter->second;
+    rendez->Ref();
+  }
+  Status s = rendez->RecvPushed(parsed, val, is_dead, accepted);
+  rendez->Unref();
+  return s;
+}
+
 void BaseRendezvousMgr::Cleanup(int64 step_id) {
   Rendezvous* rendez = nullptr;
   {
@@ -105,6 +157,14 @@ void BaseRendezvousMgr::Cleanup(int64 step_id) {
       rendez = iter->second;
       table_.erase(iter);
     }
+    rejected_pushes_.erase(step_id);
+    if (finished_step_set_.insert(step_id).second) {
+      finished_steps_.push_back(step_id);
+      if (finished_steps_.size() > kMaxFinishedSteps) {
+        finished_step_set_.erase(finished_steps_.front());
+        finished_steps_.pop_front();
+      }
+    }
   }
   if (!rendez) return;
   rendez->StartAbort(errors::Aborted("Cleanup ", step_id));
@@ -119,6 +179,7 @@ void BaseRendezvousMgr::CleanupAll() {
       rendezs.push_back(entry.second);
     }
     table_.clear();
+    rejected_pushes_.clear();
   }
   for (auto rendez : rendezs) {
     rendez->StartAbort(errors::Aborted("Shutdown"));
@@ -127,10 +188,12 @@ void BaseRendezvousMgr::CleanupAll() {
 }
 
 BaseRemoteRendezvous::BaseRemoteRendezvous(const WorkerEnv* env, int64 step_id,
-                                           bool tolerate_dup_recv)
+                                           bool tolerate_dup_recv,
+                                           PushBufferLimit* push_limit)
     : env_(env),
       step_id_(step_id),
-      local_(NewLocalRendezvous(tolerate_dup_recv)) {}
+      local_(NewLocalRendezvous(tolerate_dup_recv)),
+      push_limit_(push_limit) {}
 
 BaseRemoteRendezvous::~BaseRemoteRendezvous() {
   CHECK(active_.empty());
@@ -157,10 +220,20 @@ Status BaseRemoteRendezvous::Send(const Rendezvous::ParsedKey& parsed,
     return errors::InvalidArgument("Invalid rendezvous key (src): ",
                                    parsed.FullKey(), " @ ", env_->worker_name);
   }
+  if (!IsSameWorker(parsed.src, parsed.dst) && IsPushed(parsed)) {
+    PushToRemote(parsed, args, val, is_dead);
+    return Status::OK();
+  }
   // Buffers "val" and "device_context" in local_.
   return local_->Send(parsed, args, val, is_dead);
 }
 
+Status BaseRemoteRendezvous::SendLocal(const Rendezvous::ParsedKey& parsed,
+                                       const Rendezvous::Args& args,
+                                       const Tensor& val, bool is_dead) {
+  return local_->Send(parsed, args, val, is_dead);
+}
+
 Status BaseRemoteRendezvous::ValidateDevices(const ParsedKey& parsed,
                                              bool is_src) {
   {
@@ -268,11 +341,77 @@ void BaseRemoteRendezvous::RecvAsync(const ParsedKey& parsed,
           }
         });
     return;
+  } else if (IsPushed(parsed)) {
+    RecvPushedAsync(parsed, recv_args, std::move(done));
   } else {
     RecvFromRemoteAsync(parsed, recv_args, std::move(done));
   }
 }
 
+void BaseRemoteRendezvous::RecvPushedAsync(const Rendezvous::ParsedKey& parsed,
+                                           const Rendezvous::Args& recv_args,
+                                           DoneCallback done) {
+  const string key = parsed.FullKey().ToString();
+  bool buffered = false;
+  int64 bytes = 0;
+  bool rejected = false;
+  {
+    mutex_lock l(mu_);
+    auto it = pushed_bytes_.find(key);
+    if (it != pushed_bytes_.end()) {
+      buffered = true;
+      bytes = it->second;
+      pushed_bytes_.erase(it);
+    } else if (push_rejected_.erase(key) > 0) {
+      rejected = true;
+    } else {
+      push_waiters_.insert(key);
+    }
+  }
+  if (buffered && push_limit_ != nullptr) {
+    push_limit_->Release(bytes);
+  }
+  if (rejected) {
+    RecvFromRemoteAsync(parsed, recv_args, std::move(done));
+  } else {
+    // Both host memory, so the tensor is passed as is.
+    local_->RecvAsync(parsed, recv_args, std::move(done));
+  }
+}
+
+void BaseRemoteRendezvous::AddRejectedPushes(const std::vector<string>& keys) {
+  mutex_lock l(mu_);
+  for (const string& key : keys) {
+    push_rejected_.insert(key);
+  }
+}
+
+Status BaseRemoteRendezvous::RecvPushed(const ParsedKey& parsed,
+                                        const Tensor& val, bool is_dead,
+                                        bool* accepted) {
+  *accepted = false;
+  TF_RETURN_IF_ERROR(ValidateDevices(parsed, false /*!is_src*/));
+  if (IsSameWorker(parsed.src, parsed.dst) || !IsPushed(parsed)) {
+    // The receiver will pull the tensor.
+    return Status::OK();
+  }
+  const string key = parsed.FullKey().ToString();
+  {
+    mutex_lock l(mu_);
+    if (push_waiters_.erase(key) == 0) {
+      // Nobody is waiting yet, so the tensor is buffered if it fits.
+      const int64 bytes = val.TotalBytes();
+      if (push_limit_ != nullptr && !push_limit_->TryReserve(bytes)) {
+        push_rejected_.insert(key);
+        return Status::OK();
+      }
+      pushed_bytes_[key] = bytes;
+    }
+  }
+  *accepted = true;
+  return local_->Send(parsed, Args(), val, is_dead);
+}
+
 void BaseRemoteRendezvous::RecvLocalAsync(const ParsedKey& parsed,
                                           DoneCallback done) {
   Status s = ValidateDevices(parsed, true /* is_src */);
@@ -295,6 +434,14 @@ void BaseRemoteRendezvous::StartAbort(const Status& s) {
         call->StartAbort(s);
       }
       active_.clear();
+      // Frees the buffer space of the pushed tensors that will never be
+      // received.
+      if (push_limit_ != nullptr) {
+        for (const auto& p : pushed_bytes_) {
+          push_limit_->Release(p.second);
+        }
+      }
+      pushed_bytes_.clear();
     }
   }
 }
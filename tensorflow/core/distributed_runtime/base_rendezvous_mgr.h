@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_BASE_RENDEZVOUS_MGR_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_BASE_RENDEZVOUS_MGR_H_
 
+#include <deque>
 #include <string>
 #include <unordered_set>
 
@@ -38,6 +39,29 @@ namespace tensorflow {
 class BaseRemoteRendezvous;
 class BaseRecvTensorCall;
 
+// Bounds the number of bytes of the tensors pushed to a worker that no
+// receiver has asked for yet.
+//
+// This class is thread-safe.
+class PushBufferLimit {
+ public:
+  explicit PushBufferLimit(int64 max_bytes) : max_bytes_(max_bytes) {}
+
+  // Reserves "bytes" and returns true, or returns false if that would
+  // exceed the limit.
+  bool TryReserve(int64 bytes);
+
+  void Release(int64 bytes);
+
+ private:
+  const int64 max_bytes_;
+
+  mutex mu_;
+  int64 used_bytes_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PushBufferLimit);
+};
+
 // RendezvousMgr keeps track of a set of local rendezvous instances.
 // All tensors sent by this worker are buffered in a RendezvousMgr
 // until the tensor is received.  Each global unique "step_id"
@@ -77,6 +101,16 @@ class BaseRendezvousMgr : public RendezvousMgrInterface {
   Status RecvLocal(int64 step_id, const Rendezvous::ParsedKey& parsed,
                    Tensor* val, bool* is_dead) override;
 
+  // Delivers the tensor for "parsed", pushed by a remote worker, to the
+  // local rendezvous instance for the "step_id".  Rejects the tensor if the
+  // step has no rendezvous: if the step has not started on this worker yet,
+  // its rendezvous pulls the tensor once created.
+  //
+  // This method is used by the rpc handler of PushTensor.
+  Status RecvPushedTensor(int64 step_id, const Rendezvous::ParsedKey& parsed,
+                          const Tensor& val, bool is_dead,
+                          bool* accepted) override;
+
   // Removes rendezvous for "step_id".
   //
   // TODO(zhifengc): Have a background thread in worker that
@@ -100,6 +134,15 @@ class BaseRendezvousMgr : public RendezvousMgrInterface {
   mutex mu_;
   Table table_ GUARDED_BY(mu_);
 
+  // The keys of the tensors pushed for steps that had no rendezvous yet.
+  // Those pushes were rejected, so the step's rendezvous pulls them.
+  gtl::FlatMap<int64, std::vector<string>> rejected_pushes_ GUARDED_BY(mu_);
+
+  // The most recently cleaned up steps, oldest first.  Tensors pushed late
+  // for them are rejected without being recorded.
+  std::deque<int64> finished_steps_ GUARDED_BY(mu_);
+  gtl::FlatSet<int64> finished_step_set_ GUARDED_BY(mu_);
+
   BaseRemoteRendezvous* FindOrCreate(int64 step_id);
 
   TF_DISALLOW_COPY_AND_ASSIGN(BaseRendezvousMgr);
@@ -111,13 +154,22 @@ class BaseRendezvousMgr : public RendezvousMgrInterface {
 // Buffering of Tensor values is delegated to a "local" Rendezvous
 // obtained from NewLocalRendezvous().  This class just adds
 // functionality to coordinate with remote workers.
+//
+// Tensors are normally pulled by the receiving worker.  A subclass can
+// select tensors to be pushed by the sending worker instead, see
+// IsPushed().  A pushed tensor is buffered in the receiver's local_ until
+// it is received, as long as "push_limit" allows; the tensors pushed beyond
+// the limit are rejected, kept by the sender, and pulled by the receiver.
 class BaseRemoteRendezvous : public Rendezvous {
  public:
+  // "push_limit", if not null, bounds the bytes of the pushed tensors that
+  // are buffered.  It is not owned, and must outlive this object.
   BaseRemoteRendezvous(const WorkerEnv* env, int64 step_id,
-                       bool tolerate_dup_recv);
+                       bool tolerate_dup_recv,
+                       PushBufferLimit* push_limit = nullptr);
 
   // Forwards to local_, where the Tensor "val" will be buffered and
-  // any waiting callback stored.
+  // any waiting callback stored, or pushes it to the remote receiver.
   Status Send(const ParsedKey& key, const Rendezvous::Args& args,
               const Tensor& val, const bool is_dead) override;
 
@@ -142,11 +194,42 @@ class BaseRemoteRendezvous : public Rendezvous {
   // REQUIRES: "parsed" is one that will be Saved into the local rendezvous.
   void RecvLocalAsync(const ParsedKey& parsed, DoneCallback done);
 
+  // This method is called only by the local Worker, forwarded through
+  // the same method on RendezvousMgr, when a remote worker has pushed the
+  // tensor for "parsed".  Buffers the tensor in local_ until it is
+  // received, and sets "*accepted" to true, unless the tensor is not
+  // expected to be pushed or the buffer is full.  In that case, sets
+  // "*accepted" to false, and the tensor is pulled when it is received.
+  Status RecvPushed(const ParsedKey& parsed, const Tensor& val, bool is_dead,
+                    bool* accepted);
+
  protected:
   virtual void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
                                    const Rendezvous::Args& args,
                                    DoneCallback done) = 0;
 
+  // Returns true if the tensor for "parsed", whose source and destination
+  // are in different workers, is pushed by the sender rather than pulled
+  // by the receiver.  The sending and the receiving workers must agree.
+  virtual bool IsPushed(const Rendezvous::ParsedKey& parsed) { return false; }
+
+  // Pushes the tensor for "parsed" to the remote receiver.  If the receiver
+  // rejects it, the tensor must be passed to SendLocal() for the receiver to
+  // pull it.  If the push fails, the step must be aborted, since the
+  // receiver may be waiting for the push.
+  //
+  // REQUIRES: IsPushed(parsed).
+  virtual void PushToRemote(const Rendezvous::ParsedKey& parsed,
+                            const Rendezvous::Args& args, const Tensor& val,
+                            bool is_dead) {
+    SendLocal(parsed, args, val, is_dead).IgnoreError();
+  }
+
+  // Buffers "val" in local_ for a remote worker to pull it.
+  Status SendLocal(const Rendezvous::ParsedKey& parsed,
+                   const Rendezvous::Args& args, const Tensor& val,
+                   bool is_dead);
+
   // Returns true if "src" and "dst" are located in the same worker,
   // and hence may use a local rendezvous.
   virtual bool IsSameWorker(DeviceNameUtils::ParsedName src,
@@ -174,6 +257,27 @@ class BaseRemoteRendezvous : public Rendezvous {
   // Active outstanding RecvTensor calls.
   gtl::FlatSet<BaseRecvTensorCall*> active_ GUARDED_BY(mu_);
 
+  // Not owned.  May be null.
+  PushBufferLimit* const push_limit_;
+
+  // The pushed tensors that are buffered in local_ and not received yet,
+  // with their sizes, by key.
+  gtl::FlatMap<string, int64> pushed_bytes_ GUARDED_BY(mu_);
+  // The keys of the pushed tensors that are received before they arrive.
+  gtl::FlatSet<string> push_waiters_ GUARDED_BY(mu_);
+  // The keys of the pushed tensors that were rejected, and must be pulled.
+  gtl::FlatSet<string> push_rejected_ GUARDED_BY(mu_);
+
+  friend class BaseRendezvousMgr;
+
+  // Marks the pushes of the tensors for "keys" as rejected.
+  void AddRejectedPushes(const std::vector<string>& keys);
+
+  // Receives the pushed tensor for "parsed", or pulls it if it was
+  // rejected.
+  void RecvPushedAsync(const Rendezvous::ParsedKey& parsed,
+                       const Rendezvous::Args& recv_args, DoneCallback done);
+
   // If "is_src" is true, checks that the rendezvous key "parsed"'s
   // source is in this process. If "is_src" is false, checks that the
   // rendezvous key "parsed"'s destination is in this process.
@@ -90,6 +90,29 @@ class ExecutorTest : public ::testing::Test {
   Rendezvous* rendez_ = nullptr;
 };
 
+class StraightLineExecutorTest : public ExecutorTest {
+ protected:
+  // Like ExecutorTest::Create(), but uses the executor for graphs without
+  // control flow, and returns its error.
+  Status CreateStraightLine(const Graph* graph) {
+    const int version = graph->versions().producer();
+    LocalExecutorParams params;
+    params.device = device_;
+    params.create_kernel = [this, version](const NodeDef& ndef,
+                                           OpKernel** kernel) {
+      return CreateNonCachedKernel(device_, nullptr, ndef, version, kernel);
+    };
+    params.delete_kernel = [](OpKernel* kernel) {
+      DeleteNonCachedKernel(kernel);
+    };
+    delete exec_;
+    exec_ = nullptr;
+    runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
+    rendez_ = NewLocalRendezvous();
+    return NewStraightLineExecutor(params, graph, &exec_);
+  }
+};
+
 // A float val -> Tensor<float>
 Tensor V(const float val) {
   Tensor tensor(DT_FLOAT, TensorShape({}));
@@ -409,4 +432,172 @@ TEST_F(ExecutorTest, RecvInvalidRefDtype) {
   rendez->Unref();
 }
 
+TEST_F(ExecutorTest, ReadyNodesStartByPriority) {
+  // Identity nodes reading the same constant become ready at once, and are
+  // started by increasing "_priority", the ones without a priority last.
+  Graph* g = new Graph(OpRegistry::Global());
+  auto in = test::graph::Constant(g, V(1.0));
+  const std::vector<int64> priorities = {5, 3, -1, 1, 4};
+  std::vector<string> expected(priorities.size());
+  for (int i = 0; i < priorities.size(); ++i) {
+    Node* id = test::graph::Identity(g, in);
+    if (priorities[i] >= 0) id->AddAttr("_priority", priorities[i]);
+    expected[i] = id->name();
+  }
+  expected = {expected[3], expected[1], expected[4], expected[0], expected[2]};
+  Create(g);
+  // Runs every node on the calling thread, in the order they are started.
+  runner_ = [](std::function<void()> fn) { fn(); };
+  TF_ASSERT_OK(Run(rendez_));
+
+  std::vector<string> started;
+  ASSERT_EQ(1, step_stats_.dev_stats_size());
+  for (const NodeExecStats& stats : step_stats_.dev_stats(0).node_stats()) {
+    if (std::find(expected.begin(), expected.end(), stats.node_name()) !=
+        expected.end()) {
+      started.push_back(stats.node_name());
+    }
+  }
+  EXPECT_EQ(expected, started);
+}
+
+TEST_F(StraightLineExecutorTest, SimpleAdd) {
+  // c = a + b
+  Graph* g = new Graph(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g, "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Recv(g, "b", "float", ALICE, 1, BOB);
+  auto tmp = test::graph::Add(g, in0, in1);
+  test::graph::Send(g, tmp, "c", BOB, 1, ALICE);
+  EXPECT_TRUE(IsStraightLineGraph(g));
+  TF_ASSERT_OK(CreateStraightLine(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0),
+                             false));  // in0 = 1.0
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "b"), args, V(1.0),
+                             false));  // in1 = 1.0
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_EQ(2.0, V(out));  // out = 1.0 + 1.0 = 2.0
+  EXPECT_FALSE(is_dead);
+}
+
+TEST_F(StraightLineExecutorTest, RandomTree) {
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildTree(4096, g);
+  TF_ASSERT_OK(CreateStraightLine(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+}
+
+TEST_F(StraightLineExecutorTest, RepeatedRuns) {
+  // The per-step input slots must not leak values across steps.
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildTree(64, g);
+  TF_ASSERT_OK(CreateStraightLine(g));
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                              V(iters), false));
+    TF_ASSERT_OK(Run(rendez));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(
+        rendez->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+    EXPECT_EQ(64.0 * iters, V(out));
+    rendez->Unref();
+  }
+}
+
+TEST_F(StraightLineExecutorTest, ControlEdges) {
+  // "out" must observe the variable only after all the assignments ran.
+  Graph* g = new Graph(OpRegistry::Global());
+  auto one = test::graph::Constant(g, V(1.0));
+  auto var = test::graph::Var(g, DT_FLOAT, TensorShape({}));
+  auto init = test::graph::Assign(g, var, one);
+  auto prev = init;
+  for (int i = 0; i < 8; ++i) {
+    auto add = test::graph::Add(g, var, one);
+    g->AddControlEdge(prev, add);
+    prev = test::graph::Assign(g, var, add);
+  }
+  auto* out = test::graph::Send(g, var, "out", ALICE, kIncarnation, BOB);
+  g->AddControlEdge(prev, out);
+  TF_ASSERT_OK(CreateStraightLine(g));
+  Rendezvous* rendez = NewLocalRendezvous();
+  TF_ASSERT_OK(Run(rendez));
+  Tensor val;
+  bool is_dead;
+  TF_ASSERT_OK(rendez->Recv(Key(ALICE, kIncarnation, BOB, "out"),
+                            Rendezvous::Args(), &val, &is_dead));
+  EXPECT_EQ(9.0, V(val));
+  rendez->Unref();
+}
+
+TEST_F(StraightLineExecutorTest, RecvFromLaterSend) {
+  // The _Recv of "b" has no inputs, but its value is only sent once "a" has
+  // been received and doubled.
+  Graph* g = new Graph(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g, "a", "float", ALICE, 1, BOB);
+  auto tmp0 = test::graph::Add(g, in0, in0);
+  auto tmp1 = test::graph::Add(g, tmp0, in0);
+  test::graph::Send(g, tmp1, "b", ALICE, 1, BOB);
+  auto in1 = test::graph::Recv(g, "b", "float", ALICE, 1, BOB);
+  auto tmp2 = test::graph::Add(g, in1, in1);
+  test::graph::Send(g, tmp2, "c", BOB, 1, ALICE);
+  TF_ASSERT_OK(CreateStraightLine(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0),
+                             false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_EQ(6.0, V(out));
+}
+
+TEST_F(StraightLineExecutorTest, RecvInvalidDtype) {
+  Graph* g = new Graph(OpRegistry::Global());
+  auto one = test::graph::Recv(g, "one", "float", ALICE, 1, BOB);
+  auto var = test::graph::Var(g, DT_FLOAT, TensorShape({1}));
+  auto init = test::graph::Assign(g, var, one);
+  auto* two = test::graph::Send(g, var, "two", BOB, 1, ALICE);
+  g->AddControlEdge(init, two);  // Ensures run after init.
+  TF_ASSERT_OK(CreateStraightLine(g));
+  Rendezvous* rendez = NewLocalRendezvous();
+  // Send a double instead of float.
+  TF_ASSERT_OK(rendez->Send(Key(ALICE, 1, BOB, "one"), Rendezvous::Args(),
+                            VD(1.0), false));
+  // Fails due to invalid dtype, and the remaining nodes are skipped.
+  EXPECT_TRUE(errors::IsInternal(Run(rendez)));
+  Tensor output;
+  bool is_dead;
+  EXPECT_TRUE(errors::IsInternal(rendez->Recv(
+      Key(BOB, 1, ALICE, "two"), Rendezvous::Args(), &output, &is_dead)));
+  rendez->Unref();
+}
+
+TEST_F(StraightLineExecutorTest, RejectsControlFlow) {
+  Graph* g = new Graph(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g, "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Constant(g, VB(false));
+  auto tmp = test::graph::Switch(g, in0, in1);
+  test::graph::Send(g, tmp, "c", BOB, 1, ALICE);
+  EXPECT_FALSE(IsStraightLineGraph(g));
+  Status s = CreateStraightLine(g);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_EQ(nullptr, exec_);
+}
+
 }  // namespace tensorflow
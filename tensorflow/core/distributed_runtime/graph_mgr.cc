@@ -37,18 +37,40 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
 namespace tensorflow {
 
+// The number of graphs whose partitions are cached by default.
+static const int kDefaultMaxCachedGraphs = 16;
+
 GraphMgr::GraphMgr(const WorkerEnv* worker_env)
-    : worker_env_(worker_env), table_(5) {}
+    : GraphMgr(worker_env, kDefaultMaxCachedGraphs) {}
+
+GraphMgr::GraphMgr(const WorkerEnv* worker_env, int max_cached_graphs)
+    : worker_env_(worker_env),
+      table_(5),
+      max_cached_graphs_(max_cached_graphs) {}
 
 GraphMgr::~GraphMgr() {
   for (auto p : table_) p.second->Unref();
+  for (PartitionedGraph* partitions : cache_lru_) partitions->Unref();
+}
+
+GraphMgr::PartitionedGraph::~PartitionedGraph() {
+  for (const auto& unit : units) {
+    for (const auto& entry : unit->kernels) {
+      delete entry.second;
+    }
+    delete unit->lib;
+    delete unit->graph;
+  }
+  delete lib_def;
 }
 
 GraphMgr::Item::~Item() {
@@ -58,10 +80,11 @@ GraphMgr::Item::~Item() {
       graph_mgr->cost_model_manager_.RemoveCostModelForGraph(unit.graph);
     }
     delete unit.root;
-    delete unit.lib;
     unit.device->op_segment()->RemoveHold(this->session);
   }
-  delete this->lib_def;
+  if (this->partitions != nullptr) {
+    this->partitions->Unref();
+  }
 }
 
 // NOTE: node->device_name() is not set by GraphConstructor.  We
@@ -83,21 +106,48 @@ static Status ValidateGraphDefForDevices(const GraphDef& gdef) {
   return Status::OK();
 }
 
-// Creates executors given a graph definition "gdef" of a "session".
-// If a node in "gdef" is shared by other graphs in "session", the
-// same op kernel is reused. E.g., typically a params node is shared
-// by multiple graphs in a session.
+// Returns true if the partitions of "gdef" can be shared by the sessions
+// that register it.  The kernels of function bodies, stateful or not, are
+// owned by the function library runtime of the partitions, so graphs that
+// call functions are not shared.
+static bool IsCacheable(const GraphDef& gdef) {
+  return gdef.library().function_size() == 0;
+}
+
+// Returns the key under which the partitions of "gdef" are cached. Map
+// fields are serialized in key order, so equal graphs get equal keys.
+static string CacheKey(const GraphDef& gdef,
+                       const GraphOptions& graph_options) {
+  string buf;
+  for (const protobuf::MessageLite* proto :
+       {static_cast<const protobuf::MessageLite*>(&gdef),
+        static_cast<const protobuf::MessageLite*>(&graph_options)}) {
+    string bytes;
+    {
+      protobuf::io::StringOutputStream stream(&bytes);
+      protobuf::io::CodedOutputStream coded(&stream);
+      coded.SetSerializationDeterministic(true);
+      proto->ByteSize();  // Caches the sizes of nested messages.
+      proto->SerializeWithCachedSizes(&coded);
+    }
+    strings::StrAppend(&buf, bytes.size(), ":", bytes);
+  }
+  const Fprint128 fp = Fingerprint128(buf);
+  return strings::Printf("%016llx%016llx",
+                         static_cast<unsigned long long>(fp.high64),
+                         static_cast<unsigned long long>(fp.low64));
+}
+
+// Partitions a graph definition "gdef" over the devices and optimizes the
+// partitions.
 //
 // If "gdef" is assigned to multiple devices, extra nodes (e.g.,
 // send/recv nodes) maybe added. The extra nodes' name are generated
 // by calling "new_name(old_name)".
-//
-// "executors" are filled with one executor per device if success and
-// the caller takes the ownership of returned executors.
-Status GraphMgr::InitItem(const string& session, const GraphDef& gdef,
-                          const GraphOptions& graph_options, Item* item) {
-  item->session = session;
-  item->lib_def =
+Status GraphMgr::InitPartitions(const GraphDef& gdef,
+                                const GraphOptions& graph_options,
+                                PartitionedGraph* partitions) {
+  partitions->lib_def =
       new FunctionLibraryDefinition(OpRegistry::Global(), gdef.library());
 
   TF_RETURN_IF_ERROR(ValidateGraphDefForDevices(gdef));
@@ -105,18 +155,18 @@ Status GraphMgr::InitItem(const string& session, const GraphDef& gdef,
   if (gdef.versions().producer() >= 5) {
     // Validate the graph: we assume that merging two valid graphs
     // should maintain graph validity.
-    TF_RETURN_IF_ERROR(graph::ValidateGraphDef(gdef, *item->lib_def));
+    TF_RETURN_IF_ERROR(graph::ValidateGraphDef(gdef, *partitions->lib_def));
   }
 
   // Constructs the graph out of "gdef".
-  Graph graph(item->lib_def);
+  Graph graph(partitions->lib_def);
   GraphConstructorOptions opts;
   opts.allow_internal_ops = true;
   opts.expect_device_spec = true;
   TF_RETURN_IF_ERROR(ConvertGraphDefToGraph(opts, gdef, &graph));
 
   // Splits "graph" into multiple subgraphs by device names.
-  std::unordered_map<string, GraphDef> partitions;
+  std::unordered_map<string, GraphDef> partition_defs;
   PartitionOptions popts;
   popts.node_to_loc = SplitByDevice;
   popts.new_name = [this](const string& prefix) {
@@ -134,14 +184,14 @@ Status GraphMgr::InitItem(const string& session, const GraphDef& gdef,
   };
   popts.control_flow_added = true;
   popts.scheduling_for_recvs = graph_options.enable_recv_scheduling();
-  TF_RETURN_IF_ERROR(Partition(popts, &graph, &partitions));
+  TF_RETURN_IF_ERROR(Partition(popts, &graph, &partition_defs));
   if (popts.scheduling_for_recvs) {
-    TF_RETURN_IF_ERROR(AddControlEdges(popts, &partitions));
+    TF_RETURN_IF_ERROR(AddControlEdges(popts, &partition_defs));
   }
 
   std::unordered_map<string, std::unique_ptr<Graph>> partition_graphs;
-  for (const auto& partition : partitions) {
-    std::unique_ptr<Graph> device_graph(new Graph(item->lib_def));
+  for (const auto& partition : partition_defs) {
+    std::unique_ptr<Graph> device_graph(new Graph(partitions->lib_def));
     GraphConstructorOptions device_opts;
     // There are internal operations (e.g., send/recv) that we now allow.
     device_opts.allow_internal_ops = true;
@@ -152,58 +202,89 @@ Status GraphMgr::InitItem(const string& session, const GraphDef& gdef,
   }
 
   GraphOptimizationPassOptions optimization_options;
-  optimization_options.flib_def = item->lib_def;
+  optimization_options.flib_def = partitions->lib_def;
   optimization_options.partition_graphs = &partition_graphs;
   TF_RETURN_IF_ERROR(OptimizationPassRegistry::Global()->RunGrouping(
       OptimizationPassRegistry::POST_PARTITIONING, optimization_options));
 
-  LocalExecutorParams params;
-
-  item->units.reserve(partitions.size());
-  item->graph_mgr = this;
+  partitions->units.reserve(partition_graphs.size());
   const auto& optimizer_opts = graph_options.optimizer_options();
   GraphOptimizer optimizer(optimizer_opts);
   for (auto& p : partition_graphs) {
     const string& device_name = p.first;
     std::unique_ptr<Graph>& subgraph = p.second;
-    item->units.resize(item->units.size() + 1);
-    ExecutionUnit* unit = &(item->units.back());
+    std::unique_ptr<PartitionedGraph::Unit> unit(new PartitionedGraph::Unit);
 
     // Find the device.
-    Status s =
-        worker_env_->device_mgr->LookupDevice(device_name, &unit->device);
-    if (!s.ok()) {
-      // Remove the empty unit from the item as the item destructor wants all
-      // units to have valid devices.
-      item->units.pop_back();
-      return s;
-    }
+    TF_RETURN_IF_ERROR(
+        worker_env_->device_mgr->LookupDevice(device_name, &unit->device));
 
     // Give the device an opportunity to rewrite its subgraph.
     TF_RETURN_IF_ERROR(
         unit->device->MaybeRewriteGraph(gdef.library(), &subgraph));
 
+    // Function library runtime.
+    unit->lib = NewFunctionLibraryRuntime(
+        worker_env_->device_mgr, worker_env_->env, unit->device,
+        subgraph->versions().producer(), partitions->lib_def,
+        graph_options.optimizer_options());
+
+    optimizer.Optimize(unit->lib, worker_env_->env, unit->device, &subgraph);
+    TF_RETURN_IF_ERROR(
+        EnsureMemoryTypes(DeviceType(unit->device->device_type()),
+                          unit->device->name(), subgraph.get()));
+    unit->graph = subgraph.release();
+    partitions->units.push_back(std::move(unit));
+  }
+  return Status::OK();
+}
+
+// Creates executors over the partitions of "item" for a "session".
+// If a stateful node is shared by other graphs in "session", the
+// same op kernel is reused. E.g., typically a params node is shared
+// by multiple graphs in a session.  The kernels of stateless nodes
+// are owned by the partitions, and shared by all the items built
+// from them.
+//
+// The executors are stored in "item->units" if success and the item
+// takes the ownership of returned executors.
+Status GraphMgr::InitItem(const string& session,
+                          const GraphOptions& graph_options, Item* item) {
+  item->session = session;
+  item->graph_mgr = this;
+
+  LocalExecutorParams params;
+
+  PartitionedGraph* partitions = item->partitions;
+  item->units.reserve(partitions->units.size());
+  for (const auto& p : partitions->units) {
+    PartitionedGraph::Unit* partition = p.get();
+    item->units.resize(item->units.size() + 1);
+    ExecutionUnit* unit = &(item->units.back());
+    unit->device = partition->device;
+    unit->lib = partition->lib;
+
     // Top-level nodes in the graph uses the op segment to cache
     // kernels. Therefore, as long as the executor is alive, we need
     // to ensure the kernels cached for the session are alive.
     auto opseg = unit->device->op_segment();
     opseg->AddHold(session);
 
-    // Function library runtime.
-    unit->lib = NewFunctionLibraryRuntime(
-        worker_env_->device_mgr, worker_env_->env, unit->device,
-        subgraph->versions().producer(), item->lib_def,
-        graph_options.optimizer_options());
-
     // Construct the root executor for the subgraph.
     params.device = unit->device;
     auto lib = unit->lib;
     params.function_library = lib;
-    params.create_kernel = [session, lib, opseg](const NodeDef& ndef,
-                                                 OpKernel** kernel) {
-      // Caches the kernel only if the node is stateful.
+    params.create_kernel = [session, lib, opseg, partition](
+        const NodeDef& ndef, OpKernel** kernel) {
       if (!lib->IsStateful(ndef.op())) {
-        return lib->CreateKernel(ndef, kernel);
+        // Shares the kernel with the other items of the partition.
+        mutex_lock l(partition->mu);
+        OpKernel*& shared = partition->kernels[ndef.name()];
+        if (shared == nullptr) {
+          TF_RETURN_IF_ERROR(lib->CreateKernel(ndef, &shared));
+        }
+        *kernel = shared;
+        return Status::OK();
       }
       auto create_fn = [lib, &ndef](OpKernel** kernel) {
         return lib->CreateKernel(ndef, kernel);
@@ -213,47 +294,99 @@ Status GraphMgr::InitItem(const string& session, const GraphDef& gdef,
       // on the function library here + global op registry.
       return opseg->FindOrCreate(session, ndef.name(), kernel, create_fn);
     };
-    params.delete_kernel = [lib](OpKernel* kernel) {
-      // If the node is stateful, opseg owns it. Otherwise, delete it.
-      if (kernel && !lib->IsStateful(kernel->type_string())) {
-        delete kernel;
-      }
-    };
+    // The partition owns the stateless kernels, and opseg the stateful ones.
+    params.delete_kernel = [](OpKernel* kernel) {};
 
-    optimizer.Optimize(lib, worker_env_->env, params.device, &subgraph);
-    TF_RETURN_IF_ERROR(
-        EnsureMemoryTypes(DeviceType(unit->device->device_type()),
-                          unit->device->name(), subgraph.get()));
-    unit->graph = subgraph.get();
+    Graph* subgraph = new Graph(partitions->lib_def);
+    CopyGraph(*partition->graph, subgraph);
+    unit->graph = subgraph;
     unit->build_cost_model = graph_options.build_cost_model();
     if (unit->build_cost_model > 0) {
       skip_cost_models_ = false;
     }
-    TF_RETURN_IF_ERROR(
-        NewLocalExecutor(params, subgraph.release(), &unit->root));
+    TF_RETURN_IF_ERROR(NewLocalExecutor(params, subgraph, &unit->root));
   }
   return Status::OK();
 }
 
 Status GraphMgr::Register(const string& session, const GraphDef& gdef,
                           const GraphOptions& graph_options, string* handle) {
+  PartitionedGraph* partitions = nullptr;
+  string cache_key;
+  if (max_cached_graphs_ > 0 && IsCacheable(gdef)) {
+    // The location of the session's graph cache does not affect its
+    // partition graphs.
+    GraphOptions key_options = graph_options;
+    key_options.clear_graph_cache_dir();
+    cache_key = CacheKey(gdef, key_options);
+    mutex_lock l(mu_);
+    partitions = LookupCachedPartitionsLocked(cache_key);
+  }
+  if (partitions == nullptr) {
+    partitions = new PartitionedGraph;
+    partitions->cache_key = cache_key;
+    Status s = InitPartitions(gdef, graph_options, partitions);
+    if (!s.ok()) {
+      partitions->Unref();
+      return s;
+    }
+  }
+
   Item* item = new Item;
-  Status s = InitItem(session, gdef, graph_options, item);
+  item->partitions = partitions;
+  Status s = InitItem(session, graph_options, item);
   if (!s.ok()) {
     item->Unref();
     return s;
   }
 
   // Inserts one item into table_.
+  std::vector<PartitionedGraph*> evicted;
   {
     mutex_lock l(mu_);
     *handle = strings::Printf("%016llx", ++next_id_);
     item->handle = *handle;
     CHECK(table_.insert({*handle, item}).second);
+    if (!partitions->cache_key.empty()) {
+      InsertCachedPartitionsLocked(partitions, &evicted);
+    }
+  }
+  for (PartitionedGraph* e : evicted) {
+    e->Unref();
   }
   return Status::OK();
 }
 
+GraphMgr::PartitionedGraph* GraphMgr::LookupCachedPartitionsLocked(
+    const string& key) {
+  auto it = cache_.find(key);
+  if (it == cache_.end()) {
+    return nullptr;
+  }
+  PartitionedGraph* partitions = *it->second;
+  cache_lru_.splice(cache_lru_.begin(), cache_lru_, it->second);
+  partitions->Ref();
+  return partitions;
+}
+
+void GraphMgr::InsertCachedPartitionsLocked(
+    PartitionedGraph* partitions, std::vector<PartitionedGraph*>* evicted) {
+  if (cache_.count(partitions->cache_key) > 0) {
+    // Either "partitions" came from the cache, or another registration of
+    // the same graph cached its partitions first.
+    return;
+  }
+  partitions->Ref();
+  cache_lru_.push_front(partitions);
+  cache_[partitions->cache_key] = cache_lru_.begin();
+  while (cache_lru_.size() > static_cast<size_t>(max_cached_graphs_)) {
+    PartitionedGraph* oldest = cache_lru_.back();
+    cache_.erase(oldest->cache_key);
+    cache_lru_.pop_back();
+    evicted->push_back(oldest);
+  }
+}
+
 Status GraphMgr::Deregister(const string& handle) {
   Item* item = nullptr;
   // Removes one item from table_.
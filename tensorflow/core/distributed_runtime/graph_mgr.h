@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_GRAPH_MGR_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_GRAPH_MGR_H_
 
+#include <list>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -48,6 +50,15 @@ class StepStatsCollector;
 //
 // Multiple threads can call GraphMgr methods concurrently.
 //
+// The partitioned and optimized graphs of a registered graph that calls no
+// functions are kept in a bounded cache keyed by a fingerprint of the graph
+// and its options, also after the graph is deregistered, together with the
+// kernels of its stateless nodes.  A later session registering the same
+// graph only builds executors over copies of the cached graphs, which reuse
+// the cached stateless kernels and create the stateful ones (variables,
+// queues, sends and receives, ...) in the op segment of the new session, so
+// that no state is shared between sessions.
+//
 // E.g.,
 //   GraphMgr gmgr(worker_env);
 //   string handle;
@@ -61,6 +72,9 @@ class StepStatsCollector;
 class GraphMgr {
  public:
   explicit GraphMgr(const WorkerEnv* worker_env);
+  // Caches the partitions of at most "max_cached_graphs" graphs; 0 disables
+  // the cache.
+  GraphMgr(const WorkerEnv* worker_env, int max_cached_graphs);
   ~GraphMgr();
 
   // Registers a graph. Fills in "handle"
@@ -87,16 +101,41 @@ class GraphMgr {
   // Deregisters a graph.
   Status Deregister(const string& handle);
 
-  // Deregister all graphs.
+  // Deregister all graphs. The cached partitions are kept.
   Status DeregisterAll();
 
  private:
   typedef GraphMgr ME;
 
+  // The partitions of a registered graph, after optimization, ready to be
+  // copied into executors.  Shared by the items of the registrations of the
+  // same graph while it is cached.
+  struct PartitionedGraph : public core::RefCounted {
+    ~PartitionedGraph() override;
+
+    // Empty if the partitions are not cached.
+    string cache_key;
+
+    FunctionLibraryDefinition* lib_def = nullptr;
+
+    struct Unit {
+      Device* device = nullptr;
+      Graph* graph = nullptr;
+      FunctionLibraryRuntime* lib = nullptr;
+
+      // The kernels of the stateless nodes of "graph", by node name,
+      // shared by the executors of all the items.
+      mutex mu;
+      std::unordered_map<string, OpKernel*> kernels GUARDED_BY(mu);
+    };
+    std::vector<std::unique_ptr<Unit>> units;
+  };
+
   struct ExecutionUnit {
     Graph* graph = nullptr;
     Device* device = nullptr;
     Executor* root = nullptr;
+    // Not owned: the runtime of the partition.
     FunctionLibraryRuntime* lib = nullptr;
     // Build the cost model if this value is strictly positive.
     int64 build_cost_model = 0;
@@ -114,8 +153,9 @@ class GraphMgr {
     // Graph handle.
     string handle;
 
-    // The definition of the library is shared by all partitions.
-    FunctionLibraryDefinition* lib_def = nullptr;
+    // The partitions the executors are built from, which own their stateless
+    // kernels.  Holds a reference.
+    PartitionedGraph* partitions = nullptr;
 
     // A graph is partitioned over multiple devices.  Each partition
     // has a root executor which may call into the runtime library.
@@ -142,6 +182,13 @@ class GraphMgr {
   // mechanism to gc these graphs.
   std::unordered_map<string, Item*> table_;
 
+  // The cached partitions, most recently registered first. Each holds a
+  // reference.
+  const int max_cached_graphs_;
+  std::list<PartitionedGraph*> cache_lru_ GUARDED_BY(mu_);
+  std::unordered_map<string, std::list<PartitionedGraph*>::iterator> cache_
+      GUARDED_BY(mu_);
+
   void StartParallelExecutors(const string& handle, int64 step_id, Item* item,
                               Rendezvous* rendezvous,
                               StepStatsCollector* collector,
@@ -161,8 +208,25 @@ class GraphMgr {
   void RecvOutputsFromRendezvousAsync(Rendezvous* rendezvous, NamedTensors* out,
                                       const StatusCallback& done);
 
-  Status InitItem(const string& session, const GraphDef& gdef,
-                  const GraphOptions& graph_options, Item* item);
+  // Partitions "gdef" over the devices and optimizes the partitions.
+  Status InitPartitions(const GraphDef& gdef,
+                        const GraphOptions& graph_options,
+                        PartitionedGraph* partitions);
+
+  // Builds the executors of "item" over "item->partitions" for "session".
+  Status InitItem(const string& session, const GraphOptions& graph_options,
+                  Item* item);
+
+  // Returns the cached partitions for "key" with a new reference, or null.
+  PartitionedGraph* LookupCachedPartitionsLocked(const string& key)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Caches "partitions" under partitions->cache_key, unless partitions are
+  // already cached for it. Appends the partitions evicted from the cache to
+  // "evicted", to be unreferenced outside of mu_.
+  void InsertCachedPartitionsLocked(PartitionedGraph* partitions,
+                                    std::vector<PartitionedGraph*>* evicted)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   TF_DISALLOW_COPY_AND_ASSIGN(GraphMgr);
 };
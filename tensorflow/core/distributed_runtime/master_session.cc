@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/master_session.h"
 
+#include <deque>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -22,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/profile_handler.h"
 #include "tensorflow/core/common_runtime/stats_publisher_interface.h"
+#include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/distributed_runtime/scheduler.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
@@ -50,6 +52,21 @@ limitations under the License.
 
 namespace tensorflow {
 
+class RunManyGraphs;
+
+namespace {
+
+// Used when RunOptions.pipeline_depth is unset.
+const int kDefaultPipelineDepth = 2;
+
+// Keeps the highest 8 bits 0x01: we reserve some bits of the
+// step_id for future use.
+uint64 NewStepId() {
+  return (random::New64() & ((1uLL << 56) - 1)) | (1uLL << 56);
+}
+
+}  // namespace
+
 // MasterSession wraps SimpleClientGraph in a reference counted object.
 // This way, MasterSession can clear up the cache mapping Run requests to
 // compiled graphs while the compiled graph is still being used.
@@ -186,6 +203,17 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
                        MutableRunStepResponseWrapper* resp,
                        CancellationManager* cm, const bool is_last_partial_run);
 
+  // Runs "num_steps" steps of all partitions with the feeds of "req",
+  // starting each step while up to "depth" - 1 earlier ones are still
+  // running.  The last step has id "step_id", collects statistics into
+  // "pss" and returns its fetches in "resp".  The other steps get their
+  // own ids and are cleaned up once done.
+  Status RunPipelinedPartitions(int64 num_steps, int depth, int64 step_id,
+                                PerStepState* pss, CallOptions* opts,
+                                const RunStepRequestWrapper& req,
+                                MutableRunStepResponseWrapper* resp,
+                                CancellationManager* cm);
+
   // Calls workers to cleanup states for the step "step_id".  Calls
   // `done` when all cleanup RPCs have completed.
   void CleanupPartitionsAsync(int64 step_id, StatusCallback done);
@@ -285,6 +313,20 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
   // destructor and does not wait for the rpc completion.
   void DeregisterPartitions();
 
+  // Issues the RunGraph calls of one step of all partitions into "*calls",
+  // which WaitForPartitions waits for.
+  Status StartPartitions(int64 step_id, PerStepState* pss,
+                         const RunStepRequestWrapper& req,
+                         const bool is_last_partial_run,
+                         std::unique_ptr<RunManyGraphs>* calls);
+
+  // Waits for the RunGraph calls issued by StartPartitions, and adds the
+  // fetched tensors to "resp".
+  Status WaitForPartitions(RunManyGraphs* calls, PerStepState* pss,
+                           CallOptions* call_opts,
+                           MutableRunStepResponseWrapper* resp,
+                           CancellationManager* cm);
+
   TF_DISALLOW_COPY_AND_ASSIGN(ReffedClientGraph);
 };
 
@@ -372,13 +414,18 @@ void MasterSession::ReffedClientGraph::TrackFeedsAndFetches(
 Status MasterSession::ReffedClientGraph::DoBuildPartitions(
     PartitionOptions popts,
     std::unordered_map<string, GraphDef>* out_partitions) {
-  if (popts.need_to_record_start_times) {
+  if (popts.need_to_record_start_times || popts.need_to_record_priorities) {
     CostModel cost_model(true);
     cost_model.InitFromGraph(client_graph()->graph);
     // TODO(yuanbyu): Use the real cost model.
     // execution_state_->MergeFromGlobal(&cost_model);
     SlackAnalysis sa(&client_graph()->graph, &cost_model);
-    sa.ComputeAsap(&popts.start_times);
+    if (popts.need_to_record_start_times) {
+      sa.ComputeAsap(&popts.start_times);
+    }
+    if (popts.need_to_record_priorities) {
+      sa.ComputeSlack(&popts.node_slacks);
+    }
   }
 
   // Partition the graph.
@@ -517,6 +564,16 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
     const bool is_last_partial_run) {
   VLOG(2) << "RunPartitions step_id " << step_id << " execution_count "
           << execution_count;
+  std::unique_ptr<RunManyGraphs> calls;
+  TF_RETURN_IF_ERROR(
+      StartPartitions(step_id, pss, req, is_last_partial_run, &calls));
+  return WaitForPartitions(calls.get(), pss, call_opts, resp, cm);
+}
+
+Status MasterSession::ReffedClientGraph::StartPartitions(
+    int64 step_id, PerStepState* pss, const RunStepRequestWrapper& req,
+    const bool is_last_partial_run,
+    std::unique_ptr<RunManyGraphs>* out_calls) {
   // Maps the names of fed tensors to their index in `req`.
   std::unordered_map<StringPiece, size_t, StringPiece::Hasher> feeds(3);
 
@@ -544,11 +601,11 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
   }
 
   const int num = partitions_.size();
-  RunManyGraphs calls(num);
+  std::unique_ptr<RunManyGraphs> calls(new RunManyGraphs(num));
 
   for (int i = 0; i < num; ++i) {
     const Part& part = partitions_[i];
-    RunManyGraphs::Call* c = calls.get(i);
+    RunManyGraphs::Call* c = calls->get(i);
     c->req.reset(part.worker->CreateRunGraphRequest());
     c->resp.reset(part.worker->CreateRunGraphResponse());
     if (is_partial_) {
@@ -612,22 +669,31 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
   // Issues RunGraph calls.
   for (int i = 0; i < num; ++i) {
     const Part& part = partitions_[i];
-    RunManyGraphs::Call* call = calls.get(i);
+    RunManyGraphs::Call* call = calls->get(i);
     TRACEPRINTF("Partition %d %s", i, part.name.c_str());
     part.worker->RunGraphAsync(
         &call->opts, call->req.get(), call->resp.get(),
-        std::bind(&RunManyGraphs::WhenDone, &calls, i, std::placeholders::_1));
+        std::bind(&RunManyGraphs::WhenDone, calls.get(), i,
+                  std::placeholders::_1));
   }
+  *out_calls = std::move(calls);
+  return Status::OK();
+}
+
+Status MasterSession::ReffedClientGraph::WaitForPartitions(
+    RunManyGraphs* calls, PerStepState* pss, CallOptions* call_opts,
+    MutableRunStepResponseWrapper* resp, CancellationManager* cm) {
+  const int num = partitions_.size();
 
   // Waits for the RunGraph calls.
-  call_opts->SetCancelCallback([&calls]() { calls.StartCancel(); });
+  call_opts->SetCancelCallback([calls]() { calls->StartCancel(); });
   auto token = cm->get_cancellation_token();
   bool success =
-      cm->RegisterCallback(token, [&calls]() { calls.StartCancel(); });
+      cm->RegisterCallback(token, [calls]() { calls->StartCancel(); });
   if (!success) {
-    calls.StartCancel();
+    calls->StartCancel();
   }
-  calls.Wait();
+  calls->Wait();
   call_opts->ClearCancelCallback();
   if (success) {
     cm->DeregisterCallback(token);
@@ -636,29 +702,29 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
   }
 
   // Collects fetches.
-  Status status = calls.status();
+  Status status = calls->status();
   if (status.ok()) {
     for (int i = 0; i < num; ++i) {
       const Part& part = partitions_[i];
-      for (size_t j = 0; j < calls.get(i)->resp->num_recvs(); ++j) {
-        auto iter = part.key_fetch.find(calls.get(i)->resp->recv_key(j));
+      for (size_t j = 0; j < calls->get(i)->resp->num_recvs(); ++j) {
+        auto iter = part.key_fetch.find(calls->get(i)->resp->recv_key(j));
         if (iter == part.key_fetch.end()) {
           status.Update(errors::Internal("Unexpected fetch key: ",
-                                         calls.get(i)->resp->recv_key(j)));
+                                         calls->get(i)->resp->recv_key(j)));
           break;
         }
         const string& fetch = iter->second;
         status.Update(resp->AddTensorFromRunGraphResponse(
-            fetch, calls.get(i)->resp.get(), j));
+            fetch, calls->get(i)->resp.get(), j));
         if (!status.ok()) {
           break;
         }
       }
       if (pss->collect_timeline) {
-        pss->step_stats[i].Swap(calls.get(i)->resp->mutable_step_stats());
+        pss->step_stats[i].Swap(calls->get(i)->resp->mutable_step_stats());
       }
       if (pss->collect_costs) {
-        CostGraphDef* cost_graph = calls.get(i)->resp->mutable_cost_graph();
+        CostGraphDef* cost_graph = calls->get(i)->resp->mutable_cost_graph();
         for (int j = 0; j < cost_graph->node_size(); ++j) {
           resp->mutable_metadata()->mutable_cost_graph()->add_node()->Swap(
               cost_graph->mutable_node(j));
@@ -669,6 +735,66 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
   return status;
 }
 
+Status MasterSession::ReffedClientGraph::RunPipelinedPartitions(
+    int64 num_steps, int depth, int64 step_id, PerStepState* pss,
+    CallOptions* call_opts, const RunStepRequestWrapper& req,
+    MutableRunStepResponseWrapper* resp, CancellationManager* cm) {
+  VLOG(2) << "RunPipelinedPartitions num_steps " << num_steps << " depth "
+          << depth;
+  struct Step {
+    bool is_last;
+    int64 step_id;
+    // Points at the caller's state for the last step, and at 'own_pss'
+    // otherwise, which collects no stats.
+    PerStepState* pss;
+    PerStepState own_pss;
+    std::unique_ptr<RunManyGraphs> calls;
+    // Receives the fetches of all the steps but the last one.
+    InMemoryRunStepResponse ignored_resp;
+  };
+  std::deque<std::unique_ptr<Step>> running;
+  Status status;
+  int64 num_started = 0;
+  while (!running.empty() || (status.ok() && num_started < num_steps)) {
+    if (status.ok() && num_started < num_steps &&
+        running.size() < static_cast<size_t>(depth)) {
+      std::unique_ptr<Step> step(new Step);
+      step->is_last = num_started == num_steps - 1;
+      step->step_id = step->is_last ? step_id : NewStepId();
+      step->pss = step->is_last ? pss : &step->own_pss;
+      status.Update(StartPartitions(step->step_id, step->pss, req, false,
+                                    &step->calls));
+      if (status.ok()) {
+        running.push_back(std::move(step));
+        ++num_started;
+      }
+      continue;
+    }
+
+    // Steps finish in order, and after an error the remaining ones are
+    // cancelled.
+    std::unique_ptr<Step> step = std::move(running.front());
+    running.pop_front();
+    if (!status.ok()) {
+      step->calls->StartCancel();
+    }
+    status.Update(
+        WaitForPartitions(step->calls.get(), step->pss, call_opts,
+                          step->is_last ? resp : &step->ignored_resp, cm));
+    if (!step->is_last) {
+      // The caller cleans up the last step.
+      Ref();
+      CleanupPartitionsAsync(step->step_id, [this](const Status& s) {
+        if (!s.ok()) {
+          LOG(ERROR) << "Cleanup partition error: " << s;
+        }
+        Unref();
+      });
+    }
+  }
+  return status;
+}
+
 namespace {
 
 class CleanupBroadcastHelper {
@@ -1151,9 +1277,7 @@ Status MasterSession::PartialRunSetup(const PartialRunSetupRequest* req,
   BuildGraphOptions opts;
   BuildBuildGraphOptions(*req, &opts);
   TF_RETURN_IF_ERROR(StartStep(opts, &count, &rcg, true));
-  // Keeps the highest 8 bits 0x01: we reserve some bits of the
-  // step_id for future use.
-  uint64 step_id = (random::New64() & ((1uLL << 56) - 1)) | (1uLL << 56);
+  uint64 step_id = NewStepId();
   TRACEPRINTF("stepid %llu", step_id);
 
   rcg->Ref();
@@ -1230,6 +1354,9 @@ Status MasterSession::BuildAndRegisterPartitions(ReffedClientGraph* rcg) {
     popts.scheduling_for_recvs = true;
     popts.need_to_record_start_times = true;
   }
+  if (session_opts_.config.graph_options().enable_transfer_priorities()) {
+    popts.need_to_record_priorities = true;
+  }
 
   TF_RETURN_IF_ERROR(
       rcg->RegisterPartitions(popts, rcg->client_graph()->flib_def->ToProto()));
@@ -1362,12 +1489,12 @@ Status MasterSession::DoRunWithLocalExecution(
 
   TF_RETURN_IF_ERROR(BuildAndRegisterPartitions(rcg));
 
-  // Keeps the highest 8 bits 0x01: we reserve some bits of the
-  // step_id for future use.
-  const uint64 step_id = (random::New64() & ((1uLL << 56) - 1)) | (1uLL << 56);
+  const uint64 step_id = NewStepId();
   TRACEPRINTF("stepid %llu", step_id);
 
-  pss.collect_timeline = req.options().trace_level() == RunOptions::FULL_TRACE;
+  pss.collect_timeline =
+      req.options().trace_level() == RunOptions::FULL_TRACE &&
+      ShouldTraceStep(req.options(), step_id, &trace_step_counter_);
 
   // Build the cost model every 'build_cost_model_every' steps after skipping an
   // initial 'build_cost_model_after' steps.
@@ -1386,9 +1513,18 @@ Status MasterSession::DoRunWithLocalExecution(
     pss.collect_rpcs = ph->should_collect_rpcs();
   }
 
-  Status s =
-      rcg->RunPartitions(env_, step_id, count, execution_state_.get(), &pss,
-                         opts, req, resp, cancellation_manager_, false);
+  Status s;
+  if (req.options().num_pipelined_steps() > 1) {
+    const int depth = req.options().pipeline_depth() > 0
+                          ? req.options().pipeline_depth()
+                          : kDefaultPipelineDepth;
+    s = rcg->RunPipelinedPartitions(req.options().num_pipelined_steps(), depth,
+                                    step_id, &pss, opts, req, resp,
+                                    cancellation_manager_);
+  } else {
+    s = rcg->RunPartitions(env_, step_id, count, execution_state_.get(), &pss,
+                           opts, req, resp, cancellation_manager_, false);
+  }
   if (s.ok()) {
     pss.end_micros = Env::Default()->NowMicros();
 
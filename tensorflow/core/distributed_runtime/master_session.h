@@ -115,6 +115,9 @@ class MasterSession : public core::RefCounted {
 
   std::atomic<int64> partial_run_handle_counter_ = {0};
 
+  // The number of steps that requested tracing.  Used for sampling.
+  std::atomic<int64> trace_step_counter_ = {0};
+
   mutex mu_;
   std::unique_ptr<SimpleGraphExecutionState> execution_state_;
   int64 graph_version_;
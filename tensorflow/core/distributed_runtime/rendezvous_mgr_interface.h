@@ -65,6 +65,20 @@ class RendezvousMgrInterface {
   virtual Status RecvLocal(int64 step_id, const Rendezvous::ParsedKey& parsed,
                            Tensor* val, bool* is_dead) = 0;
 
+  // Delivers the tensor "val" for "parsed", which a remote worker pushed
+  // before it was asked for, to the local rendezvous instance for the
+  // "step_id".  Sets "*accepted" to false if the tensor was not kept, in
+  // which case its sender must keep it for a RecvTensor call.
+  //
+  // This method is used by the rpc handler of PushTensor.
+  virtual Status RecvPushedTensor(int64 step_id,
+                                  const Rendezvous::ParsedKey& parsed,
+                                  const Tensor& val, bool is_dead,
+                                  bool* accepted) {
+    *accepted = false;
+    return Status::OK();
+  }
+
   // Removes rendezvous for "step_id".
   //
   // TODO(zhifengc): Have a background thread in worker that
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_channel.h"
 
+#include <algorithm>
+#include <atomic>
 #include <limits>
 #include <map>
 #include <unordered_map>
@@ -42,15 +44,29 @@ string MakeAddress(const string& job, int task) {
   return strings::StrCat("/job:", job, "/replica:0/task:", task);
 }
 
-}  // namespace
-
-SharedGrpcChannelPtr NewHostPortGrpcChannel(const string& target) {
+::grpc::ChannelArguments HostPortChannelArguments() {
   // TODO(mrry): Implement secure channels.
   ::grpc::ChannelArguments args;
   args.SetInt(GRPC_ARG_MAX_MESSAGE_LENGTH, std::numeric_limits<int32>::max());
   // NOTE(mrry): Some versions of gRPC use a 20-second minimum backoff
   // on connection failure, which makes our tests time out.
   args.SetInt("grpc.testing.fixed_reconnect_backoff_ms", 1000);
+  return args;
+}
+
+}  // namespace
+
+SharedGrpcChannelPtr NewHostPortGrpcChannel(const string& target) {
+  return ::grpc::CreateCustomChannel(
+      target, ::grpc::InsecureChannelCredentials(), HostPortChannelArguments());
+}
+
+SharedGrpcChannelPtr NewUnsharedHostPortGrpcChannel(const string& target) {
+  // gRPC shares a connection between the channels to the same target with
+  // the same arguments, so each channel gets an argument of its own.
+  static std::atomic<int> next_channel_id(0);
+  ::grpc::ChannelArguments args = HostPortChannelArguments();
+  args.SetInt("tensorflow.unshared_channel_id", next_channel_id++);
   return ::grpc::CreateCustomChannel(
       target, ::grpc::InsecureChannelCredentials(), args);
 }
@@ -93,7 +109,7 @@ Status GrpcChannelSpec::AddHostPortsJob(
 
 namespace {
 
-// GrpcChannelCache that caches results to FindWorkerChannel() calls.
+// GrpcChannelCache that caches results to FindWorkerChannels() calls.
 class CachingGrpcChannelCache : public GrpcChannelCache {
  public:
   CachingGrpcChannelCache() {}
@@ -101,32 +117,39 @@ class CachingGrpcChannelCache : public GrpcChannelCache {
   ~CachingGrpcChannelCache() override {}
 
   SharedGrpcChannelPtr FindWorkerChannel(const string& target) override {
-    SharedGrpcChannelPtr ch = nullptr;
+    std::vector<SharedGrpcChannelPtr> channels = FindWorkerChannels(target);
+    return channels.empty() ? nullptr : channels[0];
+  }
+
+  std::vector<SharedGrpcChannelPtr> FindWorkerChannels(
+      const string& target) override {
     {
       mutex_lock l(mu_);  // could use reader lock
-      ch = gtl::FindPtrOrNull(channels_, target);
-      if (ch) {
-        return ch;
+      auto it = channels_.find(target);
+      if (it != channels_.end()) {
+        return it->second;
       }
     }
-    ch = FindChannelOnce(target);
-    if (ch) {
+    std::vector<SharedGrpcChannelPtr> channels = FindChannelsOnce(target);
+    if (!channels.empty()) {
       mutex_lock l(mu_);
-      channels_.insert({target, ch});
+      channels_.insert({target, channels});
     }
-    return ch;
+    return channels;
   }
 
  protected:
-  // Find the ClientChannel for "target".  Only called when no channel was
-  // found in the channels_ cache for "target".  A non nullptr result will be
+  // Find the ClientChannels for "target".  Only called when no channel was
+  // found in the channels_ cache for "target".  A non-empty result will be
   // cached in channels_.
-  virtual SharedGrpcChannelPtr FindChannelOnce(const string& target) = 0;
+  virtual std::vector<SharedGrpcChannelPtr> FindChannelsOnce(
+      const string& target) = 0;
 
  private:
   // TODO(zhifengc): Eviction when the map becomes too big.
   mutex mu_;
-  std::unordered_map<string, SharedGrpcChannelPtr> channels_ GUARDED_BY(mu_);
+  std::unordered_map<string, std::vector<SharedGrpcChannelPtr>> channels_
+      GUARDED_BY(mu_);
 };
 
 // A ChannelCache that is the union of multiple ChannelCaches.
@@ -167,16 +190,18 @@ class MultiGrpcChannelCache : public CachingGrpcChannelCache {
   }
 
  protected:
-  SharedGrpcChannelPtr FindChannelOnce(const string& target) override {
+  std::vector<SharedGrpcChannelPtr> FindChannelsOnce(
+      const string& target) override {
     for (GrpcChannelCache* cache : caches_) {
-      SharedGrpcChannelPtr ch(cache->FindWorkerChannel(target));
-      if (ch) {
+      std::vector<SharedGrpcChannelPtr> channels =
+          cache->FindWorkerChannels(target);
+      if (!channels.empty()) {
         mutex_lock l(mu_);
         target_caches_.insert({target, cache});
-        return ch;
+        return channels;
       }
     }
-    return nullptr;
+    return {};
   }
 
  private:
@@ -193,10 +218,12 @@ class SparseGrpcChannelCache : public CachingGrpcChannelCache {
  public:
   SparseGrpcChannelCache(const string& job_id,
                          const std::map<int, string>& host_ports,
-                         ChannelCreationFunction channel_func)
+                         ChannelCreationFunction channel_func,
+                         int num_channels_per_target)
       : job_id_(job_id),
         host_ports_(host_ports),
-        channel_func_(std::move(channel_func)) {
+        channel_func_(std::move(channel_func)),
+        num_channels_per_target_(num_channels_per_target) {
     LOG(INFO) << "Initialize GrpcChannelCache for job " << ToString();
   }
   ~SparseGrpcChannelCache() override {}
@@ -233,12 +260,21 @@ class SparseGrpcChannelCache : public CachingGrpcChannelCache {
   }
 
  protected:
-  SharedGrpcChannelPtr FindChannelOnce(const string& target) override {
+  std::vector<SharedGrpcChannelPtr> FindChannelsOnce(
+      const string& target) override {
     const string host_port = TranslateTask(target);
     if (host_port.empty()) {
-      return nullptr;
+      return {};
     }
-    return channel_func_(host_port);
+    std::vector<SharedGrpcChannelPtr> channels;
+    for (int i = 0; i < num_channels_per_target_; ++i) {
+      SharedGrpcChannelPtr ch = channel_func_(host_port);
+      if (!ch) {
+        return {};
+      }
+      channels.push_back(std::move(ch));
+    }
+    return channels;
   }
 
  private:
@@ -256,6 +292,7 @@ class SparseGrpcChannelCache : public CachingGrpcChannelCache {
   const string job_id_;
   const std::map<int, string> host_ports_;
   const ChannelCreationFunction channel_func_;
+  const int num_channels_per_target_;
   TF_DISALLOW_COPY_AND_ASSIGN(SparseGrpcChannelCache);
 };
 
@@ -263,6 +300,12 @@ class SparseGrpcChannelCache : public CachingGrpcChannelCache {
 
 GrpcChannelCache* NewGrpcChannelCache(const GrpcChannelSpec& spec,
                                       ChannelCreationFunction channel_func) {
+  return NewGrpcChannelCache(spec, std::move(channel_func), 1);
+}
+
+GrpcChannelCache* NewGrpcChannelCache(const GrpcChannelSpec& spec,
+                                      ChannelCreationFunction channel_func,
+                                      int num_channels_per_target) {
   const int num_jobs = spec.host_ports_jobs().size();
   if (!num_jobs) {
     LOG(ERROR) << "Empty channel spec.";
@@ -271,8 +314,9 @@ GrpcChannelCache* NewGrpcChannelCache(const GrpcChannelSpec& spec,
   std::vector<GrpcChannelCache*> caches;
   caches.reserve(num_jobs);
   for (auto& job : spec.host_ports_jobs()) {
-    caches.push_back(
-        new SparseGrpcChannelCache(job.job_id, job.host_ports, channel_func));
+    caches.push_back(new SparseGrpcChannelCache(
+        job.job_id, job.host_ports, channel_func,
+        std::max(num_channels_per_target, 1)));
   }
   return caches.size() == 1 ? caches[0] : new MultiGrpcChannelCache(caches);
 }
@@ -73,6 +73,13 @@ class GrpcChannelCache {
   // E.g., /job:mnist/task:2
   virtual SharedGrpcChannelPtr FindWorkerChannel(const string& target) = 0;
 
+  // Like FindWorkerChannel(), but returns all the channels to 'target',
+  // the first of which is FindWorkerChannel(target), or an empty vector if
+  // not found.  There are several if the cache was created with more than
+  // one channel per target.
+  virtual std::vector<SharedGrpcChannelPtr> FindWorkerChannels(
+      const string& target) = 0;
+
   // Translates a string in the form `/job:X/task:Z` into a host_port.
   virtual string TranslateTask(const string& task) = 0;
 };
@@ -82,10 +89,22 @@ typedef std::function<SharedGrpcChannelPtr(string)> ChannelCreationFunction;
 GrpcChannelCache* NewGrpcChannelCache(const GrpcChannelSpec& channel_spec,
                                       ChannelCreationFunction channel_func);
 
+// Like above, but the cache creates 'num_channels_per_target' channels to
+// each target with 'channel_func', which should then give each channel its
+// own connection, as NewUnsharedHostPortGrpcChannel does.
+GrpcChannelCache* NewGrpcChannelCache(const GrpcChannelSpec& channel_spec,
+                                      ChannelCreationFunction channel_func,
+                                      int num_channels_per_target);
+
 // Below here are internal-only functions.
 
 SharedGrpcChannelPtr NewHostPortGrpcChannel(const string& target);
 
+// Like NewHostPortGrpcChannel, but the channel does not share its
+// connection with the other channels to 'target', which gRPC does
+// otherwise, so that several channels carry their calls in parallel.
+SharedGrpcChannelPtr NewUnsharedHostPortGrpcChannel(const string& target);
+
 }  // namespace tensorflow
 
 #endif  // THIRD_PARTY_TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_CHANNEL_H_
@@ -140,4 +140,26 @@ TEST(GrpcChannelTest, SparseHostPorts) {
             workers);
 }
 
+TEST(GrpcChannelTest, MultipleChannelsPerTarget) {
+  GrpcChannelSpec spec;
+  TF_EXPECT_OK(spec.AddHostPortsJob("mnist", {"a:1", "b:2", "c:3"}));
+  TF_EXPECT_OK(spec.AddHostPortsJob("ps", {"d:4"}));
+  std::unique_ptr<GrpcChannelCache> cc(
+      NewGrpcChannelCache(spec, NewUnsharedHostPortGrpcChannel, 3));
+  EXPECT_TRUE(cc->FindWorkerChannels("/job:other/replica:0/task:0").empty());
+  EXPECT_EQ(nullptr, cc->FindWorkerChannel("/job:mnist/replica:0/task:2"));
+
+  for (const string& target :
+       {"/job:mnist/replica:0/task:1", "/job:ps/replica:0/task:0"}) {
+    auto channels_1 = cc->FindWorkerChannels(target);
+    auto channels_2 = cc->FindWorkerChannels(target);
+    ASSERT_EQ(3, channels_1.size());
+    EXPECT_EQ(channels_1, channels_2);
+    EXPECT_EQ(channels_1[0].get(), cc->FindWorkerChannel(target).get());
+    EXPECT_NE(channels_1[0].get(), channels_1[1].get());
+    EXPECT_NE(channels_1[0].get(), channels_1[2].get());
+    EXPECT_NE(channels_1[1].get(), channels_1[2].get());
+  }
+}
+
 }  // namespace tensorflow
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_remote_worker.h"
 
+#include <atomic>
+#include <vector>
+
 #include "grpc++/grpc++.h"
 
 #include "tensorflow/core/common_runtime/process_util.h"
@@ -34,10 +37,11 @@ namespace tensorflow {
 
 class GrpcRemoteWorker : public WorkerInterface {
  public:
-  explicit GrpcRemoteWorker(SharedGrpcChannelPtr channel,
+  explicit GrpcRemoteWorker(const std::vector<SharedGrpcChannelPtr>& channels,
                             ::grpc::CompletionQueue* completion_queue,
                             WorkerCacheLogger* logger)
-      : channel_(channel),
+      : channel_(channels[0]),
+        channels_(channels),
         cq_(completion_queue),
         getstatus_(Method(GrpcWorkerMethod::kGetStatus)),
         registergraph_(Method(GrpcWorkerMethod::kRegisterGraph)),
@@ -45,10 +49,18 @@ class GrpcRemoteWorker : public WorkerInterface {
         rungraph_(Method(GrpcWorkerMethod::kRunGraph)),
         cleanupgraph_(Method(GrpcWorkerMethod::kCleanupGraph)),
         cleanupall_(Method(GrpcWorkerMethod::kCleanupAll)),
-        recvtensor_(Method(GrpcWorkerMethod::kRecvTensor)),
+        next_recvtensor_channel_(0),
+        recvtensors_(Method(GrpcWorkerMethod::kRecvTensors)),
+        pushtensor_(Method(GrpcWorkerMethod::kPushTensor)),
         logging_(Method(GrpcWorkerMethod::kLogging)),
         tracing_(Method(GrpcWorkerMethod::kTracing)),
-        logger_(logger) {}
+        logger_(logger) {
+    for (const SharedGrpcChannelPtr& channel : channels_) {
+      recvtensor_methods_.emplace_back(
+          GrpcWorkerMethodName(GrpcWorkerMethod::kRecvTensor),
+          ::grpc::RpcMethod::NORMAL_RPC, channel);
+    }
+  }
 
   ~GrpcRemoteWorker() override {}
 
@@ -162,8 +174,65 @@ class GrpcRemoteWorker : public WorkerInterface {
       cb_to_use = &wrapper_done;
     }
 
-    IssueRequest(req_copy ? req_copy : request, response, recvtensor_,
-                 std::move(*cb_to_use), call_opts);
+    // The stripes of a tensor go over different channels, and the other
+    // calls take turns.
+    const uint32 turn =
+        request->num_stripes() > 1
+            ? request->stripe_index()
+            : next_recvtensor_channel_.fetch_add(1, std::memory_order_relaxed);
+    const int channel = turn % channels_.size();
+    IssueRequestOnChannel(channels_[channel].get(),
+                          req_copy ? req_copy : request, response,
+                          recvtensor_methods_[channel], std::move(*cb_to_use),
+                          call_opts);
+  }
+
+  void RecvTensorsAsync(CallOptions* call_opts,
+                        const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    VLOG(1) << "RecvTensorsAsync req: " << request->DebugString();
+    if (!logger_->LoggingActive()) {
+      IssueRequest(request, response, recvtensors_, std::move(done),
+                   call_opts);
+      return;
+    }
+    // Type-specialized logging for this method.
+    int64 start_usec = Env::Default()->NowMicros();
+    StatusCallback wrapper_done = [this, request, response, done,
+                                   start_usec](Status s) {
+      if (s.ok() && logger_->LoggingActive()) {
+        int64 end_usec = Env::Default()->NowMicros();
+        for (const auto& item : response->item()) {
+          // See RecvTensorAsync() for why the remote start time is clamped.
+          int64 send_start_usec = std::max(
+              start_usec,
+              static_cast<int64>(item.response().send_start_micros()));
+          send_start_usec = std::min(send_start_usec, end_usec - 1);
+          const string& key = request->rendezvous_key(item.key_index());
+          std::vector<string> key_parts = str_util::Split(key, ';');
+          if (key_parts.size() != 5) {
+            LOG(WARNING) << "Bad key: " << key;
+          } else {
+            logger_->RecordRecvTensor(request->step_id(), send_start_usec,
+                                      end_usec,
+                                      key_parts[3],  // tensor name
+                                      key_parts[0],  // src_device
+                                      key_parts[2],  // dst_device
+                                      item.response().tensor().ByteSize());
+          }
+        }
+      }
+      done(s);
+    };
+    IssueRequest(request, response, recvtensors_, std::move(wrapper_done),
+                 call_opts);
+  }
+
+  void PushTensorAsync(const PushTensorRequest* request,
+                       PushTensorResponse* response,
+                       StatusCallback done) override {
+    IssueRequest(request, response, pushtensor_, std::move(done));
   }
 
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
@@ -230,8 +299,19 @@ class GrpcRemoteWorker : public WorkerInterface {
   void IssueRequest(const RequestMessage* request, ResponseMessage* response,
                     const ::grpc::RpcMethod& method, StatusCallback done,
                     CallOptions* call_opts = nullptr) {
+    IssueRequestOnChannel(channel_.get(), request, response, method,
+                          std::move(done), call_opts);
+  }
+
+  // Like IssueRequest(), over "channel", for which "method" was created.
+  template <class RequestMessage, class ResponseMessage>
+  void IssueRequestOnChannel(::grpc::ChannelInterface* channel,
+                             const RequestMessage* request,
+                             ResponseMessage* response,
+                             const ::grpc::RpcMethod& method,
+                             StatusCallback done, CallOptions* call_opts) {
     auto state = new RPCState<RequestMessage, ResponseMessage>(
-        channel_.get(), cq_, method, *request, std::move(done), call_opts);
+        channel, cq_, method, *request, std::move(done), call_opts);
     state->StartRPC(response);
   }
 
@@ -242,6 +322,8 @@ class GrpcRemoteWorker : public WorkerInterface {
   }
 
   SharedGrpcChannelPtr channel_;
+  // All the channels to the worker, channel_ first.
+  const std::vector<SharedGrpcChannelPtr> channels_;
   ::grpc::CompletionQueue* cq_;
 
   const ::grpc::RpcMethod getstatus_;
@@ -250,7 +332,11 @@ class GrpcRemoteWorker : public WorkerInterface {
   const ::grpc::RpcMethod rungraph_;
   const ::grpc::RpcMethod cleanupgraph_;
   const ::grpc::RpcMethod cleanupall_;
-  const ::grpc::RpcMethod recvtensor_;
+  // The RecvTensor method of each of channels_.
+  std::vector<::grpc::RpcMethod> recvtensor_methods_;
+  std::atomic<uint32> next_recvtensor_channel_;
+  const ::grpc::RpcMethod recvtensors_;
+  const ::grpc::RpcMethod pushtensor_;
   const ::grpc::RpcMethod logging_;
   const ::grpc::RpcMethod tracing_;
 
@@ -263,7 +349,13 @@ class GrpcRemoteWorker : public WorkerInterface {
 WorkerInterface* NewGrpcRemoteWorker(SharedGrpcChannelPtr channel,
                                      ::grpc::CompletionQueue* completion_queue,
                                      WorkerCacheLogger* logger) {
-  return new GrpcRemoteWorker(channel, completion_queue, logger);
+  return new GrpcRemoteWorker({channel}, completion_queue, logger);
+}
+
+WorkerInterface* NewGrpcRemoteWorker(
+    const std::vector<SharedGrpcChannelPtr>& channels,
+    ::grpc::CompletionQueue* completion_queue, WorkerCacheLogger* logger) {
+  return new GrpcRemoteWorker(channels, completion_queue, logger);
 }
 
 }  // namespace tensorflow
@@ -17,6 +17,7 @@ limitations under the License.
 #define THIRD_PARTY_TENSORFLOW_DISTRIBUTED_RUNTIME_RPC_GRPC_REMOTE_WORKER_H_
 
 #include <memory>
+#include <vector>
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 
@@ -33,6 +34,13 @@ WorkerInterface* NewGrpcRemoteWorker(SharedGrpcChannelPtr channel,
                                      ::grpc::CompletionQueue* completion_queue,
                                      WorkerCacheLogger* logger);
 
+// Like above, but the RecvTensor calls are spread over "channels", and
+// the calls for stripes of a tensor go over different channels.  The other
+// calls use channels[0].  "channels" must not be empty.
+WorkerInterface* NewGrpcRemoteWorker(
+    const std::vector<SharedGrpcChannelPtr>& channels,
+    ::grpc::CompletionQueue* completion_queue, WorkerCacheLogger* logger);
+
 }  // namespace tensorflow
 
 #endif  // THIRD_PARTY_TENSORFLOW_DISTRIBUTED_RUNTIME_RPC_GRPC_REMOTE_WORKER_H_
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_server_lib.h"
 
+#include <algorithm>
 #include <cstring>
 #include <limits>
 #include <memory>
@@ -39,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 #include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/lib/strings/strcat.h"
@@ -62,6 +64,14 @@ class NoReusePortOption : public ::grpc::ServerBuilderOption {
                          plugins) override {}
 };
 
+// Returns the number of channels to open to each task; see
+// RPCOptions.num_channels_per_target.
+int NumChannelsPerTarget(const ServerDef& server_def) {
+  return std::max(1, server_def.default_session_config()
+                         .rpc_options()
+                         .num_channels_per_target());
+}
+
 }  // namespace
 
 GrpcServer::GrpcServer(const ServerDef& server_def, Env* env)
@@ -102,6 +112,8 @@ Status GrpcServer::Init() {
 
   SessionOptions sess_opts;
   sess_opts.config = server_def_.default_session_config();
+  TF_RETURN_IF_ERROR(ValidateTensorCompression(
+      sess_opts.config.rpc_options().tensor_compression()));
 
   // Configure shared devices between master and worker.
   string name_prefix =
@@ -195,7 +207,8 @@ Status GrpcServer::Init() {
   }
 
   std::unique_ptr<GrpcChannelCache> channel_cache(NewGrpcChannelCache(
-      channel_spec, GetChannelCreationFunction(server_def_)));
+      channel_spec, GetChannelCreationFunction(server_def_),
+      NumChannelsPerTarget(server_def_)));
   const string host_port = channel_cache->TranslateTask(name_prefix);
   if (!strings::safe_strto32(str_util::Split(host_port, ':')[1],
                              &requested_port_)) {
@@ -218,7 +231,8 @@ Status GrpcServer::Init() {
   // Finish setting up worker environment.
   worker_env_.graph_mgr = new GraphMgr(&worker_env_);
   worker_env_.compute_pool = ComputePool(sess_opts);
-  worker_env_.rendezvous_mgr = new RpcRendezvousMgr(&worker_env_);
+  worker_env_.rendezvous_mgr =
+      new RpcRendezvousMgr(&worker_env_, sess_opts.config.rpc_options());
 
   // Provide direct access to the master from in-process clients.
   LocalMaster::Register(target(), master_impl_.get());
@@ -295,9 +309,15 @@ std::shared_ptr<::grpc::ServerCredentials> GrpcServer::GetServerCredentials(
 
 ChannelCreationFunction GrpcServer::GetChannelCreationFunction(
     const ServerDef& server_def) const {
+  // The channels to the same task are only worth having if they do not
+  // share a connection.
+  if (NumChannelsPerTarget(server_def) > 1) {
+    return NewUnsharedHostPortGrpcChannel;
+  }
   return NewHostPortGrpcChannel;
 }
 
+
 std::unique_ptr<Master> GrpcServer::CreateMaster(MasterEnv* master_env) {
   return std::unique_ptr<Master>(new Master(master_env, 0.0));
 }
@@ -388,6 +388,325 @@ TEST(GrpcSessionTest, LargeTensorSend) {
   TF_CHECK_OK(session->Close());
 }
 
+// Returns a cluster of two workers that compress the tensors they receive
+// from each other as specified by "compression".
+static std::unique_ptr<test::TestCluster> MakeClusterWithRPCOptions(
+    const RPCOptions& rpc_options) {
+  SessionOptions options = Devices(1, 0);
+  *options.config.mutable_rpc_options() = rpc_options;
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(options, 2, &cluster));
+  return cluster;
+}
+
+static std::unique_ptr<test::TestCluster> MakeCompressingCluster(
+    const TensorCompression& compression) {
+  RPCOptions rpc_options;
+  *rpc_options.mutable_tensor_compression() = compression;
+  return MakeClusterWithRPCOptions(rpc_options);
+}
+
+// Builds a graph in which "val", a constant on the second worker, is
+// received by an identity on the first worker, whose name is returned.
+static string CreateRemoteIdentityGraphDef(const test::TestCluster& cluster,
+                                           const Tensor& val, GraphDef* def) {
+  Graph graph(OpRegistry::Global());
+  Node* a = test::graph::Constant(&graph, val);
+  Node* b = test::graph::Identity(&graph, a);
+  test::graph::ToGraphDef(&graph, def);
+  SetDevice(def, a->name(), cluster.devices()[1].name());
+  SetDevice(def, b->name(), cluster.devices()[0].name());
+  return b->name();
+}
+
+TEST(GrpcSessionTest, CompressedTensorTransport) {
+  TensorCompression compression;
+  compression.set_type(TensorCompression::FP16);
+  std::unique_ptr<test::TestCluster> cluster =
+      MakeCompressingCluster(compression);
+
+  Tensor val(DT_FLOAT, TensorShape({1024}));
+  for (int i = 0; i < 1024; ++i) {
+    val.flat<float>()(i) = 0.1f * i;
+  }
+  GraphDef def;
+  const string fetch = CreateRemoteIdentityGraphDef(*cluster, val, &def);
+
+  std::unique_ptr<Session> session(
+      NewRemote(Options(cluster->targets()[0], 1)));
+  ASSERT_TRUE(session != nullptr);
+  TF_CHECK_OK(session->Create(def));
+  for (int i = 0; i < 2; ++i) {
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({}, {fetch}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    // The tensor was rounded to half precision on the way.
+    test::ExpectClose(val, outputs[0], 1e-3, 1e-3);
+    EXPECT_NE(val.tensor_data(), outputs[0].tensor_data());
+  }
+  TF_CHECK_OK(session->Close());
+}
+
+TEST(GrpcSessionTest, TopKCompressedTensorTransport) {
+  TensorCompression compression;
+  compression.set_type(TensorCompression::TOP_K);
+  compression.set_min_bytes(1);
+  compression.set_top_k_fraction(0.5f);
+  // The only edge of the graph.
+  compression.add_edge_name_filter("edge_");
+  std::unique_ptr<test::TestCluster> cluster =
+      MakeCompressingCluster(compression);
+
+  GraphDef def;
+  const string fetch = CreateRemoteIdentityGraphDef(
+      *cluster, test::AsTensor<float>({1, 2, 3, 4}), &def);
+
+  std::unique_ptr<Session> session(
+      NewRemote(Options(cluster->targets()[0], 1)));
+  ASSERT_TRUE(session != nullptr);
+  TF_CHECK_OK(session->Create(def));
+  // The values that are not sent accumulate on the sending worker until
+  // they are large enough to be sent.
+  for (const Tensor& expected : {test::AsTensor<float>({0, 0, 3, 4}),
+                                 test::AsTensor<float>({0, 4, 0, 4})}) {
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({}, {fetch}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(expected, outputs[0]);
+  }
+  TF_CHECK_OK(session->Close());
+}
+
+TEST(GrpcSessionTest, SharedMemoryTensorTransport) {
+  RPCOptions rpc_options;
+  rpc_options.set_use_shared_memory_for_local_peers(true);
+  rpc_options.set_shared_memory_min_bytes(1024);
+  std::unique_ptr<test::TestCluster> cluster =
+      MakeClusterWithRPCOptions(rpc_options);
+
+  // The large tensor is passed through shared memory, the small one in the
+  // response.
+  for (int64 n : {1024, 16}) {
+    Tensor val(DT_INT64, TensorShape({n}));
+    for (int64 i = 0; i < n; ++i) {
+      val.flat<int64>()(i) = i * i;
+    }
+    GraphDef def;
+    const string fetch = CreateRemoteIdentityGraphDef(*cluster, val, &def);
+
+    std::unique_ptr<Session> session(
+        NewRemote(Options(cluster->targets()[0], 1)));
+    ASSERT_TRUE(session != nullptr);
+    TF_CHECK_OK(session->Create(def));
+    for (int i = 0; i < 2; ++i) {
+      std::vector<Tensor> outputs;
+      TF_CHECK_OK(session->Run({}, {fetch}, {}, &outputs));
+      ASSERT_EQ(1, outputs.size());
+      test::ExpectTensorEqual<int64>(val, outputs[0]);
+    }
+    TF_CHECK_OK(session->Close());
+  }
+}
+
+TEST(GrpcSessionTest, PushedTensorTransport) {
+  RPCOptions rpc_options;
+  rpc_options.set_push_remote_tensors(true);
+  // Room for the small tensor only, so that the large one is pulled.
+  rpc_options.set_push_buffer_max_bytes(1024);
+  std::unique_ptr<test::TestCluster> cluster =
+      MakeClusterWithRPCOptions(rpc_options);
+
+  for (int64 n : {16, 1024}) {
+    Tensor val(DT_FLOAT, TensorShape({n}));
+    for (int64 i = 0; i < n; ++i) {
+      val.flat<float>()(i) = i;
+    }
+    GraphDef def;
+    const string fetch = CreateRemoteIdentityGraphDef(*cluster, val, &def);
+
+    std::unique_ptr<Session> session(
+        NewRemote(Options(cluster->targets()[0], 1)));
+    ASSERT_TRUE(session != nullptr);
+    TF_CHECK_OK(session->Create(def));
+    for (int i = 0; i < 2; ++i) {
+      std::vector<Tensor> outputs;
+      TF_CHECK_OK(session->Run({}, {fetch}, {}, &outputs));
+      ASSERT_EQ(1, outputs.size());
+      test::ExpectTensorEqual<float>(val, outputs[0]);
+    }
+    TF_CHECK_OK(session->Close());
+  }
+}
+
+TEST(GrpcSessionTest, StripedTensorTransport) {
+  RPCOptions rpc_options;
+  rpc_options.set_num_channels_per_target(3);
+  rpc_options.set_stripe_min_bytes(1024);
+  std::unique_ptr<test::TestCluster> cluster =
+      MakeClusterWithRPCOptions(rpc_options);
+
+  // After the first step, the large tensor is received in stripes of
+  // different sizes, and the small one whole.
+  for (int64 n : {1000, 16}) {
+    Tensor val(DT_FLOAT, TensorShape({n / 4, 4}));
+    for (int64 i = 0; i < n; ++i) {
+      val.flat<float>()(i) = i;
+    }
+    GraphDef def;
+    const string fetch = CreateRemoteIdentityGraphDef(*cluster, val, &def);
+
+    std::unique_ptr<Session> session(
+        NewRemote(Options(cluster->targets()[0], 1)));
+    ASSERT_TRUE(session != nullptr);
+    TF_CHECK_OK(session->Create(def));
+    for (int i = 0; i < 3; ++i) {
+      std::vector<Tensor> outputs;
+      TF_CHECK_OK(session->Run({}, {fetch}, {}, &outputs));
+      ASSERT_EQ(1, outputs.size());
+      test::ExpectTensorEqual<float>(val, outputs[0]);
+    }
+    TF_CHECK_OK(session->Close());
+  }
+}
+
+TEST(GrpcSessionTest, SessionsShareWorkerGraphs) {
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 0), 2, &cluster));
+  const Tensor val = test::AsTensor<float>({1, 2, 3});
+  GraphDef def;
+  const string fetch = CreateRemoteIdentityGraphDef(*cluster, val, &def);
+
+  // The second session registers the same partitions as the first one, and
+  // its steps still run after the first one has deregistered them.
+  std::unique_ptr<Session> sessions[2];
+  for (auto& session : sessions) {
+    session.reset(NewRemote(Options(cluster->targets()[0], 1)));
+    ASSERT_TRUE(session != nullptr);
+    TF_CHECK_OK(session->Create(def));
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({}, {fetch}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(val, outputs[0]);
+  }
+  TF_CHECK_OK(sessions[0]->Close());
+  for (int i = 0; i < 2; ++i) {
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(sessions[1]->Run({}, {fetch}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(val, outputs[0]);
+  }
+  TF_CHECK_OK(sessions[1]->Close());
+}
+
+TEST(GrpcSessionTest, SessionsShareWorkerGraphsWithVariables) {
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 0), 1, &cluster));
+
+  GraphDef gdef;
+  string init_name;
+  string inc_name;
+  string get_name;
+  {
+    Graph g(OpRegistry::Global());
+    Tensor one(DT_FLOAT, TensorShape({}));
+    one.scalar<float>()() = 1.0;
+    Node* var = test::graph::Var(&g, DT_FLOAT, one.shape());
+    Node* init = test::graph::Assign(&g, var, test::graph::Constant(&g, one));
+    init_name = init->name();
+    Node* update = test::graph::Assign(
+        &g, var, test::graph::Add(&g, var, test::graph::Constant(&g, one)));
+    inc_name = update->name();
+    get_name = var->name();
+    test::graph::ToGraphDef(&g, &gdef);
+  }
+
+  // Both sessions register the same partitions, but create the kernels of
+  // the variable and of the assignments in their own op segments, so the
+  // second session keeps working once the first one is closed.
+  std::unique_ptr<Session> sessions[2];
+  for (auto& session : sessions) {
+    session.reset(NewRemote(Options(cluster->targets()[0], 1)));
+    ASSERT_TRUE(session != nullptr);
+    TF_CHECK_OK(session->Create(gdef));
+  }
+  TF_CHECK_OK(sessions[0]->Run({}, {}, {init_name}, nullptr));
+  TF_CHECK_OK(sessions[1]->Run({}, {}, {inc_name}, nullptr));
+  TF_CHECK_OK(sessions[0]->Close());
+  TF_CHECK_OK(sessions[1]->Run({}, {}, {inc_name}, nullptr));
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(sessions[1]->Run({}, {get_name}, {}, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  EXPECT_EQ(3.0, outputs[0].scalar<float>()());
+  TF_CHECK_OK(sessions[1]->Close());
+}
+
+TEST(GrpcSessionTest, PipelinedSteps) {
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 0), 2, &cluster));
+  const Tensor val = test::AsTensor<float>({1, 2, 3});
+  GraphDef def;
+  const string fetch = CreateRemoteIdentityGraphDef(*cluster, val, &def);
+
+  std::unique_ptr<Session> session(
+      NewRemote(Options(cluster->targets()[0], 1)));
+  ASSERT_TRUE(session != nullptr);
+  TF_CHECK_OK(session->Create(def));
+  for (int depth : {0, 1, 3}) {
+    RunOptions run_options;
+    run_options.set_num_pipelined_steps(5);
+    run_options.set_pipeline_depth(depth);
+    std::vector<Tensor> outputs;
+    RunMetadata metadata;
+    TF_CHECK_OK(
+        session->Run(run_options, {}, {fetch}, {}, &outputs, &metadata));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(val, outputs[0]);
+  }
+  TF_CHECK_OK(session->Close());
+}
+
+TEST(GrpcSessionTest, PipelinedStepsRunEachStep) {
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 0), 1, &cluster));
+
+  GraphDef gdef;
+  string init_name;
+  string inc_name;
+  string get_name;
+  {
+    Graph g(OpRegistry::Global());
+    Tensor one(DT_FLOAT, TensorShape({}));
+    one.scalar<float>()() = 1.0;
+    Node* var = test::graph::Var(&g, DT_FLOAT, one.shape());
+    Node* init = test::graph::Assign(&g, var, test::graph::Constant(&g, one));
+    init_name = init->name();
+    Node* update = test::graph::Assign(
+        &g, var, test::graph::Add(&g, var, test::graph::Constant(&g, one)));
+    inc_name = update->name();
+    get_name = var->name();
+    test::graph::ToGraphDef(&g, &gdef);
+  }
+
+  std::unique_ptr<Session> session(
+      NewRemote(Options(cluster->targets()[0], 1)));
+  ASSERT_TRUE(session != nullptr);
+  TF_CHECK_OK(session->Create(gdef));
+  TF_CHECK_OK(session->Run({}, {}, {init_name}, nullptr));
+
+  // One step at a time, so that the read-modify-write updates do not race.
+  RunOptions run_options;
+  run_options.set_num_pipelined_steps(4);
+  run_options.set_pipeline_depth(1);
+  TF_CHECK_OK(
+      session->Run(run_options, {}, {}, {inc_name}, nullptr, nullptr));
+
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(session->Run({}, {get_name}, {}, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  EXPECT_EQ(5.0, outputs[0].scalar<float>()());
+  TF_CHECK_OK(session->Close());
+}
+
 TEST(GrpcSessionTest, MultiDevices_String) {
   std::unique_ptr<test::TestCluster> cluster;
   TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 1), 2, &cluster));
@@ -138,22 +138,20 @@ static void EncodeSkeleton(const Tensor& val, io::ProtoEncodeHelper* e) {
 #endif
 }
 
-void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
-                              ::grpc::ByteBuffer* result) {
+// Encode "response", with "val" as its tensor, into a byte buffer.
+// "response" must not hold a tensor yet.
+static void EncodeResponseWithTensor(RecvTensorResponse* response,
+                                     const Tensor& val,
+                                     ::grpc::ByteBuffer* result) {
   const int kLargeTensorBytes = 1024;
-  RecvTensorResponse response;
-  if (is_dead) {
-    response.set_is_dead(is_dead);
-  }
-  response.set_send_start_micros(Env::Default()->NowMicros());
   if (!DataTypeCanUseMemcpy(val.dtype())) {
     // Straightforward but slow path for complicated kinds of tensor data
     // TODO(jeff,sanjay): If this becomes an issue, we could
     // go directly from val -> ByteBuffer, with some effort.
-    val.AsProtoTensorContent(response.mutable_tensor());
+    val.AsProtoTensorContent(response->mutable_tensor());
 
     // Encode full protocol buffer to a ByteBuffer
-    EncodeRecvTensorResponseToByteBuffer(response, result);
+    EncodeRecvTensorResponseToByteBuffer(*response, result);
   } else {
     // skeleton is the encoded TensorProto contents (dtype and shape), but
     // not the actual data
@@ -167,7 +165,7 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
          VarLengthEncodingSize(TensorProto::kTensorContentFieldNumber,
                                tdata.size()));
     string header;  // All of RecvTensorRequest except the tensor() field
-    response.AppendToString(&header);
+    response->AppendToString(&header);
 
     size_t expected_size =
         (header.size() +
@@ -265,5 +263,52 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
   }
 }
 
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
+                              ::grpc::ByteBuffer* result) {
+  RecvTensorResponse response;
+  if (is_dead) {
+    response.set_is_dead(is_dead);
+  }
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  EncodeResponseWithTensor(&response, val, result);
+}
+
+void EncodeTensorStripeToByteBuffer(const Tensor& val, int64 begin,
+                                    int64 end, ::grpc::ByteBuffer* result) {
+  RecvTensorResponse response;
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  val.shape().AsProto(response.mutable_stripe()->mutable_shape());
+  response.mutable_stripe()->set_offset(begin);
+  // The stripe shares the buffer of "val", so large stripes are not copied
+  // either.
+  Tensor flat;
+  CHECK(flat.CopyFrom(val, TensorShape({val.NumElements()})));
+  EncodeResponseWithTensor(&response, flat.Slice(begin, end), result);
+}
+
+void EncodeCompressedTensorToByteBuffer(const Tensor& val,
+                                        CompressedTensorContent* content,
+                                        ::grpc::ByteBuffer* result) {
+  // The compressed content is small compared to the tensor, so it is simply
+  // copied along with the rest of the response.
+  RecvTensorResponse response;
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  response.mutable_tensor()->set_dtype(val.dtype());
+  val.shape().AsProto(response.mutable_tensor()->mutable_tensor_shape());
+  response.mutable_compressed_content()->Swap(content);
+  EncodeRecvTensorResponseToByteBuffer(response, result);
+}
+
+void EncodeSharedMemoryTensorToByteBuffer(
+    const Tensor& val, const SharedMemoryTensorContent& content,
+    ::grpc::ByteBuffer* result) {
+  RecvTensorResponse response;
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  response.mutable_tensor()->set_dtype(val.dtype());
+  val.shape().AsProto(response.mutable_tensor()->mutable_tensor_shape());
+  response.mutable_transport_options()->PackFrom(content);
+  EncodeRecvTensorResponseToByteBuffer(response, result);
+}
+
 }  // namespace grpc
 }  // namespace tensorflow
@@ -16,11 +16,15 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 
+#include "tensorflow/core/platform/types.h"
+
 namespace grpc {
 class ByteBuffer;
 }  // namespace grpc
 
 namespace tensorflow {
+class CompressedTensorContent;
+class SharedMemoryTensorContent;
 class Tensor;
 class RecvTensorResponse;
 
@@ -51,6 +55,36 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
                               ::grpc::ByteBuffer* result);
 
+// Encode the elements ["begin", "end") of the flattened live tensor "val",
+// whose elements can be copied as bytes, into a byte buffer in a format
+// that is parseable as a RecvTensorResponse protocol buffer holding them as
+// a vector, and the shape of "val" and "begin" in its stripe.
+//
+// Discards original contents of *result.
+void EncodeTensorStripeToByteBuffer(const Tensor& val, int64 begin,
+                                    int64 end, ::grpc::ByteBuffer* result);
+
+// Encode the live tensor "val", whose content was compressed into
+// "*content", into a byte buffer in a format that is parseable as a
+// RecvTensorResponse protocol buffer holding the dtype and shape of "val"
+// and "*content".
+//
+// Leaves "*content" with unspecified contents, and discards original
+// contents of *result.
+void EncodeCompressedTensorToByteBuffer(const Tensor& val,
+                                        CompressedTensorContent* content,
+                                        ::grpc::ByteBuffer* result);
+
+// Encode the live tensor "val", whose content was written to the file
+// described by "content", into a byte buffer in a format that is parseable
+// as a RecvTensorResponse protocol buffer holding the dtype and shape of
+// "val" and "content" in its transport_options.
+//
+// Discards original contents of *result.
+void EncodeSharedMemoryTensorToByteBuffer(
+    const Tensor& val, const SharedMemoryTensorContent& content,
+    ::grpc::ByteBuffer* result);
+
 }  // namespace grpc
 }  // namespace tensorflow
 
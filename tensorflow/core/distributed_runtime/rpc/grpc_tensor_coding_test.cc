@@ -100,4 +100,35 @@ TEST_F(GrpcTensorCodingTest, Simple) {
 
 TEST_F(GrpcTensorCodingTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(GrpcTensorCodingTest, TensorStripes) {
+  Tensor t(DT_FLOAT, TensorShape({3, 5}));
+  test::FillIota<float>(&t, 0);
+  auto flat = t.flat<float>();
+  for (const std::pair<int64, int64>& range :
+       {std::make_pair(0, 15), std::make_pair(0, 4), std::make_pair(4, 15),
+        std::make_pair(7, 7)}) {
+    ::grpc::ByteBuffer buf;
+    grpc::EncodeTensorStripeToByteBuffer(t, range.first, range.second, &buf);
+    std::vector<::grpc::Slice> slices;
+    (void)buf.Dump(&slices);
+    string tmp;
+    for (const auto& s : slices) {
+      tmp.append(reinterpret_cast<const char*>(s.begin()), s.size());
+    }
+
+    RecvTensorResponse response;
+    EXPECT_TRUE(response.ParseFromString(tmp));
+    EXPECT_FALSE(response.is_dead());
+    EXPECT_EQ(range.first, response.stripe().offset());
+    EXPECT_EQ(t.shape(), TensorShape(response.stripe().shape()));
+
+    Tensor stripe;
+    EXPECT_TRUE(stripe.FromProto(response.tensor()));
+    ASSERT_EQ(range.second - range.first, stripe.NumElements());
+    for (int64 i = 0; i < stripe.NumElements(); ++i) {
+      EXPECT_EQ(flat(range.first + i), stripe.flat<float>()(i));
+    }
+  }
+}
+
 }  // namespace tensorflow
@@ -50,13 +50,17 @@ Status TestCluster::MakeTestCluster(const SessionOptions& options, int n,
   }
 
   for (int i = 0; i < n; ++i) {
-    const std::vector<string> argv(
+    std::vector<string> argv(
         {strings::StrCat(testing::TensorFlowSrcRoot(),
                          "/core/distributed_runtime/rpc/grpc_testlib_server"),
          /* see grpc_testlib_server.cc for flags */
          tf_jobs, "--tf_job=localhost", strings::StrCat("--tf_task=", i),
          strings::StrCat("--num_cpus=", num_cpus),
          strings::StrCat("--num_gpus=", num_gpus)});
+    if (options.config.has_rpc_options()) {
+      argv.push_back(strings::StrCat(
+          "--rpc_options=", options.config.rpc_options().ShortDebugString()));
+    }
     ret->subprocesses_.emplace_back(testing::CreateSubProcess(argv));
     bool success = ret->subprocesses_[i]->Start();
     if (!success) {
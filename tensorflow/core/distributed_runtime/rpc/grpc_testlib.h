@@ -42,8 +42,8 @@ namespace test {
 class TestCluster {
  public:
   // Creates a new test cluster based on the given `options` (which
-  // configure the number of devices of each type) and a count of
-  // processes `n`. On success, the test cluster is stored in
+  // configure the number of devices of each type, and the RPC options of
+  // the servers) and a count of processes `n`. On success, the test cluster is stored in
   // *out_cluster, and this function returns OK. Otherwise an error is
   // returned.
   static Status MakeTestCluster(const SessionOptions& options, int n,
@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -126,6 +127,12 @@ class GrpcWorkerService : public AsyncServiceInterface {
     for (int i = 0; i < 100; ++i) {
       ENQUEUE_REQUEST(RunGraph, true);
     }
+    for (int i = 0; i < 100; ++i) {
+      ENQUEUE_REQUEST(RecvTensors, true);
+    }
+    for (int i = 0; i < 100; ++i) {
+      ENQUEUE_REQUEST(PushTensor, false);
+    }
     for (int i = 0; i < 100; ++i) {
       ENQUEUE_REQUEST(CleanupGraph, false);
     }
@@ -245,6 +252,32 @@ class GrpcWorkerService : public AsyncServiceInterface {
     EnqueueRecvTensorRequestRaw();
   }
 
+  void RecvTensorsHandler(
+      WorkerCall<RecvTensorsRequest, RecvTensorsResponse>* call) {
+    Schedule([this, call]() {
+      CallOptions* call_opts = new CallOptions;
+      call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
+      worker_->RecvTensorsAsync(call_opts, &call->request, &call->response,
+                                [call, call_opts](const Status& s) {
+                                  call->ClearCancelCallback();
+                                  delete call_opts;
+                                  call->SendResponse(ToGrpcStatus(s));
+                                });
+    });
+    ENQUEUE_REQUEST(RecvTensors, true);
+  }
+
+  void PushTensorHandler(
+      WorkerCall<PushTensorRequest, PushTensorResponse>* call) {
+    Schedule([this, call]() {
+      worker_->PushTensorAsync(&call->request, &call->response,
+                               [call](const Status& s) {
+                                 call->SendResponse(ToGrpcStatus(s));
+                               });
+    });
+    ENQUEUE_REQUEST(PushTensor, false);
+  }
+
   void CleanupGraphHandler(
       WorkerCall<CleanupGraphRequest, CleanupGraphResponse>* call) {
     Schedule([this, call]() {
@@ -289,7 +322,14 @@ class GrpcWorkerService : public AsyncServiceInterface {
 
 }  // namespace
 
-GrpcWorker::GrpcWorker(WorkerEnv* worker_env) : Worker(worker_env) {}
+// Files that were never read, e.g. because the receiving step was aborted,
+// are deleted after this long.
+static const int64 kMaxSharedMemoryFileAgeMicros = 5 * 60 * 1000 * 1000LL;
+
+GrpcWorker::GrpcWorker(WorkerEnv* worker_env)
+    : Worker(worker_env),
+      shm_sender_(worker_env->env, kSharedMemoryDir,
+                  kMaxSharedMemoryFileAgeMicros) {}
 
 // RecvTensorAsync: unlike the other Worker methods, which use protocol buffers
 // for a response object, to avoid extra protocol buffer serialization overhead
@@ -298,6 +338,10 @@ void GrpcWorker::RecvTensorAsync(CallOptions* opts,
                                  const RecvTensorRequest* request,
                                  ::grpc::ByteBuffer* response,
                                  StatusCallback done) {
+  if (request->num_stripes() > 1) {
+    RecvTensorStripeAsync(opts, request, response, std::move(done));
+    return;
+  }
   const int64 step_id = request->step_id();
   const string& key = request->rendezvous_key();
   TRACEPRINTF("RecvTensor: %lld %s", step_id, key.c_str());
@@ -319,10 +363,10 @@ void GrpcWorker::RecvTensorAsync(CallOptions* opts,
   opts->SetCancelCallback([this, step_id]() { AbortStep(step_id); });
   env_->rendezvous_mgr->RecvLocalAsync(
       step_id, parsed,
-      [opts, response, done, src_dev](const Status& status,
-                                      const Rendezvous::Args& send_args,
-                                      const Rendezvous::Args& recv_args,
-                                      const Tensor& val, const bool is_dead) {
+      [this, opts, request, response, done, src_dev](
+          const Status& status, const Rendezvous::Args& send_args,
+          const Rendezvous::Args& recv_args, const Tensor& val,
+          const bool is_dead) {
         opts->ClearCancelCallback();
         if (status.ok()) {
           // DMA can only be used for Tensors that do not fall into
@@ -367,7 +411,24 @@ void GrpcWorker::RecvTensorAsync(CallOptions* opts,
               done(errors::Internal("No GPU device in process"));
 #endif  // GOOGLE_CUDA
             } else {
-              grpc::EncodeTensorToByteBuffer(is_dead, val, response);
+              // The residuals of TOP_K compression are kept per edge, so
+              // the key is stripped of the frame and iteration.
+              SharedMemoryTensorContent shm_content;
+              CompressedTensorContent compressed;
+              const string& key = request->rendezvous_key();
+              if (!is_dead && shm_sender_.Send(*request, val, &shm_content)) {
+                grpc::EncodeSharedMemoryTensorToByteBuffer(val, shm_content,
+                                                           response);
+              } else if (!is_dead && request->has_compression() &&
+                  compressor_.Compress(StepGraphHandle(request->step_id()),
+                                       key.substr(0, key.rfind(';')),
+                                       request->compression(), val,
+                                       &compressed)) {
+                grpc::EncodeCompressedTensorToByteBuffer(val, &compressed,
+                                                         response);
+              } else {
+                grpc::EncodeTensorToByteBuffer(is_dead, val, response);
+              }
               done(Status::OK());
             }
           }
@@ -378,6 +439,252 @@ void GrpcWorker::RecvTensorAsync(CallOptions* opts,
       });
   }
 
+// The stripes of a tensor are requested by concurrent calls, which may
+// arrive over different channels and in any order. The first of them
+// receives the tensor from the local rendezvous, and each call returns the
+// stripe_index-th of num_stripes contiguous ranges of the tensor's elements.
+void GrpcWorker::RecvTensorStripeAsync(CallOptions* opts,
+                                       const RecvTensorRequest* request,
+                                       ::grpc::ByteBuffer* response,
+                                       StatusCallback done) {
+  const int64 step_id = request->step_id();
+  const string& key = request->rendezvous_key();
+  TRACEPRINTF("RecvTensor: %lld %s stripe %d of %d", step_id, key.c_str(),
+              request->stripe_index(), request->num_stripes());
+  if (request->stripe_index() < 0 ||
+      request->stripe_index() >= request->num_stripes()) {
+    done(errors::InvalidArgument("Invalid stripe ", request->stripe_index(),
+                                 " of ", request->num_stripes(), " for ",
+                                 key));
+    return;
+  }
+  Rendezvous::ParsedKey parsed;
+  Status s = Rendezvous::ParseKey(key, &parsed);
+  Device* src_dev = nullptr;
+  if (s.ok()) {
+    s = PrepareRecvTensor(parsed, &src_dev);
+  }
+  if (!s.ok()) {
+    done(s);
+    return;
+  }
+
+  StripeCall call{opts, request, response, std::move(done)};
+  std::shared_ptr<const StripeSource> source;
+  bool first = false;
+  {
+    mutex_lock l(stripes_mu_);
+    auto it = striped_tensors_[step_id].emplace(key, StripedTensor());
+    StripedTensor* tensor = &it.first->second;
+    if (it.second) {
+      first = true;
+      tensor->num_remaining = request->num_stripes();
+    }
+    source = tensor->source;
+    if (source == nullptr) {
+      opts->SetCancelCallback([this, step_id]() { AbortStep(step_id); });
+      tensor->waiting.push_back(std::move(call));
+    }
+  }
+  if (source != nullptr) {
+    // The stripe is recorded as returned first, so that a concurrent
+    // cleanup does not delete the shared memory file it names.
+    FinishStripe(step_id, key, request->stripe_index());
+    RespondStripe(*source, call);
+    return;
+  }
+  if (!first) {
+    return;
+  }
+
+  // A tensor passed through shared memory is written there once, and is
+  // returned whole with stripe 0.
+  env_->rendezvous_mgr->RecvLocalAsync(
+      step_id, parsed,
+      [this, step_id, key, request, src_dev](
+          const Status& status, const Rendezvous::Args& send_args,
+          const Rendezvous::Args& recv_args, const Tensor& val,
+          const bool is_dead) {
+        std::shared_ptr<StripeSource> source(new StripeSource);
+        source->status = status;
+        if (status.ok() && src_dev->tensorflow_gpu_device_info() &&
+            !send_args.alloc_attrs.on_host()) {
+          source->status = errors::InvalidArgument(
+              "Striped RecvTensor requires tensors in host memory, but got ",
+              key);
+        }
+        if (source->status.ok()) {
+          source->val = val;
+          source->is_dead = is_dead;
+          source->whole = is_dead || !DataTypeCanUseMemcpy(val.dtype());
+          if (!source->whole &&
+              shm_sender_.Send(*request, val, &source->shm_content)) {
+            source->whole = true;
+            source->shm = true;
+          }
+        }
+        StripedTensorReady(step_id, key, std::move(source));
+      });
+}
+
+void GrpcWorker::StripedTensorReady(
+    int64 step_id, const string& key,
+    std::shared_ptr<const StripeSource> source) {
+  std::vector<StripeCall> waiting;
+  StripedTensor* tensor = nullptr;
+  {
+    mutex_lock l(stripes_mu_);
+    auto step = striped_tensors_.find(step_id);
+    if (step != striped_tensors_.end()) {
+      auto it = step->second.find(key);
+      if (it != step->second.end()) {
+        tensor = &it->second;
+      }
+    }
+    if (tensor != nullptr) {
+      tensor->source = source;
+      waiting.swap(tensor->waiting);
+    }
+  }
+  if (tensor == nullptr) {
+    // The step has been cleaned up, so no stripe will name the file.
+    if (source->shm) {
+      shm_sender_.Abandon(source->shm_content);
+    }
+    return;
+  }
+  for (const StripeCall& call : waiting) {
+    call.opts->ClearCancelCallback();
+    FinishStripe(step_id, key, call.request->stripe_index());
+    RespondStripe(*source, call);
+  }
+}
+
+void GrpcWorker::RespondStripe(const StripeSource& source,
+                               const StripeCall& call) {
+  if (!source.status.ok()) {
+    call.done(source.status);
+    return;
+  }
+  const int index = call.request->stripe_index();
+  if (source.whole) {
+    if (index != 0) {
+      grpc::EncodeRecvTensorResponseToByteBuffer(RecvTensorResponse(),
+                                                 call.response);
+    } else if (source.shm) {
+      grpc::EncodeSharedMemoryTensorToByteBuffer(
+          source.val, source.shm_content, call.response);
+    } else {
+      grpc::EncodeTensorToByteBuffer(source.is_dead, source.val,
+                                     call.response);
+    }
+  } else {
+    int64 begin;
+    int64 end;
+    GetStripeRange(source.val.NumElements(), call.request->num_stripes(),
+                   index, &begin, &end);
+    grpc::EncodeTensorStripeToByteBuffer(source.val, begin, end,
+                                         call.response);
+  }
+  call.done(Status::OK());
+}
+
+void GrpcWorker::FinishStripe(int64 step_id, const string& key, int index) {
+  mutex_lock l(stripes_mu_);
+  auto step = striped_tensors_.find(step_id);
+  if (step == striped_tensors_.end()) {
+    return;
+  }
+  auto it = step->second.find(key);
+  if (it == step->second.end()) {
+    return;
+  }
+  if (index == 0) {
+    it->second.stripe0_returned = true;
+  }
+  if (--it->second.num_remaining <= 0) {
+    step->second.erase(it);
+    if (step->second.empty()) {
+      striped_tensors_.erase(step);
+    }
+  }
+}
+
+  string GrpcWorker::StepGraphHandle(int64 step_id) {
+    mutex_lock l(step_graphs_mu_);
+    auto it = step_graph_handles_.find(step_id);
+    return it == step_graph_handles_.end() ? string() : it->second;
+  }
+
+  void GrpcWorker::DeregisterGraphAsync(const DeregisterGraphRequest* request,
+                                        DeregisterGraphResponse* response,
+                                        StatusCallback done) {
+    compressor_.ClearResiduals(request->graph_handle());
+    Worker::DeregisterGraphAsync(request, response, std::move(done));
+  }
+
+  void GrpcWorker::RunGraphAsync(CallOptions* opts,
+                                 RunGraphRequestWrapper* request,
+                                 MutableRunGraphResponseWrapper* response,
+                                 StatusCallback done) {
+    {
+      mutex_lock l(step_graphs_mu_);
+      step_graph_handles_[request->step_id()] = request->graph_handle();
+    }
+    Worker::RunGraphAsync(opts, request, response, std::move(done));
+  }
+
+  void GrpcWorker::CleanupGraphAsync(const CleanupGraphRequest* request,
+                                     CleanupGraphResponse* response,
+                                     StatusCallback done) {
+    {
+      mutex_lock l(step_graphs_mu_);
+      step_graph_handles_.erase(request->step_id());
+    }
+    // The shared memory files of the dropped tensors whose stripe 0 has not
+    // been returned will not be read.
+    std::vector<SharedMemoryTensorContent> abandoned;
+    {
+      // The tensors that calls are waiting for are dropped when the calls
+      // respond, with the error that the cleanup delivers to them.
+      mutex_lock l(stripes_mu_);
+      auto step = striped_tensors_.find(request->step_id());
+      if (step != striped_tensors_.end()) {
+        auto& tensors = step->second;
+        for (auto it = tensors.begin(); it != tensors.end();) {
+          if (it->second.waiting.empty()) {
+            const StripeSource* source = it->second.source.get();
+            if (source != nullptr && source->shm &&
+                !it->second.stripe0_returned) {
+              abandoned.push_back(source->shm_content);
+            }
+            it = tensors.erase(it);
+          } else {
+            ++it;
+          }
+        }
+        if (tensors.empty()) {
+          striped_tensors_.erase(step);
+        }
+      }
+    }
+    for (const SharedMemoryTensorContent& content : abandoned) {
+      shm_sender_.Abandon(content);
+    }
+    Worker::CleanupGraphAsync(request, response, std::move(done));
+  }
+
+  void GrpcWorker::CleanupAllAsync(const CleanupAllRequest* request,
+                                   CleanupAllResponse* response,
+                                   StatusCallback done) {
+    compressor_.ClearAllResiduals();
+    {
+      mutex_lock l(step_graphs_mu_);
+      step_graph_handles_.clear();
+    }
+    Worker::CleanupAllAsync(request, response, std::move(done));
+  }
+
   WorkerEnv* GrpcWorker::env() { return env_; }
 
   GrpcWorker* NewGrpcWorker(WorkerEnv* env) { return new GrpcWorker(env); }
@@ -16,6 +16,12 @@ limitations under the License.
 #ifndef THIRD_PARTY_TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_WORKER_SERVICE_H_
 #define THIRD_PARTY_TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_WORKER_SERVICE_H_
 
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 
 namespace grpc {
@@ -36,7 +42,106 @@ class GrpcWorker : public Worker {
   void RecvTensorAsync(CallOptions* opts, const RecvTensorRequest* request,
                        ::grpc::ByteBuffer* response, StatusCallback done);
 
+  // Also drops the residuals of the TOP_K compressed edges of the graph.
+  void DeregisterGraphAsync(const DeregisterGraphRequest* request,
+                            DeregisterGraphResponse* response,
+                            StatusCallback done) override;
+
+  // Also records which graph the step runs, for TOP_K compression.
+  void RunGraphAsync(CallOptions* opts, RunGraphRequestWrapper* request,
+                     MutableRunGraphResponseWrapper* response,
+                     StatusCallback done) override;
+
+  // Also drops the striped tensors of the step that no call is waiting for,
+  // and forgets which graph the step runs.
+  void CleanupGraphAsync(const CleanupGraphRequest* request,
+                         CleanupGraphResponse* response,
+                         StatusCallback done) override;
+
+  // Also drops the residuals of TOP_K compressed edges.
+  void CleanupAllAsync(const CleanupAllRequest* request,
+                       CleanupAllResponse* response,
+                       StatusCallback done) override;
+
   WorkerEnv* env();
+
+ private:
+  // A RecvTensor call for one stripe of a tensor; see
+  // RecvTensorRequest.num_stripes.
+  struct StripeCall {
+    CallOptions* opts;
+    const RecvTensorRequest* request;
+    ::grpc::ByteBuffer* response;
+    StatusCallback done;
+  };
+
+  // The value of a striped tensor, once it has been received from the local
+  // rendezvous.
+  struct StripeSource {
+    Status status;
+    Tensor val;
+    bool is_dead = false;
+    // If true, stripe 0 returns the whole tensor and the other stripes
+    // return nothing, e.g. because the tensor is dead.
+    bool whole = false;
+    // Set if the whole tensor is passed through shared memory.
+    bool shm = false;
+    SharedMemoryTensorContent shm_content;
+  };
+
+  // A tensor returned in stripes. It is received from the local rendezvous
+  // once, by the first of its stripe calls, and kept until all the stripes
+  // have been returned.
+  struct StripedTensor {
+    int num_remaining = 0;
+    // Null until the tensor has been received.
+    std::shared_ptr<const StripeSource> source;
+    // The calls that arrived before the tensor.
+    std::vector<StripeCall> waiting;
+    // Whether stripe 0, which names the shared memory file, if any, has
+    // been returned.
+    bool stripe0_returned = false;
+  };
+
+  void RecvTensorStripeAsync(CallOptions* opts,
+                             const RecvTensorRequest* request,
+                             ::grpc::ByteBuffer* response,
+                             StatusCallback done);
+
+  // Records that the tensor for "key" has been received, and responds to
+  // the stripe calls waiting for it.  Deletes the shared memory file of
+  // "source" if the stripes are no longer wanted.
+  void StripedTensorReady(int64 step_id, const string& key,
+                          std::shared_ptr<const StripeSource> source);
+
+  // Responds to "call" with its stripe of "source".
+  void RespondStripe(const StripeSource& source, const StripeCall& call);
+
+  // Records that stripe "index" of the tensor for "key" has been returned,
+  // and forgets the tensor once all of its stripes have been returned.
+  void FinishStripe(int64 step_id, const string& key, int index);
+
+  // Returns the handle of the graph that step "step_id" runs on this
+  // worker, or "" if it is unknown.
+  string StepGraphHandle(int64 step_id);
+
+  // Compresses the tensors of RecvTensor requests that ask for it.
+  TensorCompressor compressor_;
+
+  mutex step_graphs_mu_;
+  // The graph handle of each step, until the step is cleaned up.  The
+  // residuals of TOP_K compression are kept per graph.
+  std::unordered_map<int64, string> step_graph_handles_
+      GUARDED_BY(step_graphs_mu_);
+
+  // Returns tensors through shared memory to the workers on this host that
+  // ask for it.
+  SharedMemorySender shm_sender_;
+
+  mutex stripes_mu_;
+  // Indexed by step id and rendezvous key.
+  std::unordered_map<int64, std::unordered_map<string, StripedTensor>>
+      striped_tensors_ GUARDED_BY(stripes_mu_);
 };
 
 GrpcWorker* NewGrpcWorker(WorkerEnv* worker_env);
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "tensorflow/core/common_runtime/device.h"
@@ -22,6 +24,8 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
 #include "tensorflow/core/framework/types.h"
@@ -36,21 +40,144 @@ namespace tensorflow {
 
 namespace {
 
+// Receives of at most this many bytes are coalesced when
+// RPCOptions.recv_coalescing_max_bytes is 0.
+const int64 kDefaultRecvCoalescingMaxBytes = 64 << 10;
+
+// Tensors of at least this many bytes are received through shared memory
+// when RPCOptions.shared_memory_min_bytes is 0.
+const int64 kDefaultSharedMemoryMinBytes = 64 << 10;
+
+// The bytes of pushed tensors buffered by a worker when
+// RPCOptions.push_buffer_max_bytes is 0.
+const int64 kDefaultPushBufferMaxBytes = 256LL << 20;
+
+// Tensors of at least this many bytes are received in stripes when
+// RPCOptions.stripe_min_bytes is 0.
+const int64 kDefaultStripeMinBytes = 4 << 20;
+
+// Returns the rendezvous key "key" without the frame and iteration, so that
+// all the iterations of a loop share the decisions made for an edge.
+string EdgeKey(StringPiece key) {
+  return key.substr(0, key.rfind(';')).ToString();
+}
+
+// A receive that is coalesced with others into a RecvTensors call.
+struct CoalescedRecv {
+  Rendezvous::ParsedKey parsed;
+  Device* dst_device;
+  Rendezvous::Args recv_args;
+  Rendezvous::DoneCallback done;
+  // True once the receive has been part of a RecvTensors call. The remote
+  // worker then holds on to the tensor for a later RecvTensors call, so the
+  // receive must not fall back to RecvTensor.
+  bool requested = false;
+};
+
+// A receive whose tensor is returned in stripes by concurrent RecvTensor
+// calls, each read straight into its range of one tensor.
+struct StripedRecv {
+  Rendezvous::ParsedKey parsed;
+  Device* dst_device;
+  Rendezvous::Args recv_args;
+  Rendezvous::DoneCallback done;
+  int num_stripes;
+
+  mutex mu;
+  int num_remaining GUARDED_BY(mu);
+  Status status GUARDED_BY(mu);
+  // Allocated when the first stripe arrives, unless stripe 0 returns the
+  // whole tensor.
+  Tensor val GUARDED_BY(mu);
+  bool is_dead GUARDED_BY(mu) = false;
+  bool whole GUARDED_BY(mu) = false;
+  // Whether each stripe has been given its range of val to be read into.
+  std::vector<bool> read GUARDED_BY(mu);
+};
+
+class RpcRecvTensorCall;
+class RpcRecvTensorsCall;
+
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
   RpcRemoteRendezvous(const WorkerEnv* env, WorkerCacheInterface* cache,
-                      int64 step_id)
-      : BaseRemoteRendezvous(env, step_id, false), cache_(cache) {}
+                      RecvCoalescingPolicy* policy,
+                      RecvStripingPolicy* striping,
+                      const TensorCompression* compression,
+                      const SharedMemoryReceiver* shm_receiver,
+                      PushBufferLimit* push_limit, int64 step_id)
+      : BaseRemoteRendezvous(env, step_id, false, push_limit),
+        cache_(cache),
+        policy_(policy),
+        striping_(striping),
+        compression_(compression),
+        shm_receiver_(shm_receiver),
+        push_(push_limit != nullptr) {}
 
  protected:
   void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
                            const Rendezvous::Args& args,
                            DoneCallback done) override;
 
+  // The tensors sent between the CPU devices of two workers are pushed, if
+  // push mode is on.
+  bool IsPushed(const Rendezvous::ParsedKey& parsed) override {
+    return push_ && parsed.src.type == DEVICE_CPU &&
+           parsed.dst.type == DEVICE_CPU;
+  }
+
+  void PushToRemote(const Rendezvous::ParsedKey& parsed,
+                    const Rendezvous::Args& args, const Tensor& val,
+                    bool is_dead) override;
+
  private:
   ~RpcRemoteRendezvous() override {}
 
-  WorkerCacheInterface* cache_;  // Not owned.
+  // Receives the tensor for "parsed" with its own RecvTensor call.
+  void StartRecvTensorCall(const string& src_worker,
+                           const Rendezvous::ParsedKey& parsed,
+                           Device* dst_device, const Rendezvous::Args& args,
+                           DoneCallback done);
+
+  // Receives the tensor for "recv->parsed" in recv->num_stripes stripes,
+  // each with its own RecvTensor call.
+  void StartStripedRecv(const string& src_worker,
+                        std::shared_ptr<StripedRecv> recv);
+
+  // Sets "*dst" to the range of recv->val that stripe "index" of "recv" is
+  // read into, allocating recv->val for the first stripe.  Returns false,
+  // and records the error in "recv", if "stripe" does not describe the
+  // range of elements that stripe "index" must hold.
+  bool PrepareStripe(StripedRecv* recv, int index, const TensorStripe& stripe,
+                     DataType dtype, int64 num_elements, char** dst);
+
+  // Checks the stripe returned by "call" for "recv", and completes "recv"
+  // once all of its stripes have been returned.
+  void StripeDone(StripedRecv* recv, RpcRecvTensorCall* call);
+
+  // Adds "recv" to the next RecvTensors call to "src_worker".
+  void EnqueueCoalescedRecv(const string& src_worker, CoalescedRecv recv);
+
+  // Issues a RecvTensors call for the pending receives from "src_worker".
+  void StartRecvTensorsCall(const string& src_worker);
+
+  // Completes the receives whose tensors are in the response to "call",
+  // and enqueues the others again.
+  void RecvTensorsCallDone(const string& src_worker,
+                           RpcRecvTensorsCall* call);
+
+  WorkerCacheInterface* cache_;            // Not owned.
+  RecvCoalescingPolicy* policy_;           // Not owned.
+  RecvStripingPolicy* striping_;           // Not owned.
+  const TensorCompression* compression_;  // Not owned.
+  const SharedMemoryReceiver* shm_receiver_;  // Not owned, may be null.
+  const bool push_;
+
+  mutex coalesce_mu_;
+  // Receives waiting for the next RecvTensors call, by source worker.
+  std::unordered_map<string, std::vector<CoalescedRecv>> pending_recvs_
+      GUARDED_BY(coalesce_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
 
@@ -59,9 +186,15 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
  public:
   RpcRecvTensorCall() : wi_(nullptr), dst_device_(nullptr) {}
 
+  // If "compression" is not null, the remote worker may compress the
+  // tensor as specified.  If "shm_receiver" is not null, the remote worker
+  // may return the tensor through shared memory.
   void Init(WorkerInterface* wi, int64 step_id, StringPiece key,
             AllocatorAttributes alloc_attrs, Device* dst_device,
-            const Rendezvous::Args& recv_args, Rendezvous::DoneCallback done) {
+            const Rendezvous::Args& recv_args,
+            const TensorCompression* compression,
+            const SharedMemoryReceiver* shm_receiver,
+            Rendezvous::DoneCallback done) {
     wi_ = wi;
     alloc_attrs_ = alloc_attrs;
     dst_device_ = dst_device;
@@ -69,6 +202,23 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     done_ = std::move(done);
     req_.set_step_id(step_id);
     req_.set_rendezvous_key(key.data(), key.size());
+    if (compression != nullptr) {
+      *req_.mutable_compression() = *compression;
+      // The remote worker does not need to know how edges were selected.
+      req_.mutable_compression()->clear_edge_name_filter();
+    }
+    if (shm_receiver != nullptr) {
+      shm_receiver->AddToRequest(&req_);
+    }
+  }
+
+  // Asks for stripe "index" of "num_stripes" of the tensor, whose content
+  // is read into the buffer returned by "stripe_buffer".
+  void SetStripe(int num_stripes, int index,
+                 TensorResponse::StripeBufferFn stripe_buffer) {
+    req_.set_num_stripes(num_stripes);
+    req_.set_stripe_index(index);
+    stripe_buffer_ = std::move(stripe_buffer);
   }
 
   void Reset(WorkerCacheInterface* wc) {
@@ -80,6 +230,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     // opts_ appropriately.
     req_.Clear();
     resp_.Clear();
+    stripe_buffer_ = nullptr;
     {
       mutex_lock l(mu_);
       status_ = Status::OK();
@@ -117,6 +268,8 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
   bool is_dead() const { return resp_.metadata().is_dead(); }
 
+  const RecvTensorResponse& metadata() const { return resp_.metadata(); }
+
   Device* dst_device() const { return dst_device_; }
   const Rendezvous::Args& recv_args() const { return recv_args_; }
   const Rendezvous::DoneCallback& done() const { return done_; }
@@ -127,6 +280,9 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
   // Start the main RecvTensor call, checking for an async abort.
   void StartRTCall(std::function<void()> recv_done) {
     resp_.InitAlloc(dst_device_, alloc_attrs_);
+    if (stripe_buffer_ != nullptr) {
+      resp_.set_stripe_buffer(stripe_buffer_);
+    }
     using namespace std::placeholders;
     StatusCallback cb = std::bind(
         [this](std::function<void()> recv_done,
@@ -150,6 +306,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
   CallOptions opts_;
   RecvTensorRequest req_;
   TensorResponse resp_;
+  TensorResponse::StripeBufferFn stripe_buffer_;
   Rendezvous::Args recv_args_;
   Rendezvous::DoneCallback done_;
 
@@ -159,6 +316,66 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRecvTensorCall);
 };
 
+// Used to retrieve several tensors from one remote process.
+class RpcRecvTensorsCall : public BaseRecvTensorCall {
+ public:
+  RpcRecvTensorsCall(WorkerInterface* wi, int64 step_id,
+                     std::vector<CoalescedRecv> recvs)
+      : wi_(wi), recvs_(std::move(recvs)) {
+    req_.set_step_id(step_id);
+    for (CoalescedRecv& recv : recvs_) {
+      const StringPiece key = recv.parsed.FullKey();
+      req_.add_rendezvous_key(key.data(), key.size());
+      recv.requested = true;
+    }
+  }
+
+  void Start(std::function<void()> recv_done) override {
+    using namespace std::placeholders;
+    StatusCallback cb = std::bind(
+        [this](std::function<void()> recv_done,
+               // Begin unbound arguments.
+               const Status& s) {
+          if (!s.ok()) {
+            mutex_lock l(mu_);
+            status_.Update(s);
+          }
+          recv_done();
+        },
+        std::move(recv_done), _1);
+    wi_->RecvTensorsAsync(&opts_, &req_, &resp_, std::move(cb));
+  }
+
+  void StartAbort(const Status& s) override {
+    {
+      mutex_lock l(mu_);
+      status_.Update(s);
+    }
+    opts_.StartCancel();
+  }
+
+  Status status() const override {
+    mutex_lock l(mu_);
+    return status_;
+  }
+
+  WorkerInterface* wi() const { return wi_; }
+  std::vector<CoalescedRecv>* recvs() { return &recvs_; }
+  const RecvTensorsResponse& response() const { return resp_; }
+
+ private:
+  WorkerInterface* wi_;
+  std::vector<CoalescedRecv> recvs_;
+  CallOptions opts_;
+  RecvTensorsRequest req_;
+  RecvTensorsResponse resp_;
+
+  mutable mutex mu_;
+  Status status_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RpcRecvTensorsCall);
+};
+
 class RpcRecvTensorFreeList {
  public:
   RpcRecvTensorFreeList() {}
@@ -270,6 +487,57 @@ class WorkerFreeListCache : public WorkerCacheInterface {
   std::unordered_map<string, WorkerState> workers_ GUARDED_BY(mu_);
 };
 
+void RpcRemoteRendezvous::PushToRemote(const Rendezvous::ParsedKey& parsed,
+                                       const Rendezvous::Args& args,
+                                       const Tensor& val, bool is_dead) {
+  // key.dst_device identifies a remote device.
+  string dst_worker;
+  string dst_rel_device;
+  WorkerInterface* rwi = nullptr;
+  if (env_->worker_cache != nullptr &&
+      DeviceNameUtils::SplitDeviceName(parsed.dst_device, &dst_worker,
+                                       &dst_rel_device)) {
+    rwi = cache_->CreateWorker(dst_worker);
+  }
+  if (rwi == nullptr) {
+    // The receiver waits for the push, so the step must fail here.
+    StartAbort(errors::Internal("No worker known as ", dst_worker));
+    return;
+  }
+
+  struct PushCall {
+    PushTensorRequest request;
+    PushTensorResponse response;
+  };
+  PushCall* call = new PushCall;
+  call->request.set_step_id(step_id_);
+  call->request.set_rendezvous_key(parsed.FullKey().data(),
+                                   parsed.FullKey().size());
+  if (!is_dead) {
+    val.AsProtoTensorContent(call->request.mutable_tensor());
+  }
+  call->request.set_is_dead(is_dead);
+
+  Ref();
+  rwi->PushTensorAsync(
+      &call->request, &call->response,
+      [this, call, rwi, dst_worker, parsed, args, val,
+       is_dead](const Status& s) {
+        cache_->ReleaseWorker(dst_worker, rwi);
+        if (!s.ok()) {
+          // The receiver may be waiting for the tensor and never pull it,
+          // so the error must reach the step.
+          StartAbort(s);
+        } else if (!call->response.accepted()) {
+          // The receiver pulls the tensors it could not take.
+          VLOG(1) << "Push of " << parsed.FullKey() << " not accepted";
+          SendLocal(parsed, args, val, is_dead).IgnoreError();
+        }
+        delete call;
+        Unref();
+      });
+}
+
 void RpcRemoteRendezvous::RecvFromRemoteAsync(
     const Rendezvous::ParsedKey& parsed, const Rendezvous::Args& recv_args,
     DoneCallback done) {
@@ -284,32 +552,72 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
     return;
   }
 
-  // Prepare a RecvTensor call that can handle being aborted.
-  RpcRecvTensorCall* call = get_call_freelist()->New();
-
   // key.src_device identifies a remote device.
-  if (!DeviceNameUtils::SplitDeviceName(parsed.src_device, &call->src_worker_,
-                                        &call->src_rel_device_)) {
+  string src_worker;
+  string src_rel_device;
+  if (!DeviceNameUtils::SplitDeviceName(parsed.src_device, &src_worker,
+                                        &src_rel_device)) {
     s = errors::Internal(parsed.src_device,
                          " is invalid remote source device.");
   }
-  WorkerInterface* rwi = cache_->CreateWorker(call->src_worker_);
-  if (s.ok() && rwi == nullptr) {
-    s = errors::Internal("No worker known as ", call->src_worker_);
-  }
 
   Device* dst_device;
   if (s.ok()) {
     s = env_->device_mgr->LookupDevice(parsed.dst_device, &dst_device);
   }
   if (!s.ok()) {
-    get_call_freelist()->Release(call, cache_);
     done(s, Args(), recv_args, Tensor{}, false);
     return;
   }
 
+  int num_stripes = 1;
+  if (ShouldCompressEdge(*compression_, parsed.edge_name)) {
+    // Compressed tensors are neither coalesced nor striped.
+  } else if (policy_->ShouldCoalesce(src_worker, parsed)) {
+    CoalescedRecv recv;
+    recv.parsed = parsed;
+    recv.dst_device = dst_device;
+    recv.recv_args = recv_args;
+    recv.done = std::move(done);
+    EnqueueCoalescedRecv(src_worker, std::move(recv));
+    return;
+  } else {
+    num_stripes = striping_->NumStripes(parsed);
+  }
+  if (num_stripes > 1) {
+    std::shared_ptr<StripedRecv> recv(new StripedRecv);
+    recv->parsed = parsed;
+    recv->dst_device = dst_device;
+    recv->recv_args = recv_args;
+    recv->done = std::move(done);
+    recv->num_stripes = num_stripes;
+    recv->num_remaining = num_stripes;
+    recv->read.resize(num_stripes, false);
+    StartStripedRecv(src_worker, std::move(recv));
+  } else {
+    StartRecvTensorCall(src_worker, parsed, dst_device, recv_args,
+                        std::move(done));
+  }
+}
+
+void RpcRemoteRendezvous::StartRecvTensorCall(
+    const string& src_worker, const Rendezvous::ParsedKey& parsed,
+    Device* dst_device, const Rendezvous::Args& recv_args, DoneCallback done) {
+  WorkerInterface* rwi = cache_->CreateWorker(src_worker);
+  if (rwi == nullptr) {
+    done(errors::Internal("No worker known as ", src_worker), Args(),
+         recv_args, Tensor{}, false);
+    return;
+  }
+
+  // Prepare a RecvTensor call that can handle being aborted.
+  RpcRecvTensorCall* call = get_call_freelist()->New();
+  call->src_worker_ = src_worker;
   call->Init(rwi, step_id_, parsed.FullKey(), recv_args.alloc_attrs, dst_device,
-             recv_args, std::move(done));
+             recv_args,
+             ShouldCompressEdge(*compression_, parsed.edge_name) ? compression_
+                                                                 : nullptr,
+             shm_receiver_, std::move(done));
 
   // Record "call" in active_ so that it can be aborted cleanly.
   RegisterCall(call);
@@ -322,6 +630,10 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
     // If StartAbort was called prior to DeregisterCall, then the
     // current status should be bad.
     Status s = call->status();
+    if (s.ok() && !call->is_dead()) {
+      striping_->RecordSize(call->req_.rendezvous_key(),
+                            call->tensor().TotalBytes());
+    }
     call->done()(s, Args(), call->recv_args(), call->tensor(), call->is_dead());
     cache_->ReleaseWorker(call->src_worker_, call->wi_);
     call->wi_ = nullptr;
@@ -330,15 +642,357 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
   });
 }
 
+void RpcRemoteRendezvous::StartStripedRecv(
+    const string& src_worker, std::shared_ptr<StripedRecv> recv) {
+  WorkerInterface* rwi = cache_->CreateWorker(src_worker);
+  if (rwi == nullptr) {
+    recv->done(errors::Internal("No worker known as ", src_worker), Args(),
+               recv->recv_args, Tensor{}, false);
+    return;
+  }
+  // The remote worker returns each stripe over the channel of its index,
+  // so the stripes are transferred in parallel.
+  for (int i = 0; i < recv->num_stripes; ++i) {
+    if (i > 0) {
+      rwi = cache_->CreateWorker(src_worker);
+    }
+    RpcRecvTensorCall* call = get_call_freelist()->New();
+    call->src_worker_ = src_worker;
+    call->Init(rwi, step_id_, recv->parsed.FullKey(),
+               recv->recv_args.alloc_attrs, recv->dst_device,
+               recv->recv_args, nullptr, shm_receiver_, nullptr);
+    call->SetStripe(recv->num_stripes, i,
+                    [this, recv, i](const TensorStripe& stripe, DataType dtype,
+                                    int64 num_elements, char** dst) {
+                      return PrepareStripe(recv.get(), i, stripe, dtype,
+                                           num_elements, dst);
+                    });
+    RegisterCall(call);
+    Ref();
+    call->Start([this, call, recv]() {
+      DeregisterCall(call);
+      StripeDone(recv.get(), call);
+      cache_->ReleaseWorker(call->src_worker_, call->wi_);
+      call->wi_ = nullptr;
+      get_call_freelist()->Release(call, cache_);
+      Unref();
+    });
+  }
+}
+
+bool RpcRemoteRendezvous::PrepareStripe(StripedRecv* recv, int index,
+                                        const TensorStripe& stripe,
+                                        DataType dtype, int64 num_elements,
+                                        char** dst) {
+  mutex_lock l(recv->mu);
+  Status s;
+  if (!DataTypeCanUseMemcpy(dtype) || !TensorShape::IsValid(stripe.shape())) {
+    s = errors::Internal("Invalid stripe ", index, " of ",
+                         recv->parsed.FullKey());
+  } else if (!recv->val.IsInitialized() && !recv->whole) {
+    recv->val =
+        Tensor(recv->dst_device->GetAllocator(recv->recv_args.alloc_attrs),
+               dtype, TensorShape(stripe.shape()));
+  }
+  if (s.ok() &&
+      (recv->whole || dtype != recv->val.dtype() ||
+       !recv->val.shape().IsSameSize(TensorShape(stripe.shape())))) {
+    s = errors::Internal("Stripe ", index, " of ", recv->parsed.FullKey(),
+                         " does not match the other stripes");
+  }
+  if (s.ok()) {
+    // A peer that ignores num_stripes, or splits the tensor differently,
+    // must not write outside of the range of this stripe.
+    int64 begin;
+    int64 end;
+    GetStripeRange(recv->val.NumElements(), recv->num_stripes, index, &begin,
+                   &end);
+    if (stripe.offset() != begin || num_elements != end - begin) {
+      s = errors::Internal("Stripe ", index, " of ", recv->num_stripes,
+                           " of ", recv->parsed.FullKey(), " holds elements [",
+                           stripe.offset(), ", ",
+                           stripe.offset() + num_elements, "), expected [",
+                           begin, ", ", end, ")");
+    } else {
+      // Stripes do not overlap, so they are read concurrently outside of
+      // the lock.  recv->val is not reassigned once allocated, and outlives
+      // the calls for the stripes.
+      *dst = static_cast<char*>(DMAHelper::base(&recv->val)) +
+             begin * DataTypeSize(dtype);
+      recv->read[index] = true;
+    }
+  }
+  recv->status.Update(s);
+  return s.ok();
+}
+
+void RpcRemoteRendezvous::StripeDone(StripedRecv* recv,
+                                     RpcRecvTensorCall* call) {
+  const RecvTensorResponse& meta = call->metadata();
+  const int index = call->req_.stripe_index();
+  Status s = call->status();
+  {
+    mutex_lock l(recv->mu);
+    if (s.ok() && meta.has_stripe()) {
+      // The content of the stripe was read into recv->val while parsing.
+      if (!recv->read[index]) {
+        s = errors::Internal("Stripe ", index, " of ", recv->parsed.FullKey(),
+                             " was not read");
+      }
+    } else if (s.ok() && index == 0) {
+      // The remote worker returned the whole tensor with stripe 0.
+      if (recv->val.IsInitialized()) {
+        s = errors::Internal("Stripe 0 of ", recv->parsed.FullKey(),
+                             " returned the whole tensor after other stripes");
+      } else {
+        recv->whole = true;
+        recv->val = call->tensor();
+        recv->is_dead = meta.is_dead();
+      }
+    } else if (s.ok() &&
+               (call->tensor().NumElements() > 0 || meta.is_dead())) {
+      // The other stripes of a tensor that is not split are empty, so a
+      // non-empty one comes from a peer that ignores num_stripes.
+      s = errors::Internal("Stripe ", index, " of ", recv->num_stripes, " of ",
+                           recv->parsed.FullKey(),
+                           " returned the whole tensor");
+    }
+    recv->status.Update(s);
+    if (--recv->num_remaining > 0) {
+      return;
+    }
+    if (recv->status.ok() && !recv->whole) {
+      for (int i = 0; i < recv->num_stripes; ++i) {
+        if (!recv->read[i]) {
+          recv->status = errors::Internal("Missing stripe ", i, " of ",
+                                          recv->parsed.FullKey());
+          break;
+        }
+      }
+    }
+  }
+  // All the stripes have been returned, so nothing else accesses "recv".
+  if (recv->status.ok() && !recv->is_dead) {
+    striping_->RecordSize(recv->parsed.FullKey(), recv->val.TotalBytes());
+  }
+  recv->done(recv->status, Args(), recv->recv_args,
+             recv->status.ok() ? recv->val : Tensor(), recv->is_dead);
+}
+
+void RpcRemoteRendezvous::EnqueueCoalescedRecv(const string& src_worker,
+                                               CoalescedRecv recv) {
+  bool start_call;
+  {
+    mutex_lock l(coalesce_mu_);
+    std::vector<CoalescedRecv>* pending = &pending_recvs_[src_worker];
+    start_call = pending->empty();
+    pending->push_back(std::move(recv));
+  }
+  if (start_call) {
+    // Issuing the call from the compute pool lets the receives that the
+    // executor starts right after this one join the call.
+    Ref();
+    env_->compute_pool->Schedule([this, src_worker]() {
+      StartRecvTensorsCall(src_worker);
+      Unref();
+    });
+  }
+}
+
+void RpcRemoteRendezvous::StartRecvTensorsCall(const string& src_worker) {
+  std::vector<CoalescedRecv> recvs;
+  {
+    mutex_lock l(coalesce_mu_);
+    auto it = pending_recvs_.find(src_worker);
+    recvs.swap(it->second);
+    pending_recvs_.erase(it);
+  }
+
+  if (recvs.size() == 1 && !recvs[0].requested) {
+    // There is nothing to coalesce with, and RecvTensor saves a copy of the
+    // tensor.
+    CoalescedRecv& recv = recvs[0];
+    StartRecvTensorCall(src_worker, recv.parsed, recv.dst_device,
+                        recv.recv_args, std::move(recv.done));
+    return;
+  }
+
+  WorkerInterface* rwi = cache_->CreateWorker(src_worker);
+  if (rwi == nullptr) {
+    Status s = errors::Internal("No worker known as ", src_worker);
+    for (CoalescedRecv& recv : recvs) {
+      recv.done(s, Args(), recv.recv_args, Tensor{}, false);
+    }
+    return;
+  }
+
+  RpcRecvTensorsCall* call =
+      new RpcRecvTensorsCall(rwi, step_id_, std::move(recvs));
+  RegisterCall(call);
+  Ref();
+  call->Start([this, src_worker, call]() {
+    DeregisterCall(call);
+    RecvTensorsCallDone(src_worker, call);
+    cache_->ReleaseWorker(src_worker, call->wi());
+    delete call;
+    Unref();
+  });
+}
+
+void RpcRemoteRendezvous::RecvTensorsCallDone(const string& src_worker,
+                                              RpcRecvTensorsCall* call) {
+  std::vector<CoalescedRecv>* recvs = call->recvs();
+  Status s = call->status();
+  if (errors::IsUnimplemented(s)) {
+    // The remote worker does not support RecvTensors, so it holds no
+    // tensors for us either.
+    policy_->DisableWorker(src_worker);
+    for (CoalescedRecv& recv : *recvs) {
+      StartRecvTensorCall(src_worker, recv.parsed, recv.dst_device,
+                          recv.recv_args, std::move(recv.done));
+    }
+    return;
+  }
+
+  const RecvTensorsResponse& response = call->response();
+  std::vector<bool> received(recvs->size(), false);
+  if (s.ok() && response.item_size() == 0) {
+    s = errors::Internal("Empty RecvTensors response from ", src_worker);
+  }
+  for (int i = 0; s.ok() && i < response.item_size(); ++i) {
+    const int key_index = response.item(i).key_index();
+    if (key_index < 0 || static_cast<size_t>(key_index) >= recvs->size() ||
+        received[key_index]) {
+      s = errors::Internal("Invalid key index ", key_index,
+                           " in RecvTensors response from ", src_worker);
+    } else {
+      received[key_index] = true;
+    }
+  }
+  if (!s.ok()) {
+    for (CoalescedRecv& recv : *recvs) {
+      recv.done(s, Args(), recv.recv_args, Tensor{}, false);
+    }
+    return;
+  }
+
+  for (const auto& item : response.item()) {
+    CoalescedRecv& recv = (*recvs)[item.key_index()];
+    const RecvTensorResponse& tensor_response = item.response();
+    Status recv_status;
+    Tensor val;
+    if (!tensor_response.is_dead()) {
+      recv_status = recv.dst_device->MakeTensorFromProto(
+          tensor_response.tensor(), recv.recv_args.alloc_attrs, &val);
+      policy_->RecordSize(recv.parsed, val.TotalBytes());
+      striping_->RecordSize(recv.parsed.FullKey(), val.TotalBytes());
+    }
+    recv.done(recv_status, Args(), recv.recv_args, val,
+              tensor_response.is_dead());
+  }
+  for (size_t i = 0; i < recvs->size(); ++i) {
+    if (!received[i]) {
+      EnqueueCoalescedRecv(src_worker, std::move((*recvs)[i]));
+    }
+  }
+}
+
 }  // namespace
 
+RecvCoalescingPolicy::RecvCoalescingPolicy(int64 max_bytes)
+    : max_bytes_(max_bytes == 0 ? kDefaultRecvCoalescingMaxBytes
+                                : max_bytes) {}
+
+bool RecvCoalescingPolicy::ShouldCoalesce(const string& src_worker,
+                                          const Rendezvous::ParsedKey& parsed) {
+  // RecvTensors only returns tensors in host memory, and the received
+  // tensors are decoded on the host.
+  if (max_bytes_ < 0 || parsed.src.type != DEVICE_CPU ||
+      parsed.dst.type != DEVICE_CPU) {
+    return false;
+  }
+  mutex_lock l(mu_);
+  return unsupported_workers_.count(src_worker) == 0 &&
+         large_edges_.count(EdgeKey(parsed.FullKey())) == 0;
+}
+
+void RecvCoalescingPolicy::RecordSize(const Rendezvous::ParsedKey& parsed,
+                                      int64 bytes) {
+  if (bytes > max_bytes_) {
+    mutex_lock l(mu_);
+    large_edges_.insert(EdgeKey(parsed.FullKey()));
+  }
+}
+
+void RecvCoalescingPolicy::DisableWorker(const string& src_worker) {
+  mutex_lock l(mu_);
+  unsupported_workers_.insert(src_worker);
+}
+
+RecvStripingPolicy::RecvStripingPolicy(int num_stripes, int64 min_bytes)
+    : num_stripes_(num_stripes),
+      min_bytes_(min_bytes > 0 ? min_bytes : kDefaultStripeMinBytes) {}
+
+int RecvStripingPolicy::NumStripes(const Rendezvous::ParsedKey& parsed) {
+  // Stripes are only returned from host memory, and copied on the host.
+  if (num_stripes_ <= 1 || parsed.src.type != DEVICE_CPU ||
+      parsed.dst.type != DEVICE_CPU) {
+    return 1;
+  }
+  mutex_lock l(mu_);
+  return large_edges_.count(EdgeKey(parsed.FullKey())) > 0 ? num_stripes_ : 1;
+}
+
+void RecvStripingPolicy::RecordSize(StringPiece key, int64 bytes) {
+  if (num_stripes_ <= 1) {
+    return;
+  }
+  const string edge = EdgeKey(key);
+  mutex_lock l(mu_);
+  if (bytes >= min_bytes_) {
+    large_edges_.insert(edge);
+  } else {
+    large_edges_.erase(edge);
+  }
+}
+
 RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
+    : RpcRendezvousMgr(env, RPCOptions()) {}
+
+RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env,
+                                   const RPCOptions& rpc_options)
     : BaseRendezvousMgr(env),
-      cache_(new WorkerFreeListCache(env->worker_cache)) {}
+      cache_(new WorkerFreeListCache(env->worker_cache)),
+      policy_(rpc_options.recv_coalescing_max_bytes()),
+      striping_(rpc_options.num_channels_per_target(),
+                rpc_options.stripe_min_bytes()),
+      compression_(rpc_options.tensor_compression()) {
+  if (rpc_options.push_remote_tensors()) {
+    push_limit_.reset(new PushBufferLimit(
+        rpc_options.push_buffer_max_bytes() > 0
+            ? rpc_options.push_buffer_max_bytes()
+            : kDefaultPushBufferMaxBytes));
+  }
+  if (rpc_options.use_shared_memory_for_local_peers()) {
+    const int64 min_bytes = rpc_options.shared_memory_min_bytes() > 0
+                                ? rpc_options.shared_memory_min_bytes()
+                                : kDefaultSharedMemoryMinBytes;
+    shm_receiver_ =
+        SharedMemoryReceiver::Create(env->env, kSharedMemoryDir, min_bytes);
+  }
+}
+
+RpcRendezvousMgr::~RpcRendezvousMgr() {
+  // Aborting a rendezvous releases its buffered pushed tensors into
+  // push_limit_, which must still exist.
+  CleanupAll();
+}
 
 BaseRemoteRendezvous* RpcRendezvousMgr::Create(int64 step_id,
                                                const WorkerEnv* worker_env) {
-  return new RpcRemoteRendezvous(worker_env, cache_.get(), step_id);
+  return new RpcRemoteRendezvous(worker_env, cache_.get(), &policy_,
+                                 &striping_, &compression_, shm_receiver_.get(),
+                                 push_limit_.get(), step_id);
 }
 
 }  // end namespace tensorflow
@@ -16,13 +16,84 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_RPC_RENDEZVOUS_MGR_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_RPC_RENDEZVOUS_MGR_H_
 
+#include <memory>
+#include <unordered_set>
+
 #include "tensorflow/core/distributed_runtime/base_rendezvous_mgr.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
+#include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 
 namespace tensorflow {
 
+// Decides which receives of a worker are coalesced into RecvTensors calls.
+// It is shared by the rendezvous of all steps, so that what is learnt about
+// the tensors of one step applies to the next.
+class RecvCoalescingPolicy {
+ public:
+  // Coalesces the receives of tensors of at most "max_bytes"; see
+  // RPCOptions.recv_coalescing_max_bytes.
+  explicit RecvCoalescingPolicy(int64 max_bytes);
+
+  // Returns true if the tensor for "parsed", which is produced by
+  // "src_worker", may be received in a RecvTensors call.
+  bool ShouldCoalesce(const string& src_worker,
+                      const Rendezvous::ParsedKey& parsed);
+
+  // Records the size of a tensor received in a RecvTensors call. If it is
+  // too large, the tensors of the same edge are received with RecvTensor
+  // from then on.
+  void RecordSize(const Rendezvous::ParsedKey& parsed, int64 bytes);
+
+  // Stops coalescing the receives from "src_worker", which does not
+  // implement RecvTensors.
+  void DisableWorker(const string& src_worker);
+
+ private:
+  const int64 max_bytes_;
+
+  mutex mu_;
+  std::unordered_set<string> large_edges_ GUARDED_BY(mu_);
+  std::unordered_set<string> unsupported_workers_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecvCoalescingPolicy);
+};
+
+// Decides which receives are split into stripes, requested by concurrent
+// RecvTensor calls over the different channels to the remote worker. Like
+// RecvCoalescingPolicy, it is shared by the rendezvous of all steps: an
+// edge is striped once it has carried a large tensor.
+class RecvStripingPolicy {
+ public:
+  // Receives the tensors of at least "min_bytes" in "num_stripes" stripes;
+  // see RPCOptions.num_channels_per_target.
+  RecvStripingPolicy(int num_stripes, int64 min_bytes);
+
+  // Returns the number of stripes in which to receive the tensor for
+  // "parsed", which is 1 if it is not striped.
+  int NumStripes(const Rendezvous::ParsedKey& parsed);
+
+  // Records the size of a tensor received for the rendezvous key "key",
+  // which decides whether the tensors of the same edge are striped from
+  // then on.
+  void RecordSize(StringPiece key, int64 bytes);
+
+ private:
+  const int num_stripes_;
+  const int64 min_bytes_;
+
+  mutex mu_;
+  std::unordered_set<string> large_edges_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecvStripingPolicy);
+};
+
 // RendezvousMgr keeps track of a set of local rendezvous instances.
 // All tensors sent by this worker are buffered in a RendezvousMgr
 // until the tensor is received.  Each global unique "step_id"
@@ -41,9 +112,23 @@ namespace tensorflow {
 //
 // Tensors sent and recved through rendezvous managed by this
 // RendezvousMgr must have keys generated by Rendezvous::CreateKey.
+//
+// Receives of small tensors from the same remote worker in a step are
+// coalesced into RecvTensors calls, as configured by
+// RPCOptions.recv_coalescing_max_bytes.  Receives of the edges selected by
+// RPCOptions.tensor_compression ask for the tensor to be compressed, and
+// are never coalesced.  If RPCOptions.use_shared_memory_for_local_peers is
+// set, the large tensors received from workers on the same host are passed
+// through shared memory.  If RPCOptions.push_remote_tensors is set, the
+// tensors sent between the CPU devices of two workers are pushed by the
+// sending worker rather than pulled by the receiving one.  If
+// RPCOptions.num_channels_per_target is more than 1, the large tensors
+// received from the CPU devices of other workers are received in stripes.
 class RpcRendezvousMgr : public BaseRendezvousMgr {
  public:
   explicit RpcRendezvousMgr(const WorkerEnv* env);
+  RpcRendezvousMgr(const WorkerEnv* env, const RPCOptions& rpc_options);
+  ~RpcRendezvousMgr() override;
 
  protected:
   BaseRemoteRendezvous* Create(int64 step_id,
@@ -53,6 +138,14 @@ class RpcRendezvousMgr : public BaseRendezvousMgr {
   // Private cache_ that allows us to reuse WorkerInterface objects.
   std::unique_ptr<WorkerCacheInterface> cache_;
 
+  RecvCoalescingPolicy policy_;
+  RecvStripingPolicy striping_;
+  const TensorCompression compression_;
+  // Null unless tensors are received through shared memory.
+  std::unique_ptr<SharedMemoryReceiver> shm_receiver_;
+  // Null unless tensors are pushed.
+  std::unique_ptr<PushBufferLimit> push_limit_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRendezvousMgr);
 };
 
@@ -15,11 +15,20 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <algorithm>
+
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/framework/control_flow.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
@@ -197,6 +206,523 @@ TEST(RpcRendezvousMgrTest, TransferDummyDeviceContext) {
   dc->Unref();
 }
 
+namespace {
+// A remote worker that serves fixed tensors, and returns at most
+// "max_items_per_response" tensors per RecvTensors call.
+class FakeRemoteWorker : public WorkerInterface {
+ public:
+  FakeRemoteWorker(int max_items_per_response, bool supports_recv_tensors)
+      : max_items_per_response_(max_items_per_response),
+        supports_recv_tensors_(supports_recv_tensors) {}
+  ~FakeRemoteWorker() override {}
+
+  void AddTensor(const string& key, const Tensor& val) { values_[key] = val; }
+
+  int num_recv_tensor_calls() {
+    mutex_lock l(mu_);
+    return num_recv_tensor_calls_;
+  }
+
+  // The number of RecvTensor calls that asked for a stripe.
+  int num_stripe_calls() {
+    mutex_lock l(mu_);
+    return num_stripe_calls_;
+  }
+
+  // The number of keys in each RecvTensors call.
+  std::vector<int> recv_tensors_sizes() {
+    mutex_lock l(mu_);
+    return recv_tensors_sizes_;
+  }
+
+  void set_accept_pushes(bool accept) { accept_pushes_ = accept; }
+
+  // Makes the PushTensor calls fail with "s".
+  void set_push_status(const Status& s) { push_status_ = s; }
+
+  // The keys of the tensors pushed to this worker.
+  std::vector<string> pushed_keys() {
+    mutex_lock l(mu_);
+    return pushed_keys_;
+  }
+
+  void GetStatusAsync(const GetStatusRequest* request,
+                      GetStatusResponse* response,
+                      StatusCallback done) override {
+    done(errors::Unimplemented("GetStatusAsync"));
+  }
+  void RegisterGraphAsync(const RegisterGraphRequest* request,
+                          RegisterGraphResponse* response,
+                          StatusCallback done) override {
+    done(errors::Unimplemented("RegisterGraphAsync"));
+  }
+  void DeregisterGraphAsync(const DeregisterGraphRequest* request,
+                            DeregisterGraphResponse* response,
+                            StatusCallback done) override {
+    done(errors::Unimplemented("DeregisterGraphAsync"));
+  }
+  void RunGraphAsync(CallOptions* opts, RunGraphRequestWrapper* request,
+                     MutableRunGraphResponseWrapper* repsonse,
+                     StatusCallback done) override {
+    done(errors::Unimplemented("RunGraphAsync"));
+  }
+  void CleanupGraphAsync(const CleanupGraphRequest* request,
+                         CleanupGraphResponse* response,
+                         StatusCallback done) override {
+    done(errors::Unimplemented("CleanupGraphAsync"));
+  }
+  void CleanupAllAsync(const CleanupAllRequest* request,
+                       CleanupAllResponse* response,
+                       StatusCallback done) override {
+    done(errors::Unimplemented("CleanupAllAsync"));
+  }
+  void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
+                    StatusCallback done) override {
+    done(errors::Unimplemented("LoggingAsync"));
+  }
+  void TracingAsync(const TracingRequest* request, TracingResponse* response,
+                    StatusCallback done) override {
+    done(errors::Unimplemented("TracingAsync"));
+  }
+
+  void RecvTensorAsync(CallOptions* opts, const RecvTensorRequest* request,
+                       TensorResponse* response, StatusCallback done) override {
+    {
+      mutex_lock l(mu_);
+      ++num_recv_tensor_calls_;
+      if (request->num_stripes() > 1) {
+        ++num_stripe_calls_;
+      }
+    }
+    RecvTensorResponse proto;
+    const Tensor& val = values_.at(request->rendezvous_key());
+    if (request->num_stripes() > 1) {
+      // Returns the stripe_index-th of num_stripes ranges of elements.
+      const int64 n = val.NumElements();
+      const int64 per_stripe =
+          (n + request->num_stripes() - 1) / request->num_stripes();
+      const int64 begin = std::min(n, request->stripe_index() * per_stripe);
+      const int64 end = std::min(n, begin + per_stripe);
+      Tensor flat;
+      CHECK(flat.CopyFrom(val, TensorShape({n})));
+      val.shape().AsProto(proto.mutable_stripe()->mutable_shape());
+      proto.mutable_stripe()->set_offset(begin);
+      flat.Slice(begin, end).AsProtoTensorContent(proto.mutable_tensor());
+    } else {
+      val.AsProtoTensorContent(proto.mutable_tensor());
+    }
+    done(response->InitFrom(&proto));
+  }
+
+  void RecvTensorsAsync(CallOptions* opts, const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    if (!supports_recv_tensors_) {
+      WorkerInterface::RecvTensorsAsync(opts, request, response, done);
+      return;
+    }
+    {
+      mutex_lock l(mu_);
+      recv_tensors_sizes_.push_back(request->rendezvous_key_size());
+    }
+    for (int i = 0; i < request->rendezvous_key_size() &&
+                    response->item_size() < max_items_per_response_;
+         ++i) {
+      RecvTensorsResponse::Item* item = response->add_item();
+      item->set_key_index(i);
+      values_.at(request->rendezvous_key(i))
+          .AsProtoTensorContent(item->mutable_response()->mutable_tensor());
+    }
+    done(Status::OK());
+  }
+
+  void PushTensorAsync(const PushTensorRequest* request,
+                       PushTensorResponse* response,
+                       StatusCallback done) override {
+    {
+      mutex_lock l(mu_);
+      pushed_keys_.push_back(request->rendezvous_key());
+    }
+    response->set_accepted(accept_pushes_);
+    done(push_status_);
+  }
+
+ private:
+  const int max_items_per_response_;
+  const bool supports_recv_tensors_;
+  bool accept_pushes_ = true;
+  Status push_status_;
+  std::unordered_map<string, Tensor> values_;
+
+  mutex mu_;
+  int num_recv_tensor_calls_ GUARDED_BY(mu_) = 0;
+  int num_stripe_calls_ GUARDED_BY(mu_) = 0;
+  std::vector<int> recv_tensors_sizes_ GUARDED_BY(mu_);
+  std::vector<string> pushed_keys_ GUARDED_BY(mu_);
+};
+
+// A cache holding a single remote worker, which it does not own.
+class FakeRemoteWorkerCache : public WorkerCacheInterface {
+ public:
+  FakeRemoteWorkerCache(const string& target, WorkerInterface* worker)
+      : target_(target), worker_(worker) {}
+
+  void ListWorkers(std::vector<string>* workers) const override {
+    workers->push_back(target_);
+  }
+  WorkerInterface* CreateWorker(const string& target) override {
+    return target == target_ ? worker_ : nullptr;
+  }
+  void ReleaseWorker(const string& target, WorkerInterface* worker) override {}
+  bool GetDeviceLocalityNonBlocking(const string& device,
+                                    DeviceLocality* locality) override {
+    return false;
+  }
+  void GetDeviceLocalityAsync(const string& device, DeviceLocality* locality,
+                              StatusCallback done) override {}
+
+ private:
+  const string target_;
+  WorkerInterface* const worker_;
+};
+
+// Receives tensors on "/job:mnist/replica:1/task:2" from a fake
+// "/job:mnist/replica:1/task:3".
+class RemoteRecvTest {
+ public:
+  RemoteRecvTest(int max_items_per_response, bool supports_recv_tensors,
+                 const RPCOptions& rpc_options)
+      : remote_(max_items_per_response, supports_recv_tensors),
+        cache_("/job:mnist/replica:1/task:3", &remote_),
+        // A single thread, so that all the receives started by one closure
+        // on the pool are pending when the RecvTensors call is issued.
+        pool_(Env::Default(), "compute", 1) {
+    std::vector<Device*> devices;
+    TF_CHECK_OK(DeviceFactory::AddDevices(
+        SessionOptions(), "/job:mnist/replica:1/task:2", &devices));
+    device_mgr_.reset(new DeviceMgr(devices));
+    env_.env = Env::Default();
+    env_.worker_name = "/job:mnist/replica:1/task:2";
+    env_.worker_cache = &cache_;
+    env_.device_mgr = device_mgr_.get();
+    env_.compute_pool = &pool_;
+    rmgr_.reset(new RpcRendezvousMgr(&env_, rpc_options));
+  }
+
+  static string Key(const string& name) {
+    return Rendezvous::CreateKey("/job:mnist/replica:1/task:3/cpu:0", 7890,
+                                 "/job:mnist/replica:1/task:2/cpu:0", name,
+                                 FrameAndIter(0, 0));
+  }
+
+  // The key of "name" sent by the local worker to the remote one.
+  static string SendKey(const string& name) {
+    return Rendezvous::CreateKey("/job:mnist/replica:1/task:2/cpu:0", 7890,
+                                 "/job:mnist/replica:1/task:3/cpu:0", name,
+                                 FrameAndIter(0, 0));
+  }
+
+  FakeRemoteWorker* remote() { return &remote_; }
+  RpcRendezvousMgr* rmgr() { return rmgr_.get(); }
+
+  // Receives the tensors "names" in step "step_id".
+  std::vector<Tensor> Recv(int64 step_id, const std::vector<string>& names) {
+    Rendezvous* rendez = rmgr_->Find(step_id);
+    std::vector<Tensor> vals(names.size());
+    BlockingCounter counter(names.size());
+    pool_.Schedule([rendez, &names, &vals, &counter]() {
+      for (size_t i = 0; i < names.size(); ++i) {
+        rendez->RecvAsync(MakeKey(Key(names[i])), Rendezvous::Args(),
+                          [&vals, &counter, i](
+                              const Status& s, const Rendezvous::Args&,
+                              const Rendezvous::Args&, const Tensor& val,
+                              const bool is_dead) {
+                            TF_EXPECT_OK(s);
+                            vals[i] = val;
+                            counter.DecrementCount();
+                          });
+      }
+    });
+    counter.Wait();
+    rendez->Unref();
+    rmgr_->Cleanup(step_id);
+    return vals;
+  }
+
+ private:
+  FakeRemoteWorker remote_;
+  FakeRemoteWorkerCache cache_;
+  thread::ThreadPool pool_;
+  std::unique_ptr<DeviceMgr> device_mgr_;
+  WorkerEnv env_;
+  std::unique_ptr<RpcRendezvousMgr> rmgr_;
+};
+
+Tensor FloatVector(int size, float value) {
+  Tensor val(DT_FLOAT, TensorShape({size}));
+  val.flat<float>().setConstant(value);
+  return val;
+}
+}  // namespace
+
+TEST(RpcRendezvousMgrTest, CoalescesRemoteRecvs) {
+  RemoteRecvTest test(3 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, RPCOptions());
+  std::vector<string> names;
+  for (int i = 0; i < 10; ++i) {
+    names.push_back(strings::StrCat("t", i));
+    test.remote()->AddTensor(RemoteRecvTest::Key(names.back()),
+                             V(strings::StrCat("value", i)));
+  }
+  std::vector<Tensor> vals = test.Recv(123, names);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(strings::StrCat("value", i), V(vals[i]));
+  }
+  // The tensors missing from a response are requested again, even the last
+  // one, which the remote worker holds on to.
+  EXPECT_EQ(std::vector<int>({10, 7, 4, 1}),
+            test.remote()->recv_tensors_sizes());
+  EXPECT_EQ(0, test.remote()->num_recv_tensor_calls());
+}
+
+TEST(RpcRendezvousMgrTest, LargeTensorsAreReceivedIndividually) {
+  RPCOptions rpc_options;
+  rpc_options.set_recv_coalescing_max_bytes(64);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  test.remote()->AddTensor(RemoteRecvTest::Key("small0"), FloatVector(1, 1));
+  test.remote()->AddTensor(RemoteRecvTest::Key("small1"), FloatVector(2, 2));
+  test.remote()->AddTensor(RemoteRecvTest::Key("large"), FloatVector(100, 3));
+  const std::vector<string> names = {"small0", "small1", "large"};
+
+  // The first step finds out that "large" is too large to coalesce.
+  for (int64 step_id : {1, 2}) {
+    std::vector<Tensor> vals = test.Recv(step_id, names);
+    test::ExpectTensorEqual<float>(FloatVector(1, 1), vals[0]);
+    test::ExpectTensorEqual<float>(FloatVector(2, 2), vals[1]);
+    test::ExpectTensorEqual<float>(FloatVector(100, 3), vals[2]);
+  }
+  EXPECT_EQ(std::vector<int>({3, 2}), test.remote()->recv_tensors_sizes());
+  EXPECT_EQ(1, test.remote()->num_recv_tensor_calls());
+}
+
+TEST(RpcRendezvousMgrTest, FallsBackToRecvTensor) {
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      false /* supports_recv_tensors */, RPCOptions());
+  test.remote()->AddTensor(RemoteRecvTest::Key("a"), V("apple"));
+  test.remote()->AddTensor(RemoteRecvTest::Key("b"), V("banana"));
+  for (int64 step_id : {1, 2}) {
+    std::vector<Tensor> vals = test.Recv(step_id, {"a", "b"});
+    EXPECT_EQ("apple", V(vals[0]));
+    EXPECT_EQ("banana", V(vals[1]));
+  }
+  EXPECT_EQ(4, test.remote()->num_recv_tensor_calls());
+}
+
+TEST(RpcRendezvousMgrTest, CoalescingCanBeDisabled) {
+  RPCOptions rpc_options;
+  rpc_options.set_recv_coalescing_max_bytes(-1);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  test.remote()->AddTensor(RemoteRecvTest::Key("a"), V("apple"));
+  test.remote()->AddTensor(RemoteRecvTest::Key("b"), V("banana"));
+  std::vector<Tensor> vals = test.Recv(1, {"a", "b"});
+  EXPECT_EQ("apple", V(vals[0]));
+  EXPECT_EQ("banana", V(vals[1]));
+  EXPECT_TRUE(test.remote()->recv_tensors_sizes().empty());
+  EXPECT_EQ(2, test.remote()->num_recv_tensor_calls());
+}
+
+TEST(RpcRendezvousMgrTest, StripesLargeTensors) {
+  RPCOptions rpc_options;
+  rpc_options.set_recv_coalescing_max_bytes(-1);
+  rpc_options.set_num_channels_per_target(4);
+  rpc_options.set_stripe_min_bytes(64);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  Tensor large(DT_FLOAT, TensorShape({7, 3}));
+  test::FillIota<float>(&large, 1);
+  test.remote()->AddTensor(RemoteRecvTest::Key("small"), FloatVector(2, 2));
+  test.remote()->AddTensor(RemoteRecvTest::Key("large"), large);
+  test.remote()->AddTensor(RemoteRecvTest::Key("string"), V("apple"));
+
+  // The first step finds out that "large" is large enough to stripe.
+  for (int64 step_id : {1, 2}) {
+    std::vector<Tensor> vals =
+        test.Recv(step_id, {"small", "large", "string"});
+    test::ExpectTensorEqual<float>(FloatVector(2, 2), vals[0]);
+    test::ExpectTensorEqual<float>(large, vals[1]);
+    EXPECT_EQ("apple", V(vals[2]));
+  }
+  EXPECT_EQ(4, test.remote()->num_stripe_calls());
+  EXPECT_EQ(3 + 2 + 4, test.remote()->num_recv_tensor_calls());
+}
+
+TEST(RpcRendezvousMgrTest, ReceivesPushedTensors) {
+  RPCOptions rpc_options;
+  rpc_options.set_push_remote_tensors(true);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  const int64 step_id = 1;
+  Rendezvous* rendez = test.rmgr()->Find(step_id);
+  core::ScopedUnref unref(rendez);
+
+  // Pushed before it is received.
+  bool accepted = false;
+  TF_ASSERT_OK(test.rmgr()->RecvPushedTensor(
+      step_id, MakeKey(RemoteRecvTest::Key("early")), V("apple"), false,
+      &accepted));
+  EXPECT_TRUE(accepted);
+
+  // Pushed after it is received.
+  Notification n;
+  Tensor late;
+  rendez->RecvAsync(MakeKey(RemoteRecvTest::Key("late")), Rendezvous::Args(),
+                    [&n, &late](const Status& s, const Rendezvous::Args&,
+                                const Rendezvous::Args&, const Tensor& val,
+                                const bool is_dead) {
+                      TF_EXPECT_OK(s);
+                      late = val;
+                      n.Notify();
+                    });
+  EXPECT_FALSE(n.HasBeenNotified());
+  TF_ASSERT_OK(test.rmgr()->RecvPushedTensor(
+      step_id, MakeKey(RemoteRecvTest::Key("late")), V("banana"), false,
+      &accepted));
+  EXPECT_TRUE(accepted);
+  n.WaitForNotification();
+  EXPECT_EQ("banana", V(late));
+
+  std::vector<Tensor> vals = test.Recv(step_id, {"early"});
+  EXPECT_EQ("apple", V(vals[0]));
+  // Nothing was requested from the remote worker.
+  EXPECT_TRUE(test.remote()->recv_tensors_sizes().empty());
+  EXPECT_EQ(0, test.remote()->num_recv_tensor_calls());
+}
+
+TEST(RpcRendezvousMgrTest, PullsRejectedPushedTensors) {
+  RPCOptions rpc_options;
+  rpc_options.set_push_remote_tensors(true);
+  rpc_options.set_push_buffer_max_bytes(100);
+  rpc_options.set_recv_coalescing_max_bytes(-1);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  test.remote()->AddTensor(RemoteRecvTest::Key("large"), FloatVector(10, 2));
+
+  for (int64 step_id : {1, 2}) {
+    core::ScopedUnref unref(test.rmgr()->Find(step_id));
+    // The first tensor fits in the buffer, the second one does not.
+    bool accepted = false;
+    TF_ASSERT_OK(test.rmgr()->RecvPushedTensor(
+        step_id, MakeKey(RemoteRecvTest::Key("small")), FloatVector(20, 1),
+        false, &accepted));
+    EXPECT_TRUE(accepted);
+    TF_ASSERT_OK(test.rmgr()->RecvPushedTensor(
+        step_id, MakeKey(RemoteRecvTest::Key("large")), FloatVector(10, 2),
+        false, &accepted));
+    EXPECT_FALSE(accepted);
+
+    std::vector<Tensor> vals = test.Recv(step_id, {"small", "large"});
+    test::ExpectTensorEqual<float>(FloatVector(20, 1), vals[0]);
+    test::ExpectTensorEqual<float>(FloatVector(10, 2), vals[1]);
+  }
+  // The buffer space of the first step was released.
+  EXPECT_EQ(2, test.remote()->num_recv_tensor_calls());
+}
+
+TEST(RpcRendezvousMgrTest, PushedTensorsNeedPushMode) {
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, RPCOptions());
+  core::ScopedUnref unref(test.rmgr()->Find(1));
+  bool accepted = true;
+  TF_ASSERT_OK(test.rmgr()->RecvPushedTensor(
+      1, MakeKey(RemoteRecvTest::Key("a")), V("apple"), false, &accepted));
+  EXPECT_FALSE(accepted);
+  test.rmgr()->Cleanup(1);
+}
+
+TEST(RpcRendezvousMgrTest, PushesSentTensors) {
+  RPCOptions rpc_options;
+  rpc_options.set_push_remote_tensors(true);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  const int64 step_id = 1;
+  Rendezvous* rendez = test.rmgr()->Find(step_id);
+  core::ScopedUnref unref(rendez);
+
+  TF_ASSERT_OK(rendez->Send(MakeKey(RemoteRecvTest::SendKey("a")),
+                            Rendezvous::Args(), V("apple"), false));
+  // A rejected tensor is kept for the remote worker to pull it.
+  test.remote()->set_accept_pushes(false);
+  TF_ASSERT_OK(rendez->Send(MakeKey(RemoteRecvTest::SendKey("b")),
+                            Rendezvous::Args(), V("banana"), false));
+  EXPECT_EQ(std::vector<string>(
+                {RemoteRecvTest::SendKey("a"), RemoteRecvTest::SendKey("b")}),
+            test.remote()->pushed_keys());
+  Tensor val;
+  bool is_dead = false;
+  TF_ASSERT_OK(test.rmgr()->RecvLocal(
+      step_id, MakeKey(RemoteRecvTest::SendKey("b")), &val, &is_dead));
+  EXPECT_EQ("banana", V(val));
+  test.rmgr()->Cleanup(step_id);
+}
+
+TEST(RpcRendezvousMgrTest, PullsTensorsPushedBeforeStepStarts) {
+  RPCOptions rpc_options;
+  rpc_options.set_push_remote_tensors(true);
+  rpc_options.set_recv_coalescing_max_bytes(-1);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  test.remote()->AddTensor(RemoteRecvTest::Key("a"), V("apple"));
+  const int64 step_id = 1;
+
+  // The step has no rendezvous yet, so the sender keeps the tensor.
+  bool accepted = true;
+  TF_ASSERT_OK(test.rmgr()->RecvPushedTensor(
+      step_id, MakeKey(RemoteRecvTest::Key("a")), V("apple"), false,
+      &accepted));
+  EXPECT_FALSE(accepted);
+
+  std::vector<Tensor> vals = test.Recv(step_id, {"a"});
+  EXPECT_EQ("apple", V(vals[0]));
+  EXPECT_EQ(1, test.remote()->num_recv_tensor_calls());
+}
+
+TEST(RpcRendezvousMgrTest, RejectsPushesForFinishedSteps) {
+  RPCOptions rpc_options;
+  rpc_options.set_push_remote_tensors(true);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  const int64 step_id = 1;
+  test.rmgr()->Find(step_id)->Unref();
+  test.rmgr()->Cleanup(step_id);
+
+  bool accepted = true;
+  TF_ASSERT_OK(test.rmgr()->RecvPushedTensor(
+      step_id, MakeKey(RemoteRecvTest::Key("a")), V("apple"), false,
+      &accepted));
+  EXPECT_FALSE(accepted);
+}
+
+TEST(RpcRendezvousMgrTest, AbortsStepWhenPushFails) {
+  RPCOptions rpc_options;
+  rpc_options.set_push_remote_tensors(true);
+  RemoteRecvTest test(100 /* max_items_per_response */,
+                      true /* supports_recv_tensors */, rpc_options);
+  const int64 step_id = 1;
+  Rendezvous* rendez = test.rmgr()->Find(step_id);
+  core::ScopedUnref unref(rendez);
+
+  // The remote worker waits for the pushed tensor rather than pulling it.
+  test.remote()->set_push_status(errors::Unavailable("Connection reset"));
+  TF_ASSERT_OK(rendez->Send(MakeKey(RemoteRecvTest::SendKey("a")),
+                            Rendezvous::Args(), V("apple"), false));
+  Status s = rendez->Send(MakeKey(RemoteRecvTest::SendKey("b")),
+                          Rendezvous::Args(), V("banana"), false);
+  EXPECT_TRUE(errors::IsUnavailable(s)) << s;
+  test.rmgr()->Cleanup(step_id);
+}
+
 // NOTE: Remote Send/Recv is better tested in worker_test.cc
 
 }  // namespace tensorflow
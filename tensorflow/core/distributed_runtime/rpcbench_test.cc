@@ -63,9 +63,11 @@ void MakeGRPCCluster(const SessionOptions& options, int n,
     num_gpus = iter->second;
   }
 
+  const RPCOptions rpc_options = options.config.rpc_options();
   worker_threads = new thread::ThreadPool(Env::Default(), "worker_threads", n);
   for (int worker_idx = 0; worker_idx < n; ++worker_idx) {
-    worker_threads->Schedule([worker_idx, n, num_cpus, num_gpus, &port] {
+    worker_threads->Schedule([worker_idx, n, num_cpus, num_gpus, rpc_options,
+                              &port] {
       ServerDef server;
       server.set_protocol("grpc");
       server.set_job_name("localhost");
@@ -81,6 +83,7 @@ void MakeGRPCCluster(const SessionOptions& options, int n,
       auto config = server.mutable_default_session_config();
       (*config->mutable_device_count())["CPU"] = num_cpus;
       (*config->mutable_device_count())["GPU"] = num_gpus;
+      *config->mutable_rpc_options() = rpc_options;
 
       std::unique_ptr<ServerInterface> svr;
       TF_CHECK_OK(NewServer(server, &svr));
@@ -103,11 +106,14 @@ struct Cluster {
   std::vector<string> workers;
   std::vector<DeviceAttributes> devices;  // One per process
 
-  Cluster() {
+  explicit Cluster(int num_workers = kWorkers,
+                   int64 recv_coalescing_max_bytes = 0) {
     (*options.config.mutable_device_count())["CPU"] = 1;
     options.config.set_intra_op_parallelism_threads(1);
     options.config.set_inter_op_parallelism_threads(1);
-    MakeGRPCCluster(options, kWorkers, &workers, &devices);
+    options.config.mutable_rpc_options()->set_recv_coalescing_max_bytes(
+        recv_coalescing_max_bytes);
+    MakeGRPCCluster(options, num_workers, &workers, &devices);
     LOG(ERROR) << "C " << workers.size() << " " << devices.size() << " "
                << workers[0] << " " << workers[1];
     options.target = workers[0];
@@ -119,6 +125,13 @@ static const Cluster* GetCluster() {
   return result;
 }
 
+// Two-worker clusters with and without coalescing of remote receives.
+static const Cluster* GetFanInCluster(bool coalesce_recvs) {
+  static Cluster* coalescing = new Cluster(2, 0);
+  static Cluster* non_coalescing = new Cluster(2, -1);
+  return coalesce_recvs ? coalescing : non_coalescing;
+}
+
 // Make a program with specified number of stages and "width" ops per stage.
 GraphDef CreateGraphDef(int num_stages, int width, int tensor_size,
                         bool use_multiple_devices, const Cluster* cluster) {
@@ -164,27 +177,45 @@ string DebugString(const Tensor& x, const Tensor& y, int tensor_size) {
                          x_flat(1), y_flat(0), y_flat(1));
 }
 
-// TODO: Support sharding and depth.
-static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
-                      bool use_multiple_devices) {
-  testing::StopTiming();
-  const Cluster* cluster = GetCluster();
+// Make a program in which "width" tensors computed on the second device are
+// all consumed by a single op on the first device.
+GraphDef CreateFanInGraphDef(int width, int tensor_size,
+                             const Cluster* cluster) {
+  CHECK_GE(cluster->devices.size(), 2);
+
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  Scope s = Scope::NewRootScope();
 
+  // x is from the feed.
+  Output x = Const(s.WithOpName("x"), 0.0f, {tensor_size, 1});
+
+  std::vector<Output> remote;
+  for (int j = 0; j < width; j++) {
+    remote.push_back(AddN(s.WithDevice(cluster->devices[1].name()), {x}));
+  }
+
+  // Create output.
+  /* Output y =*/AddN(s.WithOpName("y"), remote);
+
+  GraphDef def;
+  TF_CHECK_OK(s.ToGraphDef(&def));
+  return def;
+}
+
+// TODO: Support sharding and depth.
+static void BM_RunGraph(int iters, const Cluster* cluster, const GraphDef& def,
+                        int tensor_size, const string& label) {
   // Creates a session.
   std::unique_ptr<Session> session(NewSession(cluster->options));
-  GraphDef def = CreateGraphDef(num_stages, width, tensor_size,
-                                use_multiple_devices, cluster);
-  graph::SetDefaultDevice(cluster->devices[0].name(), &def);
-
   TF_CHECK_OK(session->Create(def));
 
   // Randomly initialize the input.
   Tensor x(DT_FLOAT, TensorShape({tensor_size, 1}));
 
-  testing::SetLabel(
-      strings::StrCat(def.node_size(), " nodes; ",
-             use_multiple_devices ? "Multi device" : "Single device",
-             "; tensor bytes/send: ", tensor_size * sizeof(float)));
+  testing::SetLabel(strings::StrCat(def.node_size(), " nodes; ", label,
+                                    "; tensor bytes/send: ",
+                                    tensor_size * sizeof(float)));
 
   std::vector<Tensor> outputs;
 
@@ -211,6 +242,17 @@ static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
   testing::StopTiming();
   TF_CHECK_OK(session->Close());
 }
+
+static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
+                      bool use_multiple_devices) {
+  testing::StopTiming();
+  const Cluster* cluster = GetCluster();
+  GraphDef def = CreateGraphDef(num_stages, width, tensor_size,
+                                use_multiple_devices, cluster);
+  graph::SetDefaultDevice(cluster->devices[0].name(), &def);
+  BM_RunGraph(iters, cluster, def, tensor_size,
+              use_multiple_devices ? "Multi device" : "Single device");
+}
 static void BM_ShardedProgram(int iters, int width, int num_stages) {
   BM_Helper(iters, width, num_stages, 2 /*tensor_size*/, true /*multi-device*/);
 }
@@ -247,4 +289,27 @@ BENCHMARK(BM_SingleDevice)
     ->ArgPair(4, 10000)
     ->ArgPair(1, 1000000);
 
+// Many small tensors sent from one worker to another in each step, received
+// with one RecvTensor call each or coalesced into RecvTensors calls.
+static void BM_FanInHelper(int iters, int width, int tensor_size,
+                           bool coalesce_recvs) {
+  testing::StopTiming();
+  const Cluster* cluster = GetFanInCluster(coalesce_recvs);
+  GraphDef def = CreateFanInGraphDef(width, tensor_size, cluster);
+  graph::SetDefaultDevice(cluster->devices[0].name(), &def);
+  BM_RunGraph(iters, cluster, def, tensor_size,
+              coalesce_recvs ? "Coalesced recvs" : "Individual recvs");
+}
+static void BM_FanIn(int iters, int width, int tensor_size) {
+  BM_FanInHelper(iters, width, tensor_size, false /*coalesce_recvs*/);
+}
+static void BM_FanInCoalesced(int iters, int width, int tensor_size) {
+  BM_FanInHelper(iters, width, tensor_size, true /*coalesce_recvs*/);
+}
+BENCHMARK(BM_FanIn)->ArgPair(10, 2)->ArgPair(100, 2)->ArgPair(100, 1000);
+BENCHMARK(BM_FanInCoalesced)
+    ->ArgPair(10, 2)
+    ->ArgPair(100, 2)
+    ->ArgPair(100, 1000);
+
 }  // namespace tensorflow
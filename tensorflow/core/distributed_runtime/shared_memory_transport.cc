@@ -0,0 +1,251 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if !defined(PLATFORM_WINDOWS)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+const char* const kSharedMemoryDir = "/dev/shm";
+
+namespace {
+
+// Peers only ever stat or delete files with these prefixes, whatever the
+// messages they receive say.
+const char kProbePrefix[] = "tf_shm_probe_";
+const char kTensorPrefix[] = "tf_shm_tensor_";
+
+bool HasPrefix(const string& fname, const char* prefix) {
+  return io::Basename(fname).starts_with(prefix);
+}
+
+// Creates "fname", which must not exist yet, readable and writable by the
+// current user only, and writes "data" to it.  Deletes the file if it
+// cannot be written completely.
+Status CreatePrivateFile(const string& fname, StringPiece data) {
+#if defined(PLATFORM_WINDOWS)
+  return errors::Unimplemented("Shared memory files are not supported");
+#else
+  const int fd =
+      open(fname.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return errors::Unavailable("Cannot create ", fname, ": ",
+                               strerror(errno));
+  }
+  Status s;
+  while (!data.empty()) {
+    const ssize_t n = write(fd, data.data(), data.size());
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      s = errors::Unavailable("Cannot write ", fname, ": ", strerror(errno));
+      break;
+    }
+    data.remove_prefix(n);
+  }
+  if (close(fd) != 0 && s.ok()) {
+    s = errors::Unavailable("Cannot close ", fname, ": ", strerror(errno));
+  }
+  if (!s.ok()) {
+    unlink(fname.c_str());
+  }
+  return s;
+#endif
+}
+
+// Returns true if "fname" exists and is owned by the effective user of this
+// process, so that the process that created it can read the files that this
+// process creates with CreatePrivateFile.
+bool IsOwnFile(const string& fname) {
+#if defined(PLATFORM_WINDOWS)
+  return false;
+#else
+  struct stat st;
+  return stat(fname.c_str(), &st) == 0 && st.st_uid == geteuid();
+#endif
+}
+
+}  // namespace
+
+std::unique_ptr<SharedMemoryReceiver> SharedMemoryReceiver::Create(
+    Env* env, const string& dir, int64 min_bytes) {
+  SharedMemoryRecvOptions options;
+  options.set_probe_file(io::JoinPath(
+      dir, strings::StrCat(kProbePrefix, strings::Hex(random::New64()))));
+  options.set_min_bytes(min_bytes);
+  Status s = CreatePrivateFile(options.probe_file(), "");
+  if (!s.ok()) {
+    LOG(WARNING) << "Receiving tensors through the RPC, because " << dir
+                 << " is not writable: " << s;
+    return nullptr;
+  }
+  return std::unique_ptr<SharedMemoryReceiver>(
+      new SharedMemoryReceiver(env, options));
+}
+
+SharedMemoryReceiver::SharedMemoryReceiver(
+    Env* env, const SharedMemoryRecvOptions& options)
+    : env_(env), options_(options) {}
+
+SharedMemoryReceiver::~SharedMemoryReceiver() {
+  env_->DeleteFile(options_.probe_file()).IgnoreError();
+}
+
+void SharedMemoryReceiver::AddToRequest(RecvTensorRequest* request) const {
+  request->mutable_transport_options()->PackFrom(options_);
+}
+
+Status ReadSharedMemoryTensor(Env* env,
+                              const SharedMemoryTensorContent& content,
+                              Tensor* dst) {
+  if (!HasPrefix(content.file(), kTensorPrefix)) {
+    return errors::InvalidArgument("Invalid shared memory tensor file ",
+                                   content.file());
+  }
+  StringPiece buf = dst->tensor_data();
+  Status s;
+  if (!DataTypeCanUseMemcpy(dst->dtype())) {
+    s = errors::InvalidArgument("Cannot receive a tensor of type ",
+                                DataTypeString(dst->dtype()),
+                                " through shared memory");
+  } else if (content.size() != static_cast<int64>(buf.size())) {
+    s = errors::InvalidArgument("Shared memory tensor file has ",
+                                content.size(), " bytes, expected ",
+                                buf.size());
+  }
+  if (s.ok() && !buf.empty()) {
+    std::unique_ptr<RandomAccessFile> file;
+    s = env->NewRandomAccessFile(content.file(), &file);
+    if (s.ok()) {
+      char* data = const_cast<char*>(buf.data());
+      StringPiece result;
+      s = file->Read(0, buf.size(), &result, data);
+      if (s.ok() && result.size() != buf.size()) {
+        s = errors::DataLoss("Shared memory tensor file ", content.file(),
+                             " is truncated");
+      } else if (s.ok() && result.data() != data) {
+        memcpy(data, result.data(), result.size());
+      }
+    }
+  }
+  env->DeleteFile(content.file()).IgnoreError();
+  return s;
+}
+
+SharedMemorySender::SharedMemorySender(Env* env, const string& dir,
+                                       int64 max_file_age_micros)
+    : env_(env),
+      dir_(dir),
+      max_file_age_micros_(max_file_age_micros),
+      file_prefix_(strings::StrCat(kTensorPrefix,
+                                   strings::Hex(random::New64()), "_")) {}
+
+SharedMemorySender::~SharedMemorySender() {
+  // Most of the files were deleted by their receivers already.
+  for (const auto& file : files_) {
+    env_->DeleteFile(file.second).IgnoreError();
+  }
+}
+
+bool SharedMemorySender::Send(const RecvTensorRequest& request,
+                              const Tensor& val,
+                              SharedMemoryTensorContent* out) {
+  SharedMemoryRecvOptions options;
+  if (!request.transport_options().Is<SharedMemoryRecvOptions>() ||
+      !request.transport_options().UnpackTo(&options) ||
+      !DataTypeCanUseMemcpy(val.dtype())) {
+    return false;
+  }
+  const StringPiece data = val.tensor_data();
+  if (static_cast<int64>(data.size()) < options.min_bytes() ||
+      !IsLocalPeer(options.probe_file())) {
+    return false;
+  }
+
+  // The names are not predictable, so that other processes cannot create
+  // the files first, and the files are created only if they do not exist.
+  const string fname = io::JoinPath(
+      dir_, strings::StrCat(file_prefix_, strings::Hex(random::New64())));
+  Status s = CreatePrivateFile(fname, data);
+  if (!s.ok()) {
+    LOG(WARNING) << "Returning tensor in the RPC response: " << s;
+    return false;
+  }
+  {
+    mutex_lock l(mu_);
+    const uint64 now_micros = env_->NowMicros();
+    DeleteExpiredFilesLocked(now_micros);
+    files_.emplace_back(now_micros, fname);
+  }
+  out->set_file(fname);
+  out->set_size(data.size());
+  return true;
+}
+
+void SharedMemorySender::Abandon(const SharedMemoryTensorContent& content) {
+  {
+    mutex_lock l(mu_);
+    auto it = std::find_if(files_.begin(), files_.end(),
+                           [&content](const std::pair<uint64, string>& file) {
+                             return file.second == content.file();
+                           });
+    if (it == files_.end()) {
+      return;  // Not written by this sender, or deleted already.
+    }
+    files_.erase(it);
+  }
+  env_->DeleteFile(content.file()).IgnoreError();
+}
+
+bool SharedMemorySender::IsLocalPeer(const string& probe_file) {
+  {
+    mutex_lock l(mu_);
+    auto it = local_peers_.find(probe_file);
+    if (it != local_peers_.end()) {
+      return it->second;
+    }
+  }
+  const bool is_local =
+      HasPrefix(probe_file, kProbePrefix) && IsOwnFile(probe_file);
+  VLOG(1) << "Receiver of " << probe_file << " is "
+          << (is_local ? "local" : "remote");
+  mutex_lock l(mu_);
+  local_peers_[probe_file] = is_local;
+  return is_local;
+}
+
+void SharedMemorySender::DeleteExpiredFilesLocked(uint64 now_micros) {
+  while (!files_.empty() &&
+         files_.front().first + max_file_age_micros_ < now_micros) {
+    env_->DeleteFile(files_.front().second).IgnoreError();
+    files_.pop_front();
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,133 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+// Workers on the same host can pass the content of large tensors through
+// files in a shared-memory file system rather than through the RPC stack,
+// which saves the serialization and the loopback networking.  The RPC still
+// carries the request, and a response holding the tensor's dtype and shape
+// and a SharedMemoryTensorContent naming the file.
+//
+// A receiving worker proves that a peer shares its file system by naming a
+// probe file it created in each request: only a peer that can see the file
+// writes tensors for it, so workers on other hosts, or in containers with
+// their own /dev/shm, fall back to the RPC.  The files are readable by
+// their owner only, so the peer must also run as the same user.
+namespace tensorflow {
+
+// The directory in which the files are created by default.
+extern const char* const kSharedMemoryDir;
+
+// The receiving side of the transport.
+class SharedMemoryReceiver {
+ public:
+  // Creates the probe file in "dir".  Returns nullptr if "dir" cannot be
+  // written, in which case tensors are always received through the RPC.
+  static std::unique_ptr<SharedMemoryReceiver> Create(Env* env,
+                                                      const string& dir,
+                                                      int64 min_bytes);
+
+  // Deletes the probe file.
+  ~SharedMemoryReceiver();
+
+  // Asks for the tensor of "*request" to be returned through a file, if
+  // the remote worker shares the file system and the tensor is large
+  // enough.
+  void AddToRequest(RecvTensorRequest* request) const;
+
+ private:
+  SharedMemoryReceiver(Env* env, const SharedMemoryRecvOptions& options);
+
+  Env* const env_;
+  const SharedMemoryRecvOptions options_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemoryReceiver);
+};
+
+// Reads the content of "*dst", which must be an already allocated tensor of
+// a type that can be memcpy'd, from the file described by "content", and
+// deletes the file.
+Status ReadSharedMemoryTensor(Env* env,
+                              const SharedMemoryTensorContent& content,
+                              Tensor* dst);
+
+// The sending side of the transport.
+//
+// The receiver deletes each file once it has read it.  The files that are
+// never read, e.g. because the receiving step was aborted, are deleted
+// once they are older than "max_file_age_micros", and when the sender is
+// destroyed.  Files that the caller fails to return to the receiver are
+// deleted right away with Abandon().
+//
+// This class is thread-safe.
+class SharedMemorySender {
+ public:
+  SharedMemorySender(Env* env, const string& dir, int64 max_file_age_micros);
+  ~SharedMemorySender();
+
+  // Writes the content of "val" to a new file, and describes it in "*out",
+  // if "request" asks for it and the requesting worker can read the file.
+  // Returns false, and leaves "*out" unchanged, if "val" must be returned
+  // in the response.
+  bool Send(const RecvTensorRequest& request, const Tensor& val,
+            SharedMemoryTensorContent* out);
+
+  // Deletes the file described by "content", which Send() wrote but which
+  // will not be returned to the receiver.
+  void Abandon(const SharedMemoryTensorContent& content);
+
+ private:
+  // Returns true if the receiver that created "probe_file" shares the file
+  // system.
+  bool IsLocalPeer(const string& probe_file);
+
+  // Deletes the files older than max_file_age_micros_.
+  void DeleteExpiredFilesLocked(uint64 now_micros)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;
+  const string dir_;
+  const int64 max_file_age_micros_;
+  // Distinguishes the files of this sender from those of other processes.
+  const string file_prefix_;
+
+  mutex mu_;
+  // Whether the receiver of each probe file is local.
+  std::unordered_map<string, bool> local_peers_ GUARDED_BY(mu_);
+  // The files written so far with their creation times, oldest first.
+  std::deque<std::pair<uint64, string>> files_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemorySender);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
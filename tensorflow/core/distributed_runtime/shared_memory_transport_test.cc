@@ -0,0 +1,199 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+
+#include <sys/stat.h>
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+const int64 kMaxFileAgeMicros = 60 * 1000 * 1000;
+
+class SharedMemoryTransportTest : public ::testing::Test {
+ protected:
+  SharedMemoryTransportTest()
+      : env_(Env::Default()),
+        dir_(io::JoinPath(testing::TmpDir(), "shm")),
+        sender_(env_, dir_, kMaxFileAgeMicros) {
+    env_->RecursivelyCreateDir(dir_).IgnoreError();
+  }
+
+  // Returns the number of files in dir_.
+  int NumFiles() {
+    std::vector<string> children;
+    TF_CHECK_OK(env_->GetChildren(dir_, &children));
+    return children.size();
+  }
+
+  Env* const env_;
+  const string dir_;
+  SharedMemorySender sender_;
+};
+
+TEST_F(SharedMemoryTransportTest, RoundTrip) {
+  auto receiver = SharedMemoryReceiver::Create(env_, dir_, 16);
+  ASSERT_NE(nullptr, receiver);
+  const int probe_files = NumFiles();
+  RecvTensorRequest request;
+  receiver->AddToRequest(&request);
+
+  Tensor val = test::AsTensor<float>({1, 2, 3, 4, 5, 6}, {2, 3});
+  SharedMemoryTensorContent content;
+  ASSERT_TRUE(sender_.Send(request, val, &content));
+  EXPECT_EQ(24, content.size());
+  EXPECT_EQ(probe_files + 1, NumFiles());
+
+  Tensor result(DT_FLOAT, val.shape());
+  TF_ASSERT_OK(ReadSharedMemoryTensor(env_, content, &result));
+  test::ExpectTensorEqual<float>(val, result);
+  // The receiver deletes the file once it has read it.
+  EXPECT_EQ(probe_files, NumFiles());
+  EXPECT_FALSE(ReadSharedMemoryTensor(env_, content, &result).ok());
+}
+
+TEST_F(SharedMemoryTransportTest, FilesAreReadableByTheirOwnerOnly) {
+  auto receiver = SharedMemoryReceiver::Create(env_, dir_, 0);
+  ASSERT_NE(nullptr, receiver);
+  RecvTensorRequest request;
+  receiver->AddToRequest(&request);
+  SharedMemoryRecvOptions options;
+  ASSERT_TRUE(request.transport_options().UnpackTo(&options));
+  SharedMemoryTensorContent content;
+  ASSERT_TRUE(sender_.Send(request, test::AsTensor<float>({1}), &content));
+  for (const string& fname : {options.probe_file(), content.file()}) {
+    struct stat st;
+    ASSERT_EQ(0, stat(fname.c_str(), &st)) << fname;
+    EXPECT_EQ(0600, st.st_mode & 0777) << fname;
+  }
+  TF_EXPECT_OK(env_->DeleteFile(content.file()));
+}
+
+TEST_F(SharedMemoryTransportTest, AbandonDeletesFile) {
+  auto receiver = SharedMemoryReceiver::Create(env_, dir_, 0);
+  ASSERT_NE(nullptr, receiver);
+  RecvTensorRequest request;
+  receiver->AddToRequest(&request);
+  const int num_files = NumFiles();
+  SharedMemoryTensorContent content;
+  ASSERT_TRUE(sender_.Send(request, test::AsTensor<float>({1}), &content));
+  EXPECT_EQ(num_files + 1, NumFiles());
+  sender_.Abandon(content);
+  EXPECT_EQ(num_files, NumFiles());
+  // Files that the sender did not write are left alone.
+  SharedMemoryTensorContent other;
+  ASSERT_TRUE(sender_.Send(request, test::AsTensor<float>({1}), &content));
+  other.set_file(content.file() + "_other");
+  TF_ASSERT_OK(WriteStringToFile(env_, other.file(), ""));
+  sender_.Abandon(other);
+  EXPECT_EQ(num_files + 2, NumFiles());
+  TF_EXPECT_OK(env_->DeleteFile(other.file()));
+  TF_EXPECT_OK(env_->DeleteFile(content.file()));
+}
+
+TEST_F(SharedMemoryTransportTest, ProbeFileIsDeleted) {
+  const int num_files = NumFiles();
+  auto receiver = SharedMemoryReceiver::Create(env_, dir_, 0);
+  EXPECT_EQ(num_files + 1, NumFiles());
+  receiver.reset();
+  EXPECT_EQ(num_files, NumFiles());
+}
+
+TEST_F(SharedMemoryTransportTest, TensorsAreReturnedInResponse) {
+  auto receiver = SharedMemoryReceiver::Create(env_, dir_, 16);
+  ASSERT_NE(nullptr, receiver);
+  SharedMemoryTensorContent content;
+
+  // Not asked for.
+  RecvTensorRequest request;
+  EXPECT_FALSE(sender_.Send(request, test::AsTensor<int64>({1, 2, 3}),
+                            &content));
+  // Too small.
+  receiver->AddToRequest(&request);
+  EXPECT_FALSE(sender_.Send(request, test::AsTensor<int32>({1, 2, 3}),
+                            &content));
+  EXPECT_TRUE(sender_.Send(request, test::AsTensor<int32>({1, 2, 3, 4}),
+                           &content));
+  TF_EXPECT_OK(env_->DeleteFile(content.file()));
+  // Not memcpy-able.
+  Tensor strings(DT_STRING, TensorShape({100}));
+  EXPECT_FALSE(sender_.Send(request, strings, &content));
+}
+
+TEST_F(SharedMemoryTransportTest, RemotePeer) {
+  // A receiver whose probe file the sender cannot see.
+  SharedMemoryRecvOptions options;
+  options.set_probe_file(io::JoinPath(dir_, "tf_shm_probe_elsewhere"));
+  RecvTensorRequest request;
+  request.mutable_transport_options()->PackFrom(options);
+  SharedMemoryTensorContent content;
+  EXPECT_FALSE(sender_.Send(request, test::AsTensor<int64>({1, 2}), &content));
+
+  // Existing files that are not probe files do not count either.
+  options.set_probe_file(dir_);
+  request.mutable_transport_options()->PackFrom(options);
+  EXPECT_FALSE(sender_.Send(request, test::AsTensor<int64>({1, 2}), &content));
+}
+
+TEST_F(SharedMemoryTransportTest, ReadRejectsInvalidContent) {
+  Tensor dst(DT_FLOAT, TensorShape({2}));
+  SharedMemoryTensorContent content;
+  content.set_file(io::JoinPath(dir_, "not_a_tensor"));
+  content.set_size(8);
+  EXPECT_FALSE(ReadSharedMemoryTensor(env_, content, &dst).ok());
+
+  auto receiver = SharedMemoryReceiver::Create(env_, dir_, 0);
+  ASSERT_NE(nullptr, receiver);
+  RecvTensorRequest request;
+  receiver->AddToRequest(&request);
+  ASSERT_TRUE(
+      sender_.Send(request, test::AsTensor<float>({1, 2, 3}), &content));
+  const int num_files = NumFiles();
+  EXPECT_FALSE(ReadSharedMemoryTensor(env_, content, &dst).ok());
+  // The file is deleted even if it does not match the tensor.
+  EXPECT_EQ(num_files - 1, NumFiles());
+}
+
+TEST_F(SharedMemoryTransportTest, SenderDeletesUnreadFiles) {
+  auto receiver = SharedMemoryReceiver::Create(env_, dir_, 0);
+  ASSERT_NE(nullptr, receiver);
+  RecvTensorRequest request;
+  receiver->AddToRequest(&request);
+  const int num_files = NumFiles();
+  {
+    SharedMemorySender sender(env_, dir_, kMaxFileAgeMicros);
+    SharedMemoryTensorContent content;
+    ASSERT_TRUE(sender.Send(request, test::AsTensor<float>({1}), &content));
+    ASSERT_TRUE(sender.Send(request, test::AsTensor<float>({2}), &content));
+    EXPECT_EQ(num_files + 2, NumFiles());
+  }
+  EXPECT_EQ(num_files, NumFiles());
+
+  // Files older than the maximum age are deleted by the next Send.
+  SharedMemorySender sender(env_, dir_, 0);
+  SharedMemoryTensorContent content;
+  ASSERT_TRUE(sender.Send(request, test::AsTensor<float>({1}), &content));
+  env_->SleepForMicroseconds(1000);
+  ASSERT_TRUE(sender.Send(request, test::AsTensor<float>({2}), &content));
+  EXPECT_EQ(num_files + 1, NumFiles());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -14,10 +14,69 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
+
+#include <algorithm>
+#include <cstring>
+
 #include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 
 namespace tensorflow {
 
+namespace {
+
+// Returns true if the content of the tensor in "response" was passed
+// through shared memory.
+bool HasSharedMemoryContent(const RecvTensorResponse& response) {
+  return response.transport_options().Is<SharedMemoryTensorContent>();
+}
+
+// Reads the content of "*dst" from the file named in the transport options
+// of "response".
+Status ReadSharedMemoryContent(const RecvTensorResponse& response,
+                               Tensor* dst) {
+  SharedMemoryTensorContent content;
+  if (!response.transport_options().UnpackTo(&content)) {
+    return errors::InvalidArgument("Cannot parse tensor from response");
+  }
+  return ReadSharedMemoryTensor(Env::Default(), content, dst);
+}
+
+// Replaces the compressed content of "*response", or the content it passed
+// through shared memory, if any, with the tensor content.
+Status ExpandContent(RecvTensorResponse* response) {
+  const bool shared_memory = HasSharedMemoryContent(*response);
+  if (!shared_memory && !response->has_compressed_content()) {
+    return Status::OK();
+  }
+  if (!TensorShape::IsValid(response->tensor().tensor_shape())) {
+    return errors::InvalidArgument("Cannot parse tensor from response");
+  }
+  Tensor val(response->tensor().dtype(),
+             TensorShape(response->tensor().tensor_shape()));
+  if (shared_memory) {
+    TF_RETURN_IF_ERROR(ReadSharedMemoryContent(*response, &val));
+    response->clear_transport_options();
+  } else {
+    TF_RETURN_IF_ERROR(
+        DecompressTensorContent(response->compressed_content(), &val));
+    response->clear_compressed_content();
+  }
+  val.AsProtoTensorContent(response->mutable_tensor());
+  return Status::OK();
+}
+
+}  // namespace
+
+void GetStripeRange(int64 num_elements, int num_stripes, int index,
+                    int64* begin, int64* end) {
+  const int64 quotient = num_elements / num_stripes;
+  const int64 remainder = num_elements % num_stripes;
+  *begin = index * quotient + std::min<int64>(index, remainder);
+  *end = *begin + quotient + (index < remainder ? 1 : 0);
+}
+
 TensorResponse::Source::~Source() {}
 
 void TensorResponse::Clear() {
@@ -26,11 +85,13 @@ void TensorResponse::Clear() {
   alloc_attrs_ = AllocatorAttributes();
   allocator_ = nullptr;
   already_used_ = false;
+  stripe_buffer_ = nullptr;
   ClearTensor();
 }
 
 void TensorResponse::ClearTensor() {
   meta_.Clear();
+  stripe_read_ = false;
   tensor_ = Tensor();
 }
 
@@ -46,15 +107,18 @@ void TensorResponse::InitAlloc(DeviceBase* d, const AllocatorAttributes& aa) {
 }
 
 Status TensorResponse::InitFrom(RecvTensorResponse* response) {
-  Status s;
   meta_.Swap(response);
-  if (on_host_) {
+  Status s = ExpandContent(&meta_);
+  if (s.ok() && on_host_) {
     if (!tensor_.FromProto(allocator_, meta_.tensor())) {
       s = errors::InvalidArgument("Cannot parse tensor from response");
     }
-  } else {
+  } else if (s.ok()) {
     s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
   }
+  if (s.ok()) {
+    s = FinishStripe();
+  }
   {
     TensorProto empty;
     meta_.mutable_tensor()->Swap(&empty);
@@ -82,8 +146,12 @@ Status TensorResponse::ParseFrom(Source* source) {
     if (!meta_.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
       return errors::InvalidArgument("Cannot parse tensor from response");
     }
+    TF_RETURN_IF_ERROR(ExpandContent(&meta_));
     Status s =
         device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    if (s.ok()) {
+      s = FinishStripe();
+    }
     // Reduce memory usage for big tensors.
     {
       TensorProto empty;
@@ -96,10 +164,51 @@ Status TensorResponse::ParseFrom(Source* source) {
     ClearTensor();
   }
   already_used_ = true;
-  if (ParseFast(source)) return Status::OK();
-  meta_.Clear();
-  if (ParseSlow(source)) return Status::OK();
-  return errors::InvalidArgument("Cannot parse tensor from response");
+  bool parsed = ParseFast(source);
+  if (!parsed) {
+    ClearTensor();
+    parsed = ParseSlow(source);
+  }
+  if (!parsed) {
+    return errors::InvalidArgument("Cannot parse tensor from response");
+  }
+  TF_RETURN_IF_ERROR(FinishContent());
+  return FinishStripe();
+}
+
+Status TensorResponse::FinishContent() {
+  // The parsers allocated tensor_ with the destination allocator from the
+  // dtype and shape, so the content is read straight into it.
+  Status s;
+  if (HasSharedMemoryContent(meta_)) {
+    s = ReadSharedMemoryContent(meta_, &tensor_);
+    meta_.clear_transport_options();
+  } else if (meta_.has_compressed_content()) {
+    s = DecompressTensorContent(meta_.compressed_content(), &tensor_);
+    meta_.clear_compressed_content();
+  }
+  return s;
+}
+
+Status TensorResponse::FinishStripe() {
+  if (stripe_buffer_ == nullptr || !meta_.has_stripe() || stripe_read_) {
+    return Status::OK();
+  }
+  // The content was decompressed, read from shared memory or parsed by
+  // ParseSlow into tensor_.
+  char* dst = nullptr;
+  if (!DataTypeCanUseMemcpy(tensor_.dtype()) ||
+      !stripe_buffer_(meta_.stripe(), tensor_.dtype(), tensor_.NumElements(),
+                      &dst)) {
+    return errors::InvalidArgument("Cannot parse tensor stripe from response");
+  }
+  const StringPiece data = tensor_.tensor_data();
+  if (!data.empty()) {
+    memcpy(dst, data.data(), data.size());
+  }
+  stripe_read_ = true;
+  tensor_ = Tensor(tensor_.dtype());
+  return Status::OK();
 }
 
 // Define some helper routines for decoding protocol buffer wire format data
@@ -190,6 +299,22 @@ bool TensorResponse::ParseTensorSubmessage(
         if (!ReadVarintSizeAsInt(input, &num_bytes)) return false;
         seen_tensor_content = true;
         TensorShape shape(tensor_meta->tensor_shape());
+        if (stripe_buffer_ != nullptr && meta_.has_stripe()) {
+          // The stripe precedes the tensor in the responses of
+          // GrpcWorker, so its content is read straight into the buffer.
+          const DataType dtype = tensor_meta->dtype();
+          char* dst = nullptr;
+          if (static_cast<int64>(num_bytes) !=
+                  shape.num_elements() * DataTypeSize(dtype) ||
+              !stripe_buffer_(meta_.stripe(), dtype, shape.num_elements(),
+                              &dst) ||
+              !input->ReadRaw(dst, num_bytes)) {
+            return false;
+          }
+          stripe_read_ = true;
+          tensor_ = Tensor(dtype);
+          break;
+        }
         Tensor t(allocator_, tensor_meta->dtype(), shape);
         StringPiece buf = t.tensor_data();
         if (static_cast<size_t>(num_bytes) != buf.size()) return false;
@@ -255,6 +380,18 @@ bool TensorResponse::ParseFast(Source* source) {
           return false;
         break;
       }
+      case RecvTensorResponse::kCompressedContentFieldNumber: {
+        if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
+            !ReadNestedMessage(&input, meta_.mutable_compressed_content()))
+          return false;
+        break;
+      }
+      case RecvTensorResponse::kStripeFieldNumber: {
+        if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
+            !ReadNestedMessage(&input, meta_.mutable_stripe()))
+          return false;
+        break;
+      }
       default: {
         // Unknown tag, so don't handle we can't handle on the fast path
         return false;
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_CODING_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_CODING_H_
 
+#include <functional>
+
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -29,6 +31,13 @@ class Allocator;
 class DeviceBase;
 class TensorProto;
 
+// Sets [*begin, *end) to the range of the flattened elements of a tensor
+// with "num_elements" elements that is returned in stripe "index" of
+// "num_stripes" (see RecvTensorRequest.num_stripes).  The first
+// num_elements % num_stripes stripes have one more element than the others.
+void GetStripeRange(int64 num_elements, int num_stripes, int index,
+                    int64* begin, int64* end);
+
 // TensorResponse can be used as the destination of an RPC that returns
 // a RecvTensorResponse.  It efficiently decodes the incoming data
 // into Tensor contents as well as associated metadata.
@@ -46,6 +55,19 @@ class TensorResponse {
   // Initialize memory allocation related members.
   void InitAlloc(DeviceBase* d, const AllocatorAttributes& aa);
 
+  // Called when parsing a response that holds "stripe" of a tensor (see
+  // RecvTensorResponse.stripe), whose content is "num_elements" elements of
+  // "dtype".  Returns false to fail the parse, or true with "*dst" set to
+  // the buffer that the content is read into.
+  typedef std::function<bool(const TensorStripe& stripe, DataType dtype,
+                             int64 num_elements, char** dst)>
+      StripeBufferFn;
+
+  // If set, the content of a response that holds a stripe is read straight
+  // into the buffer returned by "fn" instead of into tensor(), which is left
+  // empty.  Reset by Clear().
+  void set_stripe_buffer(StripeBufferFn fn) { stripe_buffer_ = std::move(fn); }
+
   // Source provides a way for a particular RPC implementation to provide
   // received data to ParseFrom.
   class Source {
@@ -92,12 +114,22 @@ class TensorResponse {
                              TensorProto* tensor_meta);
   bool ParseFast(Source* source);
   bool ParseSlow(Source* source);
+  // Decodes the compressed content of a parsed response, or reads the
+  // content it passed through shared memory, into tensor_.
+  Status FinishContent();
+  // If the parsed response holds a stripe that was not read into the buffer
+  // of stripe_buffer_, copies it there from tensor_.
+  Status FinishStripe();
 
   bool on_host_ = false;
   DeviceBase* device_ = nullptr;
   AllocatorAttributes alloc_attrs_;
   Allocator* allocator_ = nullptr;
   bool already_used_ = false;
+  StripeBufferFn stripe_buffer_;
+  // True if the content of the parsed stripe was read into the buffer of
+  // stripe_buffer_.
+  bool stripe_read_ = false;
   Tensor tensor_;
   RecvTensorResponse meta_;
 };
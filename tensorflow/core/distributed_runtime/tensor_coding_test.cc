@@ -15,9 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -155,6 +158,166 @@ TEST_F(TensorResponseTest, Simple) {
 
 TEST_F(TensorResponseTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(TensorResponseTest, CompressedContent) {
+  // Small integers survive the round trip through half precision.
+  Tensor src(DT_FLOAT, TensorShape({3, 100}));
+  for (int i = 0; i < 300; i++) {
+    src.flat<float>()(i) = i - 150;
+  }
+  TensorCompression options;
+  options.set_type(TensorCompression::FP16);
+  TensorCompressor compressor;
+  RecvTensorResponse proto;
+  proto.set_send_start_micros(123456);
+  proto.mutable_tensor()->set_dtype(DT_FLOAT);
+  src.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  ASSERT_TRUE(compressor.Compress("graph", "edge", options, src,
+                                  proto.mutable_compressed_content()));
+  string encoded;
+  proto.AppendToString(&encoded);
+
+  StringSource source(&encoded, 1024);
+  TensorResponse response;
+  DummyDevice cpu_device(Env::Default());
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  for (int i = 0; i < 2; i++) {  // Twice so we exercise reuse of "response"
+    TF_EXPECT_OK(response.ParseFrom(&source));
+    EXPECT_EQ(123456, response.metadata().send_start_micros());
+    EXPECT_FALSE(response.metadata().has_compressed_content());
+    test::ExpectTensorEqual<float>(src, response.tensor());
+  }
+
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  TF_EXPECT_OK(response.InitFrom(&proto));
+  test::ExpectTensorEqual<float>(src, response.tensor());
+}
+
+TEST_F(TensorResponseTest, CorruptCompressedContent) {
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(DT_FLOAT);
+  TensorShape({10}).AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.mutable_compressed_content()->set_type(TensorCompression::BFLOAT16);
+  proto.mutable_compressed_content()->set_content(string(19, 0));
+  string encoded;
+  proto.AppendToString(&encoded);
+
+  StringSource source(&encoded, 1024);
+  TensorResponse response;
+  DummyDevice cpu_device(Env::Default());
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  EXPECT_FALSE(response.ParseFrom(&source).ok());
+}
+
+TEST(GetStripeRangeTest, Simple) {
+  int64 begin;
+  int64 end;
+  GetStripeRange(10, 3, 0, &begin, &end);
+  EXPECT_EQ(0, begin);
+  EXPECT_EQ(4, end);
+  GetStripeRange(10, 3, 1, &begin, &end);
+  EXPECT_EQ(4, begin);
+  EXPECT_EQ(7, end);
+  GetStripeRange(10, 3, 2, &begin, &end);
+  EXPECT_EQ(7, begin);
+  EXPECT_EQ(10, end);
+  GetStripeRange(2, 3, 2, &begin, &end);
+  EXPECT_EQ(2, begin);
+  EXPECT_EQ(2, end);
+}
+
+TEST_F(TensorResponseTest, StripeBuffer) {
+  Tensor stripe = test::AsTensor<int64>({5, 6, 7});
+  RecvTensorResponse header;
+  TensorShape({10}).AsProto(header.mutable_stripe()->mutable_shape());
+  header.mutable_stripe()->set_offset(4);
+  RecvTensorResponse body;
+  stripe.AsProtoTensorContent(body.mutable_tensor());
+  // GrpcWorker encodes the stripe before the tensor, so that the content is
+  // read straight into the buffer, while protobuf encodes it after, so that
+  // the content is copied there.
+  string stripe_first;
+  header.AppendToString(&stripe_first);
+  body.AppendToString(&stripe_first);
+  string tensor_first;
+  body.AppendToString(&tensor_first);
+  header.AppendToString(&tensor_first);
+
+  DummyDevice cpu_device(Env::Default());
+  for (const string* encoded : {&stripe_first, &tensor_first}) {
+    Tensor dst = test::AsTensor<int64>({0, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+    TensorResponse response;
+    response.InitAlloc(&cpu_device, AllocatorAttributes());
+    response.set_stripe_buffer([&dst](const TensorStripe& stripe,
+                                      DataType dtype, int64 num_elements,
+                                      char** buf) {
+      EXPECT_EQ(DT_INT64, dtype);
+      EXPECT_EQ(3, num_elements);
+      *buf = reinterpret_cast<char*>(dst.flat<int64>().data() +
+                                     stripe.offset());
+      return true;
+    });
+    StringSource source(encoded, 1024);
+    TF_EXPECT_OK(response.ParseFrom(&source));
+    EXPECT_EQ(4, response.metadata().stripe().offset());
+    EXPECT_EQ(0, response.tensor().NumElements());
+    test::ExpectTensorEqual<int64>(
+        test::AsTensor<int64>({0, 0, 0, 0, 5, 6, 7, 0, 0, 0}), dst);
+
+    // A stripe that the callback rejects fails the parse.
+    response.Clear();
+    response.InitAlloc(&cpu_device, AllocatorAttributes());
+    response.set_stripe_buffer(
+        [](const TensorStripe&, DataType, int64, char**) { return false; });
+    StringSource again(encoded, 1024);
+    EXPECT_FALSE(response.ParseFrom(&again).ok());
+  }
+}
+
+TEST_F(TensorResponseTest, SharedMemoryContent) {
+  Env* env = Env::Default();
+  const string dir = testing::TmpDir();
+  auto receiver = SharedMemoryReceiver::Create(env, dir, 0);
+  ASSERT_NE(nullptr, receiver);
+  RecvTensorRequest request;
+  receiver->AddToRequest(&request);
+  SharedMemorySender sender(env, dir, 60 * 1000 * 1000);
+  Tensor src = test::AsTensor<int64>({1, 2, 3, 4, 5, 6}, {3, 2});
+
+  // Each response is parsed, and its file deleted, once.
+  auto make_response = [&sender, &request, &src](RecvTensorResponse* proto) {
+    SharedMemoryTensorContent content;
+    ASSERT_TRUE(sender.Send(request, src, &content));
+    proto->set_send_start_micros(123456);
+    proto->mutable_tensor()->set_dtype(DT_INT64);
+    src.shape().AsProto(proto->mutable_tensor()->mutable_tensor_shape());
+    proto->mutable_transport_options()->PackFrom(content);
+  };
+
+  TensorResponse response;
+  DummyDevice cpu_device(env);
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  for (int i = 0; i < 2; i++) {  // Twice so we exercise reuse of "response"
+    RecvTensorResponse proto;
+    make_response(&proto);
+    string encoded;
+    proto.AppendToString(&encoded);
+    StringSource source(&encoded, 1024);
+    TF_EXPECT_OK(response.ParseFrom(&source));
+    EXPECT_EQ(123456, response.metadata().send_start_micros());
+    EXPECT_FALSE(response.metadata().has_transport_options());
+    test::ExpectTensorEqual<int64>(src, response.tensor());
+    // The file was deleted once read.
+    StringSource again(&encoded, 1024);
+    EXPECT_FALSE(response.ParseFrom(&again).ok());
+  }
+
+  RecvTensorResponse proto;
+  make_response(&proto);
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  TF_EXPECT_OK(response.InitFrom(&proto));
+  test::ExpectTensorEqual<int64>(src, response.tensor());
+}
+
 string MakeFloatTensorTestCase(int num_elems) {
   std::vector<int8> v(num_elems);
   for (int i = 0; i < num_elems; i++) {
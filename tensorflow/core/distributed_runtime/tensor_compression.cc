@@ -0,0 +1,298 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/framework/bfloat16.h"
+#include "tensorflow/core/framework/numeric_types.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+
+namespace {
+
+const int64 kDefaultMinBytes = 1 << 10;
+const int32 kDefaultChunkSize = 512;
+const float kDefaultTopKFraction = 0.01f;
+
+// Per-chunk header of QUANTIZED_8BIT: the minimum and the scale.
+const size_t kChunkHeaderBytes = 2 * sizeof(float);
+
+int32 ChunkSize(const TensorCompression& options) {
+  return options.chunk_size() > 0 ? options.chunk_size() : kDefaultChunkSize;
+}
+
+size_t QuantizedBytes(int64 num_elements, int32 chunk_size) {
+  const int64 num_chunks = (num_elements + chunk_size - 1) / chunk_size;
+  return num_chunks * kChunkHeaderBytes + num_elements;
+}
+
+void EncodeFP16(const float* src, int64 n, string* out) {
+  out->resize(n * sizeof(uint16));
+  char* dst = &(*out)[0];
+  for (int64 i = 0; i < n; ++i) {
+    const uint16 bits = Eigen::half(src[i]).x;
+    memcpy(dst + i * sizeof(uint16), &bits, sizeof(uint16));
+  }
+}
+
+void DecodeFP16(const char* src, int64 n, float* dst) {
+  for (int64 i = 0; i < n; ++i) {
+    Eigen::half h;
+    memcpy(&h.x, src + i * sizeof(uint16), sizeof(uint16));
+    dst[i] = static_cast<float>(h);
+  }
+}
+
+// Returns false if "src" holds values that cannot be quantized.
+bool EncodeQuantized(const float* src, int64 n, int32 chunk_size,
+                     string* out) {
+  out->resize(QuantizedBytes(n, chunk_size));
+  char* dst = &(*out)[0];
+  for (int64 start = 0; start < n; start += chunk_size) {
+    const int64 len = std::min<int64>(chunk_size, n - start);
+    const float* chunk = src + start;
+    float lo = chunk[0];
+    float hi = chunk[0];
+    for (int64 i = 0; i < len; ++i) {
+      if (!std::isfinite(chunk[i])) return false;
+      lo = std::min(lo, chunk[i]);
+      hi = std::max(hi, chunk[i]);
+    }
+    const float scale = (hi - lo) / 255.0f;
+    memcpy(dst, &lo, sizeof(float));
+    memcpy(dst + sizeof(float), &scale, sizeof(float));
+    dst += kChunkHeaderBytes;
+    for (int64 i = 0; i < len; ++i) {
+      const float q = scale > 0 ? std::round((chunk[i] - lo) / scale) : 0.0f;
+      *dst++ = static_cast<char>(
+          static_cast<uint8>(std::min(255.0f, std::max(0.0f, q))));
+    }
+  }
+  return true;
+}
+
+void DecodeQuantized(const char* src, int64 n, int32 chunk_size, float* dst) {
+  for (int64 start = 0; start < n; start += chunk_size) {
+    const int64 len = std::min<int64>(chunk_size, n - start);
+    float lo;
+    float scale;
+    memcpy(&lo, src, sizeof(float));
+    memcpy(&scale, src + sizeof(float), sizeof(float));
+    src += kChunkHeaderBytes;
+    for (int64 i = 0; i < len; ++i) {
+      dst[start + i] = lo + scale * static_cast<uint8>(*src++);
+    }
+  }
+}
+
+}  // namespace
+
+Status ValidateTensorCompression(const TensorCompression& options) {
+  if (options.type() == TensorCompression::TOP_K &&
+      options.edge_name_filter_size() == 0) {
+    return errors::InvalidArgument(
+        "TOP_K tensor compression requires an edge_name_filter");
+  }
+  return Status::OK();
+}
+
+bool ShouldCompressEdge(const TensorCompression& options,
+                        StringPiece edge_name) {
+  if (options.type() == TensorCompression::NONE ||
+      !ValidateTensorCompression(options).ok()) {
+    return false;
+  }
+  if (options.edge_name_filter_size() == 0) {
+    return true;
+  }
+  for (const string& filter : options.edge_name_filter()) {
+    if (edge_name.contains(filter)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Status DecompressTensorContent(const CompressedTensorContent& content,
+                               Tensor* dst) {
+  if (dst->dtype() != DT_FLOAT) {
+    return errors::InvalidArgument("Cannot decompress a tensor of type ",
+                                   DataTypeString(dst->dtype()));
+  }
+  const int64 n = dst->NumElements();
+  float* out = dst->flat<float>().data();
+  const string& data = content.content();
+  switch (content.type()) {
+    case TensorCompression::FP16:
+    case TensorCompression::BFLOAT16:
+      if (data.size() != n * sizeof(uint16)) {
+        return errors::InvalidArgument("Compressed tensor has ", data.size(),
+                                       " bytes for ", n, " 16-bit values");
+      }
+      if (content.type() == TensorCompression::FP16) {
+        DecodeFP16(data.data(), n, out);
+      } else {
+        BFloat16ToFloat(reinterpret_cast<const bfloat16*>(data.data()), out, n);
+      }
+      return Status::OK();
+    case TensorCompression::QUANTIZED_8BIT:
+      if (content.chunk_size() <= 0 ||
+          data.size() != QuantizedBytes(n, content.chunk_size())) {
+        return errors::InvalidArgument("Compressed tensor has ", data.size(),
+                                       " bytes for ", n,
+                                       " 8-bit values in chunks of ",
+                                       content.chunk_size());
+      }
+      DecodeQuantized(data.data(), n, content.chunk_size(), out);
+      return Status::OK();
+    case TensorCompression::TOP_K: {
+      uint32 k = 0;
+      if (data.size() >= sizeof(uint32)) {
+        memcpy(&k, data.data(), sizeof(uint32));
+      }
+      if (data.size() < sizeof(uint32) || k > n ||
+          data.size() != sizeof(uint32) + k * (sizeof(uint32) + sizeof(float))) {
+        return errors::InvalidArgument("Compressed tensor has ", data.size(),
+                                       " bytes for ", n, " values");
+      }
+      const char* indices = data.data() + sizeof(uint32);
+      const char* values = indices + k * sizeof(uint32);
+      std::fill_n(out, n, 0.0f);
+      for (uint32 i = 0; i < k; ++i) {
+        uint32 index;
+        memcpy(&index, indices + i * sizeof(uint32), sizeof(uint32));
+        if (index >= n) {
+          return errors::InvalidArgument("Compressed tensor index ", index,
+                                         " is out of range for ", n,
+                                         " values");
+        }
+        memcpy(out + index, values + i * sizeof(float), sizeof(float));
+      }
+      return Status::OK();
+    }
+    default:
+      return errors::Unimplemented("Unknown tensor compression ",
+                                   static_cast<int>(content.type()));
+  }
+}
+
+bool TensorCompressor::Compress(const string& graph_handle,
+                                const string& edge_key,
+                                const TensorCompression& options,
+                                const Tensor& val,
+                                CompressedTensorContent* out) {
+  const int64 min_bytes =
+      options.min_bytes() > 0 ? options.min_bytes() : kDefaultMinBytes;
+  if (val.dtype() != DT_FLOAT || val.TotalBytes() < min_bytes) {
+    return false;
+  }
+  const int64 n = val.NumElements();
+  const float* src = val.flat<float>().data();
+  string content;
+  switch (options.type()) {
+    case TensorCompression::FP16:
+      EncodeFP16(src, n, &content);
+      break;
+    case TensorCompression::BFLOAT16:
+      content.resize(n * sizeof(bfloat16));
+      FloatToBFloat16(src, reinterpret_cast<bfloat16*>(&content[0]), n);
+      break;
+    case TensorCompression::QUANTIZED_8BIT:
+      if (!EncodeQuantized(src, n, ChunkSize(options), &content)) {
+        return false;
+      }
+      out->set_chunk_size(ChunkSize(options));
+      break;
+    case TensorCompression::TOP_K: {
+      if (graph_handle.empty() || n > std::numeric_limits<uint32>::max()) {
+        return false;
+      }
+      float fraction = options.top_k_fraction() > 0 ? options.top_k_fraction()
+                                                    : kDefaultTopKFraction;
+      fraction = std::min(fraction, 1.0f);
+      const uint32 k = std::max<int64>(1, std::ceil(n * fraction));
+
+      std::shared_ptr<Residual> residual = GetResidual(graph_handle, edge_key);
+      mutex_lock l(residual->mu);
+      if (!residual->val.shape().IsSameSize(val.shape()) ||
+          residual->val.dtype() != DT_FLOAT) {
+        residual->val = Tensor(DT_FLOAT, val.shape());
+        residual->val.flat<float>().setZero();
+      }
+      // Accumulate "val" into the residual, send its k largest values and
+      // keep the rest for the next step.
+      float* acc = residual->val.flat<float>().data();
+      for (int64 i = 0; i < n; ++i) {
+        acc[i] += src[i];
+      }
+      std::vector<uint32> order(n);
+      for (int64 i = 0; i < n; ++i) {
+        order[i] = i;
+      }
+      std::nth_element(order.begin(), order.begin() + (k - 1), order.end(),
+                       [acc](uint32 a, uint32 b) {
+                         return std::abs(acc[a]) > std::abs(acc[b]);
+                       });
+      order.resize(k);
+      std::sort(order.begin(), order.end());
+
+      content.resize(sizeof(uint32) + k * (sizeof(uint32) + sizeof(float)));
+      char* dst = &content[0];
+      memcpy(dst, &k, sizeof(uint32));
+      char* indices = dst + sizeof(uint32);
+      char* values = indices + k * sizeof(uint32);
+      for (uint32 i = 0; i < k; ++i) {
+        memcpy(indices + i * sizeof(uint32), &order[i], sizeof(uint32));
+        memcpy(values + i * sizeof(float), &acc[order[i]], sizeof(float));
+        acc[order[i]] = 0.0f;
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+  out->set_type(options.type());
+  out->mutable_content()->swap(content);
+  return true;
+}
+
+void TensorCompressor::ClearResiduals(const string& graph_handle) {
+  mutex_lock l(mu_);
+  residuals_.erase(graph_handle);
+}
+
+void TensorCompressor::ClearAllResiduals() {
+  mutex_lock l(mu_);
+  residuals_.clear();
+}
+
+std::shared_ptr<TensorCompressor::Residual> TensorCompressor::GetResidual(
+    const string& graph_handle, const string& edge_key) {
+  mutex_lock l(mu_);
+  std::shared_ptr<Residual>& residual = residuals_[graph_handle][edge_key];
+  if (residual == nullptr) {
+    residual = std::make_shared<Residual>();
+  }
+  return residual;
+}
+
+}  // namespace tensorflow
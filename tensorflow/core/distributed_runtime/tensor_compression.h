@@ -0,0 +1,95 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
+
+#include <memory>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace tensorflow {
+
+// Returns an error if "options" are not valid.  TOP_K compression must be
+// restricted to some edges with an edge_name_filter: it is only meant for
+// values such as gradients, which are summed over steps, and corrupts
+// activations and variable reads.
+Status ValidateTensorCompression(const TensorCompression& options);
+
+// Returns true if the receiver of the edge named "edge_name" should ask for
+// it to be compressed as specified by "options".
+bool ShouldCompressEdge(const TensorCompression& options,
+                        StringPiece edge_name);
+
+// Decodes "content" into "*dst", which must be an already allocated
+// DT_FLOAT tensor of the shape of the compressed tensor.
+Status DecompressTensorContent(const CompressedTensorContent& content,
+                               Tensor* dst);
+
+// Compresses the tensors a worker sends in response to RecvTensor
+// requests.  For TOP_K compression, it keeps the residual of each edge of
+// each registered graph between steps.
+//
+// This class is thread-safe.
+class TensorCompressor {
+ public:
+  TensorCompressor() {}
+  ~TensorCompressor() {}
+
+  // Compresses "val", the tensor of the edge identified by "edge_key" in
+  // the graph registered as "graph_handle", as specified by "options" into
+  // "*out".  Returns false, and leaves "*out" unchanged, if "val" must be
+  // sent uncompressed.  An empty "graph_handle" means the graph is unknown,
+  // in which case TOP_K compression is not applied.
+  bool Compress(const string& graph_handle, const string& edge_key,
+                const TensorCompression& options, const Tensor& val,
+                CompressedTensorContent* out);
+
+  // Drops the residuals of the edges of the graph "graph_handle".
+  void ClearResiduals(const string& graph_handle);
+
+  // Drops the residuals of all edges.
+  void ClearAllResiduals();
+
+ private:
+  struct Residual {
+    mutex mu;
+    Tensor val GUARDED_BY(mu);
+  };
+
+  std::shared_ptr<Residual> GetResidual(const string& graph_handle,
+                                        const string& edge_key);
+
+  mutex mu_;
+  // Indexed by graph handle and edge key.
+  std::unordered_map<string,
+                     std::unordered_map<string, std::shared_ptr<Residual>>>
+      residuals_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(TensorCompressor);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
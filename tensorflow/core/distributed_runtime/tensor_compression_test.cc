@@ -0,0 +1,259 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+Tensor Ramp(int64 n, float start, float step) {
+  Tensor val(DT_FLOAT, TensorShape({n}));
+  for (int64 i = 0; i < n; ++i) {
+    val.flat<float>()(i) = start + i * step;
+  }
+  return val;
+}
+
+TensorCompression Options(TensorCompression::Type type) {
+  TensorCompression options;
+  options.set_type(type);
+  options.set_min_bytes(1);
+  return options;
+}
+
+// Compresses and decompresses "val", and returns the result.
+Tensor RoundTrip(TensorCompressor* compressor, const TensorCompression& options,
+                 const Tensor& val, CompressedTensorContent* content) {
+  EXPECT_TRUE(compressor->Compress("graph", "edge", options, val, content));
+  Tensor result(DT_FLOAT, val.shape());
+  TF_EXPECT_OK(DecompressTensorContent(*content, &result));
+  return result;
+}
+
+TEST(TensorCompressionTest, FP16) {
+  TensorCompressor compressor;
+  CompressedTensorContent content;
+  Tensor val = Ramp(1000, -3.0f, 0.01f);
+  Tensor result = RoundTrip(&compressor, Options(TensorCompression::FP16), val,
+                            &content);
+  EXPECT_EQ(2000, content.content().size());
+  test::ExpectClose(val, result, 1e-3, 1e-3);
+}
+
+TEST(TensorCompressionTest, BFloat16) {
+  TensorCompressor compressor;
+  CompressedTensorContent content;
+  Tensor val = Ramp(1000, 1e-20f, 1e10f);
+  Tensor result = RoundTrip(&compressor, Options(TensorCompression::BFLOAT16),
+                            val, &content);
+  EXPECT_EQ(2000, content.content().size());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_NEAR(val.flat<float>()(i), result.flat<float>()(i),
+                std::abs(val.flat<float>()(i)) / 128);
+  }
+}
+
+TEST(TensorCompressionTest, Quantized8Bit) {
+  TensorCompressor compressor;
+  CompressedTensorContent content;
+  TensorCompression options = Options(TensorCompression::QUANTIZED_8BIT);
+  options.set_chunk_size(100);
+  // The chunks have very different ranges, and the last one is partial.
+  Tensor val(DT_FLOAT, TensorShape({250}));
+  for (int i = 0; i < 250; ++i) {
+    val.flat<float>()(i) = (i < 100 ? 0.001f : 100.0f) * (i % 10);
+  }
+  Tensor result = RoundTrip(&compressor, options, val, &content);
+  EXPECT_EQ(100, content.chunk_size());
+  EXPECT_EQ(3 * 8 + 250, content.content().size());
+  for (int i = 0; i < 250; ++i) {
+    const float range = i < 100 ? 0.009f : 900.0f;
+    EXPECT_NEAR(val.flat<float>()(i), result.flat<float>()(i), range / 510);
+  }
+}
+
+TEST(TensorCompressionTest, QuantizedConstantChunk) {
+  TensorCompressor compressor;
+  CompressedTensorContent content;
+  Tensor val(DT_FLOAT, TensorShape({10}));
+  val.flat<float>().setConstant(-2.5f);
+  Tensor result = RoundTrip(
+      &compressor, Options(TensorCompression::QUANTIZED_8BIT), val, &content);
+  test::ExpectTensorEqual<float>(val, result);
+}
+
+TEST(TensorCompressionTest, QuantizedNonFiniteIsNotCompressed) {
+  TensorCompressor compressor;
+  CompressedTensorContent content;
+  Tensor val = Ramp(10, 0, 1);
+  val.flat<float>()(3) = std::numeric_limits<float>::infinity();
+  EXPECT_FALSE(compressor.Compress("graph", "edge",
+                                   Options(TensorCompression::QUANTIZED_8BIT),
+                                   val, &content));
+}
+
+TEST(TensorCompressionTest, TopKAccumulatesResidual) {
+  TensorCompressor compressor;
+  TensorCompression options = Options(TensorCompression::TOP_K);
+  options.set_top_k_fraction(0.25f);
+
+  // Each step sends the two largest values of the tensor plus the residual
+  // of the previous steps.
+  Tensor val = Ramp(8, 1.0f, 1.0f);
+  const std::vector<Tensor> expected = {
+      test::AsTensor<float>({0, 0, 0, 0, 0, 0, 7, 8}, {8}),
+      test::AsTensor<float>({0, 0, 0, 0, 10, 12, 0, 0}, {8}),
+      test::AsTensor<float>({0, 0, 0, 0, 0, 0, 14, 16}, {8})};
+  for (const Tensor& step_expected : expected) {
+    CompressedTensorContent content;
+    Tensor result = RoundTrip(&compressor, options, val, &content);
+    EXPECT_EQ(4 + 2 * 8, content.content().size());
+    test::ExpectTensorEqual<float>(step_expected, result);
+  }
+
+  // Once the residual is dropped, the next step starts over.
+  compressor.ClearResiduals("graph");
+  CompressedTensorContent content;
+  test::ExpectTensorEqual<float>(expected[0],
+                                 RoundTrip(&compressor, options, val, &content));
+}
+
+TEST(TensorCompressionTest, TopKResidualsArePerEdge) {
+  TensorCompressor compressor;
+  TensorCompression options = Options(TensorCompression::TOP_K);
+  options.set_top_k_fraction(0.5f);
+  Tensor val = test::AsTensor<float>({1, -4, 3, 2}, {4});
+
+  CompressedTensorContent content;
+  ASSERT_TRUE(compressor.Compress("graph", "a", options, val, &content));
+  Tensor result(DT_FLOAT, val.shape());
+  TF_ASSERT_OK(DecompressTensorContent(content, &result));
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, -4, 3, 0}, {4}),
+                                 result);
+
+  // Edge "a" still holds 1 and 2, edge "b" holds nothing.
+  ASSERT_TRUE(compressor.Compress("graph", "a", options, val, &content));
+  TF_ASSERT_OK(DecompressTensorContent(content, &result));
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, -4, 0, 4}, {4}),
+                                 result);
+  ASSERT_TRUE(compressor.Compress("graph", "b", options, val, &content));
+  TF_ASSERT_OK(DecompressTensorContent(content, &result));
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, -4, 3, 0}, {4}),
+                                 result);
+}
+
+TEST(TensorCompressionTest, TopKResidualsArePerGraph) {
+  TensorCompressor compressor;
+  TensorCompression options = Options(TensorCompression::TOP_K);
+  options.set_top_k_fraction(0.5f);
+  Tensor val = test::AsTensor<float>({1, -4, 3, 2}, {4});
+  const Tensor first = test::AsTensor<float>({0, -4, 3, 0}, {4});
+
+  // Graphs "g1" and "g2" have an edge of the same name, with separate
+  // residuals.
+  CompressedTensorContent content;
+  Tensor result(DT_FLOAT, val.shape());
+  for (const string& graph : {"g1", "g2"}) {
+    ASSERT_TRUE(compressor.Compress(graph, "a", options, val, &content));
+    TF_ASSERT_OK(DecompressTensorContent(content, &result));
+    test::ExpectTensorEqual<float>(first, result);
+  }
+
+  // Dropping the residuals of "g1" leaves those of "g2".
+  compressor.ClearResiduals("g1");
+  ASSERT_TRUE(compressor.Compress("g1", "a", options, val, &content));
+  TF_ASSERT_OK(DecompressTensorContent(content, &result));
+  test::ExpectTensorEqual<float>(first, result);
+  ASSERT_TRUE(compressor.Compress("g2", "a", options, val, &content));
+  TF_ASSERT_OK(DecompressTensorContent(content, &result));
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, -4, 0, 4}, {4}),
+                                 result);
+
+  // Without a graph, the residual cannot be kept.
+  EXPECT_FALSE(compressor.Compress("", "a", options, val, &content));
+}
+
+TEST(TensorCompressionTest, TopKRequiresEdgeNameFilter) {
+  TensorCompression options = Options(TensorCompression::TOP_K);
+  EXPECT_TRUE(errors::IsInvalidArgument(ValidateTensorCompression(options)));
+  EXPECT_FALSE(ShouldCompressEdge(options, "edge_7_gradients/w"));
+  options.add_edge_name_filter("gradients/");
+  TF_EXPECT_OK(ValidateTensorCompression(options));
+  EXPECT_TRUE(ShouldCompressEdge(options, "edge_7_gradients/w"));
+  EXPECT_FALSE(ShouldCompressEdge(options, "edge_8_w/read"));
+  TF_EXPECT_OK(ValidateTensorCompression(Options(TensorCompression::FP16)));
+}
+
+TEST(TensorCompressionTest, UncompressedTensors) {
+  TensorCompressor compressor;
+  CompressedTensorContent content;
+  TensorCompression options = Options(TensorCompression::FP16);
+  EXPECT_FALSE(compressor.Compress(
+      "graph", "edge", options, test::AsTensor<int32>({1, 2, 3}), &content));
+  options.set_min_bytes(100);
+  EXPECT_FALSE(
+      compressor.Compress("graph", "edge", options, Ramp(24, 0, 1), &content));
+  EXPECT_TRUE(
+      compressor.Compress("graph", "edge", options, Ramp(25, 0, 1), &content));
+  EXPECT_FALSE(compressor.Compress("graph", "edge",
+                                   Options(TensorCompression::NONE),
+                                   Ramp(100, 0, 1), &content));
+}
+
+TEST(TensorCompressionTest, ShouldCompressEdge) {
+  TensorCompression options;
+  EXPECT_FALSE(ShouldCompressEdge(options, "edge_1_x"));
+  options.set_type(TensorCompression::BFLOAT16);
+  EXPECT_TRUE(ShouldCompressEdge(options, "edge_1_x"));
+  options.add_edge_name_filter("gradients/");
+  EXPECT_FALSE(ShouldCompressEdge(options, "edge_1_x"));
+  EXPECT_TRUE(ShouldCompressEdge(options, "edge_7_gradients/MatMul_grad"));
+}
+
+TEST(TensorCompressionTest, DecompressRejectsCorruptContent) {
+  Tensor dst(DT_FLOAT, TensorShape({4}));
+  CompressedTensorContent content;
+  content.set_type(TensorCompression::FP16);
+  content.set_content(string(6, 0));
+  EXPECT_FALSE(DecompressTensorContent(content, &dst).ok());
+
+  content.set_type(TensorCompression::QUANTIZED_8BIT);
+  content.set_content(string(12, 0));
+  EXPECT_FALSE(DecompressTensorContent(content, &dst).ok());
+  content.set_chunk_size(4);
+  TF_EXPECT_OK(DecompressTensorContent(content, &dst));
+
+  // One value at index 9.
+  content.set_type(TensorCompression::TOP_K);
+  string top_k = {1, 0, 0, 0, 9, 0, 0, 0, 0, 0, 0, 0};
+  content.set_content(top_k);
+  EXPECT_FALSE(DecompressTensorContent(content, &dst).ok());
+  top_k[4] = 3;
+  content.set_content(top_k);
+  TF_EXPECT_OK(DecompressTensorContent(content, &dst));
+  content.set_content(top_k.substr(0, 10));
+  EXPECT_FALSE(DecompressTensorContent(content, &dst).ok());
+
+  Tensor ints(DT_INT32, TensorShape({4}));
+  EXPECT_FALSE(DecompressTensorContent(content, &ints).ok());
+}
+
+}  // namespace
+}  // namespace tensorflow
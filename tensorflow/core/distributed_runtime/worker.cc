@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/worker.h"
 
+#include <unordered_set>
+
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
@@ -185,7 +187,8 @@ void Worker::DoRunGraph(CallOptions* opts, RunGraphRequestWrapper* request,
   StepStatsCollector* collector = nullptr;
   if (request->exec_opts().record_timeline() ||
       request->exec_opts().record_costs()) {
-    collector = new StepStatsCollector(response->mutable_step_stats());
+    collector = new StepStatsCollector(response->mutable_step_stats(),
+                                       true /* buffered */);
     // TODO(mrry,pbar): GPU tracing for distributed steps.
   }
   CancellationManager* cm = new CancellationManager;
@@ -342,6 +345,26 @@ void Worker::CleanupGraphAsync(const CleanupGraphRequest* request,
                                StatusCallback done) {
   const int64 step_id = request->step_id();
   env_->rendezvous_mgr->Cleanup(step_id);
+  {
+    // Drops the tensors that no RecvTensors call is waiting for. The others
+    // are dropped when their calls respond, with the error that the
+    // cleanup above delivers to them.
+    mutex_lock l(recv_tensors_mu_);
+    auto step = recv_tensors_.find(step_id);
+    if (step != recv_tensors_.end()) {
+      auto& items = step->second;
+      for (auto it = items.begin(); it != items.end();) {
+        if (it->second.call == nullptr) {
+          it = items.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      if (items.empty()) {
+        recv_tensors_.erase(step);
+      }
+    }
+  }
   done(Status::OK());
 }
 
@@ -394,4 +417,224 @@ void Worker::RecvTensorAsync(CallOptions* opts,
   done(errors::Unimplemented("Worker::RecvTensorAsync()"));
 }
 
+struct Worker::RecvTensorsCall {
+  int64 step_id;
+  CallOptions* opts;
+  const RecvTensorsRequest* request;
+  RecvTensorsResponse* response;
+  StatusCallback done;
+  // True while RecvTensorsAsync() is still requesting the tensors, so that
+  // all the tensors that are ready at once go into the same response.
+  bool starting = true;
+  bool finished = false;
+};
+
+// RecvTensors returns as soon as any of the requested tensors is ready,
+// rather than when all of them are: the producer of one tensor may depend on
+// the caller having received another. The tensors that are not ready yet
+// are received into recv_tensors_ and returned by a later call.
+void Worker::RecvTensorsAsync(CallOptions* opts,
+                              const RecvTensorsRequest* request,
+                              RecvTensorsResponse* response,
+                              StatusCallback done) {
+  const int64 step_id = request->step_id();
+  const int num_keys = request->rendezvous_key_size();
+  TRACEPRINTF("RecvTensors: %lld %d", step_id, num_keys);
+  if (num_keys == 0) {
+    done(errors::InvalidArgument("RecvTensors requires at least one key"));
+    return;
+  }
+  std::vector<Rendezvous::ParsedKey> parsed(num_keys);
+  std::vector<Device*> src_devs(num_keys);
+  std::unordered_set<StringPiece, StringPiece::Hasher> seen;
+  for (int i = 0; i < num_keys; ++i) {
+    const string& key = request->rendezvous_key(i);
+    Status s = Rendezvous::ParseKey(key, &parsed[i]);
+    if (s.ok()) {
+      s = PrepareRecvTensor(parsed[i], &src_devs[i]);
+    }
+    if (s.ok() && !seen.insert(key).second) {
+      s = errors::InvalidArgument("Duplicated key in RecvTensors: ", key);
+    }
+    if (!s.ok()) {
+      done(s);
+      return;
+    }
+  }
+
+  std::shared_ptr<RecvTensorsCall> call(new RecvTensorsCall);
+  call->step_id = step_id;
+  call->opts = opts;
+  call->request = request;
+  call->response = response;
+  call->done = std::move(done);
+
+  // Only the tensors that no earlier call has requested are received from
+  // the rendezvous; the others are already in recv_tensors_.
+  std::vector<int> to_recv;
+  {
+    mutex_lock l(recv_tensors_mu_);
+    auto& items = recv_tensors_[step_id];
+    for (int i = 0; i < num_keys; ++i) {
+      auto it = items.emplace(request->rendezvous_key(i), RecvTensorsItem());
+      if (it.second) {
+        to_recv.push_back(i);
+      }
+      it.first->second.call = call;
+    }
+  }
+
+  opts->SetCancelCallback([this, step_id]() { AbortStep(step_id); });
+  for (int i : to_recv) {
+    const string key = request->rendezvous_key(i);
+    Device* src_dev = src_devs[i];
+    env_->rendezvous_mgr->RecvLocalAsync(
+        step_id, parsed[i],
+        [this, step_id, key, src_dev](const Status& status,
+                                      const Rendezvous::Args& send_args,
+                                      const Rendezvous::Args& recv_args,
+                                      const Tensor& val, const bool is_dead) {
+          Status s = status;
+          if (s.ok() && src_dev->tensorflow_gpu_device_info() &&
+              !send_args.alloc_attrs.on_host()) {
+            s = errors::InvalidArgument(
+                "RecvTensors requires tensors in host memory, but got ", key);
+          }
+          RecvTensorsItemReady(step_id, key, s, val, is_dead);
+        });
+  }
+  {
+    mutex_lock l(recv_tensors_mu_);
+    call->starting = false;
+  }
+  MaybeFinishRecvTensors(call);
+}
+
+void Worker::RecvTensorsItemReady(int64 step_id, const string& key,
+                                  const Status& status, const Tensor& val,
+                                  bool is_dead) {
+  std::shared_ptr<RecvTensorsCall> call;
+  {
+    mutex_lock l(recv_tensors_mu_);
+    auto step = recv_tensors_.find(step_id);
+    if (step == recv_tensors_.end()) {
+      return;  // The step has been cleaned up.
+    }
+    auto it = step->second.find(key);
+    if (it == step->second.end()) {
+      return;
+    }
+    RecvTensorsItem* item = &it->second;
+    item->ready = true;
+    item->status = status;
+    item->val = val;
+    item->is_dead = is_dead;
+    if (item->call != nullptr && !item->call->starting) {
+      call = item->call;
+    }
+  }
+  if (call != nullptr) {
+    // Responding from the compute pool, rather than on the producer's
+    // thread, also lets tensors produced at about the same time share the
+    // response.
+    env_->compute_pool->Schedule(
+        [this, call]() { MaybeFinishRecvTensors(call); });
+  }
+}
+
+void Worker::MaybeFinishRecvTensors(
+    const std::shared_ptr<RecvTensorsCall>& call) {
+  const RecvTensorsRequest* request = call->request;
+  std::vector<std::pair<int, RecvTensorsItem>> ready;
+  {
+    mutex_lock l(recv_tensors_mu_);
+    if (call->starting || call->finished) {
+      return;
+    }
+    // The step cannot have been removed, because the call's tensors are
+    // only removed from recv_tensors_ once the call has finished.
+    auto step = recv_tensors_.find(call->step_id);
+    CHECK(step != recv_tensors_.end());
+    auto& items = step->second;
+    for (int i = 0; i < request->rendezvous_key_size(); ++i) {
+      auto it = items.find(request->rendezvous_key(i));
+      if (it != items.end() && it->second.ready) {
+        ready.emplace_back(i, std::move(it->second));
+        items.erase(it);
+      }
+    }
+    if (ready.empty()) {
+      return;
+    }
+    // Tensors that become ready from now on are kept for a later call.
+    for (int i = 0; i < request->rendezvous_key_size(); ++i) {
+      auto it = items.find(request->rendezvous_key(i));
+      if (it != items.end() && it->second.call == call) {
+        it->second.call.reset();
+      }
+    }
+    if (items.empty()) {
+      recv_tensors_.erase(step);
+    }
+    call->finished = true;
+  }
+
+  call->opts->ClearCancelCallback();
+  Status s;
+  const int64 send_start_micros = Env::Default()->NowMicros();
+  for (auto& r : ready) {
+    const RecvTensorsItem& item = r.second;
+    if (!item.status.ok()) {
+      s = item.status;
+      break;
+    }
+    RecvTensorsResponse::Item* response_item = call->response->add_item();
+    response_item->set_key_index(r.first);
+    RecvTensorResponse* response = response_item->mutable_response();
+    response->set_is_dead(item.is_dead);
+    response->set_send_start_micros(send_start_micros);
+    if (!item.is_dead) {
+      item.val.AsProtoTensorContent(response->mutable_tensor());
+    }
+  }
+  if (!s.ok()) {
+    call->response->Clear();
+  }
+  call->done(s);
+}
+
+void Worker::PushTensorAsync(const PushTensorRequest* request,
+                             PushTensorResponse* response,
+                             StatusCallback done) {
+  const int64 step_id = request->step_id();
+  const string& key = request->rendezvous_key();
+  TRACEPRINTF("PushTensor: %lld %s", step_id, key.c_str());
+  Rendezvous::ParsedKey parsed;
+  Status s = Rendezvous::ParseKey(key, &parsed);
+  Device* dst_dev = nullptr;
+  if (s.ok()) {
+    s = env_->device_mgr->LookupDevice(parsed.dst_device, &dst_dev);
+  }
+  if (!s.ok()) {
+    done(s);
+    return;
+  }
+  // Pushed tensors always live in host memory.
+  Tensor val;
+  if (!request->is_dead()) {
+    AllocatorAttributes alloc_attrs;
+    alloc_attrs.set_on_host(true);
+    if (!val.FromProto(dst_dev->GetAllocator(alloc_attrs),
+                       request->tensor())) {
+      done(errors::InvalidArgument("Cannot parse pushed tensor ", key));
+      return;
+    }
+  }
+  bool accepted = false;
+  s = env_->rendezvous_mgr->RecvPushedTensor(step_id, parsed, val,
+                                             request->is_dead(), &accepted);
+  response->set_accepted(accepted);
+  done(s);
+}
+
 }  // namespace tensorflow
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef THIRD_PARTY_TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_WORKER_H_
 #define THIRD_PARTY_TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_WORKER_H_
 
+#include <memory>
 #include <unordered_map>
 
 #include "tensorflow/core/distributed_runtime/graph_mgr.h"
@@ -72,6 +73,14 @@ class Worker : public WorkerInterface {
   void RecvTensorAsync(CallOptions* opts, const RecvTensorRequest* request,
                        TensorResponse* response, StatusCallback done) override;
 
+  void RecvTensorsAsync(CallOptions* opts, const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override;
+
+  void PushTensorAsync(const PushTensorRequest* request,
+                       PushTensorResponse* response,
+                       StatusCallback done) override;
+
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
                     StatusCallback done) override;
 
@@ -110,6 +119,35 @@ class Worker : public WorkerInterface {
                      PairHash>
       partial_runs_ GUARDED_BY(mu_);
 
+  // A RecvTensors call that has not responded yet.
+  struct RecvTensorsCall;
+
+  // A tensor requested by a RecvTensors call. It is kept until it has been
+  // returned in a response, so that a response need not wait for all the
+  // requested tensors.
+  struct RecvTensorsItem {
+    bool ready = false;
+    Status status;
+    Tensor val;
+    bool is_dead = false;
+    // The call waiting for this tensor, if any.
+    std::shared_ptr<RecvTensorsCall> call;
+  };
+
+  mutex recv_tensors_mu_;
+  // Indexed by step id and rendezvous key.
+  std::unordered_map<int64, std::unordered_map<string, RecvTensorsItem>>
+      recv_tensors_ GUARDED_BY(recv_tensors_mu_);
+
+  // Records that the tensor for "key" has been received from the local
+  // rendezvous, and wakes up the call waiting for it.
+  void RecvTensorsItemReady(int64 step_id, const string& key,
+                            const Status& status, const Tensor& val,
+                            bool is_dead);
+
+  // Responds to "call" if any of its tensors is ready.
+  void MaybeFinishRecvTensors(const std::shared_ptr<RecvTensorsCall>& call);
+
   PartialRunState* FindPartialRun(const string& graph_handle, int step_id);
 
   void InsertPartialRunLocked(const string& graph_handle, int step_id,
@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/call_options.h"
 #include "tensorflow/core/distributed_runtime/message_wrappers.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/types.h"
@@ -98,6 +99,32 @@ class WorkerInterface {
                                TensorResponse* response,
                                StatusCallback done) = 0;
 
+  // Receives several host-memory tensors of one step. Unlike
+  // RecvTensorAsync(), this calls `done` as soon as at least one of the
+  // tensors is ready, and the response holds only the ready tensors; see
+  // `RecvTensorsResponse` in worker.proto.
+  //
+  // Implementations that do not support this method return UNIMPLEMENTED,
+  // and callers fall back to RecvTensorAsync().
+  virtual void RecvTensorsAsync(CallOptions* opts,
+                                const RecvTensorsRequest* request,
+                                RecvTensorsResponse* response,
+                                StatusCallback done) {
+    done(errors::Unimplemented("RecvTensorsAsync()"));
+  }
+
+  // Delivers a host-memory tensor to the worker that will receive it,
+  // before that worker asks for it; see `PushTensorRequest` in
+  // worker.proto.
+  //
+  // Implementations that do not support this method return UNIMPLEMENTED,
+  // and callers keep the tensor for a RecvTensor call.
+  virtual void PushTensorAsync(const PushTensorRequest* request,
+                               PushTensorResponse* response,
+                               StatusCallback done) {
+    done(errors::Unimplemented("PushTensorAsync()"));
+  }
+
   virtual void LoggingAsync(const LoggingRequest* request,
                             LoggingResponse* response, StatusCallback done) = 0;
 
@@ -15,12 +15,16 @@ limitations under the License.
 
 #include "tensorflow/core/framework/allocator.h"
 
+#include <vector>
+
 #include "tensorflow/core/framework/allocator_registry.h"
 #include "tensorflow/core/framework/log_memory.h"
 #include "tensorflow/core/framework/tracking_allocator.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
@@ -62,14 +66,22 @@ void EnableCPUAllocatorFullStats(bool enable) {
 
 class CPUAllocator : public Allocator {
  public:
-  CPUAllocator() {}
+  // If 'numa_node' is not port::kNUMANoAffinity, memory is requested from
+  // that NUMA node.
+  explicit CPUAllocator(int numa_node = port::kNUMANoAffinity)
+      : numa_node_(numa_node) {}
 
   ~CPUAllocator() override {}
 
-  string Name() override { return "cpu"; }
+  string Name() override {
+    if (numa_node_ == port::kNUMANoAffinity) return "cpu";
+    return strings::StrCat("cpu_numa", numa_node_);
+  }
 
   void* AllocateRaw(size_t alignment, size_t num_bytes) override {
-    void* p = port::AlignedMalloc(num_bytes, alignment);
+    void* p = numa_node_ == port::kNUMANoAffinity
+                  ? port::AlignedMalloc(num_bytes, alignment)
+                  : port::NUMAMalloc(numa_node_, num_bytes, alignment);
     if (cpu_allocator_collect_stats) {
       const std::size_t alloc_size = port::MallocExtension_GetAllocatedSize(p);
       mutex_lock l(mu_);
@@ -90,7 +102,11 @@ class CPUAllocator : public Allocator {
       mutex_lock l(mu_);
       stats_.bytes_in_use -= alloc_size;
     }
-    port::AlignedFree(ptr);
+    if (numa_node_ == port::kNUMANoAffinity) {
+      port::AlignedFree(ptr);
+    } else {
+      port::NUMAFree(ptr);
+    }
   }
 
   void GetStats(AllocatorStats* stats) override {
@@ -103,6 +119,7 @@ class CPUAllocator : public Allocator {
   }
 
  private:
+  const int numa_node_;
   mutex mu_;
   AllocatorStats stats_ GUARDED_BY(mu_);
 
@@ -110,8 +127,8 @@ class CPUAllocator : public Allocator {
 };
 
 namespace {
-Allocator* MakeCpuAllocator() {
-  Allocator* allocator = new CPUAllocator;
+Allocator* MakeCpuAllocator(int numa_node) {
+  Allocator* allocator = new CPUAllocator(numa_node);
   if (cpu_allocator_collect_full_stats || LogMemory::IsEnabled()) {
     allocator = new TrackingAllocator(allocator, true);
   }
@@ -127,6 +144,22 @@ Allocator* cpu_allocator() {
   return cpu_alloc;
 }
 
+Allocator* cpu_allocator(int numa_node) {
+  if (numa_node == port::kNUMANoAffinity || !port::NUMAEnabled()) {
+    return cpu_allocator();
+  }
+  static mutex mu(LINKER_INITIALIZED);
+  static std::vector<Allocator*>* numa_allocators =
+      new std::vector<Allocator*>;
+  mutex_lock l(mu);
+  if (numa_node >= static_cast<int>(numa_allocators->size())) {
+    numa_allocators->resize(numa_node + 1, nullptr);
+  }
+  Allocator*& allocator = (*numa_allocators)[numa_node];
+  if (allocator == nullptr) allocator = MakeCpuAllocator(numa_node);
+  return allocator;
+}
+
 REGISTER_MEM_ALLOCATOR("DefaultCPUAllocator", 100, CPUAllocator);
 
 }  // namespace tensorflow
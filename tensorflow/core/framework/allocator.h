@@ -303,6 +303,11 @@ struct AllocatorAttributes {
 // default malloc. The returned allocator is a process singleton.
 Allocator* cpu_allocator();
 
+// Returns a process-wide allocator whose memory is placed on the given
+// NUMA node.  Falls back to cpu_allocator() if 'numa_node' is
+// port::kNUMANoAffinity or the platform has a single NUMA node.
+Allocator* cpu_allocator(int numa_node);
+
 // If 'enable' is true, the process-wide cpu allocator collects
 // AllocatorStats. By default, it's disabled.
 void EnableCPUAllocatorStats(bool enable);
@@ -64,13 +64,26 @@ struct DupRecvKeyEq {
   }
 };
 
-// struct used to store the recvs, so that start times can be properly updated
+// struct used to store the recvs, so that start times and priorities can be
+// properly updated
 struct RecvInfo {
+  NodeDef* send;
   NodeDef* recv;
   NodeDef* real_recv;
   int64 start_time;
+  int64 priority;
 };
 
+// Sets the "_priority" attribute of the send/recv pair.
+void AddPriority(int64 priority, NodeDef* send, NodeDef* recv,
+                 NodeDef* real_recv) {
+  AddNodeAttr("_priority", priority, send);
+  AddNodeAttr("_priority", priority, recv);
+  if (real_recv != recv) {
+    AddNodeAttr("_priority", priority, real_recv);
+  }
+}
+
 typedef std::unordered_map<DupRecvKey, RecvInfo, DupRecvKeyHash, DupRecvKeyEq>
     DupRecvTable;
 
@@ -913,6 +926,13 @@ Status Partition(const PartitionOptions& opts, Graph* g,
           }
         }
       }
+      // The nodes added by AddControlFlow() have no slack, and take the
+      // highest priority.
+      const int64 priority =
+          opts.need_to_record_priorities &&
+                  dst->id() < static_cast<int>(opts.node_slacks.size())
+              ? opts.node_slacks[dst->id()]
+              : 0;
 
       // Check whether there is already a send/recv pair transferring
       // the same tensor/control from the src to dst partition.
@@ -935,6 +955,10 @@ Status Partition(const PartitionOptions& opts, Graph* g,
         if (iter->second.start_time > recv_start_time) {
           iter->second.start_time = recv_start_time;
         }
+        // Likewise, the transfer is as urgent as its most urgent consumer.
+        if (iter->second.priority > priority) {
+          iter->second.priority = priority;
+        }
         continue;
       }
 
@@ -989,6 +1013,9 @@ Status Partition(const PartitionOptions& opts, Graph* g,
         if (real_recv != recv) {
           AddNodeAttr("_start_time", recv_start_time, real_recv);
         }
+        if (opts.need_to_record_priorities) {
+          AddPriority(priority, send, recv, real_recv);
+        }
         // If src is of ref type and the edge is not a control edge, dst has
         // read semantics and therefore we must control the recv.
         ref_recvs.push_back(real_recv);
@@ -996,7 +1023,7 @@ Status Partition(const PartitionOptions& opts, Graph* g,
         // Memorize the send/recv pair, only if this is not a "ref" edge.
         // NOTE(yuanbyu): Collapsing ref edges requires extreme care so
         // for now we don't do it.
-        dup_recv[key] = {recv, real_recv, recv_start_time};
+        dup_recv[key] = {send, recv, real_recv, recv_start_time, priority};
         ref_control_inputs.push_back(recv->name());
       }
 
@@ -1042,6 +1069,12 @@ Status Partition(const PartitionOptions& opts, Graph* g,
       }
     }
   }
+  if (opts.need_to_record_priorities) {
+    for (auto& it : dup_recv) {
+      AddPriority(it.second.priority, it.second.send, it.second.recv,
+                  it.second.real_recv);
+    }
+  }
 
   VLOG(1) << "Added send/recv: controls=" << num_control
           << ", data=" << num_data;
@@ -71,6 +71,15 @@ struct PartitionOptions {
   // in the graph as a node attribute.
   bool need_to_record_start_times = false;
   std::vector<Microseconds> start_times;
+
+  // If 'need_to_record_priorities' is true, each send and recv is given a
+  // "_priority" attribute, the smallest slack in 'node_slacks' of the nodes
+  // consuming the tensor it transfers. 'node_slacks' is indexed by node id,
+  // as computed by SlackAnalysis::ComputeSlack before partitioning; the
+  // nodes added for control flow by Partition() get priority 0. Executors
+  // start the ready nodes with the smallest priority first.
+  bool need_to_record_priorities = false;
+  std::vector<int64> node_slacks;
 };
 
 // Partition "input" graph into a set of graphs, one per location.
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/control_flow_ops_internal.h"
 #include "tensorflow/cc/ops/random_ops.h"
 #include "tensorflow/cc/ops/sendrecv_ops.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/graph/equal_graph_def.h"
 #include "tensorflow/core/graph/graph.h"
@@ -30,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/graph/graph_def_builder.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
@@ -374,6 +376,112 @@ TEST_F(GraphPartitionTest, CrossDeviceLoop1) {
   }
 }
 
+TEST_F(GraphPartitionTest, TransferPriorities) {
+  auto a1 = FloatInput(in_.WithOpName("A1"));
+  auto a2 = FloatInput(in_.WithOpName("A2"));
+  auto b1 = FloatInput(in_.WithOpName("B1"));
+  Combine(in_.WithOpName("B2"), a1, b1);
+  Combine(in_.WithOpName("B3"), a1, a2);
+
+  Graph g(OpRegistry::Global());
+  TF_ASSERT_OK(ConvertGraphDefToGraph(GraphConstructorOptions(), ToGraphDef(),
+                                      &g));
+  for (Node* node : g.nodes()) {
+    node->set_assigned_device_name(DeviceName(node));
+  }
+  PartitionOptions popts;
+  popts.node_to_loc = SplitByDevice;
+  popts.new_name = [&g](const string& prefix) { return g.NewName(prefix); };
+  popts.get_incarnation = [](const string& name) {
+    return (name[0] - 'A') + 100;
+  };
+  popts.need_to_record_priorities = true;
+  // The slack of "B3" is 30, and that of the other nodes 20.
+  popts.node_slacks.resize(g.num_node_ids(), 20);
+  for (const Node* node : g.nodes()) {
+    if (node->name() == "B3") popts.node_slacks[node->id()] = 30;
+  }
+  TF_ASSERT_OK(Partition(popts, &g, &partitions_));
+  EXPECT_EQ(2, partitions_.size());
+
+  // Every send and recv takes the smallest slack of the consumers of its
+  // tensor, and the other nodes have no priority.
+  std::unordered_map<string, int64> priorities;
+  for (const auto& kv : partitions_) {
+    for (const NodeDef& ndef : kv.second.node()) {
+      int64 priority;
+      if (GetNodeAttr(ndef, "_priority", &priority).ok()) {
+        EXPECT_TRUE(ndef.op() == "_Send" || ndef.op() == "_Recv")
+            << ndef.DebugString();
+        string tensor_name;
+        TF_ASSERT_OK(GetNodeAttr(ndef, "tensor_name", &tensor_name));
+        priorities[strings::StrCat(ndef.op(), ":", tensor_name)] = priority;
+      }
+    }
+  }
+  ASSERT_EQ(4, priorities.size());
+  for (const auto& kv : priorities) {
+    if (StringPiece(kv.first).ends_with("_A1")) {
+      EXPECT_EQ(20, kv.second) << kv.first;
+    } else {
+      EXPECT_TRUE(StringPiece(kv.first).ends_with("_A2")) << kv.first;
+      EXPECT_EQ(30, kv.second) << kv.first;
+    }
+  }
+}
+
+TEST_F(GraphPartitionTest, TransferPrioritiesInLoop) {
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+  auto a1 = BoolInput(in_.WithOpName("A1"));
+  auto a2 = ::tensorflow::ops::internal::Enter(in_.WithOpName("A2"), a1, "foo");
+  auto a3 = ::tensorflow::ops::Merge(in_.WithOpName("A3"),
+                                     {a2, Input("A5", 0, DT_BOOL)})
+                .output;
+  LoopCond(in_.WithOpName("A4"), a3);
+  auto b1 = Identity(in_.WithOpName("B1"), a3);
+  NextIteration(in_.WithOpName("A5"), b1);
+
+  Graph g(OpRegistry::Global());
+  TF_ASSERT_OK(ConvertGraphDefToGraph(GraphConstructorOptions(), ToGraphDef(),
+                                      &g));
+  for (Node* node : g.nodes()) {
+    node->set_assigned_device_name(DeviceName(node));
+  }
+  PartitionOptions popts;
+  popts.node_to_loc = SplitByDevice;
+  popts.new_name = [&g](const string& prefix) { return g.NewName(prefix); };
+  popts.get_incarnation = [](const string& name) {
+    return (name[0] - 'A') + 100;
+  };
+  popts.need_to_record_priorities = true;
+  // The slacks only cover the nodes of the original graph, and not the
+  // control loops Partition() adds for the cross-device frame.
+  popts.node_slacks.resize(g.num_node_ids(), 20);
+  TF_ASSERT_OK(Partition(popts, &g, &partitions_));
+  EXPECT_EQ(2, partitions_.size());
+
+  // The transfers of "A3" and "B1" take the slack of their consumers, and
+  // those feeding the added control loop nodes have priority 0.
+  int num_loop_transfers = 0;
+  for (const auto& kv : partitions_) {
+    for (const NodeDef& ndef : kv.second.node()) {
+      if (ndef.op() != "_Send" && ndef.op() != "_Recv") continue;
+      int64 priority;
+      TF_ASSERT_OK(GetNodeAttr(ndef, "_priority", &priority));
+      string tensor_name;
+      TF_ASSERT_OK(GetNodeAttr(ndef, "tensor_name", &tensor_name));
+      if (StringPiece(tensor_name).ends_with("_A3") ||
+          StringPiece(tensor_name).ends_with("_B1")) {
+        EXPECT_EQ(20, priority) << tensor_name;
+      } else {
+        EXPECT_EQ(0, priority) << tensor_name;
+        ++num_loop_transfers;
+      }
+    }
+  }
+  EXPECT_GT(num_loop_transfers, 0);
+}
+
 TEST_F(GraphPartitionTest, PartitionIncompleteGraph) {
   NodeDef ndef;
   Graph g(OpRegistry::Global());
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 
 // See docs in ../ops/parsing_ops.cc.
+#include <string.h>
+#include <deque>
 #include <vector>
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -21,6 +23,8 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -60,178 +64,213 @@ class DecodeCSVOp : public OpKernel {
     OpOutputList output;
     OP_REQUIRES_OK(ctx, ctx->output_list("output", &output));
 
+    std::vector<Tensor*> outputs(out_type_.size());
     for (int i = 0; i < static_cast<int>(out_type_.size()); ++i) {
-      Tensor* out = nullptr;
-      OP_REQUIRES_OK(ctx, output.allocate(i, records->shape(), &out));
+      OP_REQUIRES_OK(ctx, output.allocate(i, records->shape(), &outputs[i]));
     }
 
-    for (int64 i = 0; i < records_size; ++i) {
-      const StringPiece record(records_t(i));
-      std::vector<string> fields;
-      ExtractFields(ctx, record, &fields);
-      OP_REQUIRES(ctx, fields.size() == out_type_.size(),
-                  errors::InvalidArgument("Expect ", out_type_.size(),
-                                          " fields but have ", fields.size(),
-                                          " in record ", i));
-
-      // Check each field in the record
-      for (int f = 0; f < static_cast<int>(out_type_.size()); ++f) {
-        const DataType& dtype = out_type_[f];
-        switch (dtype) {
-          case DT_INT32: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-
-              output[f]->flat<int32>()(i) = record_defaults[f].flat<int32>()(0);
-            } else {
-              int32 value;
-              OP_REQUIRES(ctx, strings::safe_strto32(fields[f], &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid int32: ",
-                                                  fields[f]));
-              output[f]->flat<int32>()(i) = value;
-            }
-            break;
+    // Records are parsed independently on the worker threads.  To report the
+    // same error as a sequential parse, only the error in the first invalid
+    // record is kept.
+    mutex mu;
+    int64 first_error_record = records_size;
+    Status first_error;
+    auto parse_records = [&](int64 start, int64 limit) {
+      std::vector<StringPiece> fields;
+      std::deque<string> unescaped_fields;
+      for (int64 i = start; i < limit; ++i) {
+        Status s = ParseRecord(i, records_t(i), record_defaults, outputs,
+                               &fields, &unescaped_fields);
+        if (!s.ok()) {
+          mutex_lock l(mu);
+          if (i < first_error_record) {
+            first_error_record = i;
+            first_error = s;
           }
-          case DT_INT64: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-
-              output[f]->flat<int64>()(i) = record_defaults[f].flat<int64>()(0);
-            } else {
-              int64 value;
-              OP_REQUIRES(ctx, strings::safe_strto64(fields[f], &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid int64: ",
-                                                  fields[f]));
-              output[f]->flat<int64>()(i) = value;
-            }
+          return;
+        }
+      }
+    };
+    // Parsing a numeric field takes on the order of a hundred cycles.
+    const int64 cost_per_record = 100 * out_type_.size() + 1;
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers, records_size,
+          cost_per_record, parse_records);
+    OP_REQUIRES_OK(ctx, first_error);
+  }
+
+ private:
+  std::vector<DataType> out_type_;
+  char delim_;
+
+  // Parses the i-th record into the i-th element of each output.
+  Status ParseRecord(int64 i, StringPiece record,
+                     const OpInputList& record_defaults,
+                     const std::vector<Tensor*>& outputs,
+                     std::vector<StringPiece>* fields,
+                     std::deque<string>* unescaped_fields) const {
+    fields->clear();
+    if (!unescaped_fields->empty()) unescaped_fields->clear();
+    TF_RETURN_IF_ERROR(ExtractFields(record, fields, unescaped_fields));
+    if (fields->size() != out_type_.size()) {
+      return errors::InvalidArgument("Expect ", out_type_.size(),
+                                     " fields but have ", fields->size(),
+                                     " in record ", i);
+    }
+
+    // Check each field in the record
+    for (int f = 0; f < static_cast<int>(out_type_.size()); ++f) {
+      const StringPiece field = (*fields)[f];
+      Tensor* out = outputs[f];
+
+      // If this field is empty, check if default is given:
+      // If yes, use default value; Otherwise report error.
+      if (field.empty()) {
+        if (record_defaults[f].NumElements() != 1) {
+          return errors::InvalidArgument(
+              "Field ", f, " is required but missing in record ", i, "!");
+        }
+        switch (out_type_[f]) {
+          case DT_INT32:
+            out->flat<int32>()(i) = record_defaults[f].flat<int32>()(0);
             break;
-          }
-          case DT_FLOAT: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-              output[f]->flat<float>()(i) = record_defaults[f].flat<float>()(0);
-            } else {
-              float value;
-              OP_REQUIRES(ctx, strings::safe_strtof(fields[f].c_str(), &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid float: ",
-                                                  fields[f]));
-              output[f]->flat<float>()(i) = value;
-            }
+          case DT_INT64:
+            out->flat<int64>()(i) = record_defaults[f].flat<int64>()(0);
             break;
-          }
-          case DT_STRING: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-              output[f]->flat<string>()(i) =
-                  record_defaults[f].flat<string>()(0);
-            } else {
-              output[f]->flat<string>()(i) = fields[f];
-            }
+          case DT_FLOAT:
+            out->flat<float>()(i) = record_defaults[f].flat<float>()(0);
+            break;
+          case DT_STRING:
+            out->flat<string>()(i) = record_defaults[f].flat<string>()(0);
             break;
-          }
           default:
-            OP_REQUIRES(ctx, false,
-                        errors::InvalidArgument("csv: data type ", dtype,
-                                                " not supported in field ", f));
+            return errors::InvalidArgument("csv: data type ", out_type_[f],
+                                           " not supported in field ", f);
+        }
+        continue;
+      }
+
+      switch (out_type_[f]) {
+        case DT_INT32: {
+          int32 value;
+          if (!strings::safe_strto32(field, &value)) {
+            return errors::InvalidArgument("Field ", f, " in record ", i,
+                                           " is not a valid int32: ", field);
+          }
+          out->flat<int32>()(i) = value;
+          break;
         }
+        case DT_INT64: {
+          int64 value;
+          if (!strings::safe_strto64(field, &value)) {
+            return errors::InvalidArgument("Field ", f, " in record ", i,
+                                           " is not a valid int64: ", field);
+          }
+          out->flat<int64>()(i) = value;
+          break;
+        }
+        case DT_FLOAT: {
+          float value;
+          if (!strings::safe_strtof(field, &value)) {
+            return errors::InvalidArgument("Field ", f, " in record ", i,
+                                           " is not a valid float: ", field);
+          }
+          out->flat<float>()(i) = value;
+          break;
+        }
+        case DT_STRING:
+          out->flat<string>()(i).assign(field.data(), field.size());
+          break;
+        default:
+          return errors::InvalidArgument("csv: data type ", out_type_[f],
+                                         " not supported in field ", f);
       }
     }
+    return Status::OK();
   }
 
- private:
-  std::vector<DataType> out_type_;
-  char delim_;
-
-  void ExtractFields(OpKernelContext* ctx, StringPiece input,
-                     std::vector<string>* result) {
-    int64 current_idx = 0;
+  // Splits "input" into fields.  Fields point into "input", except for
+  // quoted fields containing escaped quotes, which are unescaped into
+  // "unescaped_fields".
+  Status ExtractFields(StringPiece input, std::vector<StringPiece>* result,
+                       std::deque<string>* unescaped_fields) const {
+    const char* const data = input.data();
+    const size_t size = input.size();
+    size_t current_idx = 0;
     if (!input.empty()) {
-      while (static_cast<size_t>(current_idx) < input.size()) {
-        if (input[current_idx] == '\n' || input[current_idx] == '\r') {
+      while (current_idx < size) {
+        if (data[current_idx] == '\n' || data[current_idx] == '\r') {
           current_idx++;
           continue;
         }
 
-        bool quoted = false;
-        if (input[current_idx] == '"') {
-          quoted = true;
-          current_idx++;
-        }
-
-        // This is the body of the field;
-        string field;
-        if (!quoted) {
-          while (static_cast<size_t>(current_idx) < input.size() &&
-                 input[current_idx] != delim_) {
-            OP_REQUIRES(ctx, input[current_idx] != '"' &&
-                                 input[current_idx] != '\n' &&
-                                 input[current_idx] != '\r',
-                        errors::InvalidArgument(
-                            "Unquoted fields cannot have quotes/CRLFs inside"));
-            field += input[current_idx];
-            current_idx++;
+        if (data[current_idx] != '"') {
+          // The body of an unquoted field extends to the next delimiter, or
+          // the end.  The loops below are written so that memchr and the
+          // compiler can vectorize them.
+          const char* delim = static_cast<const char*>(
+              memchr(data + current_idx, delim_, size - current_idx));
+          const size_t end = delim == nullptr ? size : delim - data;
+          bool has_special_chars = false;
+          for (size_t j = current_idx; j < end; ++j) {
+            const char c = data[j];
+            has_special_chars |= (c == '"') | (c == '\n') | (c == '\r');
           }
+          if (has_special_chars) {
+            return errors::InvalidArgument(
+                "Unquoted fields cannot have quotes/CRLFs inside");
+          }
+          result->emplace_back(data + current_idx, end - current_idx);
 
           // Go to next field or the end
-          current_idx++;
+          current_idx = end + 1;
         } else {
           // Quoted field needs to be ended with '"' and delim or end
-          while (
-              (static_cast<size_t>(current_idx) < input.size() - 1) &&
-              (input[current_idx] != '"' || input[current_idx + 1] != delim_)) {
-            if (input[current_idx] != '"') {
-              field += input[current_idx];
-              current_idx++;
-            } else {
-              OP_REQUIRES(
-                  ctx, input[current_idx + 1] == '"',
-                  errors::InvalidArgument("Quote inside a string has to be "
-                                          "escaped by another quote"));
-              field += '"';
-              current_idx += 2;
+          current_idx++;
+          const size_t start = current_idx;
+          bool has_escaped_quotes = false;
+          while (true) {
+            const char* quote = static_cast<const char*>(
+                memchr(data + current_idx, '"', size - current_idx));
+            if (quote == nullptr) {
+              return errors::InvalidArgument(
+                  "Quoted field has to end with quote followed by delim or "
+                  "end");
             }
+            current_idx = quote - data;
+            if (current_idx == size - 1 || data[current_idx + 1] == delim_) {
+              break;
+            }
+            if (data[current_idx + 1] != '"') {
+              return errors::InvalidArgument(
+                  "Quote inside a string has to be escaped by another quote");
+            }
+            has_escaped_quotes = true;
+            current_idx += 2;
           }
 
-          OP_REQUIRES(
-              ctx, (static_cast<size_t>(current_idx) < input.size() &&
-                    input[current_idx] == '"' &&
-                    (static_cast<size_t>(current_idx) == input.size() - 1 ||
-                     input[current_idx + 1] == delim_)),
-              errors::InvalidArgument("Quoted field has to end with quote "
-                                      "followed by delim or end"));
+          if (!has_escaped_quotes) {
+            result->emplace_back(data + start, current_idx - start);
+          } else {
+            unescaped_fields->emplace_back();
+            string* field = &unescaped_fields->back();
+            field->reserve(current_idx - start);
+            for (size_t j = start; j < current_idx; ++j) {
+              field->push_back(data[j]);
+              if (data[j] == '"') ++j;
+            }
+            result->emplace_back(*field);
+          }
 
           current_idx += 2;
         }
-
-        result->push_back(field);
       }
 
       // Check if the last field is missing
-      if (input[input.size() - 1] == delim_) result->push_back(string());
+      if (data[size - 1] == delim_) result->emplace_back();
     }
+    return Status::OK();
   }
 };
 
@@ -16,6 +16,7 @@ limitations under the License.
 // See docs in ../ops/image_ops.cc
 
 #include <memory>
+#include <vector>
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -24,9 +25,50 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/jpeg/jpeg_mem.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
+namespace {
+
+// Reads the attrs shared by the JPEG decoding ops, other than "channels",
+// into "flags".
+Status GetDecodeJpegAttrs(OpKernelConstruction* context,
+                          jpeg::UncompressFlags* flags) {
+  TF_RETURN_IF_ERROR(context->GetAttr("ratio", &flags->ratio));
+  if (flags->ratio != 1 && flags->ratio != 2 && flags->ratio != 4 &&
+      flags->ratio != 8) {
+    return errors::InvalidArgument("ratio must be 1, 2, 4, or 8, got ",
+                                   flags->ratio);
+  }
+  TF_RETURN_IF_ERROR(
+      context->GetAttr("fancy_upscaling", &flags->fancy_upscaling));
+  TF_RETURN_IF_ERROR(context->GetAttr("try_recover_truncated",
+                                      &flags->try_recover_truncated_jpeg));
+  TF_RETURN_IF_ERROR(context->GetAttr("acceptable_fraction",
+                                      &flags->min_acceptable_fraction));
+
+  string dct_method;
+  TF_RETURN_IF_ERROR(context->GetAttr("dct_method", &dct_method));
+  if (!(dct_method.empty() || dct_method == "INTEGER_FAST" ||
+        dct_method == "INTEGER_ACCURATE")) {
+    return errors::InvalidArgument(
+        "dct_method must be one of {'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}");
+  }
+  if (dct_method == "INTEGER_FAST") {
+    flags->dct_method = JDCT_IFAST;
+  } else if (dct_method == "INTEGER_ACCURATE") {
+    flags->dct_method = JDCT_ISLOW;
+  } else {
+    // The TensorFlow-chosen default is IFAST, sacrificing decoding
+    // image quality for speed.
+    flags->dct_method = JDCT_IFAST;
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
 // Decode the contents of a JPEG file
 class DecodeJpegOp : public OpKernel {
  public:
@@ -36,35 +78,7 @@ class DecodeJpegOp : public OpKernel {
                              flags_.components == 3,
                 errors::InvalidArgument("channels must be 0, 1, or 3, got ",
                                         flags_.components));
-    OP_REQUIRES_OK(context, context->GetAttr("ratio", &flags_.ratio));
-    OP_REQUIRES(context, flags_.ratio == 1 || flags_.ratio == 2 ||
-                             flags_.ratio == 4 || flags_.ratio == 8,
-                errors::InvalidArgument("ratio must be 1, 2, 4, or 8, got ",
-                                        flags_.ratio));
-    OP_REQUIRES_OK(
-        context, context->GetAttr("fancy_upscaling", &flags_.fancy_upscaling));
-    OP_REQUIRES_OK(context,
-                   context->GetAttr("try_recover_truncated",
-                                    &flags_.try_recover_truncated_jpeg));
-    OP_REQUIRES_OK(context, context->GetAttr("acceptable_fraction",
-                                             &flags_.min_acceptable_fraction));
-
-    string dct_method;
-    OP_REQUIRES_OK(context, context->GetAttr("dct_method", &dct_method));
-    OP_REQUIRES(
-        context, (dct_method.empty() || dct_method == "INTEGER_FAST" ||
-                  dct_method == "INTEGER_ACCURATE"),
-        errors::InvalidArgument("dct_method must be one of "
-                                "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
-    if (dct_method == "INTEGER_FAST") {
-      flags_.dct_method = JDCT_IFAST;
-    } else if (dct_method == "INTEGER_ACCURATE") {
-      flags_.dct_method = JDCT_ISLOW;
-    } else {
-      // The TensorFlow-chosen default is IFAST, sacrificing decoding
-      // image quality for speed.
-      flags_.dct_method = JDCT_IFAST;
-    }
+    OP_REQUIRES_OK(context, GetDecodeJpegAttrs(context, &flags_));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -101,4 +115,130 @@ class DecodeJpegOp : public OpKernel {
 };
 REGISTER_KERNEL_BUILDER(Name("DecodeJpeg").Device(DEVICE_CPU), DecodeJpegOp);
 
+// Decode a batch of JPEG files, optionally cropping them, in parallel.
+class DecodeJpegBatchOp : public OpKernel {
+ public:
+  explicit DecodeJpegBatchOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &flags_.components));
+    OP_REQUIRES(context, flags_.components == 1 || flags_.components == 3,
+                errors::InvalidArgument("channels must be 1 or 3, got ",
+                                        flags_.components));
+    OP_REQUIRES_OK(context, GetDecodeJpegAttrs(context, &flags_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& contents = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(contents.shape()),
+                errors::InvalidArgument("contents must be a vector, got shape ",
+                                        contents.shape().DebugString()));
+    const int64 batch_size = contents.dim_size(0);
+    const Tensor& crop_windows = context->input(1);
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsMatrix(crop_windows.shape()) &&
+                    crop_windows.dim_size(1) == 4 &&
+                    (crop_windows.dim_size(0) == batch_size ||
+                     crop_windows.dim_size(0) == 0),
+                errors::InvalidArgument(
+                    "crop_windows must have shape [", batch_size,
+                    ", 4] or [0, 4], got ",
+                    crop_windows.shape().DebugString()));
+    const bool crop = crop_windows.dim_size(0) > 0;
+    auto input = contents.vec<string>();
+    auto windows = crop_windows.matrix<int32>();
+    for (int64 i = 0; i < batch_size; ++i) {
+      OP_REQUIRES(
+          context, input(i).size() <= std::numeric_limits<int>::max(),
+          errors::InvalidArgument("JPEG contents are too large for int: ",
+                                  input(i).size()));
+    }
+
+    // All the images are decoded into one tensor, so they must have the same
+    // size, which is known before decoding any of them.
+    int height = 0;
+    int width = 0;
+    if (crop) {
+      height = windows(0, 2);
+      width = windows(0, 3);
+      OP_REQUIRES(context, height > 0 && width > 0,
+                  errors::InvalidArgument("Crop windows must not be empty, got ",
+                                          height, "x", width));
+      for (int64 i = 1; i < batch_size; ++i) {
+        OP_REQUIRES(context, windows(i, 2) == height && windows(i, 3) == width,
+                    errors::InvalidArgument(
+                        "All crop windows must have the same size, but window ",
+                        i, " is ", windows(i, 2), "x", windows(i, 3),
+                        " and window 0 is ", height, "x", width));
+      }
+    } else if (batch_size > 0) {
+      OP_REQUIRES(context,
+                  jpeg::GetImageInfo(input(0).data(), input(0).size(), &width,
+                                     &height, nullptr),
+                  errors::InvalidArgument("Invalid JPEG data, size ",
+                                          input(0).size()));
+      // libjpeg rounds the scaled size up.
+      height = (height + flags_.ratio - 1) / flags_.ratio;
+      width = (width + flags_.ratio - 1) / flags_.ratio;
+    }
+    const int channels = flags_.components;
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({batch_size, height, width, channels}),
+                       &output));
+    if (output->NumElements() == 0) {
+      return;
+    }
+    uint8* const output_data = output->flat<uint8>().data();
+    const int64 image_size = static_cast<int64>(height) * width * channels;
+
+    std::vector<Status> statuses(batch_size);
+    auto decode = [&](int64 start, int64 limit) {
+      for (int64 i = start; i < limit; ++i) {
+        jpeg::UncompressFlags flags = flags_;
+        if (crop) {
+          flags.crop = true;
+          flags.crop_y = windows(i, 0);
+          flags.crop_x = windows(i, 1);
+          flags.crop_height = windows(i, 2);
+          flags.crop_width = windows(i, 3);
+        }
+        uint8* const image = output_data + i * image_size;
+        const uint8* result = jpeg::Uncompress(
+            input(i).data(), input(i).size(), flags, nullptr /* nwarn */,
+            [&](int w, int h, int c) -> uint8* {
+              if (h != height || w != width || c != channels) {
+                statuses[i] = errors::InvalidArgument(
+                    "Image ", i, " has shape [", h, ",", w, ",", c,
+                    "], which differs from the shape of the batch [", height,
+                    ",", width, ",", channels, "]");
+                return nullptr;
+              }
+              return image;
+            });
+        if (result == nullptr && statuses[i].ok()) {
+          statuses[i] = errors::InvalidArgument("Invalid JPEG data for image ",
+                                                i, ", size ", input(i).size());
+        }
+      }
+    };
+    // Decoding costs tens of cycles per output pixel.
+    const int64 cost_per_image = image_size * 50;
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers, batch_size,
+          cost_per_image, decode);
+
+    for (const Status& status : statuses) {
+      OP_REQUIRES_OK(context, status);
+    }
+  }
+
+ private:
+  jpeg::UncompressFlags flags_;
+};
+REGISTER_KERNEL_BUILDER(Name("DecodeJpegBatch").Device(DEVICE_CPU),
+                        DecodeJpegBatchOp);
+
 }  // namespace tensorflow
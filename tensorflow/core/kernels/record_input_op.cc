@@ -36,6 +36,8 @@ class RecordInputOp : public OpKernel {
     GETATTR(int64, file_buffer_size);
     GETATTR(int64, file_parallelism);
     GETATTR(int64, batch_size);
+    GETATTR(int64, records_per_split);
+    GETATTR(int64, prefetch_size);
 #undef GETATTR
 
     RecordYielder::Options yopts;
@@ -44,6 +46,8 @@ class RecordInputOp : public OpKernel {
     yopts.bufsize = file_buffer_size;
     yopts.file_shuffle_shift_ratio = file_shuffle_shift_ratio;
     yopts.parallelism = file_parallelism;
+    yopts.records_per_split = records_per_split;
+    yopts.prefetch_size = prefetch_size;
     yielder_ = std::unique_ptr<RecordYielder>(new RecordYielder(ctx, yopts));
 
     batch_size_ = batch_size;
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/record_yielder.h"
 
+#include "tensorflow/core/lib/io/record_index.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/env.h"
@@ -24,6 +25,7 @@ namespace tensorflow {
 RecordYielder::RecordYielder(OpKernelConstruction* context,
                              const RecordYielder::Options& opts)
     : opts_(opts),
+      env_(context->env()),
       thread_(new thread::ThreadPool(context->env(), ThreadOptions(),
                                      "record_yielder", 1 + opts.parallelism,
                                      /* low_latency_hint */ false)),
@@ -68,9 +70,18 @@ Status RecordYielder::YieldOne(string* value) {
   return status_;
 }
 
+// A run of records of one file: either the whole file, or records
+// [begin, end) as located by the file's index.
+struct RecordYielder::Split {
+  string filename;
+  std::shared_ptr<const io::RecordIndex> index;  // Null for whole files.
+  int64 begin = 0;
+  int64 end = 0;
+};
+
 struct RecordYielder::Shard {
-  int index;                      // Shard index.
-  std::vector<string> filenames;  // File names given to this shard.
+  int index;                  // Shard index.
+  std::vector<Split> splits;  // Record runs given to this shard.
   Notification done;              // Notified when this shard is done.
   Status status;                  // Shard status.
 };
@@ -87,9 +98,42 @@ static Status MatchFiles(const string& patterns,
     std::vector<string> tmp_filenames;
     TF_RETURN_IF_ERROR(
         Env::Default()->GetMatchingPaths(file_pattern, &tmp_filenames));
-    filenames->insert(filenames->end(),
-                      std::make_move_iterator(tmp_filenames.begin()),
-                      std::make_move_iterator(tmp_filenames.end()));
+    for (string& filename : tmp_filenames) {
+      // Record indices living next to the records are not records.
+      if (!io::IsRecordIndexFileName(filename)) {
+        filenames->push_back(std::move(filename));
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status RecordYielder::MakeSplits(const std::vector<string>& filenames,
+                                 std::vector<Split>* splits) {
+  for (const string& filename : filenames) {
+    Split whole_file;
+    whole_file.filename = filename;
+    if (opts_.records_per_split <= 0) {
+      splits->push_back(std::move(whole_file));
+      continue;
+    }
+    const string index_filename = io::RecordIndexFileName(filename);
+    if (!env_->FileExists(index_filename).ok()) {
+      splits->push_back(std::move(whole_file));
+      continue;
+    }
+    std::shared_ptr<io::RecordIndex> index(new io::RecordIndex);
+    TF_RETURN_IF_ERROR(index->ReadFromFile(env_, index_filename));
+    for (int64 begin = 0; begin < index->num_records();
+         begin += opts_.records_per_split) {
+      Split split;
+      split.filename = filename;
+      split.index = index;
+      split.begin = begin;
+      split.end =
+          std::min(begin + opts_.records_per_split, index->num_records());
+      splits->push_back(std::move(split));
+    }
   }
   return Status::OK();
 }
@@ -109,29 +153,33 @@ void RecordYielder::MainLoop() {
       if (ShouldFinish(s)) break;
     }
 
-    // Shuffles these files according to the epoch # and random seed.
+    // Splits indexed files into runs of records.
+    std::vector<Split> splits;
+    s = MakeSplits(filenames, &splits);
+    if (ShouldFinish(s)) break;
+
+    // Shuffles these splits according to the epoch # and random seed.
     std::mt19937_64 shuffle_rnd(
         Hash64(reinterpret_cast<char*>(&epoch_), sizeof(epoch_), opts_.seed));
-    std::shuffle(filenames.begin(), filenames.end(), shuffle_rnd);
+    std::shuffle(splits.begin(), splits.end(), shuffle_rnd);
 
-    // Left-shift the filename list.
-    const std::vector<string>::size_type num = filenames.size();
+    // Left-shift the split list.
+    const std::vector<Split>::size_type num = splits.size();
     int64 shift;
     if (0 <= opts_.file_shuffle_shift_ratio &&
         opts_.file_shuffle_shift_ratio < 1) {
       shift = opts_.file_shuffle_shift_ratio * num;
-      std::rotate(filenames.begin(), filenames.begin() + shift,
-                  filenames.end());
+      std::rotate(splits.begin(), splits.begin() + shift, splits.end());
     }
 
-    // Shards files and use one thread to go through each shard.
+    // Shards splits and use one thread to go through each shard.
     const int N = opts_.parallelism;
     std::vector<Shard> shards(N);
     for (int i = 0; i < N; ++i) {
       Shard* shard = &shards[i];
       shard->index = i;
-      for (std::vector<string>::size_type j = i; j < filenames.size(); j += N) {
-        shard->filenames.push_back(filenames[j]);
+      for (std::vector<Split>::size_type j = i; j < splits.size(); j += N) {
+        shard->splits.push_back(splits[j]);
       }
       thread_->Schedule([this, shard]() { ShardLoop(shard); });
     }
@@ -180,19 +228,35 @@ bool RecordYielder::Add(std::vector<string>* values) {
 void RecordYielder::ShardLoop(Shard* shard) {
   std::vector<string> values;
   const int64 kRecords = 16;
-  for (const string& filename : shard->filenames) {
+  for (const Split& split : shard->splits) {
+    const string& filename = split.filename;
     std::unique_ptr<RandomAccessFile> file;
     if (ShouldFinish(Status::OK())) break;
-    Status s = Env::Default()->NewRandomAccessFile(filename, &file);
+    Status s = env_->NewRandomAccessFile(filename, &file);
     if (!s.ok()) {
       shard->status = errors::InvalidArgument("Can't open ", filename);
       break;
     }
-    io::RecordReader rdr(file.get());
+    io::RecordReaderOptions options;
+    options.buffer_size = 256 << 10;
+    options.prefetch_size = opts_.prefetch_size;
+    if (split.index != nullptr && split.end < split.index->num_records()) {
+      // The records of the next split are left to the shard reading it.
+      options.read_ahead_limit = split.index->offset(split.end);
+    }
+    io::RecordReader rdr(file.get(), options, env_);
     uint64 offset = 0;
+    int64 next_record = split.begin;
     string record;
     while (true) {
-      Status s = rdr.ReadRecord(&offset, &record);
+      Status s;
+      if (split.index == nullptr) {
+        s = rdr.ReadRecord(&offset, &record);
+      } else if (next_record < split.end) {
+        s = rdr.ReadRecordAt(*split.index, next_record++, &record);
+      } else {
+        break;
+      }
       if (s.ok()) {
         values.emplace_back(std::move(record));
         if (values.size() >= kRecords && Add(&values)) {
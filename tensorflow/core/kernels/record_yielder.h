@@ -58,7 +58,8 @@ namespace tensorflow {
 class RecordYielder {
  public:
   struct Options {
-    // Glob pattern for tfrecords.
+    // Glob pattern for tfrecords.  Matching record index sidecars (see
+    // io::IsRecordIndexFileName()) are skipped.
     string file_pattern;
 
     // Random seed. It determines how data files are shuffled and how
@@ -78,6 +79,16 @@ class RecordYielder {
     // Uses these many concurrent tfrecord iterators to iterate through
     // tfrecords.
     int32 parallelism = 1;
+
+    // If > 0, files with a record index (see io::RecordIndex) are split into
+    // runs of this many records.  The runs are shuffled along with the other
+    // files and read concurrently, so that a few large files still keep
+    // all iterators busy and are spread over the randomization buffer.
+    int64 records_per_split = 0;
+
+    // If > 0, each tfrecord iterator reads up to this many bytes ahead of
+    // the records being parsed on a background thread.
+    int64 prefetch_size = 0;
   };
 
   explicit RecordYielder(OpKernelConstruction* context,
@@ -97,6 +108,7 @@ class RecordYielder {
   typedef RecordYielder ME;
 
   Options opts_;
+  Env* const env_;  // Not owned.
 
   // Backgrounds threads. Owned.
   thread::ThreadPool* thread_;
@@ -146,6 +158,9 @@ class RecordYielder {
   }
 
   void MainLoop();
+  struct Split;
+  Status MakeSplits(const std::vector<string>& filenames,
+                    std::vector<Split>* splits);
   struct Shard;
   void ShardLoop(Shard* shard);
   bool ShouldFinish(const Status& s);
@@ -13,18 +13,25 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <numeric>
 #include <unordered_map>
 
 #include <vector>
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
@@ -233,17 +240,26 @@ void RestoreTensor(OpKernelContext* context,
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                         const Tensor& tensor_names,
                         const Tensor& shape_and_slices,
-                        gtl::ArraySlice<DataType> dtypes) {
+                        gtl::ArraySlice<DataType> dtypes, bool use_mmap) {
   const string& prefix_string = prefix.scalar<string>()();
   const auto& tensor_names_flat = tensor_names.flat<string>();
   const auto& shape_and_slices_flat = shape_and_slices.flat<string>();
 
-  BundleReader reader(Env::Default(), prefix_string);
+  BundleReader::Options options;
+  options.pool = context->device()->tensorflow_cpu_worker_threads()->workers;
+  options.use_mmap = use_mmap;
+  BundleReader reader(Env::Default(), prefix_string, options);
   TF_RETURN_IF_ERROR(reader.status());
 
-  // TODO(zongheng): potential optimization: one Seek() in first lookup.
-  // TODO(zongheng): consider measuring speed and issuing concurrent lookups
-  // within a fixed memory budget.
+  // The full tensors are looked up together at the end, so that they are
+  // read concurrently.  Their outputs are allocated by the reader when it maps
+  // them.
+  std::vector<int> full_indices;
+  std::vector<string> full_names;
+  std::vector<Tensor> full_tensors;
+  std::vector<Tensor*> full_tensor_ptrs;
+  full_tensors.reserve(tensor_names_flat.size());
+
   TensorShape restored_full_shape;
   Tensor* restored_tensor = nullptr;
   for (size_t i = 0; i < tensor_names_flat.size(); ++i) {
@@ -253,10 +269,16 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
         reader.LookupTensorShape(tensor_name, &restored_full_shape));
 
     if (shape_and_slice.empty()) {
-      // Lookup the full tensor.
-      TF_RETURN_IF_ERROR(
-          context->allocate_output(i, restored_full_shape, &restored_tensor));
-      TF_RETURN_IF_ERROR(reader.Lookup(tensor_name, restored_tensor));
+      full_indices.push_back(i);
+      full_names.push_back(tensor_name);
+      if (use_mmap) {
+        full_tensors.emplace_back();
+      } else {
+        TF_RETURN_IF_ERROR(
+            context->allocate_output(i, restored_full_shape, &restored_tensor));
+        full_tensors.push_back(*restored_tensor);
+      }
+      full_tensor_ptrs.push_back(&full_tensors.back());
     } else {
       // Lookup the slice.
       TensorShape parsed_full_shape;
@@ -277,15 +299,175 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
           context->allocate_output(i, parsed_slice_shape, &restored_tensor));
       TF_RETURN_IF_ERROR(
           reader.LookupSlice(tensor_name, parsed_slice, restored_tensor));
+      if (dtypes[i] != restored_tensor->dtype()) {
+        return errors::InvalidArgument(
+            "Expected dtype ", DataTypeString(dtypes[i]),
+            " does not equal restored dtype ",
+            DataTypeString(restored_tensor->dtype()));
+      }
     }
-    if (dtypes[i] != restored_tensor->dtype()) {
+  }
+
+  TF_RETURN_IF_ERROR(reader.LookupMany(full_names, full_tensor_ptrs));
+  for (size_t j = 0; j < full_indices.size(); ++j) {
+    const int i = full_indices[j];
+    const Tensor& restored = full_tensors[j];
+    if (dtypes[i] != restored.dtype()) {
       return errors::InvalidArgument("Expected dtype ",
                                      DataTypeString(dtypes[i]),
                                      " does not equal restored dtype ",
-                                     DataTypeString(restored_tensor->dtype()));
+                                     DataTypeString(restored.dtype()));
     }
+    if (use_mmap) context->set_output(i, restored);
   }
   return Status::OK();
 }
 
+AsyncCheckpointSaver::AsyncCheckpointSaver()
+    : coordinator_(Env::Default(), "async_checkpoint", 1) {}
+
+AsyncCheckpointSaver::~AsyncCheckpointSaver() {
+  // The pending saves refer to this object.
+  mutex_lock l(mu_);
+  while (num_pending_ > 0) {
+    done_.wait(l);
+  }
+}
+
+Status AsyncCheckpointSaver::LookupOrCreate(ResourceMgr* rm,
+                                            AsyncCheckpointSaver** saver) {
+  return rm->LookupOrCreate<AsyncCheckpointSaver>(
+      rm->default_container(), "_async_checkpoint_saver", saver,
+      [](AsyncCheckpointSaver** ret) {
+        *ret = new AsyncCheckpointSaver;
+        return Status::OK();
+      });
+}
+
+void AsyncCheckpointSaver::Start(std::unique_ptr<Snapshot> snapshot,
+                                 int num_shards, int num_writer_threads) {
+  {
+    mutex_lock l(mu_);
+    ++num_pending_;
+  }
+  std::shared_ptr<Snapshot> shared_snapshot(snapshot.release());
+  coordinator_.Schedule(
+      [this, shared_snapshot, num_shards, num_writer_threads]() {
+        const Status s =
+            Write(*shared_snapshot, num_shards, num_writer_threads);
+        if (!s.ok()) {
+          LOG(ERROR) << "Asynchronous save to " << shared_snapshot->prefix
+                     << " failed: " << s;
+        }
+        mutex_lock l(mu_);
+        status_.Update(s);
+        --num_pending_;
+        done_.notify_all();
+      });
+}
+
+Status AsyncCheckpointSaver::WaitForAll() {
+  mutex_lock l(mu_);
+  while (num_pending_ > 0) {
+    done_.wait(l);
+  }
+  Status s = status_;
+  status_ = Status::OK();
+  return s;
+}
+
+int AsyncCheckpointSaver::NumPending() {
+  mutex_lock l(mu_);
+  return num_pending_;
+}
+
+string AsyncCheckpointSaver::DebugString() {
+  return strings::StrCat("AsyncCheckpointSaver with ", NumPending(),
+                         " pending saves");
+}
+
+Status AsyncCheckpointSaver::Write(const Snapshot& snapshot, int num_shards,
+                                   int num_writer_threads) {
+  Env* env = Env::Default();
+  const int num_tensors = snapshot.tensors.size();
+  num_shards = std::max(1, std::min(num_shards, num_tensors));
+
+  // Balances the bytes written to each shard: each tensor, largest first,
+  // goes to the shard with the fewest bytes so far.
+  std::vector<int> order(num_tensors);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&snapshot](int a, int b) {
+    return snapshot.tensors[a].TotalBytes() > snapshot.tensors[b].TotalBytes();
+  });
+  std::vector<std::vector<int>> shards(num_shards);
+  std::vector<int64> shard_bytes(num_shards, 0);
+  for (int i : order) {
+    const int shard =
+        std::min_element(shard_bytes.begin(), shard_bytes.end()) -
+        shard_bytes.begin();
+    shards[shard].push_back(i);
+    shard_bytes[shard] += snapshot.tensors[i].TotalBytes();
+  }
+
+  // The shards are written as separate bundles in a temporary directory, as
+  // the sharded saves of the Python Saver do.
+  const string tmp_dir =
+      strings::StrCat(snapshot.prefix, "_temp_", random::New64());
+  std::vector<string> shard_prefixes(num_shards);
+  std::vector<Status> shard_status(num_shards);
+  if (num_writer_threads <= 0 || num_writer_threads > num_shards) {
+    num_writer_threads = num_shards;
+  }
+  thread::ThreadPool writers(env, "async_checkpoint_writer",
+                             num_writer_threads);
+  BlockingCounter counter(num_shards);
+  for (int shard = 0; shard < num_shards; ++shard) {
+    shard_prefixes[shard] =
+        io::JoinPath(tmp_dir, strings::Printf("part-%05d", shard));
+    writers.Schedule([env, &snapshot, &shards, &shard_prefixes,
+                      &shard_status, &counter, shard]() {
+      // Aligned so that the tensors can be restored with use_mmap.
+      BundleWriter::Options options;
+      options.data_alignment = Allocator::kAllocatorAlignment;
+      BundleWriter writer(env, shard_prefixes[shard], options);
+      Status s;
+      for (int i : shards[shard]) {
+        const string& tensor_name = snapshot.tensor_names[i];
+        const string& shape_spec = snapshot.shape_and_slices[i];
+        const Tensor& tensor = snapshot.tensors[i];
+        if (shape_spec.empty()) {
+          s = writer.Add(tensor_name, tensor);
+        } else {
+          // Validated by the op.
+          TensorShape shape;
+          TensorSlice slice(tensor.dims());
+          TensorShape slice_shape;
+          s = checkpoint::ParseShapeAndSlice(shape_spec, &shape, &slice,
+                                             &slice_shape);
+          if (s.ok()) s = writer.AddSlice(tensor_name, shape, slice, tensor);
+        }
+        if (!s.ok()) break;
+      }
+      // Always finishes the writer, which cleans up after errors.
+      s.Update(writer.Finish());
+      shard_status[shard] = s;
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+
+  Status s;
+  for (const Status& shard_s : shard_status) {
+    s.Update(shard_s);
+  }
+  if (s.ok()) {
+    s = MergeBundles(env, shard_prefixes, snapshot.prefix);
+  }
+  int64 undeleted_files, undeleted_dirs;
+  Status delete_status =
+      env->DeleteRecursively(tmp_dir, &undeleted_files, &undeleted_dirs);
+  if (!delete_status.ok()) VLOG(1) << delete_status;
+  return s;
+}
+
 }  // namespace tensorflow
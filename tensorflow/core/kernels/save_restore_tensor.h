@@ -16,6 +16,17 @@ limitations under the License.
 #ifndef TENSORFLOW_KERNELS_SAVE_RESTORE_TENSOR_H_
 #define TENSORFLOW_KERNELS_SAVE_RESTORE_TENSOR_H_
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_writer.h"
 
@@ -60,10 +71,67 @@ void RestoreTensor(OpKernelContext* context,
 //   * "prefix" has 1 element, DT_STRING.
 //   * "tensor_names" and "shape_and_slices" shaped {N}, both DT_STRING.
 //   * "dtypes" has N elements, the datatypes of the to-restore tensors.
+// If "use_mmap" is true, the full tensors are backed by copy-on-write mappings
+// of the checkpoint files where possible (see BundleReader::Options).
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                         const Tensor& tensor_names,
                         const Tensor& shape_and_slices,
-                        gtl::ArraySlice<DataType> dtypes);
+                        gtl::ArraySlice<DataType> dtypes,
+                        bool use_mmap = false);
+
+// Writes the V2 checkpoints saved by SaveV2Async ops in the background.  There
+// is one per ResourceMgr, e.g. per session with DirectSession, so that the
+// pending saves and their errors of one session do not leak into another.
+// Destroying it waits for the pending saves.  Thread-safe.
+class AsyncCheckpointSaver : public ResourceBase {
+ public:
+  AsyncCheckpointSaver();
+  ~AsyncCheckpointSaver() override;
+
+  // Returns in "*saver" the saver of "rm", creating it if needed.  The caller
+  // owns a reference to "*saver".
+  static Status LookupOrCreate(ResourceMgr* rm, AsyncCheckpointSaver** saver);
+
+  // The tensors to save, as the inputs of SaveV2.  "tensors" must not be
+  // modified once passed to Start().
+  struct Snapshot {
+    string prefix;
+    std::vector<string> tensor_names;
+    std::vector<string> shape_and_slices;
+    std::vector<Tensor> tensors;
+  };
+
+  // Starts writing "snapshot" to its prefix, spreading the tensors over
+  // "num_shards" bundles, whose metadata is then merged with MergeBundles().
+  // The bundles are written by "num_writer_threads" threads, or one per
+  // bundle if 0.
+  void Start(std::unique_ptr<Snapshot> snapshot, int num_shards,
+             int num_writer_threads);
+
+  // Blocks until the saves started so far are complete.  Returns the error of
+  // the first of them that failed since the last call, if any.
+  Status WaitForAll();
+
+  // Returns the number of saves started but not complete yet.
+  int NumPending();
+
+  string DebugString() override;
+
+ private:
+  // Writes "snapshot" synchronously.  Runs on coordinator_.
+  Status Write(const Snapshot& snapshot, int num_shards,
+               int num_writer_threads);
+
+  // Runs the saves one after another.
+  thread::ThreadPool coordinator_;
+
+  mutex mu_;
+  condition_variable done_;
+  int num_pending_ GUARDED_BY(mu_) = 0;
+  Status status_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AsyncCheckpointSaver);
+};
 
 }  // namespace tensorflow
 
@@ -18,12 +18,16 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/kernels/save_restore_tensor.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/env.h"
@@ -104,7 +108,10 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<string>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<string>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
+    // Aligned so that the tensors can be restored with use_mmap.
+    BundleWriter::Options options;
+    options.data_alignment = Allocator::kAllocatorAlignment;
+    BundleWriter writer(Env::Default(), prefix_string, options);
     VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
 
     for (int i = 0; i < num_tensors; ++i) {
@@ -137,11 +144,142 @@ class SaveV2 : public OpKernel {
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
 
+// Saves a list of named tensors using the tensor bundle library, in the
+// background: only takes a snapshot of the tensors, which AsyncCheckpointSaver
+// then writes.
+class SaveV2Async : public OpKernel {
+ public:
+  explicit SaveV2Async(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("num_shards", &num_shards_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_writer_threads",
+                                             &num_writer_threads_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& prefix = context->input(0);
+    const Tensor& tensor_names = context->input(1);
+    const Tensor& shape_and_slices = context->input(2);
+    ValidateInputs(true /* is save op */, context, prefix, tensor_names,
+                   shape_and_slices);
+    if (!context->status().ok()) return;
+
+    // Holds at most one snapshot in memory.
+    AsyncCheckpointSaver* saver;
+    OP_REQUIRES_OK(context, AsyncCheckpointSaver::LookupOrCreate(
+                                context->resource_manager(), &saver));
+    core::ScopedUnref unref(saver);
+    OP_REQUIRES_OK(context, saver->WaitForAll());
+
+    const int kFixedInputs = 3;  // Prefix, tensor names, shape_and_slices.
+    const int num_tensors = static_cast<int>(tensor_names.NumElements());
+    const auto& tensor_names_flat = tensor_names.flat<string>();
+    const auto& shape_and_slices_flat = shape_and_slices.flat<string>();
+
+    std::unique_ptr<AsyncCheckpointSaver::Snapshot> snapshot(
+        new AsyncCheckpointSaver::Snapshot);
+    snapshot->prefix = prefix.scalar<string>()();
+    snapshot->tensors.resize(num_tensors);
+    std::vector<int> to_copy;
+    for (int i = 0; i < num_tensors; ++i) {
+      const string& tensor_name = tensor_names_flat(i);
+      const Tensor& tensor = context->input(i + kFixedInputs);
+      snapshot->tensor_names.push_back(tensor_name);
+      snapshot->shape_and_slices.push_back(shape_and_slices_flat(i));
+
+      if (!shape_and_slices_flat(i).empty()) {
+        const string& shape_spec = shape_and_slices_flat(i);
+        TensorShape shape;
+        TensorSlice slice(tensor.dims());
+        TensorShape slice_shape;
+
+        OP_REQUIRES_OK(context, checkpoint::ParseShapeAndSlice(
+                                    shape_spec, &shape, &slice, &slice_shape));
+        OP_REQUIRES(context, slice_shape.IsSameSize(tensor.shape()),
+                    errors::InvalidArgument("Slice in shape_and_slice "
+                                            "specification does not match the "
+                                            "shape of the tensor to  save: ",
+                                            shape_spec, ", tensor: ",
+                                            tensor.shape().DebugString()));
+      }
+
+      // A tensor no one else holds can not change anymore, so it is saved
+      // as is.  The others (e.g. variables) are copied.
+      std::unique_ptr<Tensor> forwarded =
+          context->forward_input(i + kFixedInputs, tensor.dtype(),
+                                 tensor.shape(), DEVICE_MEMORY,
+                                 AllocatorAttributes());
+      if (forwarded != nullptr) {
+        snapshot->tensors[i] = *forwarded;
+      } else {
+        to_copy.push_back(i);
+      }
+    }
+
+    // Copies the tensors concurrently.
+    thread::ThreadPool* pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    BlockingCounter counter(to_copy.size());
+    for (int i : to_copy) {
+      pool->Schedule([context, &snapshot, &counter, i]() {
+        snapshot->tensors[i] =
+            tensor::DeepCopy(context->input(i + kFixedInputs));
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+
+    VLOG(1) << "Saving " << num_tensors << " tensors to "
+            << snapshot->prefix << " in the background";
+    saver->Start(std::move(snapshot), num_shards_, num_writer_threads_);
+  }
+
+ private:
+  int num_shards_;
+  int num_writer_threads_;
+};
+REGISTER_KERNEL_BUILDER(Name("SaveV2Async").Device(DEVICE_CPU), SaveV2Async);
+
+class WaitForAsyncSaves : public OpKernel {
+ public:
+  explicit WaitForAsyncSaves(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    AsyncCheckpointSaver* saver;
+    OP_REQUIRES_OK(context, AsyncCheckpointSaver::LookupOrCreate(
+                                context->resource_manager(), &saver));
+    core::ScopedUnref unref(saver);
+    OP_REQUIRES_OK(context, saver->WaitForAll());
+  }
+};
+REGISTER_KERNEL_BUILDER(Name("WaitForAsyncSaves").Device(DEVICE_CPU),
+                        WaitForAsyncSaves);
+
+class NumPendingAsyncSaves : public OpKernel {
+ public:
+  explicit NumPendingAsyncSaves(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    AsyncCheckpointSaver* saver;
+    OP_REQUIRES_OK(context, AsyncCheckpointSaver::LookupOrCreate(
+                                context->resource_manager(), &saver));
+    core::ScopedUnref unref(saver);
+    Tensor* num_pending = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape({}), &num_pending));
+    num_pending->scalar<int32>()() = saver->NumPending();
+  }
+};
+REGISTER_KERNEL_BUILDER(Name("NumPendingAsyncSaves").Device(DEVICE_CPU),
+                        NumPendingAsyncSaves);
+
 // Restores a list of named tensors from a tensor bundle (V2 checkpoint format).
 class RestoreV2 : public OpKernel {
  public:
   explicit RestoreV2(OpKernelConstruction* context) : OpKernel(context) {
     OP_REQUIRES_OK(context, context->GetAttr("dtypes", &dtypes_));
+    OP_REQUIRES_OK(context, context->GetAttr("use_mmap", &use_mmap_));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -172,13 +310,16 @@ class RestoreV2 : public OpKernel {
       return;
     }
     // If found, invokes the V2 reader.
-    OP_REQUIRES_OK(context, RestoreTensorsV2(context, prefix, tensor_names,
-                                             shape_and_slices, dtypes_));
+    OP_REQUIRES_OK(context,
+                   RestoreTensorsV2(context, prefix, tensor_names,
+                                    shape_and_slices, dtypes_, use_mmap_));
   }
 
  private:
   // Expected dtypes of the to-restore tensors.
   std::vector<DataType> dtypes_;
+  // Whether the restored tensors are backed by mappings of the checkpoint.
+  bool use_mmap_;
 };
 REGISTER_KERNEL_BUILDER(Name("RestoreV2").Device(DEVICE_CPU), RestoreV2);
 
@@ -18,11 +18,15 @@ limitations under the License.
 
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/kernels/save_restore_tensor.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/env.h"
@@ -339,5 +343,128 @@ TEST_F(SaveV2OpTest, Simple) {
   }
 }
 
+class SaveV2AsyncOpTest : public OpsTestBase {
+ protected:
+  void MakeOp() {
+    TF_ASSERT_OK(NodeDefBuilder("myop", "SaveV2Async")
+                     .Input(FakeInput())  // prefix
+                     .Input(FakeInput())  // tensor_names
+                     .Input(FakeInput())  // shape_and_slices
+                     .Input(FakeInput({DT_FLOAT, DT_INT32, DT_FLOAT}))
+                     .Attr("num_shards", 2)
+                     .Attr("num_writer_threads", 1)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Waits for the saves started in device_'s resource manager.
+  Status WaitForAll() {
+    AsyncCheckpointSaver* saver;
+    TF_RETURN_IF_ERROR(AsyncCheckpointSaver::LookupOrCreate(
+        device_->resource_manager(), &saver));
+    core::ScopedUnref unref(saver);
+    return saver->WaitForAll();
+  }
+};
+
+TEST_F(SaveV2AsyncOpTest, Simple) {
+  const string prefix = io::JoinPath(testing::TmpDir(), "tensor_async");
+  const string tensornames[] = {"tensor_float", "tensor_int", "tensor_slice"};
+  const string slices[] = {"", "", "4 2 0,2:-"};
+
+  MakeOp();
+  AddInput<string>(TensorShape({}),
+                   [&prefix](int x) -> string { return prefix; });
+  AddInput<string>(TensorShape({3}),
+                   [&tensornames](int x) -> string { return tensornames[x]; });
+  AddInput<string>(TensorShape({3}),
+                   [&slices](int x) -> string { return slices[x]; });
+  AddInput<float>(TensorShape({2, 4}),
+                  [](int x) -> float { return static_cast<float>(x) / 10; });
+  AddInput<int32>(TensorShape({10}), [](int x) -> int32 { return x + 1; });
+  AddInput<float>(TensorShape({2, 2}), [](int x) -> float { return x; });
+
+  // Another reference to the float tensor, through which it is modified after
+  // the op returns, like a variable updated by the next training step.
+  Tensor variable = *mutable_input(3).tensor;
+  TF_ASSERT_OK(RunOpKernel());
+  variable.flat<float>().setConstant(-1);
+
+  TF_ASSERT_OK(WaitForAll());
+
+  BundleReader reader(Env::Default(), prefix);
+  TF_ASSERT_OK(reader.status());
+  {
+    Tensor val;
+    TF_ASSERT_OK(reader.Lookup("tensor_float", &val));
+    Tensor expected(DT_FLOAT, TensorShape({2, 4}));
+    test::FillFn<float>(&expected, [](int x) -> float {
+      return static_cast<float>(x) / 10;
+    });
+    test::ExpectTensorEqual<float>(expected, val);
+  }
+  {
+    Tensor val;
+    TF_ASSERT_OK(reader.Lookup("tensor_int", &val));
+    Tensor expected(DT_INT32, TensorShape({10}));
+    test::FillFn<int32>(&expected, [](int x) -> int32 { return x + 1; });
+    test::ExpectTensorEqual<int32>(expected, val);
+  }
+  {
+    Tensor val(DT_FLOAT, TensorShape({2, 2}));
+    TF_ASSERT_OK(reader.LookupSlice(
+        "tensor_slice", TensorSlice::ParseOrDie("0,2:-"), &val));
+    Tensor expected(DT_FLOAT, TensorShape({2, 2}));
+    test::FillFn<float>(&expected, [](int x) -> float { return x; });
+    test::ExpectTensorEqual<float>(expected, val);
+  }
+
+  // The temporary shards are gone.
+  std::vector<string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(testing::TmpDir(), &children));
+  for (const string& child : children) {
+    EXPECT_FALSE(StringPiece(child).starts_with("tensor_async_temp_"));
+  }
+}
+
+TEST_F(SaveV2AsyncOpTest, NumPending) {
+  TF_ASSERT_OK(NodeDefBuilder("myop", "NumPendingAsyncSaves")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(WaitForAll());
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_EQ(0, GetOutput(0)->scalar<int32>()());
+}
+
+TEST(AsyncCheckpointSaverTest, OnePerResourceMgr) {
+  ResourceMgr rm1;
+  ResourceMgr rm2;
+  AsyncCheckpointSaver* saver1;
+  AsyncCheckpointSaver* saver2;
+  AsyncCheckpointSaver* saver1_again;
+  TF_ASSERT_OK(AsyncCheckpointSaver::LookupOrCreate(&rm1, &saver1));
+  core::ScopedUnref unref1(saver1);
+  TF_ASSERT_OK(AsyncCheckpointSaver::LookupOrCreate(&rm2, &saver2));
+  core::ScopedUnref unref2(saver2);
+  TF_ASSERT_OK(AsyncCheckpointSaver::LookupOrCreate(&rm1, &saver1_again));
+  core::ScopedUnref unref1_again(saver1_again);
+  EXPECT_EQ(saver1, saver1_again);
+  EXPECT_NE(saver1, saver2);
+
+  // A failed save is only reported by the saver it was started on.
+  std::unique_ptr<AsyncCheckpointSaver::Snapshot> snapshot(
+      new AsyncCheckpointSaver::Snapshot);
+  const string not_a_dir = io::JoinPath(testing::TmpDir(), "not_a_dir");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), not_a_dir, ""));
+  snapshot->prefix = io::JoinPath(not_a_dir, "ckpt");
+  snapshot->tensor_names = {"t"};
+  snapshot->shape_and_slices = {""};
+  snapshot->tensors = {test::AsTensor<float>({1, 2})};
+  saver1->Start(std::move(snapshot), 1, 0);
+  EXPECT_FALSE(saver1->WaitForAll().ok());
+  EXPECT_EQ(0, saver1->NumPending());
+  TF_EXPECT_OK(saver2->WaitForAll());
+}
+
 }  // namespace
 }  // namespace tensorflow
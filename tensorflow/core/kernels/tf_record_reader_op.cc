@@ -28,11 +28,12 @@ namespace tensorflow {
 class TFRecordReader : public ReaderBase {
  public:
   TFRecordReader(const string& node_name, const string& compression_type,
-                 Env* env)
+                 int64 prefetch_size, Env* env)
       : ReaderBase(strings::StrCat("TFRecordReader '", node_name, "'")),
         env_(env),
         offset_(0),
-        compression_type_(compression_type) {}
+        compression_type_(compression_type),
+        prefetch_size_(prefetch_size) {}
 
   Status OnWorkStartedLocked() override {
     offset_ = 0;
@@ -40,7 +41,11 @@ class TFRecordReader : public ReaderBase {
 
     io::RecordReaderOptions options =
         io::RecordReaderOptions::CreateRecordReaderOptions(compression_type_);
-    reader_.reset(new io::RecordReader(file_.get(), options));
+    // Uncompressed records are read sequentially in large chunks, optionally
+    // prefetched ahead of parsing.
+    options.buffer_size = kBufferSize;
+    options.prefetch_size = prefetch_size_;
+    reader_.reset(new io::RecordReader(file_.get(), options, env_));
     return Status::OK();
   }
 
@@ -73,13 +78,18 @@ class TFRecordReader : public ReaderBase {
   // TODO(josh11b): Implement serializing and restoring the state.
 
  private:
+  static constexpr int64 kBufferSize = 256 << 10;
+
   Env* const env_;
   uint64 offset_;
   std::unique_ptr<RandomAccessFile> file_;
   std::unique_ptr<io::RecordReader> reader_;
   string compression_type_ = "";
+  const int64 prefetch_size_;
 };
 
+constexpr int64 TFRecordReader::kBufferSize;
+
 class TFRecordReaderOp : public ReaderOpKernel {
  public:
   explicit TFRecordReaderOp(OpKernelConstruction* context)
@@ -89,9 +99,11 @@ class TFRecordReaderOp : public ReaderOpKernel {
     string compression_type;
     OP_REQUIRES_OK(context,
                    context->GetAttr("compression_type", &compression_type));
+    int64 prefetch_size;
+    OP_REQUIRES_OK(context, context->GetAttr("prefetch_size", &prefetch_size));
 
-    SetReaderFactory([this, compression_type, env]() {
-      return new TFRecordReader(name(), compression_type, env);
+    SetReaderFactory([this, compression_type, prefetch_size, env]() {
+      return new TFRecordReader(name(), compression_type, prefetch_size, env);
     });
   }
 };
@@ -0,0 +1,193 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/filter_block.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace table {
+
+// For testing: emit an array with one hash value per key
+class TestHashFilter : public FilterPolicy {
+ public:
+  const char* Name() const override { return "TestHashFilter"; }
+
+  void CreateFilter(const StringPiece* keys, int n,
+                    string* dst) const override {
+    for (int i = 0; i < n; i++) {
+      uint32 h = Hash32(keys[i].data(), keys[i].size(), 1);
+      core::PutFixed32(dst, h);
+    }
+  }
+
+  bool KeyMayMatch(const StringPiece& key,
+                   const StringPiece& filter) const override {
+    uint32 h = Hash32(key.data(), key.size(), 1);
+    for (size_t i = 0; i + 4 <= filter.size(); i += 4) {
+      if (h == core::DecodeFixed32(filter.data() + i)) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+class FilterBlockTest : public ::testing::Test {
+ public:
+  TestHashFilter policy_;
+};
+
+TEST_F(FilterBlockTest, EmptyBuilder) {
+  FilterBlockBuilder builder(&policy_);
+  StringPiece block = builder.Finish();
+  ASSERT_EQ(string("\x00\x00\x00\x00\x0b", 5), block.ToString());
+  FilterBlockReader reader(&policy_, block);
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
+  ASSERT_TRUE(reader.KeyMayMatch(100000, "foo"));
+}
+
+TEST_F(FilterBlockTest, SingleChunk) {
+  FilterBlockBuilder builder(&policy_);
+  builder.StartBlock(100);
+  builder.AddKey("foo");
+  builder.AddKey("bar");
+  builder.AddKey("box");
+  builder.StartBlock(200);
+  builder.AddKey("box");
+  builder.StartBlock(300);
+  builder.AddKey("hello");
+  StringPiece block = builder.Finish();
+  FilterBlockReader reader(&policy_, block);
+  ASSERT_TRUE(reader.KeyMayMatch(100, "foo"));
+  ASSERT_TRUE(reader.KeyMayMatch(100, "bar"));
+  ASSERT_TRUE(reader.KeyMayMatch(100, "box"));
+  ASSERT_TRUE(reader.KeyMayMatch(100, "hello"));
+  ASSERT_TRUE(reader.KeyMayMatch(100, "foo"));
+  ASSERT_FALSE(reader.KeyMayMatch(100, "missing"));
+  ASSERT_FALSE(reader.KeyMayMatch(100, "other"));
+}
+
+TEST_F(FilterBlockTest, MultiChunk) {
+  FilterBlockBuilder builder(&policy_);
+
+  // First filter
+  builder.StartBlock(0);
+  builder.AddKey("foo");
+  builder.StartBlock(2000);
+  builder.AddKey("bar");
+
+  // Second filter
+  builder.StartBlock(3100);
+  builder.AddKey("box");
+
+  // Third filter is empty
+
+  // Last filter
+  builder.StartBlock(9000);
+  builder.AddKey("box");
+  builder.AddKey("hello");
+
+  StringPiece block = builder.Finish();
+  FilterBlockReader reader(&policy_, block);
+
+  // Check first filter
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
+  ASSERT_TRUE(reader.KeyMayMatch(2000, "bar"));
+  ASSERT_FALSE(reader.KeyMayMatch(0, "box"));
+  ASSERT_FALSE(reader.KeyMayMatch(0, "hello"));
+
+  // Check second filter
+  ASSERT_TRUE(reader.KeyMayMatch(3100, "box"));
+  ASSERT_FALSE(reader.KeyMayMatch(3100, "foo"));
+  ASSERT_FALSE(reader.KeyMayMatch(3100, "bar"));
+  ASSERT_FALSE(reader.KeyMayMatch(3100, "hello"));
+
+  // Check third filter (empty)
+  ASSERT_FALSE(reader.KeyMayMatch(4100, "foo"));
+  ASSERT_FALSE(reader.KeyMayMatch(4100, "bar"));
+  ASSERT_FALSE(reader.KeyMayMatch(4100, "box"));
+  ASSERT_FALSE(reader.KeyMayMatch(4100, "hello"));
+
+  // Check last filter
+  ASSERT_TRUE(reader.KeyMayMatch(9000, "box"));
+  ASSERT_TRUE(reader.KeyMayMatch(9000, "hello"));
+  ASSERT_FALSE(reader.KeyMayMatch(9000, "foo"));
+  ASSERT_FALSE(reader.KeyMayMatch(9000, "bar"));
+}
+
+static string Key(int i) {
+  char buf[4];
+  core::EncodeFixed32(buf, i);
+  return string(buf, sizeof(buf));
+}
+
+TEST(BloomFilterTest, EmptyFilter) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  string filter;
+  policy->CreateFilter(nullptr, 0, &filter);
+  ASSERT_FALSE(policy->KeyMayMatch("hello", filter));
+  ASSERT_FALSE(policy->KeyMayMatch("world", filter));
+}
+
+TEST(BloomFilterTest, Small) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  StringPiece keys[] = {"hello", "world"};
+  string filter;
+  policy->CreateFilter(keys, 2, &filter);
+  ASSERT_TRUE(policy->KeyMayMatch("hello", filter));
+  ASSERT_TRUE(policy->KeyMayMatch("world", filter));
+  ASSERT_FALSE(policy->KeyMayMatch("x", filter));
+  ASSERT_FALSE(policy->KeyMayMatch("foo", filter));
+}
+
+TEST(BloomFilterTest, FalsePositiveRate) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  for (int length : {1, 10, 100, 1000, 10000}) {
+    std::vector<string> key_strings;
+    for (int i = 0; i < length; i++) {
+      key_strings.push_back(Key(i));
+    }
+    std::vector<StringPiece> keys(key_strings.begin(), key_strings.end());
+    string filter;
+    policy->CreateFilter(keys.data(), length, &filter);
+    EXPECT_LE(filter.size(), static_cast<size_t>((length * 10 / 8) + 40))
+        << length;
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(policy->KeyMayMatch(Key(i), filter))
+          << "Length " << length << "; key " << i;
+    }
+
+    // Check false positive rate
+    int hits = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (policy->KeyMayMatch(Key(i + 1000000000), filter)) {
+        hits++;
+      }
+    }
+    EXPECT_LE(hits, 200) << length;  // Must not be over 2%
+  }
+}
+
+}  // namespace table
+}  // namespace tensorflow
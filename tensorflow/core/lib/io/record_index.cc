@@ -0,0 +1,123 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/record_index.h"
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace io {
+
+namespace {
+const uint64 kRecordIndexMagic = 0x7265636f7264696eull;  // "recordin"
+const size_t kFooterSize = sizeof(uint64) + sizeof(uint32) + sizeof(uint64);
+const char kRecordIndexSuffix[] = ".tfindex";
+}  // namespace
+
+void RecordIndex::EncodeTo(string* dst) const {
+  const size_t start = dst->size();
+  dst->reserve(start + offsets_.size() * sizeof(uint64) + kFooterSize);
+  for (uint64 offset : offsets_) {
+    core::PutFixed64(dst, offset);
+  }
+  core::PutFixed64(dst, offsets_.size());
+  core::PutFixed32(dst, crc32c::Mask(crc32c::Value(dst->data() + start,
+                                                   dst->size() - start)));
+  core::PutFixed64(dst, kRecordIndexMagic);
+}
+
+Status RecordIndex::DecodeFrom(StringPiece input) {
+  if (input.size() < kFooterSize) {
+    return errors::DataLoss("record index is too short");
+  }
+  const char* footer = input.data() + input.size() - kFooterSize;
+  if (core::DecodeFixed64(footer + sizeof(uint64) + sizeof(uint32)) !=
+      kRecordIndexMagic) {
+    return errors::DataLoss("not a record index (bad magic number)");
+  }
+  const uint64 num_records = core::DecodeFixed64(footer);
+  if (num_records != (input.size() - kFooterSize) / sizeof(uint64) ||
+      (input.size() - kFooterSize) % sizeof(uint64) != 0) {
+    return errors::DataLoss("record index size does not match its ",
+                            num_records, " records");
+  }
+  const uint32 masked_crc = core::DecodeFixed32(footer + sizeof(uint64));
+  if (crc32c::Unmask(masked_crc) !=
+      crc32c::Value(input.data(), input.size() - kFooterSize + sizeof(uint64))) {
+    return errors::DataLoss("corrupted record index");
+  }
+  offsets_.resize(num_records);
+  for (uint64 i = 0; i < num_records; ++i) {
+    offsets_[i] = core::DecodeFixed64(input.data() + i * sizeof(uint64));
+    if (i > 0 && offsets_[i] <= offsets_[i - 1]) {
+      offsets_.clear();
+      return errors::DataLoss("record index offsets are not increasing");
+    }
+  }
+  return Status::OK();
+}
+
+Status RecordIndex::WriteToFile(Env* env, const string& fname) const {
+  string data;
+  EncodeTo(&data);
+  return WriteStringToFile(env, fname, data);
+}
+
+Status RecordIndex::ReadFromFile(Env* env, const string& fname) {
+  string data;
+  TF_RETURN_IF_ERROR(ReadFileToString(env, fname, &data));
+  Status s = DecodeFrom(data);
+  if (!s.ok()) {
+    return errors::DataLoss(s.error_message(), " in ", fname);
+  }
+  return Status::OK();
+}
+
+Status RecordIndex::BuildFromRecords(RandomAccessFile* file) {
+  offsets_.clear();
+  RecordReaderOptions options;
+  options.buffer_size = 256 << 10;
+  RecordReader reader(file, options);
+  uint64 offset = 0;
+  string record;
+  while (true) {
+    const uint64 record_offset = offset;
+    Status s = reader.ReadRecord(&offset, &record);
+    if (errors::IsOutOfRange(s)) {
+      return Status::OK();
+    }
+    if (!s.ok()) {
+      offsets_.clear();
+      return s;
+    }
+    offsets_.push_back(record_offset);
+  }
+}
+
+string RecordIndexFileName(const string& fname) {
+  return strings::StrCat(fname, kRecordIndexSuffix);
+}
+
+bool IsRecordIndexFileName(StringPiece fname) {
+  return fname.ends_with(kRecordIndexSuffix);
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,98 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LIB_IO_RECORD_INDEX_H_
+#define TENSORFLOW_LIB_IO_RECORD_INDEX_H_
+
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+class Env;
+class RandomAccessFile;
+
+namespace io {
+
+// The offsets of the records of an uncompressed TFRecord file, in order.
+// With an index, a RecordReader can start reading at the i-th record, so
+// that several readers can split one file, or records can be visited in a
+// permuted order.
+//
+// An index is stored in a sidecar file next to the records (see
+// RecordIndexFileName()) with the following layout:
+//   fixed64 offsets[num_records]
+//   fixed64 num_records
+//   fixed32 masked crc32c of all the preceding bytes
+//   fixed64 magic number
+//
+// Sidecars are not written automatically: a writer saves the index()
+// of a RecordWriter created with RecordWriterOptions::build_index, and
+// BuildFromRecords() indexes existing files.
+class RecordIndex {
+ public:
+  RecordIndex() {}
+  explicit RecordIndex(std::vector<uint64> offsets)
+      : offsets_(std::move(offsets)) {}
+
+  int64 num_records() const { return offsets_.size(); }
+
+  // REQUIRES: 0 <= i < num_records()
+  uint64 offset(int64 i) const { return offsets_[i]; }
+
+  const std::vector<uint64>& offsets() const { return offsets_; }
+
+  // Appends the offset of the next record.
+  void Add(uint64 offset) { offsets_.push_back(offset); }
+
+  void Clear() { offsets_.clear(); }
+
+  // Appends the serialized index to "*dst".
+  void EncodeTo(string* dst) const;
+
+  // Replaces the contents of this index with the serialized index in
+  // "input".  Returns DATA_LOSS if "input" is not a valid index.
+  Status DecodeFrom(StringPiece input);
+
+  // Writes the index to "fname", replacing any existing file.
+  Status WriteToFile(Env* env, const string& fname) const;
+
+  // Reads the index stored in "fname".
+  Status ReadFromFile(Env* env, const string& fname);
+
+  // Builds the index of an existing uncompressed TFRecord file by scanning
+  // it.  Fails if the file contains a corrupted record.
+  Status BuildFromRecords(RandomAccessFile* file);
+
+ private:
+  std::vector<uint64> offsets_;
+};
+
+// Returns the name of the sidecar file holding the index of the TFRecord
+// file "fname".
+string RecordIndexFileName(const string& fname);
+
+// Returns true if "fname" names a record index sidecar file, so that globs
+// over record files can skip them.
+bool IsRecordIndexFileName(StringPiece fname);
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_RECORD_INDEX_H_
@@ -0,0 +1,180 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/record_index.h"
+
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+string Record(int i) { return strings::StrCat("record_", i, string(i, 'x')); }
+
+// Writes "num_records" records to "fname" and returns their index.
+RecordIndex WriteRecords(const string& fname, int num_records) {
+  std::unique_ptr<WritableFile> file;
+  TF_CHECK_OK(Env::Default()->NewWritableFile(fname, &file));
+  RecordWriterOptions options;
+  options.build_index = true;
+  RecordWriter writer(file.get(), options);
+  for (int i = 0; i < num_records; ++i) {
+    TF_CHECK_OK(writer.WriteRecord(Record(i)));
+  }
+  TF_CHECK_OK(file->Close());
+  return writer.index();
+}
+
+TEST(RecordIndexTest, EncodeDecode) {
+  RecordIndex index({0, 17, 100, 1ull << 40});
+  string encoded;
+  index.EncodeTo(&encoded);
+
+  RecordIndex decoded;
+  TF_EXPECT_OK(decoded.DecodeFrom(encoded));
+  EXPECT_EQ(index.offsets(), decoded.offsets());
+
+  RecordIndex empty;
+  encoded.clear();
+  empty.EncodeTo(&encoded);
+  TF_EXPECT_OK(decoded.DecodeFrom(encoded));
+  EXPECT_EQ(0, decoded.num_records());
+}
+
+TEST(RecordIndexTest, DecodeDetectsCorruption) {
+  RecordIndex index({0, 17, 100});
+  string encoded;
+  index.EncodeTo(&encoded);
+
+  RecordIndex decoded;
+  EXPECT_TRUE(errors::IsDataLoss(decoded.DecodeFrom("")));
+  EXPECT_TRUE(errors::IsDataLoss(
+      decoded.DecodeFrom(StringPiece(encoded).substr(1))));
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    string corrupted = encoded;
+    corrupted[i] ^= 0x10;
+    EXPECT_TRUE(errors::IsDataLoss(decoded.DecodeFrom(corrupted))) << i;
+  }
+}
+
+TEST(RecordIndexTest, ReadRecordsByIndex) {
+  const string fname = testing::TmpDir() + "/record_index_test";
+  const int kNumRecords = 50;
+  const RecordIndex written = WriteRecords(fname, kNumRecords);
+  ASSERT_EQ(kNumRecords, written.num_records());
+  EXPECT_EQ(0, written.offset(0));
+
+  // Round trip through the sidecar file.
+  const string index_fname = RecordIndexFileName(fname);
+  EXPECT_TRUE(IsRecordIndexFileName(index_fname));
+  EXPECT_FALSE(IsRecordIndexFileName(fname));
+  TF_ASSERT_OK(written.WriteToFile(Env::Default(), index_fname));
+  RecordIndex index;
+  TF_ASSERT_OK(index.ReadFromFile(Env::Default(), index_fname));
+  EXPECT_EQ(written.offsets(), index.offsets());
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  for (int64 buffer_size : {0, 64, 1 << 20}) {
+    RecordReaderOptions options;
+    options.buffer_size = buffer_size;
+    RecordReader reader(file.get(), options);
+    string record;
+    // Backwards, then with a stride, to exercise seeking.
+    for (int i = kNumRecords - 1; i >= 0; --i) {
+      TF_ASSERT_OK(reader.ReadRecordAt(index, i, &record));
+      EXPECT_EQ(Record(i), record);
+    }
+    for (int i = 0; i < kNumRecords; i += 7) {
+      TF_ASSERT_OK(reader.ReadRecordAt(index, i, &record));
+      EXPECT_EQ(Record(i), record);
+    }
+    EXPECT_TRUE(
+        errors::IsOutOfRange(reader.ReadRecordAt(index, kNumRecords, &record)));
+    EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecordAt(index, -1, &record)));
+  }
+}
+
+TEST(RecordIndexTest, BuildFromRecords) {
+  const string fname = testing::TmpDir() + "/record_index_build_test";
+  const RecordIndex written = WriteRecords(fname, 30);
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  RecordIndex built;
+  TF_ASSERT_OK(built.BuildFromRecords(file.get()));
+  EXPECT_EQ(written.offsets(), built.offsets());
+}
+
+TEST(RecordIndexTest, AppendToIndexedFile) {
+  const string fname = testing::TmpDir() + "/record_index_append_test";
+  RecordIndex index = WriteRecords(fname, 5);
+
+  uint64 file_size;
+  TF_ASSERT_OK(Env::Default()->GetFileSize(fname, &file_size));
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_ASSERT_OK(Env::Default()->NewAppendableFile(fname, &file));
+    RecordWriterOptions options;
+    options.build_index = true;
+    options.initial_offset = file_size;
+    RecordWriter writer(file.get(), options);
+    for (int i = 5; i < 8; ++i) {
+      TF_ASSERT_OK(writer.WriteRecord(Record(i)));
+    }
+    TF_ASSERT_OK(file->Close());
+    ASSERT_EQ(3, writer.index().num_records());
+    EXPECT_EQ(file_size, writer.index().offset(0));
+    for (uint64 offset : writer.index().offsets()) {
+      index.Add(offset);
+    }
+  }
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  RecordIndex built;
+  TF_ASSERT_OK(built.BuildFromRecords(file.get()));
+  EXPECT_EQ(built.offsets(), index.offsets());
+}
+
+TEST(RecordIndexTest, ReadRecordAtRequiresUncompressedFile) {
+  const string fname = testing::TmpDir() + "/record_index_zlib_test";
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_ASSERT_OK(Env::Default()->NewWritableFile(fname, &file));
+    RecordWriter writer(file.get(),
+                        RecordWriterOptions::CreateRecordWriterOptions("ZLIB"));
+    TF_ASSERT_OK(writer.WriteRecord("abc"));
+  }
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  RecordReader reader(file.get(),
+                      RecordReaderOptions::CreateRecordReaderOptions("ZLIB"));
+  string record;
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      reader.ReadRecordAt(RecordIndex({0}), 0, &record)));
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tensorflow
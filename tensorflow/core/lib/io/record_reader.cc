@@ -16,13 +16,22 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_reader.h"
 
 #include <limits.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
 
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#if !defined(IS_SLIM_BUILD)
+#include "tensorflow/core/lib/io/snappy/snappy_inputstream.h"
+#endif  // IS_SLIM_BUILD
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 namespace io {
@@ -45,6 +54,12 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
                << " No compression will be used.";
 #else
     options.zlib_options = io::ZlibCompressionOptions::GZIP();
+#endif  // IS_SLIM_BUILD
+  } else if (compression_type == compression::kSnappy) {
+    options.compression_type = io::RecordReaderOptions::SNAPPY_COMPRESSION;
+#if defined(IS_SLIM_BUILD)
+    LOG(ERROR) << "Compression is not supported but compression_type is set."
+               << " No compression will be used.";
 #endif  // IS_SLIM_BUILD
   } else if (compression_type != compression::kNone) {
     LOG(ERROR) << "Unsupported compression_type:" << compression_type
@@ -53,8 +68,143 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
   return options;
 }
 
+// Reads the chunks of a file that follow the one last returned by
+// GetChunk() on a background thread, so that they are in memory by the time
+// the records in them are parsed.  Chunks stop at "limit".
+class RecordReader::Prefetcher {
+ public:
+  Prefetcher(Env* env, RandomAccessFile* file, size_t chunk_size,
+             int64 max_bytes, uint64 limit)
+      : file_(file),
+        chunk_size_(chunk_size),
+        max_bytes_(max_bytes),
+        limit_(limit) {
+    thread_.reset(env->StartThread(ThreadOptions(), "record_reader_prefetch",
+                                   [this]() { Loop(); }));
+  }
+
+  ~Prefetcher() {
+    {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+    }
+    cv_.notify_all();
+    thread_.reset();  // Joins the thread.
+  }
+
+  // Sets "*chunk" to the chunk_size bytes of the file at "offset", or to
+  // fewer bytes at the end of the file or at the limit.
+  // REQUIRES: offset < limit
+  Status GetChunk(uint64 offset, string* chunk) {
+    mutex_lock l(mu_);
+    const uint64 expected_offset =
+        ready_.empty() ? next_offset_ : ready_.front().offset;
+    if (offset != expected_offset) {
+      // The reader moved elsewhere: drop the chunks read so far.
+      ready_.clear();
+      ready_bytes_ = 0;
+      next_offset_ = offset;
+      ++generation_;
+      stopped_ = false;
+      cv_.notify_all();
+    } else if (ready_.empty() && stopped_) {
+      // Read again after reaching the end of the file (which may have grown
+      // since) or an error.
+      stopped_ = false;
+      cv_.notify_all();
+    }
+    while (ready_.empty()) {
+      cv_.wait(l);
+    }
+    Chunk& front = ready_.front();
+    chunk->swap(front.data);
+    Status s = front.status;
+    ready_bytes_ -= chunk->size();
+    ready_.pop_front();
+    cv_.notify_all();
+    return s;
+  }
+
+ private:
+  struct Chunk {
+    uint64 offset;
+    string data;
+    Status status;
+  };
+
+  void Loop() {
+    while (true) {
+      uint64 offset;
+      uint64 generation;
+      {
+        mutex_lock l(mu_);
+        while (!cancelled_ && (stopped_ || ready_bytes_ >= max_bytes_)) {
+          cv_.wait(l);
+        }
+        if (cancelled_) return;
+        offset = next_offset_;
+        generation = generation_;
+        if (offset >= limit_) {
+          stopped_ = true;
+          continue;
+        }
+      }
+
+      const size_t size = std::min<uint64>(chunk_size_, limit_ - offset);
+      Chunk chunk;
+      chunk.offset = offset;
+      chunk.data.resize(size);
+      StringPiece result;
+      chunk.status = file_->Read(offset, size, &result, &chunk.data[0]);
+      if (errors::IsOutOfRange(chunk.status)) {
+        // A short read at the end of the file.
+        chunk.status = Status::OK();
+      }
+      if (chunk.status.ok()) {
+        if (result.data() != chunk.data.data()) {
+          memmove(&chunk.data[0], result.data(), result.size());
+        }
+        chunk.data.resize(result.size());
+      } else {
+        chunk.data.clear();
+      }
+
+      mutex_lock l(mu_);
+      if (generation != generation_) continue;  // Stale read.
+      if (!chunk.status.ok() || chunk.data.size() < size ||
+          offset + size >= limit_) {
+        stopped_ = true;
+      }
+      next_offset_ += chunk.data.size();
+      ready_bytes_ += chunk.data.size();
+      ready_.push_back(std::move(chunk));
+      cv_.notify_all();
+    }
+  }
+
+  RandomAccessFile* const file_;  // Not owned.
+  const size_t chunk_size_;
+  const int64 max_bytes_;
+  const uint64 limit_;
+
+  mutex mu_;
+  condition_variable cv_;
+  std::deque<Chunk> ready_ GUARDED_BY(mu_);
+  int64 ready_bytes_ GUARDED_BY(mu_) = 0;
+  // The offset of the chunk read next by the thread.
+  uint64 next_offset_ GUARDED_BY(mu_) = 0;
+  // Incremented whenever the reader moves elsewhere in the file.
+  uint64 generation_ GUARDED_BY(mu_) = 0;
+  // True at the end of the file and after errors, until the next GetChunk().
+  // The thread only starts reading at the first GetChunk().
+  bool stopped_ GUARDED_BY(mu_) = true;
+  bool cancelled_ GUARDED_BY(mu_) = false;
+
+  std::unique_ptr<Thread> thread_;
+};
+
 RecordReader::RecordReader(RandomAccessFile* file,
-                           const RecordReaderOptions& options)
+                           const RecordReaderOptions& options, Env* env)
     : src_(file), options_(options) {
   if (options.compression_type == RecordReaderOptions::ZLIB_COMPRESSION) {
 // We don't have zlib available on all embedded platforms, so fail.
@@ -62,22 +212,103 @@ RecordReader::RecordReader(RandomAccessFile* file,
     LOG(FATAL) << "Zlib compression is unsupported on mobile platforms.";
 #else   // IS_SLIM_BUILD
     random_input_stream_.reset(new RandomAccessInputStream(file));
-    zlib_input_stream_.reset(new ZlibInputStream(
+    compressed_input_stream_.reset(new ZlibInputStream(
         random_input_stream_.get(), options.zlib_options.input_buffer_size,
         options.zlib_options.output_buffer_size, options.zlib_options));
+#endif  // IS_SLIM_BUILD
+  } else if (options.compression_type ==
+             RecordReaderOptions::SNAPPY_COMPRESSION) {
+#if defined(IS_SLIM_BUILD)
+    LOG(FATAL) << "Snappy compression is unsupported on mobile platforms.";
+#else   // IS_SLIM_BUILD
+    compressed_input_stream_.reset(
+        new SnappyInputStream(file, options.snappy_input_buffer_size,
+                              options.snappy_threads,
+                              options.snappy_max_block_size, env));
 #endif  // IS_SLIM_BUILD
   } else if (options.compression_type == RecordReaderOptions::NONE) {
-    // Nothing to do.
+    if (options.buffer_size > 0 && options.prefetch_size > 0) {
+      prefetcher_.reset(new Prefetcher(env, file, options.buffer_size,
+                                       options.prefetch_size,
+                                       options.read_ahead_limit));
+    }
   } else {
     LOG(FATAL) << "Unspecified compression type :" << options.compression_type;
   }
 }
 
 RecordReader::~RecordReader() {
-  zlib_input_stream_.reset(nullptr);
+  prefetcher_.reset(nullptr);
+  compressed_input_stream_.reset(nullptr);
   random_input_stream_.reset(nullptr);
 }
 
+Status RecordReader::AppendChunk(size_t n) {
+  const uint64 offset = buffer_offset_ + buffer_.size();
+  const uint64 limit = options_.read_ahead_limit;
+  const size_t chunk_size =
+      offset < limit ? std::min<uint64>(options_.buffer_size, limit - offset)
+                     : n;
+  size_t bytes_read;
+  if (prefetcher_ && offset < limit) {
+    string chunk;
+    TF_RETURN_IF_ERROR(prefetcher_->GetChunk(offset, &chunk));
+    bytes_read = chunk.size();
+    if (buffer_.empty()) {
+      buffer_.swap(chunk);
+    } else {
+      buffer_.append(chunk);
+    }
+  } else {
+    // Read straight into the end of the buffer.
+    const size_t old_size = buffer_.size();
+    buffer_.resize(old_size + chunk_size);
+    char* scratch = &buffer_[old_size];
+    StringPiece result;
+    Status s = src_->Read(offset, chunk_size, &result, scratch);
+    if (!s.ok() && !errors::IsOutOfRange(s)) {
+      buffer_.resize(old_size);
+      return s;
+    }
+    if (result.data() != scratch) {
+      memmove(scratch, result.data(), result.size());
+    }
+    bytes_read = result.size();
+    buffer_.resize(old_size + bytes_read);
+  }
+  if (bytes_read < chunk_size) {
+    buffer_eof_ = true;
+  }
+  return Status::OK();
+}
+
+Status RecordReader::ReadBuffered(uint64 offset, size_t n,
+                                  StringPiece* result) {
+  if (offset < buffer_offset_ || offset > buffer_offset_ + buffer_.size()) {
+    // Not a sequential read: start over at "offset".
+    buffer_.clear();
+    buffer_offset_ = offset;
+    buffer_eof_ = false;
+  }
+  if (offset + n > buffer_offset_ + buffer_.size()) {
+    // Drop the bytes before "offset", which have been parsed already, so
+    // that the buffer does not grow beyond one chunk plus one record.
+    buffer_.erase(0, offset - buffer_offset_);
+    buffer_offset_ = offset;
+    while (buffer_.size() < n && !buffer_eof_) {
+      TF_RETURN_IF_ERROR(AppendChunk(n - buffer_.size()));
+    }
+  }
+  const size_t available = std::min<uint64>(
+      n, buffer_offset_ + buffer_.size() - offset);
+  *result = StringPiece(buffer_.data() + (offset - buffer_offset_), available);
+  if (available < n) {
+    // The file may still be growing, so try to read more next time.
+    buffer_eof_ = false;
+  }
+  return Status::OK();
+}
+
 // Read n+4 bytes from file, verify that checksum of first n bytes is
 // stored in the last 4 bytes and store the first n bytes in *result.
 // May use *storage as backing store.
@@ -91,15 +322,15 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
   storage->resize(expected);
 
 #if !defined(IS_SLIM_BUILD)
-  if (zlib_input_stream_) {
-    // If we have a zlib compressed buffer, we assume that the
+  if (compressed_input_stream_) {
+    // If we have a compressed buffer, we assume that the
     // file is being read sequentially, and we use the underlying
     // implementation to read the data.
     //
     // No checks are done to validate that the file is being read
-    // sequentially.  At some point the zlib input buffer may support
+    // sequentially.  At some point the compressed input buffers may support
     // seeking, possibly inefficiently.
-    TF_RETURN_IF_ERROR(zlib_input_stream_->ReadNBytes(expected, storage));
+    TF_RETURN_IF_ERROR(compressed_input_stream_->ReadNBytes(expected, storage));
 
     if (storage->size() != expected) {
       if (storage->size() == 0) {
@@ -119,7 +350,15 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
     // This version supports reading from arbitrary offsets
     // since we are accessing the random access file directly.
     StringPiece data;
-    TF_RETURN_IF_ERROR(src_->Read(offset, expected, &data, &(*storage)[0]));
+    if (options_.buffer_size > 0) {
+      TF_RETURN_IF_ERROR(ReadBuffered(offset, expected, &data));
+      if (data.size() < expected) {
+        // Same as a short read from the file.
+        return errors::OutOfRange("eof");
+      }
+    } else {
+      TF_RETURN_IF_ERROR(src_->Read(offset, expected, &data, &(*storage)[0]));
+    }
     if (data.size() != expected) {
       if (data.size() == 0) {
         return errors::OutOfRange("eof");
@@ -172,5 +411,19 @@ Status RecordReader::ReadRecord(uint64* offset, string* record) {
   return Status::OK();
 }
 
+Status RecordReader::ReadRecordAt(const RecordIndex& index, int64 i,
+                                  string* record) {
+  if (options_.compression_type != RecordReaderOptions::NONE) {
+    return errors::FailedPrecondition(
+        "Compressed record files can not be read by record index");
+  }
+  if (i < 0 || i >= index.num_records()) {
+    return errors::OutOfRange("record ", i, " is out of range [0, ",
+                              index.num_records(), ")");
+  }
+  uint64 offset = index.offset(i);
+  return ReadRecord(&offset, record);
+}
+
 }  // namespace io
 }  // namespace tensorflow
@@ -16,42 +16,75 @@ limitations under the License.
 #ifndef TENSORFLOW_LIB_IO_RECORD_READER_H_
 #define TENSORFLOW_LIB_IO_RECORD_READER_H_
 
+#include <memory>
+
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/io/record_index.h"
 #if !defined(IS_SLIM_BUILD)
+#include "tensorflow/core/lib/io/inputstream_interface.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
 #endif  // IS_SLIM_BUILD
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 
-class RandomAccessFile;
-
 namespace io {
 
 class RecordReaderOptions {
  public:
-  enum CompressionType { NONE = 0, ZLIB_COMPRESSION = 1 };
+  enum CompressionType {
+    NONE = 0,
+    ZLIB_COMPRESSION = 1,
+    SNAPPY_COMPRESSION = 2
+  };
   CompressionType compression_type = NONE;
 
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
+  // If > 0, uncompressed records are parsed out of chunks of this many bytes
+  // read from the file, instead of reading every record with separate reads
+  // of its header and of its payload.  Best for sequential reading.
+  int64 buffer_size = 0;
+
+  // If > 0 and buffer_size > 0, a background thread reads the chunks
+  // following the one being parsed, keeping up to this many bytes ready.
+  int64 prefetch_size = 0;
+
+  // With buffer_size > 0, chunks are not read beyond this offset, e.g. the
+  // end of the records of the file that will be read.  Records that extend
+  // beyond it are still read in full, with reads of just their bytes.
+  uint64 read_ahead_limit = kuint64max;
+
 #if !defined(IS_SLIM_BUILD)
   // Options specific to zlib compression.
   ZlibCompressionOptions zlib_options;
 #endif  // IS_SLIM_BUILD
+
+  // Options specific to snappy compression.  The compressed file is read in
+  // chunks of snappy_input_buffer_size bytes, and if snappy_threads > 1, that
+  // many compressed blocks are decompressed concurrently on a thread pool
+  // owned by the reader.  Blocks that decompress to more than
+  // snappy_max_block_size bytes, i.e. that hold a record larger than that,
+  // fail with DATA_LOSS.
+  int64 snappy_input_buffer_size = 256 << 10;
+  int snappy_threads = 1;
+  int64 snappy_max_block_size = 256 << 20;
 };
 
 class RecordReader {
  public:
   // Create a reader that will return log records from "*file".
-  // "*file" must remain live while this Reader is in use.
+  // "*file" must remain live while this Reader is in use.  "env" runs the
+  // prefetching thread, if any.
   RecordReader(RandomAccessFile* file,
-               const RecordReaderOptions& options = RecordReaderOptions());
+               const RecordReaderOptions& options = RecordReaderOptions(),
+               Env* env = Env::Default());
 
   virtual ~RecordReader();
 
@@ -60,15 +93,43 @@ class RecordReader {
   // OUT_OF_RANGE for end of file, or something else for an error.
   Status ReadRecord(uint64* offset, string* record);
 
+  // Read the record number "i" of the file, as located by "index", into
+  // *record.  Returns OUT_OF_RANGE if the index has no record "i".  Only
+  // supported for uncompressed files.  Reading consecutive records this way
+  // is as efficient as calling ReadRecord().
+  Status ReadRecordAt(const RecordIndex& index, int64 i, string* record);
+
  private:
   Status ReadChecksummed(uint64 offset, size_t n, StringPiece* result,
                          string* storage);
 
+  // Like ReadChecksummed() for uncompressed files, when reading through
+  // buffer_.  Sets "*result" to the bytes at [offset, offset + n), or to
+  // fewer bytes at the end of the file.  "*result" is valid until the next
+  // call.
+  Status ReadBuffered(uint64 offset, size_t n, StringPiece* result);
+
+  // Appends the next chunk of the file, starting at buffer_offset_ +
+  // buffer_.size(), to buffer_.  Sets buffer_eof_ at the end of the file.
+  // Beyond options_.read_ahead_limit, appends only the "n" bytes needed.
+  Status AppendChunk(size_t n);
+
+  class Prefetcher;
+
   RandomAccessFile* src_;
   RecordReaderOptions options_;
+
+  // The bytes of the file at [buffer_offset_, buffer_offset_ +
+  // buffer_.size()) when options_.buffer_size > 0.
+  string buffer_;
+  uint64 buffer_offset_ = 0;
+  bool buffer_eof_ = false;
+  std::unique_ptr<Prefetcher> prefetcher_;
+
 #if !defined(IS_SLIM_BUILD)
   std::unique_ptr<RandomAccessInputStream> random_input_stream_;
-  std::unique_ptr<ZlibInputStream> zlib_input_stream_;
+  // The decompressed contents of a compressed file.
+  std::unique_ptr<InputStreamInterface> compressed_input_stream_;
 #endif  // IS_SLIM_BUILD
 
   TF_DISALLOW_COPY_AND_ASSIGN(RecordReader);
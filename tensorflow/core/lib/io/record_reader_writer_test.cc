@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/record_writer.h"
 
+#include <algorithm>
 #include <vector>
 #include "tensorflow/core/platform/env.h"
 
@@ -24,7 +25,10 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 
@@ -105,4 +109,220 @@ TEST(RecordReaderWriterTest, TestZlib) {
   }
 }
 
+static bool SnappyCompressionSupported() {
+  string out;
+  StringPiece in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  return port::Snappy_Compress(in.data(), in.size(), &out);
+}
+
+TEST(RecordReaderWriterTest, TestSnappy) {
+  if (!SnappyCompressionSupported()) {
+    fprintf(stderr, "Snappy disabled. Skipping test\n");
+    return;
+  }
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_snappy_test";
+
+  // Records of varying sizes, some larger than a compressed block.
+  std::vector<string> records;
+  for (int i = 0; i < 200; ++i) {
+    records.push_back(string(i * 37 % 3000, 'a' + i % 26));
+  }
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriterOptions options =
+        io::RecordWriterOptions::CreateRecordWriterOptions("SNAPPY");
+    options.snappy_block_size = 1024;
+    io::RecordWriter writer(file.get(), options);
+    for (const string& record : records) {
+      TF_EXPECT_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  for (int threads : {1, 4}) {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReaderOptions options =
+        io::RecordReaderOptions::CreateRecordReaderOptions("SNAPPY");
+    options.snappy_input_buffer_size = 100;
+    options.snappy_threads = threads;
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    string record;
+    for (const string& expected : records) {
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ(expected, record);
+    }
+    EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+  }
+
+  // Blocks larger than the limit are rejected rather than allocated.
+  {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReaderOptions options =
+        io::RecordReaderOptions::CreateRecordReaderOptions("SNAPPY");
+    options.snappy_max_block_size = 100;
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    string record;
+    EXPECT_TRUE(errors::IsDataLoss(reader.ReadRecord(&offset, &record)));
+  }
+}
+
+TEST(RecordReaderWriterTest, TestBuffered) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_buffered_test";
+
+  // Records of varying sizes, some larger than the read buffers.
+  std::vector<string> records;
+  for (int i = 0; i < 200; ++i) {
+    records.push_back(string((i * 37) % 300, 'a' + i % 26));
+  }
+  std::vector<uint64> offsets;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    uint64 offset = 0;
+    for (const string& record : records) {
+      offsets.push_back(offset);
+      TF_EXPECT_OK(writer.WriteRecord(record));
+      offset += record.size() + 16;
+    }
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  for (int prefetch_size : {0, 1, 1000}) {
+    for (int buf_size : {1, 7, 64, 1000, 65536}) {
+      std::unique_ptr<RandomAccessFile> read_file;
+      TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+      io::RecordReaderOptions options;
+      options.buffer_size = buf_size;
+      options.prefetch_size = prefetch_size;
+      io::RecordReader reader(read_file.get(), options);
+      uint64 offset = 0;
+      string record;
+      for (const string& expected : records) {
+        TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ(expected, record);
+      }
+      EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+
+      // Reading at earlier offsets restarts the buffer.
+      for (int i : {150, 3, 4, 199, 0}) {
+        offset = offsets[i];
+        TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ(records[i], record);
+      }
+    }
+  }
+}
+
+// Records the end of the furthest read of a file.
+class ReadExtentFile : public RandomAccessFile {
+ public:
+  explicit ReadExtentFile(RandomAccessFile* file) : file_(file) {}
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    {
+      mutex_lock l(mu_);
+      extent_ = std::max<uint64>(extent_, offset + n);
+    }
+    return file_->Read(offset, n, result, scratch);
+  }
+
+  uint64 extent() const {
+    mutex_lock l(mu_);
+    return extent_;
+  }
+
+ private:
+  RandomAccessFile* const file_;
+  mutable mutex mu_;
+  mutable uint64 extent_ GUARDED_BY(mu_) = 0;
+};
+
+TEST(RecordReaderWriterTest, TestBufferedReadAheadLimit) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_limit_test";
+
+  std::vector<string> records;
+  for (int i = 0; i < 20; ++i) {
+    records.push_back(string((i * 37) % 300, 'a' + i % 26));
+  }
+  std::vector<uint64> offsets;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    uint64 offset = 0;
+    for (const string& record : records) {
+      offsets.push_back(offset);
+      TF_EXPECT_OK(writer.WriteRecord(record));
+      offset += record.size() + 16;
+    }
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  for (int prefetch_size : {0, 1000}) {
+    for (int buf_size : {7, 64, 65536}) {
+      std::unique_ptr<RandomAccessFile> base_file;
+      TF_CHECK_OK(env->NewRandomAccessFile(fname, &base_file));
+      ReadExtentFile read_file(base_file.get());
+      io::RecordReaderOptions options;
+      options.buffer_size = buf_size;
+      options.prefetch_size = prefetch_size;
+      options.read_ahead_limit = offsets[10];
+      io::RecordReader reader(&read_file, options);
+      uint64 offset = 0;
+      string record;
+      for (int i = 0; i < 10; ++i) {
+        TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ(records[i], record);
+      }
+      EXPECT_LE(read_file.extent(), offsets[10]);
+
+      // Records beyond the limit are still read, without reading ahead.
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ(records[10], record);
+      EXPECT_EQ(offsets[11], read_file.extent());
+    }
+  }
+}
+
+TEST(RecordReaderWriterTest, TestBufferedGrowingFile) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_growing_test";
+
+  for (int prefetch_size : {0, 4096}) {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_CHECK_OK(file->Flush());
+
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReaderOptions options;
+    options.buffer_size = 1024;
+    options.prefetch_size = prefetch_size;
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    string record;
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("abc", record);
+    EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+
+    // Records appended after reaching the end of the file are read.
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_CHECK_OK(file->Flush());
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("defg", record);
+  }
+}
+
 }  // namespace tensorflow
@@ -18,6 +18,9 @@ limitations under the License.
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/io/compression.h"
+#if !defined(IS_SLIM_BUILD)
+#include "tensorflow/core/lib/io/snappy/snappy_outputbuffer.h"
+#endif  // IS_SLIM_BUILD
 #include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
@@ -26,6 +29,10 @@ namespace {
 bool IsZlibCompressed(RecordWriterOptions options) {
   return options.compression_type == RecordWriterOptions::ZLIB_COMPRESSION;
 }
+
+bool IsCompressed(RecordWriterOptions options) {
+  return options.compression_type != RecordWriterOptions::NONE;
+}
 }  // namespace
 
 RecordWriterOptions RecordWriterOptions::CreateRecordWriterOptions(
@@ -46,6 +53,12 @@ RecordWriterOptions RecordWriterOptions::CreateRecordWriterOptions(
                << " No compression will be used.";
 #else
     options.zlib_options = io::ZlibCompressionOptions::GZIP();
+#endif  // IS_SLIM_BUILD
+  } else if (compression_type == compression::kSnappy) {
+    options.compression_type = io::RecordWriterOptions::SNAPPY_COMPRESSION;
+#if defined(IS_SLIM_BUILD)
+    LOG(ERROR) << "Compression is not supported but compression_type is set."
+               << " No compression will be used.";
 #endif  // IS_SLIM_BUILD
   } else if (compression_type != compression::kNone) {
     LOG(ERROR) << "Unsupported compression_type:" << compression_type
@@ -56,7 +69,7 @@ RecordWriterOptions RecordWriterOptions::CreateRecordWriterOptions(
 
 RecordWriter::RecordWriter(WritableFile* dest,
                            const RecordWriterOptions& options)
-    : dest_(dest), options_(options) {
+    : dest_(dest), options_(options), offset_(options.initial_offset) {
   if (IsZlibCompressed(options)) {
 // We don't have zlib available on all embedded platforms, so fail.
 #if defined(IS_SLIM_BUILD)
@@ -71,17 +84,34 @@ RecordWriter::RecordWriter(WritableFile* dest,
                  << s.ToString();
     }
     dest_ = zlib_output_buffer;
+#endif  // IS_SLIM_BUILD
+  } else if (options.compression_type ==
+             RecordWriterOptions::SNAPPY_COMPRESSION) {
+#if defined(IS_SLIM_BUILD)
+    LOG(FATAL) << "Snappy compression is unsupported on mobile platforms.";
+#else   // IS_SLIM_BUILD
+    dest_ = new SnappyOutputBuffer(dest, options.snappy_block_size,
+                                   options.snappy_output_buffer_size);
 #endif  // IS_SLIM_BUILD
   } else if (options.compression_type == RecordWriterOptions::NONE) {
     // Nothing to do
   } else {
     LOG(FATAL) << "Unspecified compression type :" << options.compression_type;
   }
+  if (options.compression_type != RecordWriterOptions::NONE) {
+    if (options.build_index) {
+      LOG(FATAL) << "Record indices are only supported for uncompressed "
+                    "files.";
+    }
+    if (options.initial_offset > 0) {
+      LOG(FATAL) << "Appending is only supported for uncompressed files.";
+    }
+  }
 }
 
 RecordWriter::~RecordWriter() {
 #if !defined(IS_SLIM_BUILD)
-  if (IsZlibCompressed(options_)) {
+  if (IsCompressed(options_)) {
     Status s = dest_->Close();
     if (!s.ok()) {
       LOG(ERROR) << "Could not finish writing file: " << s;
@@ -110,11 +140,16 @@ Status RecordWriter::WriteRecord(StringPiece data) {
 
   TF_RETURN_IF_ERROR(dest_->Append(StringPiece(header, sizeof(header))));
   TF_RETURN_IF_ERROR(dest_->Append(data));
-  return dest_->Append(StringPiece(footer, sizeof(footer)));
+  TF_RETURN_IF_ERROR(dest_->Append(StringPiece(footer, sizeof(footer))));
+  if (options_.build_index) {
+    index_.Add(offset_);
+  }
+  offset_ += sizeof(header) + data.size() + sizeof(footer);
+  return Status::OK();
 }
 
 Status RecordWriter::Flush() {
-  if (IsZlibCompressed(options_)) {
+  if (IsCompressed(options_)) {
     return dest_->Flush();
   }
   return Status::OK();
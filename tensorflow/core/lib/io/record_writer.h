@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/io/record_index.h"
 #if !defined(IS_SLIM_BUILD)
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_outputbuffer.h"
@@ -33,22 +34,46 @@ namespace io {
 
 class RecordWriterOptions {
  public:
-  enum CompressionType { NONE = 0, ZLIB_COMPRESSION = 1 };
+  enum CompressionType {
+    NONE = 0,
+    ZLIB_COMPRESSION = 1,
+    SNAPPY_COMPRESSION = 2
+  };
   CompressionType compression_type = NONE;
 
   static RecordWriterOptions CreateRecordWriterOptions(
       const string& compression_type);
 
+  // If true, the writer records the offset of every record it writes in
+  // index(), to be saved next to the file with RecordIndex::WriteToFile().
+  // Only supported for uncompressed files.
+  bool build_index = false;
+
+  // The size of the destination file when the writer is created, e.g. from
+  // Env::GetFileSize() when appending to an existing file, so that the
+  // offsets in index() are those of the file.  index() then only holds the
+  // records written by this writer, which follow those of the file's existing
+  // index.
+  uint64 initial_offset = 0;
+
 // Options specific to zlib compression.
 #if !defined(IS_SLIM_BUILD)
   ZlibCompressionOptions zlib_options;
 #endif  // IS_SLIM_BUILD
+
+  // Options specific to snappy compression.  Records are compressed in
+  // independent blocks of snappy_block_size uncompressed bytes (or one block
+  // per record, for larger records), which readers can decompress
+  // concurrently.
+  int32 snappy_block_size = 256 << 10;
+  int32 snappy_output_buffer_size = 256 << 10;
 };
 
 class RecordWriter {
  public:
   // Create a writer that will append data to "*dest".
-  // "*dest" must be initially empty.
+  // "*dest" must be initially empty, or hold options.initial_offset bytes of
+  // uncompressed records.
   // "*dest" must remain live while this Writer is in use.
   RecordWriter(WritableFile* dest,
                const RecordWriterOptions& options = RecordWriterOptions());
@@ -62,9 +87,16 @@ class RecordWriter {
   // WritableFile.
   Status Flush();
 
+  // The offsets of the records written so far, if options.build_index is
+  // set.
+  const RecordIndex& index() const { return index_; }
+
  private:
   WritableFile* dest_;
   RecordWriterOptions options_;
+  // The offset at which the next record starts.
+  uint64 offset_;
+  RecordIndex index_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(RecordWriter);
 };
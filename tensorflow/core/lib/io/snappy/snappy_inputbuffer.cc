@@ -129,7 +129,7 @@ Status SnappyInputBuffer::ReadCompressedBlockLength(uint32* length) {
     size_t readable = std::min(bytes_to_read, avail_in_);
 
     for (int i = 0; i < readable; i++) {
-      *length = (*length << 8) | next_in_[0];
+      *length = (*length << 8) | static_cast<uint8>(next_in_[0]);
       bytes_to_read--;
       next_in_++;
       avail_in_--;
@@ -89,7 +89,7 @@ class SnappyInputBuffer : public InputStreamInterface {
   size_t ReadBytesFromCache(size_t bytes_to_read, string* result);
 
   // Reads the length of the next *compressed* block and stores in `length`.
-  // The length is stored in 4 bytes in little endian notation.
+  // The length is stored in 4 bytes in big endian notation.
   Status ReadCompressedBlockLength(uint32* length);
 
   RandomAccessFile* file_;         // Not owned
@@ -0,0 +1,177 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/snappy/snappy_inputstream.h"
+
+#include <algorithm>
+#include <vector>
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/snappy.h"
+
+namespace tensorflow {
+namespace io {
+
+namespace {
+
+// Upper bound of the compressed size of `bytes` bytes, as computed by
+// snappy::MaxCompressedLength().
+int64 MaxCompressedLength(int64 bytes) { return 32 + bytes + bytes / 6; }
+
+Status Uncompress(const string& compressed, int64 max_block_bytes,
+                  string* output) {
+  size_t length;
+  if (!port::Snappy_GetUncompressedLength(compressed.data(), compressed.size(),
+                                          &length)) {
+    return errors::DataLoss("Parsing error in Snappy_GetUncompressedLength");
+  }
+  // The length comes from the file, so it is checked before allocating.
+  if (length > static_cast<uint64>(max_block_bytes)) {
+    return errors::DataLoss("Snappy block of ", length,
+                            " uncompressed bytes exceeds the limit of ",
+                            max_block_bytes, ". Possible data corruption.");
+  }
+  output->resize(length);
+  if (!port::Snappy_Uncompress(compressed.data(), compressed.size(),
+                               &(*output)[0])) {
+    return errors::DataLoss("Snappy_Uncompress failed");
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+SnappyInputStream::SnappyInputStream(RandomAccessFile* file,
+                                     size_t input_buffer_bytes,
+                                     int num_threads, int64 max_block_bytes,
+                                     Env* env)
+    : input_(file, input_buffer_bytes),
+      blocks_per_batch_(std::max(num_threads, 1)),
+      max_block_bytes_(max_block_bytes) {
+  if (num_threads > 1) {
+    thread_pool_.reset(
+        new thread::ThreadPool(env, "snappy_inputstream", num_threads));
+  }
+}
+
+SnappyInputStream::~SnappyInputStream() {}
+
+Status SnappyInputStream::ReadNBytes(int64 bytes_to_read, string* result) {
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Can't read a negative number of bytes: ",
+                                   bytes_to_read);
+  }
+  result->clear();
+  result->reserve(bytes_to_read);
+  while (result->size() < static_cast<size_t>(bytes_to_read)) {
+    if (blocks_.empty()) {
+      if (eof_) {
+        return errors::OutOfRange("EOF reached");
+      }
+      TF_RETURN_IF_ERROR(ReadBlocks());
+      continue;
+    }
+    const string& front = blocks_.front();
+    const size_t bytes_to_copy = std::min<size_t>(
+        front.size() - pos_in_front_, bytes_to_read - result->size());
+    result->append(front, pos_in_front_, bytes_to_copy);
+    pos_in_front_ += bytes_to_copy;
+    bytes_read_ += bytes_to_copy;
+    if (pos_in_front_ == front.size()) {
+      blocks_.pop_front();
+      pos_in_front_ = 0;
+    }
+  }
+  return Status::OK();
+}
+
+int64 SnappyInputStream::Tell() const { return bytes_read_; }
+
+Status SnappyInputStream::Reset() {
+  TF_RETURN_IF_ERROR(input_.Reset());
+  blocks_.clear();
+  pos_in_front_ = 0;
+  bytes_read_ = 0;
+  eof_ = false;
+  return Status::OK();
+}
+
+Status SnappyInputStream::ReadBlocks() {
+  // The compressed blocks are read sequentially, which is cheap compared to
+  // decompressing them.
+  std::vector<string> compressed;
+  for (int i = 0; i < blocks_per_batch_; ++i) {
+    string length_bytes;
+    Status s = input_.ReadNBytes(4, &length_bytes);
+    if (errors::IsOutOfRange(s) && length_bytes.empty()) {
+      eof_ = true;
+      break;
+    } else if (errors::IsOutOfRange(s)) {
+      return errors::DataLoss("Truncated snappy block length");
+    }
+    TF_RETURN_IF_ERROR(s);
+    uint32 length = 0;
+    for (int j = 0; j < 4; ++j) {
+      length = (length << 8) | static_cast<uint8>(length_bytes[j]);
+    }
+
+    if (length > MaxCompressedLength(max_block_bytes_)) {
+      return errors::DataLoss("Snappy block of ", length,
+                              " compressed bytes exceeds the limit of ",
+                              MaxCompressedLength(max_block_bytes_),
+                              ". Possible data corruption.");
+    }
+
+    compressed.emplace_back();
+    s = input_.ReadNBytes(length, &compressed.back());
+    if (errors::IsOutOfRange(s)) {
+      return errors::DataLoss("Failed to read ", length,
+                              " bytes of snappy block. Possible data "
+                              "corruption.");
+    }
+    TF_RETURN_IF_ERROR(s);
+  }
+
+  std::vector<string> uncompressed(compressed.size());
+  std::vector<Status> statuses(compressed.size());
+  if (thread_pool_ != nullptr && compressed.size() > 1) {
+    BlockingCounter counter(compressed.size());
+    for (size_t i = 0; i < compressed.size(); ++i) {
+      thread_pool_->Schedule([this, &compressed, &uncompressed, &statuses,
+                              &counter, i]() {
+        statuses[i] =
+            Uncompress(compressed[i], max_block_bytes_, &uncompressed[i]);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  } else {
+    for (size_t i = 0; i < compressed.size(); ++i) {
+      statuses[i] =
+          Uncompress(compressed[i], max_block_bytes_, &uncompressed[i]);
+    }
+  }
+
+  for (size_t i = 0; i < compressed.size(); ++i) {
+    TF_RETURN_IF_ERROR(statuses[i]);
+    if (!uncompressed[i].empty()) {
+      blocks_.push_back(std::move(uncompressed[i]));
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,99 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LIB_IO_SNAPPY_INPUTSTREAM_H_
+#define TENSORFLOW_LIB_IO_SNAPPY_INPUTSTREAM_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/buffered_inputstream.h"
+#include "tensorflow/core/lib/io/inputstream_interface.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace io {
+
+// A SnappyInputStream reads a file written by SnappyOutputBuffer: a sequence
+// of independently compressed snappy blocks, each preceded by its
+// compressed length in 4 big-endian bytes.
+//
+// Unlike SnappyInputBuffer, blocks may be of any size, and several blocks
+// can be decompressed concurrently: with `num_threads` > 1, the stream reads
+// the next `num_threads` compressed blocks at once and decompresses them on
+// a thread pool.  Blocks that decompress to more than `max_block_bytes` are
+// rejected as corrupted, since their length is read from the file.
+//
+// A given instance of a SnappyInputStream is NOT safe for concurrent use
+// by multiple threads.
+class SnappyInputStream : public InputStreamInterface {
+ public:
+  // Create a SnappyInputStream for `file` that reads the compressed data in
+  // chunks of `input_buffer_bytes` bytes.  Does *not* take ownership of
+  // "file".
+  SnappyInputStream(RandomAccessFile* file, size_t input_buffer_bytes,
+                    int num_threads, int64 max_block_bytes,
+                    Env* env = Env::Default());
+
+  ~SnappyInputStream() override;
+
+  // Reads bytes_to_read bytes into *result, overwriting *result.
+  //
+  // Return Status codes:
+  // OK:
+  //   If successful.
+  // OUT_OF_RANGE:
+  //   If there are not enough bytes to read before the end of the file.
+  // DATA_LOSS:
+  //   If uncompression failed, if a block is larger than `max_block_bytes`
+  //   or if the file is corrupted.
+  // others:
+  //   If reading from file failed.
+  Status ReadNBytes(int64 bytes_to_read, string* result) override;
+
+  int64 Tell() const override;
+
+  Status Reset() override;
+
+ private:
+  // Reads up to `blocks_per_batch_` compressed blocks from `input_` and
+  // appends them, decompressed, to `blocks_`.  Sets `eof_` at the end of the
+  // file.
+  Status ReadBlocks();
+
+  BufferedInputStream input_;
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+  const int blocks_per_batch_;
+  const int64 max_block_bytes_;
+
+  // Decompressed blocks that have not been fully consumed yet.
+  std::deque<string> blocks_;
+  // Number of consumed bytes of blocks_.front().
+  size_t pos_in_front_ = 0;
+  // Number of decompressed bytes returned so far.
+  int64 bytes_read_ = 0;
+  bool eof_ = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SnappyInputStream);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_SNAPPY_INPUTSTREAM_H_
@@ -70,12 +70,23 @@ Status SnappyOutputBuffer::Write(StringPiece data) {
   return Status::OK();
 }
 
+Status SnappyOutputBuffer::Append(const StringPiece& data) {
+  return Write(data);
+}
+
 Status SnappyOutputBuffer::Flush() {
   TF_RETURN_IF_ERROR(DeflateBuffered());
   TF_RETURN_IF_ERROR(FlushOutputBufferToFile());
   return Status::OK();
 }
 
+Status SnappyOutputBuffer::Sync() {
+  TF_RETURN_IF_ERROR(Flush());
+  return file_->Sync();
+}
+
+Status SnappyOutputBuffer::Close() { return Flush(); }
+
 int32 SnappyOutputBuffer::AvailableInputSpace() const {
   return input_buffer_capacity_ - avail_in_;
 }
@@ -164,7 +175,7 @@ Status SnappyOutputBuffer::Deflate() {
   char* compressed_length_array = new char[4];
   std::fill(compressed_length_array, compressed_length_array + 4, 0);
   for (int i = 0; i < 4; i++) {
-    // Little endian.
+    // Big endian.
     compressed_length_array[i] = output.size() >> (8 * (3 - i));
   }
   TF_RETURN_IF_ERROR(AddToOutputBuffer(compressed_length_array, 4));
@@ -40,10 +40,12 @@ namespace io {
 // Output file format:
 // The output file consists of a sequence of compressed blocks. Each block
 // starts with a 4 byte header which stores the length (in bytes) of the
-// _compressed_ block _excluding_ this header. The compressed
-// block (excluding the 4 byte header) is a valid snappy block and can directly
-// be uncompressed using Snappy_Uncompress.
-class SnappyOutputBuffer {
+// _compressed_ block _excluding_ this header, in big endian order. The
+// compressed block (excluding the 4 byte header) is a valid snappy block and
+// can directly be uncompressed using Snappy_Uncompress.  Blocks are
+// compressed independently of each other, so they can be uncompressed
+// concurrently (see SnappyInputStream).
+class SnappyOutputBuffer : public WritableFile {
  public:
   // Create an SnappyOutputBuffer for `file` with two buffers that cache the
   // 1. input data to be deflated
@@ -63,9 +65,18 @@ class SnappyOutputBuffer {
   // To immediately write contents to file call `Flush()`.
   Status Write(StringPiece data);
 
+  // Same as Write(), so that a SnappyOutputBuffer can stand in for `file`.
+  Status Append(const StringPiece& data) override;
+
   // Compresses any cached input and writes all output to file. This must be
   // called before the destructor to avoid any data loss.
-  Status Flush();
+  Status Flush() override;
+
+  // Flushes and then syncs `file`.
+  Status Sync() override;
+
+  // Same as Flush(). Does *not* close `file`.
+  Status Close() override;
 
  private:
   // Appends `data` to `input_buffer_`.
@@ -54,6 +54,14 @@ class Table {
   // call one of the Seek methods on the iterator before using it).
   Iterator* NewIterator() const;
 
+  // Looks up "key" and, if the table contains it, stores the associated
+  // value in "*value".  Returns NotFound if the key is not present.
+  //
+  // Unlike a Seek() on NewIterator(), this consults the table's filter
+  // block (see Options::filter_policy) and so usually answers negative
+  // lookups without reading any data block.
+  Status Get(const StringPiece& key, string* value) const;
+
   // Given a key, return an approximate byte offset in the file where
   // the data for that key begins (or would begin if the key were
   // present in the file).  The returned value is in terms of file
@@ -74,7 +82,10 @@ class Table {
   // that key is not present.
   Status InternalGet(const StringPiece& key, void* arg,
                      void (*handle_result)(void* arg, const StringPiece& k,
-                                           const StringPiece& v));
+                                           const StringPiece& v)) const;
+
+  void ReadMeta(const Footer& footer);
+  void ReadFilter(const StringPiece& filter_handle_value);
 
   // No copying allowed
   Table(const Table&);
@@ -21,6 +21,9 @@ limitations under the License.
 namespace tensorflow {
 namespace table {
 
+class Cache;
+class FilterPolicy;
+
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
 // being stored in a file.  The following enum describes which
@@ -60,6 +63,24 @@ struct Options {
   // incompressible, the kSnappyCompression implementation will
   // efficiently detect that and will switch to uncompressed mode.
   CompressionType compression = kSnappyCompression;
+
+  // If non-NULL, use the specified cache for blocks read by Table::Open()d
+  // tables.  A single cache may be shared by many tables; each table
+  // partitions the key space with its own Cache::NewId().  Blocks that
+  // are read from an mmap-ed or otherwise zero-copy file are not cached.
+  //
+  // Default: NULL, i.e. every block is re-read and re-parsed on access.
+  Cache* block_cache = nullptr;
+
+  // If non-NULL, TableBuilder writes a filter block built with this policy
+  // (e.g. NewBloomFilterPolicy() from filter_policy.h), and Table::Get()
+  // consults the filter to skip data blocks that cannot contain a key.
+  // Readers must use a policy with the same Name() as the writer to make
+  // use of the filter; tables without a matching filter are still read
+  // correctly.
+  //
+  // Default: NULL
+  const FilterPolicy* filter_policy = nullptr;
 };
 
 }  // namespace table
@@ -20,13 +20,17 @@ limitations under the License.
 #include <string>
 #include <vector>
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/block.h"
 #include "tensorflow/core/lib/io/block_builder.h"
+#include "tensorflow/core/lib/io/cache.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
 #include "tensorflow/core/lib/io/format.h"
 #include "tensorflow/core/lib/io/iterator.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/test.h"
@@ -224,11 +228,17 @@ class TableConstructor : public Constructor {
     // Open the table
     source_ = new StringSource(sink.contents());
     Options table_options;
+    table_options.block_cache = options.block_cache;
+    table_options.filter_policy = options.filter_policy;
     return Table::Open(table_options, source_, sink.contents().size(), &table_);
   }
 
   virtual Iterator* NewIterator() const { return table_->NewIterator(); }
 
+  Status Get(const StringPiece& key, string* value) const {
+    return table_->Get(key, value);
+  }
+
   uint64 ApproximateOffsetOf(const StringPiece& key) const {
     return table_->ApproximateOffsetOf(key);
   }
@@ -597,6 +607,151 @@ TEST(TableTest, ApproximateOffsetOfCompressed) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 4000, 7000));
 }
 
+TEST(TableTest, Get) {
+  TableConstructor c;
+  c.Add("k01", "hello");
+  c.Add("k02", "hello2");
+  c.Add("k03", string(3000, 'x'));
+  c.Add("k04", "hello4");
+  std::vector<string> keys;
+  KVMap kvmap;
+  Options options;
+  options.block_size = 1024;
+  options.compression = kNoCompression;
+  c.Finish(options, &keys, &kvmap);
+
+  string value;
+  TF_EXPECT_OK(c.Get("k01", &value));
+  EXPECT_EQ("hello", value);
+  TF_EXPECT_OK(c.Get("k03", &value));
+  EXPECT_EQ(string(3000, 'x'), value);
+  TF_EXPECT_OK(c.Get("k04", &value));
+  EXPECT_EQ("hello4", value);
+  EXPECT_TRUE(errors::IsNotFound(c.Get("k00", &value)));
+  EXPECT_TRUE(errors::IsNotFound(c.Get("k02a", &value)));
+  EXPECT_TRUE(errors::IsNotFound(c.Get("k05", &value)));
+}
+
+TEST(TableTest, BlockCacheAvoidsRereads) {
+  std::unique_ptr<Cache> cache(NewLRUCache(1 << 20));
+  TableConstructor c;
+  c.Add("k01", "hello");
+  c.Add("k02", string(10000, 'x'));
+  c.Add("k03", "hello3");
+  std::vector<string> keys;
+  KVMap kvmap;
+  Options options;
+  options.block_size = 1024;
+  options.compression = kNoCompression;
+  options.block_cache = cache.get();
+  c.Finish(options, &keys, &kvmap);
+
+  const uint64 bytes_after_open = c.BytesRead();
+  for (int i = 0; i < 2; ++i) {
+    Iterator* iter = c.NewIterator();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    }
+    TF_EXPECT_OK(iter->status());
+    delete iter;
+  }
+  const uint64 bytes_after_scan = c.BytesRead();
+  EXPECT_GT(bytes_after_scan - bytes_after_open, 10000);
+  EXPECT_GT(cache->TotalCharge(), 10000);
+
+  // Every data block is now cached: neither scans nor point lookups
+  // touch the file again.
+  Iterator* iter = c.NewIterator();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+  }
+  delete iter;
+  string value;
+  TF_EXPECT_OK(c.Get("k02", &value));
+  EXPECT_EQ(string(10000, 'x'), value);
+  EXPECT_EQ(bytes_after_scan, c.BytesRead());
+}
+
+TEST(TableTest, BlockCacheSharedAcrossTables) {
+  std::unique_ptr<Cache> cache(NewLRUCache(1 << 20));
+  Options options;
+  options.compression = kNoCompression;
+  options.block_cache = cache.get();
+  std::vector<string> keys;
+  KVMap kvmap;
+
+  TableConstructor c1;
+  c1.Add("k01", "table1");
+  c1.Finish(options, &keys, &kvmap);
+  TableConstructor c2;
+  c2.Add("k01", "table2");
+  c2.Finish(options, &keys, &kvmap);
+
+  // Both tables store their only block at offset 0; the cache must
+  // keep them apart.
+  string value;
+  TF_EXPECT_OK(c1.Get("k01", &value));
+  EXPECT_EQ("table1", value);
+  TF_EXPECT_OK(c2.Get("k01", &value));
+  EXPECT_EQ("table2", value);
+  TF_EXPECT_OK(c1.Get("k01", &value));
+  EXPECT_EQ("table1", value);
+}
+
+TEST(TableTest, FilterSkipsDataBlocks) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  TableConstructor c;
+  for (int i = 0; i < 1000; i += 2) {
+    c.Add(strings::Printf("k%05d", i), string(100, 'v'));
+  }
+  std::vector<string> keys;
+  KVMap kvmap;
+  Options options;
+  options.block_size = 1024;
+  options.compression = kNoCompression;
+  options.filter_policy = policy.get();
+  c.Finish(options, &keys, &kvmap);
+
+  string value;
+  for (int i = 0; i < 1000; i += 2) {
+    TF_EXPECT_OK(c.Get(strings::Printf("k%05d", i), &value));
+  }
+
+  // Lookups of absent keys that fall between present ones mostly avoid
+  // reading data blocks.
+  const uint64 bytes_before = c.BytesRead();
+  int reads = 0;
+  for (int i = 1; i < 1000; i += 2) {
+    const uint64 before = c.BytesRead();
+    EXPECT_TRUE(errors::IsNotFound(c.Get(strings::Printf("k%05d", i), &value)));
+    if (c.BytesRead() != before) ++reads;
+  }
+  EXPECT_LT(reads, 25);
+  EXPECT_LT(c.BytesRead() - bytes_before, 25 * 1500);
+}
+
+TEST(TableTest, IterateTableWithFilter) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  TableConstructor c;
+  c.Add("k01", "hello");
+  c.Add("k02", "hello2");
+  std::vector<string> keys;
+  KVMap kvmap;
+  Options options;
+  options.filter_policy = policy.get();
+  c.Finish(options, &keys, &kvmap);
+
+  // The filter block must not show up as table contents.
+  Iterator* iter = c.NewIterator();
+  iter->SeekToFirst();
+  ASSERT_TRUE(iter->Valid());
+  EXPECT_EQ("k01", iter->key());
+  iter->Next();
+  ASSERT_TRUE(iter->Valid());
+  EXPECT_EQ("k02", iter->key());
+  iter->Next();
+  EXPECT_FALSE(iter->Valid());
+  delete iter;
+}
+
 TEST(TableTest, SeekToFirstKeyDoesNotReadTooMuch) {
   random::PhiloxRandom philox(301, 17);
   random::SimplePhilox rnd(&philox);
@@ -70,6 +70,16 @@ class FewerArgsForCompiler {
   int stride_;
 };
 
+// Returns true if the crop window in `flags` lies within an image of the
+// given size.
+bool IsCropWindowValid(const UncompressFlags& flags, int input_image_width,
+                       int input_image_height) {
+  return flags.crop_width > 0 && flags.crop_height > 0 && flags.crop_x >= 0 &&
+         flags.crop_y >= 0 &&
+         flags.crop_y + flags.crop_height <= input_image_height &&
+         flags.crop_x + flags.crop_width <= input_image_width;
+}
+
 uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
   // unpack the argball
   const int datasize = argball->datasize_;
@@ -159,8 +169,65 @@ uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
     return nullptr;
   }
 
+  // The size of the returned image, which is the size of the crop window when
+  // cropping.
+  int target_output_width = cinfo.output_width;
+  int target_output_height = cinfo.output_height;
+  // The number of rows above the crop window.
+  int skipped_scanlines = 0;
+  // The offset of the crop window in the scanlines returned by libjpeg.
+  int crop_x_offset = 0;
+  if (flags.crop) {
+    if (!IsCropWindowValid(flags, cinfo.output_width, cinfo.output_height)) {
+      LOG(ERROR) << "Invalid crop window: x=" << flags.crop_x
+                 << ", y=" << flags.crop_y << ", w=" << flags.crop_width
+                 << ", h=" << flags.crop_height << " for image_width: "
+                 << cinfo.output_width
+                 << " and image_height: " << cinfo.output_height;
+      jpeg_destroy_decompress(&cinfo);
+      return nullptr;
+    }
+    target_output_width = flags.crop_width;
+    target_output_height = flags.crop_height;
+
+#ifdef LIBJPEG_TURBO_VERSION
+    // Only transform the MCU columns overlapping the window.  libjpeg moves
+    // the left edge of the window to an MCU boundary and widens it to match,
+    // updating cinfo.output_width, so the decoded scanlines may start to the
+    // left of crop_x.  The window is also widened by one pixel on each side,
+    // where possible, as fancy upsampling replicates the chroma samples at
+    // the edges of the decoded region instead of interpolating them.
+    JDIMENSION crop_x = flags.crop_x;
+    JDIMENSION crop_width = flags.crop_width;
+    if (crop_x > 0) {
+      --crop_x;
+      ++crop_width;
+    }
+    if (crop_x + crop_width < cinfo.output_width) {
+      ++crop_width;
+    }
+    jpeg_crop_scanline(&cinfo, &crop_x, &crop_width);
+    crop_x_offset = flags.crop_x - crop_x;
+
+    // Skip the rows above the window, which only requires entropy decoding.
+    skipped_scanlines = jpeg_skip_scanlines(&cinfo, flags.crop_y);
+    if (skipped_scanlines != flags.crop_y) {
+      LOG(ERROR) << "Skipped " << skipped_scanlines << " lines instead of "
+                 << flags.crop_y;
+      jpeg_destroy_decompress(&cinfo);
+      return nullptr;
+    }
+#else
+    // jpeg_crop_scanline() and jpeg_skip_scanlines() need libjpeg-turbo
+    // 1.5 or later.  Other libjpegs decode whole rows: the rows above the
+    // window are read and dropped below, and the columns outside it are
+    // dropped when copying each scanline.
+    crop_x_offset = flags.crop_x;
+#endif  // LIBJPEG_TURBO_VERSION
+  }
+
   // check for compatible stride
-  const int min_stride = cinfo.output_width * components * sizeof(JSAMPLE);
+  const int min_stride = target_output_width * components * sizeof(JSAMPLE);
   if (stride == 0) {
     stride = min_stride;
   } else if (stride < min_stride) {
@@ -170,34 +237,58 @@ uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
   }
 
   // Remember stride and height for use in Uncompress
-  argball->height_ = cinfo.output_height;
+  argball->height_ = target_output_height;
   argball->stride_ = stride;
 
   uint8* const dstdata = argball->allocate_output_(
-      cinfo.output_width, cinfo.output_height, components);
+      target_output_width, target_output_height, components);
   if (dstdata == nullptr) {
     jpeg_destroy_decompress(&cinfo);
     return nullptr;
   }
   JSAMPLE* output_line = static_cast<JSAMPLE*>(dstdata);
 
-  // Temporary buffer used for CMYK -> RGB conversion.
+  // Temporary buffer used for CMYK -> RGB conversion, and for scanlines that
+  // start to the left of the crop window or extend past it.
   const bool use_cmyk = (cinfo.out_color_space == JCS_CMYK);
-  tempdata = use_cmyk ? new JSAMPLE[cinfo.output_width * 4] : NULL;
+  const bool realign_scanlines =
+      (target_output_width != static_cast<int>(cinfo.output_width));
+  tempdata = (use_cmyk || realign_scanlines)
+                 ? new JSAMPLE[cinfo.output_width * cinfo.output_components]
+                 : NULL;
+
+#ifndef LIBJPEG_TURBO_VERSION
+  // Decode and drop the rows above the crop window.  Scanlines as wide as
+  // the output fit in its first row, which is overwritten later.
+  JSAMPLE* skipped_line = tempdata != NULL ? tempdata : output_line;
+  while (flags.crop &&
+         static_cast<int>(cinfo.output_scanline) < flags.crop_y) {
+    if (jpeg_read_scanlines(&cinfo, &skipped_line, 1) != 1) {
+      LOG(ERROR) << "Premature end of JPEG data. Stopped at line "
+                 << cinfo.output_scanline << " above the crop window";
+      delete[] tempdata;
+      jpeg_destroy_decompress(&cinfo);
+      return nullptr;
+    }
+  }
+  skipped_scanlines = cinfo.output_scanline;
+#endif  // LIBJPEG_TURBO_VERSION
 
   // If there is an error reading a line, this aborts the reading.
   // Save the fraction of the image that has been read.
-  argball->height_read_ = cinfo.output_height;
-  while (cinfo.output_scanline < cinfo.output_height) {
+  const int max_scanlines_to_read = skipped_scanlines + target_output_height;
+  argball->height_read_ = target_output_height;
+  while (static_cast<int>(cinfo.output_scanline) < max_scanlines_to_read) {
     int num_lines_read = 0;
-    if (cinfo.out_color_space == JCS_CMYK) {
+    if (use_cmyk) {
       num_lines_read = jpeg_read_scanlines(&cinfo, &tempdata, 1);
       // Convert CMYK to RGB
-      for (size_t i = 0; i < cinfo.output_width; ++i) {
-        int c = tempdata[4 * i + 0];
-        int m = tempdata[4 * i + 1];
-        int y = tempdata[4 * i + 2];
-        int k = tempdata[4 * i + 3];
+      const JSAMPLE* cmyk_line = tempdata + crop_x_offset * 4;
+      for (int i = 0; i < target_output_width; ++i) {
+        int c = cmyk_line[4 * i + 0];
+        int m = cmyk_line[4 * i + 1];
+        int y = cmyk_line[4 * i + 2];
+        int k = cmyk_line[4 * i + 3];
         int r, g, b;
         if (cinfo.saw_Adobe_marker) {
           r = (k * c) / 255;
@@ -212,19 +303,25 @@ uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
         output_line[3 * i + 1] = g;
         output_line[3 * i + 2] = b;
       }
+    } else if (realign_scanlines) {
+      num_lines_read = jpeg_read_scanlines(&cinfo, &tempdata, 1);
+      if (num_lines_read > 0) {
+        memcpy(output_line, tempdata + crop_x_offset * components, min_stride);
+      }
     } else {
       num_lines_read = jpeg_read_scanlines(&cinfo, &output_line, 1);
     }
     // Handle error cases
     if (num_lines_read == 0) {
       LOG(ERROR) << "Premature end of JPEG data. Stopped at line "
-                 << cinfo.output_scanline << "/" << cinfo.output_height;
+                 << cinfo.output_scanline - skipped_scanlines << "/"
+                 << target_output_height;
       if (!flags.try_recover_truncated_jpeg) {
-        argball->height_read_ = cinfo.output_scanline;
+        argball->height_read_ = cinfo.output_scanline - skipped_scanlines;
         error = JPEGERRORS_UNEXPECTED_END_OF_DATA;
       } else {
-        for (size_t line = cinfo.output_scanline; line < cinfo.output_height;
-             ++line) {
+        for (int line = cinfo.output_scanline - skipped_scanlines;
+             line < target_output_height; ++line) {
           if (line == 0) {
             // If even the first line is missing, fill with black color
             memset(output_line, 0, min_stride);
@@ -235,7 +332,7 @@ uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
           output_line += stride;
         }
         argball->height_read_ =
-            cinfo.output_height;  // consider all lines as read
+            target_output_height;  // consider all lines as read
         // prevent error-on-exit in libjpeg:
         cinfo.output_scanline = cinfo.output_height;
       }
@@ -254,17 +351,17 @@ uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
   if (components == 4) {
     // Start on the last line.
     JSAMPLE* scanlineptr = static_cast<JSAMPLE*>(
-        dstdata + static_cast<int64>(cinfo.output_height - 1) * stride);
+        dstdata + static_cast<int64>(target_output_height - 1) * stride);
     const JSAMPLE kOpaque = -1;  // All ones appropriate for JSAMPLE.
-    const int right_rgb = (cinfo.output_width - 1) * 3;
-    const int right_rgba = (cinfo.output_width - 1) * 4;
+    const int right_rgb = (target_output_width - 1) * 3;
+    const int right_rgba = (target_output_width - 1) * 4;
 
-    for (int y = cinfo.output_height; y-- > 0;) {
+    for (int y = target_output_height; y-- > 0;) {
       // We do all the transformations in place, going backwards for each row.
       const JSAMPLE* rgb_pixel = scanlineptr + right_rgb;
       JSAMPLE* rgba_pixel = scanlineptr + right_rgba;
       scanlineptr -= stride;
-      for (int x = cinfo.output_width; x-- > 0;
+      for (int x = target_output_width; x-- > 0;
            rgba_pixel -= 4, rgb_pixel -= 3) {
         // We copy the 3 bytes at rgb_pixel into the 4 bytes at rgba_pixel
         // The "a" channel is set to be opaque.
@@ -309,7 +406,12 @@ uint8* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
   // Handle errors in JPEG
   switch (error) {
     case JPEGERRORS_OK:
-      jpeg_finish_decompress(&cinfo);
+      if (cinfo.output_scanline < cinfo.output_height) {
+        // The rows below the crop window are not needed.
+        jpeg_abort(reinterpret_cast<j_common_ptr>(&cinfo));
+      } else {
+        jpeg_finish_decompress(&cinfo);
+      }
       break;
     case JPEGERRORS_UNEXPECTED_END_OF_DATA:
     case JPEGERRORS_BAD_PARAM:
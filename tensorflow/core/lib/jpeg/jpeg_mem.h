@@ -61,6 +61,21 @@ struct UncompressFlags {
   //
   // Setting this has a quality/speed trade-off implication.
   J_DCT_METHOD dct_method = JDCT_DEFAULT;
+
+  // If true, only the window of crop_width x crop_height pixels whose top-left
+  // corner is (crop_x, crop_y) is decoded.  The window is given in the
+  // coordinates of the image downscaled by `ratio`, and must lie within it.
+  // Rows below the window are not decoded at all.  With libjpeg-turbo 1.5 or
+  // later, rows above the window are skipped without being
+  // inverse-transformed and only the MCU columns overlapping the window are
+  // transformed, so this is much cheaper than decoding the whole image and
+  // cropping it afterwards.  Other libjpegs decode the rows above the window
+  // and whole rows.
+  bool crop = false;
+  int crop_x = 0;
+  int crop_y = 0;
+  int crop_width = 0;
+  int crop_height = 0;
 };
 
 // Uncompress some raw JPEG data given by the pointer srcdata and the length
@@ -21,6 +21,7 @@ limitations under the License.
 #include <string.h>
 
 #include <memory>
+#include <vector>
 
 #include "tensorflow/core/lib/jpeg/jpeg_handle.h"
 #include "tensorflow/core/platform/env.h"
@@ -95,6 +96,108 @@ TEST(JpegMemTest, Jpeg) {
   TestJPEG(env, data_path + "jpeg_merge_test1_cmyk.jpg");
 }
 
+// Checks that decoding a crop window of "jpegfile" matches the same window of
+// the whole decoded image.
+void TestCropAndDecodeJpeg(Env* env, const string& jpegfile,
+                           const UncompressFlags& default_flags) {
+  string jpeg;
+  ReadFileToStringOrDie(Env::Default(), jpegfile, &jpeg);
+  const int fsize = jpeg.size();
+  const uint8* const temp = bit_cast<const uint8*>(jpeg.data());
+
+  // Decode the whole image.
+  int w1, h1, c1;
+  std::unique_ptr<uint8[]> imgdata1(
+      Uncompress(temp, fsize, default_flags, &w1, &h1, &c1, nullptr));
+  ASSERT_NE(imgdata1, nullptr);
+
+  // Windows at the corners, in the middle and not aligned to MCU boundaries.
+  const std::vector<std::vector<int>> windows = {
+      {0, 0, w1, h1},
+      {0, 0, 1, 1},
+      {w1 - 1, h1 - 1, 1, 1},
+      {w1 / 4, h1 / 3, w1 / 2, h1 / 2},
+      {w1 / 8 + 1, h1 / 8 + 1, w1 / 2, h1 / 3},
+      {w1 / 2 + 3, 0, w1 / 2 - 3, h1}};
+  for (const auto& window : windows) {
+    UncompressFlags flags = default_flags;
+    flags.crop = true;
+    flags.crop_x = window[0];
+    flags.crop_y = window[1];
+    flags.crop_width = window[2];
+    flags.crop_height = window[3];
+    int w2, h2, c2;
+    std::unique_ptr<uint8[]> imgdata2(
+        Uncompress(temp, fsize, flags, &w2, &h2, &c2, nullptr));
+    ASSERT_NE(imgdata2, nullptr);
+    ASSERT_EQ(flags.crop_width, w2);
+    ASSERT_EQ(flags.crop_height, h2);
+    ASSERT_EQ(c1, c2);
+
+    const int stride1 = w1 * c1;
+    const int stride2 = w2 * c2;
+    for (int i = 0; i < h2; i++) {
+      const uint8* p1 = &imgdata1[(i + flags.crop_y) * stride1 +
+                                  flags.crop_x * c1];
+      const uint8* p2 = &imgdata2[i * stride2];
+      for (int j = 0; j < stride2; j++) {
+        ASSERT_EQ(p1[j], p2[j])
+            << "p1 != p2 in [" << i << "][" << j / c1 << "][" << j % c1
+            << "] for window (" << flags.crop_x << ", " << flags.crop_y
+            << ", " << flags.crop_width << ", " << flags.crop_height << ")";
+      }
+    }
+  }
+
+  // Windows that do not fit in the image are rejected.
+  UncompressFlags flags = default_flags;
+  flags.crop = true;
+  flags.crop_x = w1 / 2;
+  flags.crop_width = w1 / 2 + 1;
+  flags.crop_height = 1;
+  std::unique_ptr<uint8[]> imgdata3(
+      Uncompress(temp, fsize, flags, nullptr, nullptr, nullptr, nullptr));
+  EXPECT_EQ(imgdata3, nullptr);
+}
+
+TEST(JpegMemTest, CropAndDecodeJpeg) {
+  Env* env = Env::Default();
+  const string data_path = kTestData;
+  UncompressFlags flags;
+
+  // Test basic flags for jpeg and cmyk jpeg.
+  TestCropAndDecodeJpeg(env, data_path + "jpeg_merge_test1.jpg", flags);
+  TestCropAndDecodeJpeg(env, data_path + "jpeg_merge_test1_cmyk.jpg", flags);
+}
+
+TEST(JpegMemTest, CropAndDecodeJpegWithRatio) {
+  Env* env = Env::Default();
+  const string data_path = kTestData;
+  UncompressFlags flags;
+  for (int ratio : {1, 2, 4, 8}) {
+    flags.ratio = ratio;
+    TestCropAndDecodeJpeg(env, data_path + "jpeg_merge_test1.jpg", flags);
+  }
+}
+
+TEST(JpegMemTest, CropAndDecodeJpegWithComponents) {
+  Env* env = Env::Default();
+  const string data_path = kTestData;
+  UncompressFlags flags;
+  for (const int components : {0, 1, 3}) {
+    flags.components = components;
+    TestCropAndDecodeJpeg(env, data_path + "jpeg_merge_test1.jpg", flags);
+  }
+}
+
+TEST(JpegMemTest, CropAndDecodeJpegWithUpScaling) {
+  Env* env = Env::Default();
+  const string data_path = kTestData;
+  UncompressFlags flags;
+  flags.fancy_upscaling = false;
+  TestCropAndDecodeJpeg(env, data_path + "jpeg_merge_test1.jpg", flags);
+}
+
 TEST(JpegMemTest, Jpeg2) {
   // create known data, for size in_w x in_h
   const int in_w = 256;
@@ -18,6 +18,7 @@ limitations under the License.
 #include <float.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
 #include <cmath>
 #include <locale>
@@ -312,6 +313,96 @@ bool safe_strtof(const char* str, float* value) {
   return *str != '\0' && *endptr == '\0';
 }
 
+namespace {
+
+// Parses a plain decimal number, "[+-]digits[.digits][(e|E)[+-]digits]",
+// whose significand fits exactly in a float and whose decimal exponent is
+// small enough that the power of ten is exact too.  The result is then
+// correctly rounded by a single float multiplication or division.  Returns
+// false, without setting *value, for any other input, which may or may not
+// be a valid number.
+bool FastDecimalToFloat(StringPiece str, float* value) {
+  static const float kPowersOfTen[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                       1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  static const int kMaxExponent = 10;
+  static const uint32 kMaxSignificand = 1 << 24;
+
+  const char* p = str.data();
+  const char* const end = p + str.size();
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  uint32 significand = 0;
+  int exponent = 0;
+  bool any_digits = false;
+  for (; p < end && isdigit(*p); ++p) {
+    any_digits = true;
+    significand = significand * 10 + (*p - '0');
+    if (significand > kMaxSignificand) return false;
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && isdigit(*p); ++p) {
+      any_digits = true;
+      significand = significand * 10 + (*p - '0');
+      if (significand > kMaxSignificand) return false;
+      --exponent;
+    }
+  }
+  if (!any_digits) return false;
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exponent = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      negative_exponent = (*p == '-');
+      ++p;
+    }
+    if (p == end || !isdigit(*p)) return false;
+    int explicit_exponent = 0;
+    for (; p < end && isdigit(*p); ++p) {
+      explicit_exponent = explicit_exponent * 10 + (*p - '0');
+      if (explicit_exponent > 2 * kMaxExponent) return false;
+    }
+    exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+  }
+  if (p != end) return false;
+
+  float result = static_cast<float>(significand);
+  if (significand != 0) {
+    if (exponent < -kMaxExponent || exponent > kMaxExponent) return false;
+    if (exponent < 0) {
+      result /= kPowersOfTen[-exponent];
+    } else {
+      result *= kPowersOfTen[exponent];
+    }
+  }
+  *value = negative ? -result : result;
+  return true;
+}
+
+}  // namespace
+
+bool safe_strtof(StringPiece str, float* value) {
+  SkipSpaces(&str);
+  while (!str.empty() && isspace(str[str.size() - 1])) {
+    str.remove_suffix(1);
+  }
+  if (FastDecimalToFloat(str, value)) return true;
+
+  // An embedded NUL would silently truncate the string below.
+  if (str.empty() || memchr(str.data(), '\0', str.size()) != nullptr) {
+    return false;
+  }
+  char buffer[kFastToBufferSize];
+  if (str.size() < sizeof(buffer)) {
+    memcpy(buffer, str.data(), str.size());
+    buffer[str.size()] = '\0';
+    return safe_strtof(buffer, value);
+  }
+  return safe_strtof(str.ToString().c_str(), value);
+}
+
 bool safe_strtod(const char* str, double* value) {
   const char* endptr;
   *value = locale_independent_strtonum<double>(str, &endptr);
@@ -117,6 +117,11 @@ bool safe_strtou64(StringPiece str, uint64* value);
 // Values may be rounded on over- and underflow.
 bool safe_strtof(const char* str, float* value);
 
+// Same as above, for strings that are not NUL-terminated.  Plain decimal
+// numbers with few significant digits, the common case in text data, are
+// parsed directly without copying `str`.
+bool safe_strtof(StringPiece str, float* value);
+
 // Convert strings to double precision floating point values.
 // Leading and trailing spaces are allowed.
 // Values may be rounded on over- and underflow.
@@ -280,6 +280,51 @@ TEST(safe_strtof, Float) {
   EXPECT_FALSE(safe_strtof("-infinity is awesome", &result));
 }
 
+TEST(safe_strtof, FloatFromStringPiece) {
+  float result = 0;
+
+  // Numbers handled without copying the input.
+  EXPECT_TRUE(safe_strtof(StringPiece("0.123456"), &result));
+  EXPECT_EQ(0.123456f, result);
+  EXPECT_TRUE(safe_strtof(StringPiece(" -12.5e-1 "), &result));
+  EXPECT_EQ(-1.25f, result);
+  EXPECT_TRUE(safe_strtof(StringPiece("+3E5"), &result));
+  EXPECT_EQ(3e5f, result);
+  EXPECT_TRUE(safe_strtof(StringPiece(".5"), &result));
+  EXPECT_EQ(0.5f, result);
+  EXPECT_TRUE(safe_strtof(StringPiece("7."), &result));
+  EXPECT_EQ(7.0f, result);
+  EXPECT_TRUE(safe_strtof(StringPiece("16777216"), &result));
+  EXPECT_EQ(16777216.0f, result);
+
+  // Numbers that fall back to the general parser.
+  EXPECT_TRUE(safe_strtof(StringPiece("16777217"), &result));
+  EXPECT_EQ(16777216.0f, result);
+  EXPECT_TRUE(safe_strtof(StringPiece("0.1234567890123"), &result));
+  EXPECT_EQ(0.1234567890123f, result);
+  EXPECT_TRUE(safe_strtof(StringPiece("1e39"), &result));
+  EXPECT_EQ(std::numeric_limits<float>::infinity(), result);
+  EXPECT_TRUE(safe_strtof(StringPiece("-0x2A"), &result));
+  EXPECT_EQ(-42.0f, result);
+  EXPECT_TRUE(safe_strtof(StringPiece("-inf"), &result));
+  EXPECT_EQ(-std::numeric_limits<float>::infinity(), result);
+  EXPECT_TRUE(
+      safe_strtof(StringPiece("3.14159265358979323846264338327950288"),
+                  &result));
+  EXPECT_EQ(3.14159265358979323846264338327950288f, result);
+
+  // Only the bytes in the StringPiece are parsed.
+  EXPECT_TRUE(safe_strtof(StringPiece("1.5,2.5", 3), &result));
+  EXPECT_EQ(1.5f, result);
+
+  EXPECT_FALSE(safe_strtof(StringPiece(""), &result));
+  EXPECT_FALSE(safe_strtof(StringPiece(" "), &result));
+  EXPECT_FALSE(safe_strtof(StringPiece("."), &result));
+  EXPECT_FALSE(safe_strtof(StringPiece("1e"), &result));
+  EXPECT_FALSE(safe_strtof(StringPiece("0.12345abc"), &result));
+  EXPECT_FALSE(safe_strtof(StringPiece("1\0", 2), &result));
+}
+
 TEST(safe_strtod, Double) {
   double result = 0;
 
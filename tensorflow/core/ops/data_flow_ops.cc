@@ -2238,19 +2238,28 @@ REGISTER_OP("RecordInput")
     .Attr("file_buffer_size: int = 10000")
     .Attr("file_parallelism: int = 16")
     .Attr("batch_size: int = 32")
+    .Attr("records_per_split: int = 0")
+    .Attr("prefetch_size: int = 0")
     .SetIsStateful()
     .SetShapeFn(shape_inference::UnknownShape)
     .Doc(R"doc(
 Emits randomized records.
 
 records: A tensor of shape [batch_size].
-file_pattern: Glob pattern for the data files.
+file_pattern: Glob pattern for the data files.  Matching record index sidecars,
+    whose names end in ".tfindex", are skipped.
 file_random_seed: Random seeds used to produce randomized records.
 file_shuffle_shift_ratio: Shifts the list of files after the list is randomly
     shuffled.
 file_buffer_size: The randomization shuffling buffer.
 file_parallelism: How many sstables are opened and concurrently iterated over.
 batch_size: The batch size.
+records_per_split: If positive, files with a record index sidecar are split into
+    runs of this many records, which are shuffled and read concurrently like
+    separate files.
+prefetch_size: If positive, each of the "file_parallelism" iterators reads up
+    to this many bytes ahead of the records being parsed on a background
+    thread.
 )doc");
 
 }  // namespace tensorflow
@@ -366,6 +366,70 @@ dct_method: string specifying a hint about the algorithm used for
 image: 3-D with shape `[height, width, channels]`..
 )doc");
 
+// --------------------------------------------------------------------------
+REGISTER_OP("DecodeJpegBatch")
+    .Input("contents: string")
+    .Input("crop_windows: int32")
+    .Attr("channels: int = 3")
+    .Attr("ratio: int = 1")
+    .Attr("fancy_upscaling: bool = true")
+    .Attr("try_recover_truncated: bool = false")
+    .Attr("acceptable_fraction: float = 1.0")
+    .Attr("dct_method: string = ''")
+    .Output("images: uint8")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle contents;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &contents));
+      ShapeHandle crop_windows;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &crop_windows));
+      DimensionHandle unused;
+      TF_RETURN_IF_ERROR(c->WithValue(c->Dim(crop_windows, 1), 4, &unused));
+      int32 channels;
+      TF_RETURN_IF_ERROR(c->GetAttr("channels", &channels));
+      if (channels != 1 && channels != 3) {
+        return errors::InvalidArgument("channels must be 1 or 3, got ",
+                                       channels);
+      }
+      c->set_output(0, c->MakeShape({c->Dim(contents, 0),
+                                     InferenceContext::kUnknownDim,
+                                     InferenceContext::kUnknownDim, channels}));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Decode a batch of JPEG-encoded images, optionally cropped, to uint8.
+
+The images are decoded in parallel directly into the output tensor, so they
+must all decode to the same size: either each image is cropped to a window of
+the same size, or the images all have the same size.
+
+When `crop_windows` is not empty, only the i-th crop window of the i-th image
+is decoded, which is much faster than decoding the whole image and cropping
+it afterwards: rows above the window are only entropy-decoded, rows below it
+are not decoded at all, and only the MCU columns overlapping the window are
+inverse-transformed.  Crop windows are given in the coordinates of the image
+downscaled by `ratio`.
+
+See `DecodeJpeg` for a description of the other attributes.
+
+contents: 1-D.  The JPEG-encoded images.
+crop_windows: 2-D with shape `[batch, 4]` or `[0, 4]`.  The i-th row is the
+  crop window `[crop_y, crop_x, crop_height, crop_width]` of the i-th image.
+  If empty, the images are not cropped.
+channels: Number of color channels for the decoded images, 1 (grayscale) or
+  3 (RGB).
+ratio: Downscaling ratio.
+fancy_upscaling: If true use a slower but nicer upscaling of the
+  chroma planes (yuv420/422 only).
+try_recover_truncated:  If true try to recover an image from truncated input.
+acceptable_fraction: The minimum required fraction of lines before a truncated
+  input is accepted.
+dct_method: string specifying a hint about the algorithm used for
+  decompression.  Defaults to "" which maps to a system-specific
+  default.  Currently valid values are ["INTEGER_FAST",
+  "INTEGER_ACCURATE"].
+images: 4-D with shape `[batch, height, width, channels]`.
+)doc");
+
 // --------------------------------------------------------------------------
 REGISTER_OP("EncodeJpeg")
     .Input("image: uint8")
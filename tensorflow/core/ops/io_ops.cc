@@ -101,6 +101,7 @@ REGISTER_OP("RestoreV2")
     .Input("shape_and_slices: string")
     .Output("tensors: dtypes")
     .Attr("dtypes: list(type)")
+    .Attr("use_mmap: bool = false")
     .SetShapeFn([](InferenceContext* c) {
       ShapeHandle shape0, shape1, shape2;
       TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &shape0));
@@ -133,10 +134,82 @@ shape_and_slices: shape {N}.  The slice specs of the tensors to be restored.
   Empty strings indicate that they are non-partitioned tensors.
 dtypes: shape {N}.  The list of expected dtype for the tensors.  Must match
   those stored in the checkpoint.
+use_mmap: If true, the non-partitioned numeric tensors read from a local V2
+  checkpoint are backed by copy-on-write mappings of its data files instead
+  of being copied into fresh buffers.  The data files must then not be
+  truncated or overwritten in place while the tensors are alive, which would
+  crash the process with SIGBUS.
 tensors: shape {N}.  The restored tensors, whose shapes are read from the
   checkpoint directly.
 )doc");
 
+REGISTER_OP("SaveV2Async")
+    .Input("prefix: string")
+    .Input("tensor_names: string")
+    .Input("shape_and_slices: string")
+    .Input("tensors: dtypes")
+    .Attr("dtypes: list(type)")
+    .Attr("num_shards: int >= 1 = 4")
+    .Attr("num_writer_threads: int >= 0 = 0")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      ShapeHandle s;
+      DimensionHandle unused_dim;
+
+      // Validate prefix.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+
+      // Validate tensor_names and shapes_and_slices.
+      for (int i = 1; i <= 2; ++i) {
+        TF_RETURN_IF_ERROR(c->WithRank(c->input(i), 1, &s));
+        TF_RETURN_IF_ERROR(
+            c->WithValue(c->Dim(s, 0), c->num_inputs() - 3, &unused_dim));
+      }
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Saves tensors in V2 checkpoint format in the background.
+
+Like SaveV2, but only takes a snapshot of the tensors before returning.  The
+snapshot is then written by background threads into "num_shards" data files
+concurrently, whose metadata is finally merged into the checkpoint at "prefix".
+
+First waits for the saves started before in this session, as WaitForAsyncSaves
+does, so that at most one snapshot is held in memory.  Fails if one of those
+saves failed, in which case this save is not started.
+
+prefix: Must have a single element. The prefix of the V2 checkpoint to which we
+  write the tensors.
+tensor_names: shape {N}. The names of the tensors to be saved.
+shape_and_slices: shape {N}.  The slice specs of the tensors to be saved.
+  Empty strings indicate that they are non-partitioned tensors.
+tensors: `N` tensors to save.
+num_shards: The number of data files the tensors are spread over.
+num_writer_threads: The number of threads writing the data files, or 0 for one
+  per data file.
+)doc");
+
+REGISTER_OP("WaitForAsyncSaves")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::NoOutputs)
+    .Doc(R"doc(
+Waits until the saves started by SaveV2Async in this session are complete.
+
+Fails with the error of the first of them that failed since the last wait, if
+any.
+)doc");
+
+REGISTER_OP("NumPendingAsyncSaves")
+    .Output("num_pending: int32")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Returns the number of incomplete saves started by SaveV2Async in this session.
+
+num_pending: scalar.
+)doc");
+
 REGISTER_OP("MergeV2Checkpoints")
     .Input("checkpoint_prefixes: string")
     .Input("destination_prefix: string")
@@ -479,6 +552,7 @@ REGISTER_OP("TFRecordReader")
     .Attr("container: string = ''")
     .Attr("shared_name: string = ''")
     .Attr("compression_type: string = ''")
+    .Attr("prefetch_size: int >= 0 = 0")
     .SetIsStateful()
     .SetShapeFn(TwoElementOutput)
     .Doc(R"doc(
@@ -489,6 +563,8 @@ container: If non-empty, this reader is placed in the given container.
         Otherwise, a default container is used.
 shared_name: If non-empty, this reader is named in the given bucket
              with this shared_name. Otherwise, the node name is used instead.
+prefetch_size: If positive, a background thread reads up to this many bytes of
+               an uncompressed file ahead of the records being parsed.
 )doc");
 
 REGISTER_OP("TFRecordReaderV2")
@@ -496,6 +572,7 @@ REGISTER_OP("TFRecordReaderV2")
     .Attr("container: string = ''")
     .Attr("shared_name: string = ''")
     .Attr("compression_type: string = ''")
+    .Attr("prefetch_size: int >= 0 = 0")
     .SetIsStateful()
     .SetShapeFn(shape_inference::ScalarShape)
     .Doc(R"doc(
@@ -506,6 +583,8 @@ container: If non-empty, this reader is placed in the given container.
         Otherwise, a default container is used.
 shared_name: If non-empty, this reader is named in the given bucket
              with this shared_name. Otherwise, the node name is used instead.
+prefetch_size: If positive, a background thread reads up to this many bytes of
+               an uncompressed file ahead of the records being parsed.
 )doc");
 
 // TODO(cwhipkey): mark this deprecated in favor of V2.
@@ -0,0 +1,174 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/platform/cloud/file_block_cache.h"
+#include <algorithm>
+#include <cstring>
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+FileBlockCache::FileBlockCache(size_t block_size, uint64 max_bytes,
+                               int num_fetch_threads, Env* env)
+    : block_size_(block_size), max_bytes_(max_bytes) {
+  CHECK_GT(block_size_, 0) << "The block size must be positive.";
+  if (num_fetch_threads > 1) {
+    fetch_pool_.reset(
+        new thread::ThreadPool(env, "file_block_fetch", num_fetch_threads));
+  }
+}
+
+FileBlockCache::~FileBlockCache() {}
+
+Status FileBlockCache::Read(const string& file_key, uint64 offset, size_t n,
+                            const BlockFetcher& fetcher, char* buffer,
+                            size_t* bytes_read) {
+  *bytes_read = 0;
+  if (n == 0) {
+    return Status::OK();
+  }
+  const uint64 first_block = offset / block_size_;
+  const uint64 last_block = (offset + n - 1) / block_size_;
+  const size_t num_blocks = last_block - first_block + 1;
+
+  // Collect the cached blocks and the indices of the ones to fetch. A cached
+  // block shorter than block_size_ is the last block of the file, so there is
+  // no point looking past it.
+  std::vector<BlockData> blocks(num_blocks);
+  std::vector<size_t> missing;
+  {
+    mutex_lock lock(mu_);
+    for (size_t i = 0; i < num_blocks; ++i) {
+      blocks[i] = LookupLocked(Key(file_key, first_block + i));
+      if (blocks[i] == nullptr) {
+        ++stats_.misses;
+        missing.push_back(i);
+      } else {
+        ++stats_.hits;
+        if (blocks[i]->size() < block_size_) {
+          break;
+        }
+      }
+    }
+  }
+
+  if (!missing.empty()) {
+    std::vector<std::shared_ptr<std::vector<char>>> fetched(missing.size());
+    std::vector<Status> statuses(missing.size());
+    auto fetch = [&](size_t j) {
+      fetched[j].reset(new std::vector<char>);
+      statuses[j] = fetcher((first_block + missing[j]) * block_size_,
+                            block_size_, fetched[j].get());
+    };
+    if (fetch_pool_ != nullptr && missing.size() > 1) {
+      BlockingCounter counter(missing.size());
+      for (size_t j = 0; j < missing.size(); ++j) {
+        fetch_pool_->Schedule([&fetch, &counter, j]() {
+          fetch(j);
+          counter.DecrementCount();
+        });
+      }
+      counter.Wait();
+    } else {
+      // Fetching sequentially, so stop at the first error or end of file.
+      for (size_t j = 0; j < missing.size(); ++j) {
+        fetch(j);
+        if (!statuses[j].ok() || fetched[j]->size() < block_size_) {
+          break;
+        }
+      }
+    }
+
+    Status status;
+    mutex_lock lock(mu_);
+    for (size_t j = 0; j < missing.size() && fetched[j] != nullptr; ++j) {
+      if (!statuses[j].ok()) {
+        status.Update(statuses[j]);
+        continue;
+      }
+      stats_.bytes_fetched += fetched[j]->size();
+      if (fetched[j]->size() > block_size_) {
+        fetched[j]->resize(block_size_);
+      }
+      blocks[missing[j]] = fetched[j];
+      if (!fetched[j]->empty()) {
+        InsertLocked(Key(file_key, first_block + missing[j]), fetched[j]);
+      }
+    }
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  // Copy the requested range out of the blocks, stopping at the end of file.
+  for (size_t i = 0; i < num_blocks && *bytes_read < n; ++i) {
+    if (blocks[i] == nullptr) {
+      break;
+    }
+    const std::vector<char>& block = *blocks[i];
+    const uint64 pos_in_block =
+        offset + *bytes_read - (first_block + i) * block_size_;
+    if (pos_in_block >= block.size()) {
+      break;
+    }
+    const size_t copy_size =
+        std::min<uint64>(block.size() - pos_in_block, n - *bytes_read);
+    std::memcpy(buffer + *bytes_read, block.data() + pos_in_block, copy_size);
+    *bytes_read += copy_size;
+    if (block.size() < block_size_) {
+      break;
+    }
+  }
+  return Status::OK();
+}
+
+FileBlockCache::Stats FileBlockCache::stats() const {
+  mutex_lock lock(mu_);
+  return stats_;
+}
+
+uint64 FileBlockCache::cache_size() const {
+  mutex_lock lock(mu_);
+  return cache_size_;
+}
+
+FileBlockCache::BlockData FileBlockCache::LookupLocked(const Key& key) {
+  auto it = blocks_.find(key);
+  if (it == blocks_.end()) {
+    return nullptr;
+  }
+  lru_list_.splice(lru_list_.begin(), lru_list_, it->second.lru_iterator);
+  return it->second.data;
+}
+
+void FileBlockCache::InsertLocked(const Key& key, BlockData data) {
+  auto it = blocks_.find(key);
+  if (it != blocks_.end()) {
+    // Another reader fetched the same block concurrently; keep the newer copy.
+    cache_size_ -= it->second.data->size();
+    lru_list_.erase(it->second.lru_iterator);
+    blocks_.erase(it);
+  }
+  cache_size_ += data->size();
+  lru_list_.push_front(key);
+  blocks_[key] = Block{std::move(data), lru_list_.begin()};
+  while (cache_size_ > max_bytes_ && !lru_list_.empty()) {
+    auto victim = blocks_.find(lru_list_.back());
+    cache_size_ -= victim->second.data->size();
+    blocks_.erase(victim);
+    lru_list_.pop_back();
+  }
+}
+
+}  // namespace tensorflow
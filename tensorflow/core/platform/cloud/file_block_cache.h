@@ -0,0 +1,128 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_CORE_PLATFORM_CLOUD_FILE_BLOCK_CACHE_H_
+#define THIRD_PARTY_TENSORFLOW_CORE_PLATFORM_CLOUD_FILE_BLOCK_CACHE_H_
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+/// \brief An LRU cache of fixed-size file blocks, shared between files.
+///
+/// Blocks are identified by an opaque file key and the block index within
+/// the file. Callers are expected to fold anything that changes the file
+/// contents (e.g. a GCS object generation) into the file key, so cached
+/// blocks never need to be invalidated explicitly; stale blocks simply age
+/// out of the cache.
+///
+/// When a read spans several blocks that are not cached, the missing blocks
+/// are fetched concurrently on an internal thread pool.
+///
+/// This class is thread-safe.
+class FileBlockCache {
+ public:
+  /// \brief Fetches up to `n` bytes of a file starting at `offset` into `out`.
+  ///
+  /// Returning fewer than `n` bytes signals the end of the file.
+  typedef std::function<Status(uint64 offset, size_t n,
+                               std::vector<char>* out)>
+      BlockFetcher;
+
+  /// Cumulative counters describing the cache's effectiveness.
+  struct Stats {
+    /// Number of block lookups served from the cache.
+    int64 hits = 0;
+    /// Number of block lookups that required a fetch.
+    int64 misses = 0;
+    /// Total number of bytes returned by the fetchers.
+    int64 bytes_fetched = 0;
+  };
+
+  /// \brief Creates a cache holding at most `max_bytes` of `block_size`-sized
+  /// blocks.
+  ///
+  /// Up to `num_fetch_threads` blocks are fetched in parallel for a single
+  /// read; a value of 1 or less fetches blocks sequentially on the caller's
+  /// thread.
+  FileBlockCache(size_t block_size, uint64 max_bytes, int num_fetch_threads,
+                 Env* env = Env::Default());
+  ~FileBlockCache();
+
+  /// \brief Reads up to `n` bytes starting at `offset` of the file identified
+  /// by `file_key` into `buffer`, fetching missing blocks with `fetcher`.
+  ///
+  /// `*bytes_read` is set to the number of bytes copied into `buffer`, which
+  /// is less than `n` only if the end of the file was reached. Returns the
+  /// first error reported by `fetcher`, if any.
+  Status Read(const string& file_key, uint64 offset, size_t n,
+              const BlockFetcher& fetcher, char* buffer, size_t* bytes_read);
+
+  /// Returns a snapshot of the cache counters.
+  Stats stats() const;
+
+  /// Returns the number of bytes currently held in the cache.
+  uint64 cache_size() const;
+
+  size_t block_size() const { return block_size_; }
+
+ private:
+  typedef std::pair<string, uint64> Key;
+  typedef std::shared_ptr<const std::vector<char>> BlockData;
+
+  struct Block {
+    BlockData data;
+    std::list<Key>::iterator lru_iterator;
+  };
+
+  /// Looks up a block and marks it as most recently used. Returns nullptr if
+  /// the block is not cached.
+  BlockData LookupLocked(const Key& key) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// Inserts a block and evicts least recently used blocks until the cache
+  /// fits within max_bytes_.
+  void InsertLocked(const Key& key, BlockData data)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const size_t block_size_;
+  const uint64 max_bytes_;
+  std::unique_ptr<thread::ThreadPool> fetch_pool_;
+
+  mutable mutex mu_;
+  std::map<Key, Block> blocks_ GUARDED_BY(mu_);
+  /// Block keys, most recently used first.
+  std::list<Key> lru_list_ GUARDED_BY(mu_);
+  uint64 cache_size_ GUARDED_BY(mu_) = 0;
+  Stats stats_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FileBlockCache);
+};
+
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_CORE_PLATFORM_CLOUD_FILE_BLOCK_CACHE_H_
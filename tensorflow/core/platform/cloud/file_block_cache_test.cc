@@ -0,0 +1,199 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/platform/cloud/file_block_cache.h"
+#include <set>
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+/// A fetcher serving a file of `file_size` bytes whose i-th byte is 'a' + i
+/// modulo 26. Records the offsets of all fetches.
+class FakeFile {
+ public:
+  explicit FakeFile(uint64 file_size) : file_size_(file_size) {}
+
+  FileBlockCache::BlockFetcher fetcher() {
+    return [this](uint64 offset, size_t n, std::vector<char>* out) {
+      {
+        mutex_lock lock(mu_);
+        fetched_offsets_.push_back(offset);
+      }
+      out->clear();
+      for (uint64 i = offset; i < std::min<uint64>(offset + n, file_size_);
+           ++i) {
+        out->push_back('a' + i % 26);
+      }
+      return Status::OK();
+    };
+  }
+
+  string Contents(uint64 offset, size_t n) const {
+    string result;
+    for (uint64 i = offset; i < std::min<uint64>(offset + n, file_size_); ++i) {
+      result.push_back('a' + i % 26);
+    }
+    return result;
+  }
+
+  std::vector<uint64> fetched_offsets() {
+    mutex_lock lock(mu_);
+    return fetched_offsets_;
+  }
+
+ private:
+  const uint64 file_size_;
+  mutex mu_;
+  std::vector<uint64> fetched_offsets_ GUARDED_BY(mu_);
+};
+
+string ReadCache(FileBlockCache* cache, const string& key, uint64 offset,
+                 size_t n, const FileBlockCache::BlockFetcher& fetcher) {
+  std::vector<char> buffer(n);
+  size_t bytes_read = 0;
+  TF_EXPECT_OK(
+      cache->Read(key, offset, n, fetcher, buffer.data(), &bytes_read));
+  return string(buffer.data(), bytes_read);
+}
+
+TEST(FileBlockCacheTest, ReadsWithinAndAcrossBlocks) {
+  FakeFile file(100);
+  FileBlockCache cache(16, 1024, 1);
+
+  EXPECT_EQ(file.Contents(3, 5), ReadCache(&cache, "f", 3, 5, file.fetcher()));
+  EXPECT_EQ(file.Contents(10, 30),
+            ReadCache(&cache, "f", 10, 30, file.fetcher()));
+  EXPECT_EQ(std::vector<uint64>({0, 16, 32}), file.fetched_offsets());
+
+  const FileBlockCache::Stats stats = cache.stats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(48, stats.bytes_fetched);
+  EXPECT_EQ(48, cache.cache_size());
+}
+
+TEST(FileBlockCacheTest, RepeatedReadsHitTheCache) {
+  FakeFile file(64);
+  FileBlockCache cache(16, 1024, 1);
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(file.Contents(0, 64),
+              ReadCache(&cache, "f", 0, 64, file.fetcher()));
+  }
+  EXPECT_EQ(4, file.fetched_offsets().size());
+  const FileBlockCache::Stats stats = cache.stats();
+  EXPECT_EQ(16, stats.hits);
+  EXPECT_EQ(4, stats.misses);
+  EXPECT_EQ(64, stats.bytes_fetched);
+}
+
+TEST(FileBlockCacheTest, ShortReadAtEndOfFile) {
+  FakeFile file(20);
+  FileBlockCache cache(16, 1024, 1);
+
+  EXPECT_EQ(file.Contents(10, 10),
+            ReadCache(&cache, "f", 10, 100, file.fetcher()));
+  // The short final block is cached and ends subsequent reads without a fetch.
+  EXPECT_EQ(file.Contents(18, 2),
+            ReadCache(&cache, "f", 18, 100, file.fetcher()));
+  EXPECT_EQ("", ReadCache(&cache, "f", 30, 10, file.fetcher()));
+  EXPECT_EQ(std::vector<uint64>({0, 16}), file.fetched_offsets());
+}
+
+TEST(FileBlockCacheTest, KeysAreIndependent) {
+  FakeFile file(32);
+  FileBlockCache cache(16, 1024, 1);
+
+  ReadCache(&cache, "gs://bucket/object@1", 0, 8, file.fetcher());
+  ReadCache(&cache, "gs://bucket/object@2", 0, 8, file.fetcher());
+  ReadCache(&cache, "gs://bucket/object@1", 0, 8, file.fetcher());
+  EXPECT_EQ(2, file.fetched_offsets().size());
+  EXPECT_EQ(1, cache.stats().hits);
+}
+
+TEST(FileBlockCacheTest, EvictsLeastRecentlyUsed) {
+  FakeFile file(64);
+  FileBlockCache cache(16, 32, 1);
+
+  ReadCache(&cache, "f", 0, 1, file.fetcher());   // Block 0.
+  ReadCache(&cache, "f", 16, 1, file.fetcher());  // Block 1.
+  ReadCache(&cache, "f", 0, 1, file.fetcher());   // Block 0 is now newest.
+  ReadCache(&cache, "f", 32, 1, file.fetcher());  // Evicts block 1.
+  EXPECT_EQ(32, cache.cache_size());
+
+  ReadCache(&cache, "f", 0, 1, file.fetcher());
+  ReadCache(&cache, "f", 16, 1, file.fetcher());
+  EXPECT_EQ(std::vector<uint64>({0, 16, 32, 16}), file.fetched_offsets());
+}
+
+TEST(FileBlockCacheTest, ZeroSizeCacheStillReads) {
+  FakeFile file(64);
+  FileBlockCache cache(16, 0, 1);
+
+  EXPECT_EQ(file.Contents(5, 40),
+            ReadCache(&cache, "f", 5, 40, file.fetcher()));
+  EXPECT_EQ(file.Contents(5, 40),
+            ReadCache(&cache, "f", 5, 40, file.fetcher()));
+  EXPECT_EQ(6, file.fetched_offsets().size());
+  EXPECT_EQ(0, cache.cache_size());
+}
+
+TEST(FileBlockCacheTest, ParallelFetchOfMissingBlocks) {
+  FakeFile file(1000);
+  FileBlockCache cache(10, 10000, 4);
+
+  // Warm up one block in the middle of the range.
+  ReadCache(&cache, "f", 500, 10, file.fetcher());
+  EXPECT_EQ(file.Contents(0, 1000),
+            ReadCache(&cache, "f", 0, 1000, file.fetcher()));
+
+  const std::vector<uint64> offsets = file.fetched_offsets();
+  const std::set<uint64> unique_offsets(offsets.begin(), offsets.end());
+  EXPECT_EQ(100, offsets.size());
+  EXPECT_EQ(100, unique_offsets.size());
+  EXPECT_EQ(1, cache.stats().hits);
+  EXPECT_EQ(1000, cache.stats().bytes_fetched);
+}
+
+TEST(FileBlockCacheTest, FetchErrorIsReturnedAndNotCached) {
+  FakeFile file(64);
+  FileBlockCache cache(16, 1024, 4);
+  auto failing_fetcher = [](uint64 offset, size_t n, std::vector<char>* out) {
+    if (offset == 16) {
+      return errors::Unavailable("fetch failed");
+    }
+    out->assign(n, 'x');
+    return Status::OK();
+  };
+
+  std::vector<char> buffer(64);
+  size_t bytes_read;
+  EXPECT_EQ(error::UNAVAILABLE, cache
+                                    .Read("f", 0, 64, failing_fetcher,
+                                          buffer.data(), &bytes_read)
+                                    .code());
+  // The blocks that were fetched successfully are kept.
+  EXPECT_EQ(48, cache.cache_size());
+  EXPECT_EQ(file.Contents(16, 16),
+            ReadCache(&cache, "f", 16, 16, file.fetcher()));
+  EXPECT_EQ(std::vector<uint64>({16}), file.fetched_offsets());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -55,6 +55,44 @@ constexpr uint64 HTTP_CODE_RESUME_INCOMPLETE = 308;
 
 // The file statistics returned by Stat() for directories.
 const FileStatistics DIRECTORY_STAT(0, 0, true);
+// The environment variables configuring the block cache shared by all
+// RandomAccessFiles of the default file system. The cache is disabled unless
+// GCS_BLOCK_CACHE_MAX_BYTES is set to a positive value.
+constexpr char kBlockCacheMaxBytes[] = "GCS_BLOCK_CACHE_MAX_BYTES";
+constexpr char kBlockCacheBlockSize[] = "GCS_BLOCK_CACHE_BLOCK_SIZE";
+constexpr char kBlockCacheFetchThreads[] = "GCS_BLOCK_CACHE_FETCH_THREADS";
+constexpr uint64 kDefaultBlockCacheBlockSize = 16 * 1024 * 1024;
+constexpr uint64 kDefaultBlockCacheFetchThreads = 8;
+
+/// Reads an unsigned integer from an environment variable, falling back to
+/// `default_value` if the variable is unset or malformed.
+uint64 GetEnvUint64(const char* name, uint64 default_value) {
+  const char* value = std::getenv(name);
+  uint64 result;
+  if (value == nullptr || !strings::safe_strtou64(value, &result)) {
+    return default_value;
+  }
+  return result;
+}
+
+/// Returns the process-wide block cache configured from the environment, or
+/// nullptr if it is disabled.
+std::shared_ptr<FileBlockCache> GetSharedBlockCache() {
+  static std::shared_ptr<FileBlockCache>* cache = []() {
+    const uint64 max_bytes = GetEnvUint64(kBlockCacheMaxBytes, 0);
+    const uint64 block_size =
+        GetEnvUint64(kBlockCacheBlockSize, kDefaultBlockCacheBlockSize);
+    const uint64 fetch_threads =
+        GetEnvUint64(kBlockCacheFetchThreads, kDefaultBlockCacheFetchThreads);
+    auto* result = new std::shared_ptr<FileBlockCache>;
+    if (max_bytes > 0 && block_size > 0) {
+      result->reset(new FileBlockCache(block_size, max_bytes,
+                                       static_cast<int>(fetch_threads)));
+    }
+    return result;
+  }();
+  return *cache;
+}
 
 Status GetTmpFilename(string* filename) {
   if (!filename) {
@@ -298,6 +336,80 @@ class GcsRandomAccessFile : public RandomAccessFile {
   mutable size_t buffer_start_offset_ GUARDED_BY(mu_) = 0;
 };
 
+/// A GCS-based implementation of a random access file that reads through a
+/// FileBlockCache shared with other files. All reads are pinned to the object
+/// generation observed when the file was opened, so cached blocks of earlier
+/// generations are never returned.
+class GcsBlockCachedRandomAccessFile : public RandomAccessFile {
+ public:
+  GcsBlockCachedRandomAccessFile(const string& bucket, const string& object,
+                                 int64 generation, uint64 file_size,
+                                 AuthProvider* auth_provider,
+                                 HttpRequest::Factory* http_request_factory,
+                                 FileBlockCache* block_cache)
+      : bucket_(bucket),
+        object_(object),
+        generation_(generation),
+        file_size_(file_size),
+        cache_key_(strings::StrCat(bucket, "/", object, "@", generation)),
+        auth_provider_(auth_provider),
+        http_request_factory_(http_request_factory),
+        block_cache_(block_cache) {}
+
+  /// Reads the requested range from the block cache. Thread-safe.
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    size_t bytes_read = 0;
+    if (offset < file_size_) {
+      const size_t bytes_to_read = std::min<uint64>(n, file_size_ - offset);
+      TF_RETURN_IF_ERROR(block_cache_->Read(
+          cache_key_, offset, bytes_to_read,
+          [this](uint64 block_offset, size_t block_size,
+                 std::vector<char>* out) {
+            return LoadBlockFromGCS(block_offset, block_size, out);
+          },
+          scratch, &bytes_read));
+    }
+    *result = StringPiece(scratch, bytes_read);
+    if (bytes_read < n) {
+      return errors::OutOfRange("EOF reached, ", bytes_read,
+                                " bytes were read out of ", n,
+                                " bytes requested.");
+    }
+    return Status::OK();
+  }
+
+ private:
+  /// Fetches the given range of the pinned object generation from GCS.
+  Status LoadBlockFromGCS(uint64 offset, size_t n,
+                          std::vector<char>* out) const {
+    string auth_token;
+    TF_RETURN_IF_ERROR(AuthProvider::GetToken(auth_provider_, &auth_token));
+
+    std::unique_ptr<HttpRequest> request(http_request_factory_->Create());
+    TF_RETURN_IF_ERROR(request->Init());
+    TF_RETURN_IF_ERROR(request->SetUri(strings::StrCat(
+        "https://", kStorageHost, "/", bucket_, "/",
+        request->EscapeString(object_), "?generation=", generation_)));
+    TF_RETURN_IF_ERROR(request->AddAuthBearerHeader(auth_token));
+    TF_RETURN_IF_ERROR(request->SetRange(
+        offset, std::min<uint64>(offset + n, file_size_) - 1));
+    TF_RETURN_IF_ERROR(request->SetResultBuffer(out));
+    TF_RETURN_WITH_CONTEXT_IF_ERROR(request->Send(), " when reading gs://",
+                                    bucket_, "/", object_);
+    return Status::OK();
+  }
+
+  const string bucket_;
+  const string object_;
+  const int64 generation_;
+  const uint64 file_size_;
+  const string cache_key_;
+  AuthProvider* auth_provider_;
+  HttpRequest::Factory* http_request_factory_;
+  FileBlockCache* block_cache_;
+};
+
 /// \brief GCS-based implementation of a writeable file.
 ///
 /// Since GCS objects are immutable, this implementation writes to a local
@@ -585,7 +697,8 @@ class GcsReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
 
 GcsFileSystem::GcsFileSystem()
     : auth_provider_(new GoogleAuthProvider()),
-      http_request_factory_(new HttpRequest::Factory()) {}
+      http_request_factory_(new HttpRequest::Factory()),
+      block_cache_(GetSharedBlockCache()) {}
 
 GcsFileSystem::GcsFileSystem(
     std::unique_ptr<AuthProvider> auth_provider,
@@ -596,10 +709,31 @@ GcsFileSystem::GcsFileSystem(
       read_ahead_bytes_(read_ahead_bytes),
       initial_retry_delay_usec_(initial_retry_delay_usec) {}
 
+GcsFileSystem::GcsFileSystem(
+    std::unique_ptr<AuthProvider> auth_provider,
+    std::unique_ptr<HttpRequest::Factory> http_request_factory,
+    size_t read_ahead_bytes, int64 initial_retry_delay_usec,
+    std::shared_ptr<FileBlockCache> block_cache)
+    : auth_provider_(std::move(auth_provider)),
+      http_request_factory_(std::move(http_request_factory)),
+      read_ahead_bytes_(read_ahead_bytes),
+      initial_retry_delay_usec_(initial_retry_delay_usec),
+      block_cache_(std::move(block_cache)) {}
+
 Status GcsFileSystem::NewRandomAccessFile(
     const string& fname, std::unique_ptr<RandomAccessFile>* result) {
   string bucket, object;
   TF_RETURN_IF_ERROR(ParseGcsPath(fname, false, &bucket, &object));
+  if (block_cache_) {
+    uint64 file_size;
+    int64 generation;
+    TF_RETURN_IF_ERROR(
+        GetObjectGeneration(bucket, object, &file_size, &generation));
+    result->reset(new GcsBlockCachedRandomAccessFile(
+        bucket, object, generation, file_size, auth_provider_.get(),
+        http_request_factory_.get(), block_cache_.get()));
+    return Status::OK();
+  }
   result->reset(new GcsRandomAccessFile(bucket, object, auth_provider_.get(),
                                         http_request_factory_.get(),
                                         read_ahead_bytes_));
@@ -754,6 +888,34 @@ Status GcsFileSystem::StatForObject(const string& bucket, const string& object,
   return Status::OK();
 }
 
+Status GcsFileSystem::GetObjectGeneration(const string& bucket,
+                                          const string& object, uint64* size,
+                                          int64* generation) {
+  string auth_token;
+  TF_RETURN_IF_ERROR(AuthProvider::GetToken(auth_provider_.get(), &auth_token));
+
+  std::vector<char> output_buffer;
+  std::unique_ptr<HttpRequest> request(http_request_factory_->Create());
+  TF_RETURN_IF_ERROR(request->Init());
+  TF_RETURN_IF_ERROR(request->SetUri(strings::StrCat(
+      kGcsUriBase, "b/", bucket, "/o/", request->EscapeString(object),
+      "?fields=size%2Cgeneration")));
+  TF_RETURN_IF_ERROR(request->AddAuthBearerHeader(auth_token));
+  TF_RETURN_IF_ERROR(request->SetResultBuffer(&output_buffer));
+  TF_RETURN_WITH_CONTEXT_IF_ERROR(
+      request->Send(), " when reading metadata of gs://", bucket, "/", object);
+
+  StringPiece response_piece =
+      StringPiece(output_buffer.data(), output_buffer.size());
+  Json::Value root;
+  TF_RETURN_IF_ERROR(ParseJson(response_piece, &root));
+  int64 signed_size;
+  TF_RETURN_IF_ERROR(GetInt64Value(root, "size", &signed_size));
+  TF_RETURN_IF_ERROR(GetInt64Value(root, "generation", generation));
+  *size = signed_size;
+  return Status::OK();
+}
+
 Status GcsFileSystem::BucketExists(const string& bucket, bool* result) {
   if (!result) {
     return errors::Internal("'result' cannot be nullptr.");
@@ -16,10 +16,12 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_PLATFORM_GCS_FILE_SYSTEM_H_
 #define TENSORFLOW_CORE_PLATFORM_GCS_FILE_SYSTEM_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/cloud/auth_provider.h"
+#include "tensorflow/core/platform/cloud/file_block_cache.h"
 #include "tensorflow/core/platform/cloud/http_request.h"
 #include "tensorflow/core/platform/cloud/retrying_file_system.h"
 #include "tensorflow/core/platform/file_system.h"
@@ -36,6 +38,15 @@ class GcsFileSystem : public FileSystem {
   GcsFileSystem(std::unique_ptr<AuthProvider> auth_provider,
                 std::unique_ptr<HttpRequest::Factory> http_request_factory,
                 size_t read_ahead_bytes, int64 initial_retry_delay_usec);
+  /// \brief Creates a file system whose RandomAccessFiles read through
+  /// `block_cache`, which may be shared with other file systems.
+  ///
+  /// If `block_cache` is nullptr, the per-file read-ahead buffer of
+  /// `read_ahead_bytes` is used instead.
+  GcsFileSystem(std::unique_ptr<AuthProvider> auth_provider,
+                std::unique_ptr<HttpRequest::Factory> http_request_factory,
+                size_t read_ahead_bytes, int64 initial_retry_delay_usec,
+                std::shared_ptr<FileBlockCache> block_cache);
 
   Status NewRandomAccessFile(
       const string& filename,
@@ -105,6 +116,9 @@ class GcsFileSystem : public FileSystem {
   /// Retrieves file statistics assuming fname points to a GCS object.
   Status StatForObject(const string& bucket, const string& object,
                        FileStatistics* stat);
+  /// Retrieves the size and the current generation of a GCS object.
+  Status GetObjectGeneration(const string& bucket, const string& object,
+                             uint64* size, int64* generation);
   Status RenameObject(const string& src, const string& target);
 
   std::unique_ptr<AuthProvider> auth_provider_;
@@ -117,6 +131,11 @@ class GcsFileSystem : public FileSystem {
   // The initial delay for exponential backoffs when retrying failed calls.
   const int64 initial_retry_delay_usec_ = 1000000L;
 
+  // The block cache used by RandomAccessFiles, or nullptr if disabled. The
+  // default constructor shares one process-wide cache configured through the
+  // GCS_BLOCK_CACHE_* environment variables.
+  std::shared_ptr<FileBlockCache> block_cache_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(GcsFileSystem);
 };
 
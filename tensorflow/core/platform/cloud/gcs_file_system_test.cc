@@ -192,6 +192,108 @@ TEST(GcsFileSystemTest, NewRandomAccessFile_WithReadAhead) {
   EXPECT_EQ("0123", result);
 }
 
+TEST(GcsFileSystemTest, NewRandomAccessFile_WithBlockCache) {
+  std::vector<HttpRequest*> requests(
+      {new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "random_access.txt?fields=size%2Cgeneration\n"
+           "Auth Token: fake_token\n",
+           "{\"size\": \"15\", \"generation\": \"1\"}"),
+       new FakeHttpRequest(
+           "Uri: https://storage.googleapis.com/bucket/random_access.txt"
+           "?generation=1\n"
+           "Auth Token: fake_token\n"
+           "Range: 0-7\n",
+           "01234567"),
+       new FakeHttpRequest(
+           "Uri: https://storage.googleapis.com/bucket/random_access.txt"
+           "?generation=1\n"
+           "Auth Token: fake_token\n"
+           "Range: 8-14\n",
+           "89abcde"),
+       // The second file is opened on the same generation, so all of its
+       // reads are served from the cache.
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "random_access.txt?fields=size%2Cgeneration\n"
+           "Auth Token: fake_token\n",
+           "{\"size\": \"15\", \"generation\": \"1\"}"),
+       // The object was overwritten before the third file was opened, so its
+       // blocks are fetched again.
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "random_access.txt?fields=size%2Cgeneration\n"
+           "Auth Token: fake_token\n",
+           "{\"size\": \"4\", \"generation\": \"2\"}"),
+       new FakeHttpRequest(
+           "Uri: https://storage.googleapis.com/bucket/random_access.txt"
+           "?generation=2\n"
+           "Auth Token: fake_token\n"
+           "Range: 0-3\n",
+           "wxyz")});
+  std::shared_ptr<FileBlockCache> block_cache(
+      new FileBlockCache(8 /* block size */, 1024 /* max bytes */,
+                         1 /* fetch threads */));
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   0 /* read ahead bytes */, 0 /* initial retry delay */,
+                   block_cache);
+
+  char scratch[100];
+  StringPiece result;
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_EXPECT_OK(fs.NewRandomAccessFile("gs://bucket/random_access.txt", &file));
+  TF_EXPECT_OK(file->Read(2, 4, &result, scratch));
+  EXPECT_EQ("2345", result);
+  // Spans both blocks, the first of which is already cached.
+  TF_EXPECT_OK(file->Read(6, 4, &result, scratch));
+  EXPECT_EQ("6789", result);
+  EXPECT_EQ(errors::Code::OUT_OF_RANGE,
+            file->Read(12, 10, &result, scratch).code());
+  EXPECT_EQ("cde", result);
+  EXPECT_EQ(errors::Code::OUT_OF_RANGE,
+            file->Read(20, 10, &result, scratch).code());
+  EXPECT_TRUE(result.empty());
+
+  std::unique_ptr<RandomAccessFile> same_generation;
+  TF_EXPECT_OK(
+      fs.NewRandomAccessFile("gs://bucket/random_access.txt", &same_generation));
+  TF_EXPECT_OK(same_generation->Read(0, 15, &result, scratch));
+  EXPECT_EQ("0123456789abcde", result);
+
+  std::unique_ptr<RandomAccessFile> new_generation;
+  TF_EXPECT_OK(
+      fs.NewRandomAccessFile("gs://bucket/random_access.txt", &new_generation));
+  EXPECT_EQ(errors::Code::OUT_OF_RANGE,
+            new_generation->Read(0, 8, &result, scratch).code());
+  EXPECT_EQ("wxyz", result);
+
+  const FileBlockCache::Stats stats = block_cache->stats();
+  EXPECT_EQ(4, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(19, stats.bytes_fetched);
+}
+
+TEST(GcsFileSystemTest, NewRandomAccessFile_WithBlockCache_StatFails) {
+  std::vector<HttpRequest*> requests({new FakeHttpRequest(
+      "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+      "random_access.txt?fields=size%2Cgeneration\n"
+      "Auth Token: fake_token\n",
+      "", errors::NotFound("404"), 404)});
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   0 /* read ahead bytes */, 0 /* initial retry delay */,
+                   std::make_shared<FileBlockCache>(8, 1024, 1));
+
+  std::unique_ptr<RandomAccessFile> file;
+  EXPECT_EQ(errors::Code::NOT_FOUND,
+            fs.NewRandomAccessFile("gs://bucket/random_access.txt", &file)
+                .code());
+}
+
 TEST(GcsFileSystemTest, NewRandomAccessFile_NoObjectName) {
   std::vector<HttpRequest*> requests;
   GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
@@ -0,0 +1,63 @@
+/* Copyright 2015 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_PLATFORM_NUMA_H_
+#define TENSORFLOW_PLATFORM_NUMA_H_
+
+#include "tensorflow/core/platform/platform.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace port {
+
+// Value used to indicate that no NUMA node affinity is requested or known.
+constexpr int kNUMANoAffinity = -1;
+
+// Returns true iff NUMA topology information is available on this platform
+// and more than one node is present.
+bool NUMAEnabled();
+
+// Returns the number of NUMA nodes present with respect to CPU operations.
+// Typically this will be the number of sockets where some RAM has greater
+// affinity with one socket than another.  Returns 1 if the topology cannot be
+// determined.
+int NUMANumNodes();
+
+// Returns the number of schedulable CPUs that belong to `node`, or
+// NumSchedulableCPUs() if the topology is unknown.
+int NUMANumSchedulableCPUs(int node);
+
+// If possible, restricts the calling thread to the CPUs of `node`.  If
+// `node == kNUMANoAffinity`, removes any node affinity previously set.
+void NUMASetThreadNodeAffinity(int node);
+
+// Returns the NUMA node the calling thread was bound to by
+// NUMASetThreadNodeAffinity(), or kNUMANoAffinity.
+int NUMAGetThreadNodeAffinity();
+
+// Like AlignedMalloc(), but asks the operating system to back the returned
+// memory with pages local to `node`.  Allocations of at least a page get
+// their own page-granular mapping, bound to `node` before first touch;
+// smaller ones, and all allocations when binding is not supported, come from
+// AlignedMalloc() with no particular affinity.  The binding is a preference:
+// under memory pressure pages may still come from other nodes.
+// Memory returned by NUMAMalloc() must be released with NUMAFree().
+void* NUMAMalloc(int node, size_t size, int minimum_alignment);
+void NUMAFree(void* ptr);
+
+}  // namespace port
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_PLATFORM_NUMA_H_
@@ -13,11 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <string.h>
 #include <condition_variable>
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -33,6 +35,42 @@ TEST(Port, AlignedMalloc) {
   }
 }
 
+TEST(Port, NUMAMalloc) {
+  EXPECT_GE(NUMANumNodes(), 1);
+  for (int node = 0; node < NUMANumNodes(); ++node) {
+    EXPECT_GE(NUMANumSchedulableCPUs(node), 1);
+    for (int alignment : {64, 4096, 1 << 16}) {
+      for (size_t size : {1, 4096, 5000, 1 << 20}) {
+        void* p = NUMAMalloc(node, size, alignment);
+        ASSERT_TRUE(p != NULL) << "NUMAMalloc(" << node << ", " << size << ", "
+                               << alignment << ")";
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+        memset(p, 0, size);
+        NUMAFree(p);
+      }
+    }
+  }
+}
+
+TEST(Port, NUMAThreadAffinity) {
+  for (int node = 0; node < NUMANumNodes(); ++node) {
+    int observed = kNUMANoAffinity - 1;
+    {
+      ThreadOptions thread_options;
+      thread_options.numa_node = node;
+      thread::ThreadPool pool(Env::Default(), thread_options, "test", 1);
+      pool.Schedule(
+          [&observed]() { observed = NUMAGetThreadNodeAffinity(); });
+      // ~ThreadPool waits for the scheduled closure.
+    }
+    if (NUMAEnabled()) {
+      EXPECT_EQ(node, observed);
+    } else {
+      EXPECT_NE(kNUMANoAffinity - 1, observed);
+    }
+  }
+}
+
 TEST(ConditionVariable, WaitForMilliseconds_Timeout) {
   mutex m;
   mutex_lock l(m);
@@ -20,10 +20,17 @@ limitations under the License.
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/types.h"
 #if defined(__linux__) && !defined(__ANDROID__)
 #include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unordered_map>
+#include <vector>
 #endif
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -90,6 +97,195 @@ void* AlignedMalloc(size_t size, int minimum_alignment) {
 
 void AlignedFree(void* aligned_memory) { Free(aligned_memory); }
 
+#if defined(__linux__) && !defined(__ANDROID__)
+namespace {
+
+// Parses a sysfs list file such as "0-3,8-11\n" into its member ids.
+bool ReadSysfsList(const char* path, std::vector<int>* ids) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) return false;
+  char buf[4096];
+  const bool read_ok = fgets(buf, sizeof(buf), f) != nullptr;
+  fclose(f);
+  if (!read_ok) return false;
+  const char* p = buf;
+  while (*p != '\0' && *p != '\n') {
+    char* end;
+    const long lo = strtol(p, &end, 10);
+    if (end == p) return false;
+    long hi = lo;
+    p = end;
+    if (*p == '-') {
+      hi = strtol(p + 1, &end, 10);
+      if (end == p + 1) return false;
+      p = end;
+    }
+    for (long i = lo; i <= hi; ++i) ids->push_back(static_cast<int>(i));
+    if (*p == ',') ++p;
+  }
+  return true;
+}
+
+// NUMA nodes that contain at least one CPU this process may be scheduled on.
+// Nodes are numbered densely from 0; `sysfs_ids` maps them back to the
+// kernel's node ids, which may be sparse.
+struct NUMATopology {
+  std::vector<int> sysfs_ids;
+  std::vector<cpu_set_t> cpus;
+  cpu_set_t process_cpus;
+};
+
+const NUMATopology& GetNUMATopology() {
+  static const NUMATopology* topology = [] {
+    NUMATopology* t = new NUMATopology;
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &t->process_cpus) != 0) {
+      return t;
+    }
+    std::vector<int> nodes;
+    if (!ReadSysfsList("/sys/devices/system/node/online", &nodes)) return t;
+    for (int node : nodes) {
+      char path[128];
+      snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+               node);
+      std::vector<int> node_cpus;
+      if (!ReadSysfsList(path, &node_cpus)) continue;
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (int cpu : node_cpus) {
+        if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &t->process_cpus)) {
+          CPU_SET(cpu, &set);
+        }
+      }
+      if (CPU_COUNT(&set) == 0) continue;
+      t->sysfs_ids.push_back(node);
+      t->cpus.push_back(set);
+    }
+    return t;
+  }();
+  return *topology;
+}
+
+thread_local int numa_thread_node = kNUMANoAffinity;
+
+// Lengths of the regions NUMAMalloc() mapped directly from the kernel, keyed
+// by address, so that NUMAFree() can tell them apart from AlignedMalloc()
+// memory and unmap them.
+mutex numa_regions_mu(LINKER_INITIALIZED);
+
+std::unordered_map<void*, size_t>* NUMARegions() {
+  static std::unordered_map<void*, size_t>* regions =
+      new std::unordered_map<void*, size_t>;
+  return regions;
+}
+
+}  // namespace
+
+bool NUMAEnabled() { return GetNUMATopology().cpus.size() > 1; }
+
+int NUMANumNodes() {
+  const int n = GetNUMATopology().cpus.size();
+  return n > 0 ? n : 1;
+}
+
+int NUMANumSchedulableCPUs(int node) {
+  const NUMATopology& t = GetNUMATopology();
+  if (node < 0 || node >= static_cast<int>(t.cpus.size())) {
+    return NumSchedulableCPUs();
+  }
+  return CPU_COUNT(&t.cpus[node]);
+}
+
+void NUMASetThreadNodeAffinity(int node) {
+  const NUMATopology& t = GetNUMATopology();
+  if (node >= static_cast<int>(t.cpus.size())) {
+    LOG(WARNING) << "NUMA node " << node << " does not exist";
+    return;
+  }
+  const cpu_set_t& set = node < 0 ? t.process_cpus : t.cpus[node];
+  if (sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0) {
+    LOG(WARNING) << "sched_setaffinity failed for NUMA node " << node << ": "
+                 << strerror(errno);
+    return;
+  }
+  numa_thread_node = node < 0 ? kNUMANoAffinity : node;
+}
+
+int NUMAGetThreadNodeAffinity() { return numa_thread_node; }
+
+void* NUMAMalloc(int node, size_t size, int minimum_alignment) {
+  const NUMATopology& t = GetNUMATopology();
+  if (node < 0 || node >= static_cast<int>(t.cpus.size())) {
+    return AlignedMalloc(size, minimum_alignment);
+  }
+  // mbind() works on whole pages and only affects pages faulted in after the
+  // call, so binding part of the heap would move neighbouring objects' pages
+  // and leave recycled ones where they are.  Instead, give each allocation of
+  // at least a page its own anonymous mapping and bind it before anything
+  // touches it.  Smaller allocations are not worth a mapping each.
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const int kBitsPerWord = 8 * sizeof(unsigned long);
+  const int kMaxNodes = 16 * kBitsPerWord;
+  const int sysfs_id = t.sysfs_ids[node];
+  if (size < page_size || minimum_alignment > static_cast<int>(page_size) ||
+      sysfs_id >= kMaxNodes) {
+    return AlignedMalloc(size, minimum_alignment);
+  }
+  const size_t len = (size + page_size - 1) / page_size * page_size;
+  void* ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) return nullptr;
+  // MPOL_PREFERRED: allocate the pages on the node if possible, falling back
+  // to other nodes under memory pressure.
+  const int kMpolPreferred = 1;
+  unsigned long nodemask[16] = {0};
+  nodemask[sysfs_id / kBitsPerWord] = 1UL << (sysfs_id % kBitsPerWord);
+  if (syscall(SYS_mbind, ptr, len, kMpolPreferred, nodemask, kMaxNodes, 0) !=
+      0) {
+    VLOG(1) << "mbind to NUMA node " << node << " failed: " << strerror(errno);
+  }
+  mutex_lock l(numa_regions_mu);
+  (*NUMARegions())[ptr] = len;
+  return ptr;
+}
+
+void NUMAFree(void* ptr) {
+  if (ptr == nullptr) return;
+  size_t len = 0;
+  {
+    mutex_lock l(numa_regions_mu);
+    auto it = NUMARegions()->find(ptr);
+    if (it != NUMARegions()->end()) {
+      len = it->second;
+      NUMARegions()->erase(it);
+    }
+  }
+  if (len == 0) {
+    AlignedFree(ptr);
+  } else if (munmap(ptr, len) != 0) {
+    LOG(ERROR) << "munmap of NUMA region failed: " << strerror(errno);
+  }
+}
+
+#else  // !(defined(__linux__) && !defined(__ANDROID__))
+
+bool NUMAEnabled() { return false; }
+
+int NUMANumNodes() { return 1; }
+
+int NUMANumSchedulableCPUs(int node) { return NumSchedulableCPUs(); }
+
+void NUMASetThreadNodeAffinity(int node) {}
+
+int NUMAGetThreadNodeAffinity() { return kNUMANoAffinity; }
+
+void* NUMAMalloc(int node, size_t size, int minimum_alignment) {
+  return AlignedMalloc(size, minimum_alignment);
+}
+
+void NUMAFree(void* ptr) { AlignedFree(ptr); }
+
+#endif  // defined(__linux__) && !defined(__ANDROID__)
+
 void* Malloc(size_t size) {
 #ifdef TENSORFLOW_USE_JEMALLOC
   return jemalloc_malloc(size);
@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/platform/init_main.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/types.h"
 
@@ -58,6 +59,22 @@ void* AlignedMalloc(size_t size, int minimum_alignment) {
 
 void AlignedFree(void* aligned_memory) { _aligned_free(aligned_memory); }
 
+bool NUMAEnabled() { return false; }
+
+int NUMANumNodes() { return 1; }
+
+int NUMANumSchedulableCPUs(int node) { return NumSchedulableCPUs(); }
+
+void NUMASetThreadNodeAffinity(int node) {}
+
+int NUMAGetThreadNodeAffinity() { return kNUMANoAffinity; }
+
+void* NUMAMalloc(int node, size_t size, int minimum_alignment) {
+  return AlignedMalloc(size, minimum_alignment);
+}
+
+void NUMAFree(void* ptr) { AlignedFree(ptr); }
+
 void* Malloc(size_t size) { return ::malloc(size); }
 
 void* Realloc(void* ptr, size_t size) { return ::realloc(ptr, size); }
@@ -23,10 +23,12 @@ limitations under the License.
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/casts.h"
+#include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/presized_cuckoo_map.h"
@@ -60,6 +62,148 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+template <typename T>
+class LimitedArraySlice {
+ public:
+  LimitedArraySlice(T* begin, size_t num_elements)
+      : current_(begin), end_(begin + num_elements) {}
+
+  // May return negative if there were push_back calls after slice was filled.
+  int64 EndDistance() const { return end_ - current_; }
+
+  // Attempts to push value to the back of this. If the slice has
+  // already been filled, this method has no effect on the underlying data, but
+  // it changes the number returned by EndDistance into negative values.
+  void push_back(T&& value) {
+    if (EndDistance() > 0) *current_ = std::move(value);
+    ++current_;
+  }
+
+  // Returns a pointer to the next n elements of the slice and moves past
+  // them.  Like push_back, if fewer than n elements are left this has no
+  // effect on the underlying data: it returns nullptr and only changes
+  // EndDistance.
+  T* Grow(size_t n) {
+    T* result = EndDistance() >= static_cast<int64>(n) ? current_ : nullptr;
+    current_ += n;
+    return result;
+  }
+
+ private:
+  T* current_;
+  T* end_;
+};
+
+// Grows "list" by n elements and returns a pointer to the first new one, or
+// nullptr if the list can not hold n more elements.
+template <typename T>
+T* Grow(SmallVector<T>* list, size_t n) {
+  const size_t old_size = list->size();
+  list->resize(old_size + n);
+  return list->data() + old_size;
+}
+
+template <typename T>
+T* Grow(LimitedArraySlice<T>* list, size_t n) {
+  return list->Grow(n);
+}
+
+// Copies n little-endian floats starting at "data" to "out".  On little-endian
+// hosts this is a single memcpy.
+void CopyLittleEndianFloats(const uint8* data, size_t n, float* out) {
+  if (port::kLittleEndian) {
+    memcpy(out, data, n * sizeof(float));
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = bit_cast<float>(
+          core::DecodeFixed32(reinterpret_cast<const char*>(data) + 4 * i));
+    }
+  }
+}
+
+// Returns the number of bytes in [p, end) that do not have their most
+// significant bit set, i.e. the number of varints that end in that range.
+size_t CountVarints(const uint8* p, const uint8* end) {
+  size_t count = 0;
+  // Inspect 8 bytes at a time: the byte that ends a varint gets a 1 in its
+  // lowest bit and the multiplication sums those bits into the top byte.
+  for (; end - p >= 8; p += 8) {
+    uint64 word;
+    memcpy(&word, p, sizeof(word));
+    const uint64 ends = (~word & 0x8080808080808080ULL) >> 7;
+    count += (ends * 0x0101010101010101ULL) >> 56;
+  }
+  for (; p < end; ++p) {
+    if (*p < 0x80) ++count;
+  }
+  return count;
+}
+
+// Decodes a single varint starting at *p into *value and advances *p past it.
+// Returns false if the varint is longer than 10 bytes or is cut off by "end".
+inline bool DecodeVarint64(const uint8** p, const uint8* end, uint64* value) {
+  const uint8* ptr = *p;
+  uint64 result = 0;
+  for (uint32 shift = 0; shift <= 63 && ptr < end; shift += 7) {
+    const uint64 byte = *ptr++;
+    result |= (byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      *value = result;
+      *p = ptr;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Decodes the packed varints in [p, end) into out[0, n), where n must be the
+// result of CountVarints(p, end).  Returns false on malformed input.
+bool DecodePackedVarints(const uint8* p, const uint8* end, size_t n,
+                         int64* out) {
+  int64* const out_end = out + n;
+  while (out < out_end) {
+    // Fast path: if none of the next 8 bytes has a continuation bit they
+    // are 8 single-byte varints, which is the common case for ids and
+    // small counts.
+    if (end - p >= 8 && out_end - out >= 8) {
+      uint64 word;
+      memcpy(&word, p, sizeof(word));
+      if ((word & 0x8080808080808080ULL) == 0) {
+        for (int i = 0; i < 8; ++i) {
+          out[i] = p[i];
+        }
+        p += 8;
+        out += 8;
+        continue;
+      }
+    }
+    uint64 value;
+    if (!DecodeVarint64(&p, end, &value)) return false;
+    *out++ = static_cast<int64>(value);
+  }
+  return p == end;
+}
+
+bool ParseString(protobuf::io::CodedInputStream* stream, StringPiece* result) {
+  DCHECK(stream != nullptr);
+  DCHECK(result != nullptr);
+  uint32 length;
+  if (!stream->ReadVarint32(&length)) return false;
+  if (length == 0) {
+    *result = StringPiece(nullptr, 0);
+    return true;
+  }
+  const void* stream_alias;
+  int stream_size;
+  if (!stream->GetDirectBufferPointer(&stream_alias, &stream_size)) {
+    return false;
+  }
+  if (static_cast<uint32>(stream_size) < length) return false;
+  *result = StringPiece(static_cast<const char*>(stream_alias), length);
+  stream->Skip(length);
+  return true;
+}
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -108,12 +252,11 @@ class Feature {
 
     while (!stream.ExpectAtEnd()) {
       if (!stream.ExpectTag(kDelimitedTag(1))) return false;
-      // parse string
-      uint32 bytes_length;
-      if (!stream.ReadVarint32(&bytes_length)) return false;
-      string bytes;
-      if (!stream.ReadString(&bytes, bytes_length)) return false;
-      bytes_list->push_back(std::move(bytes));
+      // The values reference the serialized input; they are copied only
+      // when they are written to an output tensor.
+      StringPiece bytes;
+      if (!ParseString(&stream, &bytes)) return false;
+      bytes_list->push_back(bytes);
     }
     stream.PopLimit(limit);
     return true;
@@ -137,17 +280,14 @@ class Feature {
 
       if (peek_tag == kDelimitedTag(1)) {                       // packed
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
-        uint32 packed_length;
-        if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          uint32 buffer32;
-          if (!stream.ReadLittleEndian32(&buffer32)) return false;
-          float_list->push_back(bit_cast<float>(buffer32));
-        }
-
-        stream.PopLimit(packed_limit);
+        const uint8* packed;
+        size_t packed_length;
+        if (!ParsePacked(&stream, &packed, &packed_length)) return false;
+        if (packed_length % sizeof(float) != 0) return false;
+
+        const size_t n = packed_length / sizeof(float);
+        float* out = Grow(float_list, n);
+        if (n > 0 && out != nullptr) CopyLittleEndianFloats(packed, n, out);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kFixed32Tag(1))) return false;
@@ -179,17 +319,17 @@ class Feature {
       }
       if (peek_tag == kDelimitedTag(1)) {                       // packed
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
-        uint32 packed_length;
-        if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          protobuf_uint64 n;  // There is no API for int64
-          if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64>(n));
+        const uint8* packed;
+        size_t packed_length;
+        if (!ParsePacked(&stream, &packed, &packed_length)) return false;
+
+        const uint8* packed_end = packed + packed_length;
+        const size_t n = CountVarints(packed, packed_end);
+        int64* out = Grow(int64_list, n);
+        if (out != nullptr &&
+            !DecodePackedVarints(packed, packed_end, n, out)) {
+          return false;
         }
-
-        stream.PopLimit(packed_limit);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kVarintTag(1))) return false;
@@ -206,6 +346,17 @@ class Feature {
   StringPiece GetSerialized() const { return serialized_; }
 
  private:
+  // Reads the length of a packed field and returns its contents in
+  // [*data, *data + *size) without copying them.
+  static bool ParsePacked(protobuf::io::CodedInputStream* stream,
+                          const uint8** data, size_t* size) {
+    StringPiece packed;
+    if (!ParseString(stream, &packed)) return false;
+    *data = reinterpret_cast<const uint8*>(packed.data());
+    *size = packed.size();
+    return true;
+  }
+
   // TODO(lew): Pair of uint8* would be more natural.
   StringPiece serialized_;
 };
@@ -240,26 +391,6 @@ inline bool SkipExtraneousTag(protobuf::io::CodedInputStream* stream) {
   return false;  // unrecognized tag type
 }
 
-bool ParseString(protobuf::io::CodedInputStream* stream, StringPiece* result) {
-  DCHECK(stream != nullptr);
-  DCHECK(result != nullptr);
-  uint32 length;
-  if (!stream->ReadVarint32(&length)) return false;
-  if (length == 0) {
-    *result = StringPiece(nullptr, 0);
-    return true;
-  }
-  const void* stream_alias;
-  int stream_size;
-  if (!stream->GetDirectBufferPointer(&stream_alias, &stream_size)) {
-    return false;
-  }
-  if (static_cast<uint32>(stream_size) < length) return false;
-  *result = StringPiece(static_cast<const char*>(stream_alias), length);
-  stream->Skip(length);
-  return true;
-}
-
 bool ParseFeatureMapEntry(protobuf::io::CodedInputStream* stream,
                           parsed::FeatureMapEntry* feature_map_entry) {
   DCHECK(stream != nullptr);
@@ -343,12 +474,11 @@ bool TestFastParse(const string& serialized, Example* example) {
       case DT_INVALID:
         break;
       case DT_STRING: {
-        SmallVector<string> list;
+        SmallVector<StringPiece> list;
         if (!name_and_feature.second.ParseBytesList(&list)) return false;
         auto* result_list = value.mutable_bytes_list();
-        for (auto& bytes : list) {
-          auto* new_value = result_list->add_value();
-          new_value->swap(bytes);
+        for (StringPiece bytes : list) {
+          result_list->add_value(bytes.data(), bytes.size());
         }
         break;
       }
@@ -408,7 +538,8 @@ enum class Type { Sparse, Dense };
 struct SparseBuffer {
   // Features are in one of the 3 vectors below depending on config's dtype.
   // Other 2 vectors remain empty.
-  SmallVector<string> bytes_list;
+  // bytes_list references the serialized examples, which outlive the buffer.
+  SmallVector<StringPiece> bytes_list;
   SmallVector<float> float_list;
   SmallVector<int64> int64_list;
 
@@ -425,44 +556,54 @@ struct SeededHasher {
   uint64 seed{0xDECAFCAFFE};
 };
 
-template <typename T>
-class LimitedArraySlice {
- public:
-  LimitedArraySlice(T* begin, size_t num_elements)
-      : current_(begin), end_(begin + num_elements) {}
+// Temporaries shared by all examples of a minibatch, so that parsing an
+// example stops allocating once they have grown to the largest example.
+struct MiniBatchScratch {
+  explicit MiniBatchScratch(const Config& config)
+      : sparse_feature_last_example(config.sparse.size(), -1),
+        dense_feature_last_example(config.dense.size(), -1) {}
 
-  // May return negative if there were push_back calls after slice was filled.
-  int64 EndDistance() const { return end_ - current_; }
+  parsed::Example parsed_example;
+  // Index of the last example in which each feature was seen.  Examples of
+  // a minibatch are parsed in increasing index order, so these need no
+  // reset between examples.
+  std::vector<int64> sparse_feature_last_example;
+  std::vector<int64> dense_feature_last_example;
+  // Fixed length dense strings, before they are copied to the output.
+  SmallVector<StringPiece> bytes_list;
+};
 
-  // Attempts to push value to the back of this. If the slice has
-  // already been filled, this method has no effect on the underlying data, but
-  // it changes the number returned by EndDistance into negative values.
-  void push_back(T&& value) {
-    if (EndDistance() > 0) *current_ = std::move(value);
-    ++current_;
+template <typename T>
+void CopyBlock(const T* b, const T* e, T* t) {
+  std::copy(b, e, t);
+}
+void CopyBlock(const StringPiece* b, const StringPiece* e, string* t) {
+  for (; b != e; ++b, ++t) {
+    t->assign(b->data(), b->size());
   }
-
- private:
-  T* current_;
-  T* end_;
-};
+}
 
 Status FastParseSerializedExample(
     const string& serialized_example, const string& example_name,
     const size_t example_index, const Config& config,
     const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
-    SeededHasher hasher, std::vector<Tensor>* output_dense,
+    SeededHasher hasher, MiniBatchScratch* scratch,
+    std::vector<Tensor>* output_dense,
     std::vector<SparseBuffer>* output_varlen_dense,
     std::vector<SparseBuffer>* output_sparse) {
+  DCHECK(scratch != nullptr);
   DCHECK(output_dense != nullptr);
   DCHECK(output_sparse != nullptr);
-  parsed::Example parsed_example;
+  parsed::Example& parsed_example = scratch->parsed_example;
+  parsed_example.clear();
   if (!ParseExample(serialized_example, &parsed_example)) {
     return errors::InvalidArgument("Could not parse example input, value: '",
                                    serialized_example, "'");
   }
-  std::vector<int64> sparse_feature_last_example(config.sparse.size(), -1);
-  std::vector<int64> dense_feature_last_example(config.dense.size(), -1);
+  std::vector<int64>& sparse_feature_last_example =
+      scratch->sparse_feature_last_example;
+  std::vector<int64>& dense_feature_last_example =
+      scratch->dense_feature_last_example;
 
   // Handle features present in the example.
   const size_t parsed_example_size = parsed_example.size();
@@ -563,12 +704,15 @@ Status FastParseSerializedExample(
             break;
           }
           case DT_STRING: {
-            auto out_p = out.flat<string>().data() + offset;
-            LimitedArraySlice<string> slice(out_p, num_elements);
-            if (!feature.ParseBytesList(&slice)) return parse_error();
-            if (slice.EndDistance() != 0) {
-              return shape_error(num_elements - slice.EndDistance(), "bytes");
+            SmallVector<StringPiece>& bytes_list = scratch->bytes_list;
+            bytes_list.clear();
+            if (!feature.ParseBytesList(&bytes_list)) return parse_error();
+            if (bytes_list.size() != num_elements) {
+              return shape_error(bytes_list.size(), "bytes");
             }
+            auto out_p = out.flat<string>().data() + offset;
+            CopyBlock(bytes_list.data(), bytes_list.data() + num_elements,
+                      out_p);
             break;
           }
           default:
@@ -764,8 +908,19 @@ Status CheckConfigDataType(DataType dtype) {
   }
 }
 
+// Type of the elements SparseBuffer holds for outputs of type T.
+template <typename T>
+struct BufferElement {
+  using Type = T;
+};
+template <>
+struct BufferElement<string> {
+  using Type = StringPiece;
+};
+
 template <typename T>
-const SmallVector<T>& GetListFromBuffer(const SparseBuffer& buffer);
+const SmallVector<typename BufferElement<T>::Type>& GetListFromBuffer(
+    const SparseBuffer& buffer);
 
 template <>
 const SmallVector<int64>& GetListFromBuffer<int64>(const SparseBuffer& buffer) {
@@ -776,20 +931,11 @@ const SmallVector<float>& GetListFromBuffer<float>(const SparseBuffer& buffer) {
   return buffer.float_list;
 }
 template <>
-const SmallVector<string>& GetListFromBuffer<string>(
+const SmallVector<StringPiece>& GetListFromBuffer<string>(
     const SparseBuffer& buffer) {
   return buffer.bytes_list;
 }
 
-template <typename T>
-void CopyOrMoveBlock(const T* b, const T* e, T* t) {
-  std::copy(b, e, t);
-}
-template <>
-void CopyOrMoveBlock(const string* b, const string* e, string* t) {
-  std::move(b, e, t);
-}
-
 template <typename T>
 void FillAndCopyVarLen(
     const int d, const size_t num_elements,
@@ -822,7 +968,7 @@ void FillAndCopyVarLen(
     for (size_t j = 0; j < examples_in_buffer; ++j) {
       // Number of elements stored for this example.
       const size_t num_elems = end_indices[j] - elements_tally;
-      CopyOrMoveBlock(list_ptr, list_ptr + num_elems, data);
+      CopyBlock(list_ptr, list_ptr + num_elems, data);
       // Move forward this many elements in the varlen buffer.
       list_ptr += num_elems;
       // Move forward to the next minibatch entry in the values output.
@@ -930,13 +1076,14 @@ Status FastParseExample(const Config& config,
   auto ProcessMiniBatch = [&](size_t minibatch) {
     sparse_buffers[minibatch].resize(config.sparse.size());
     varlen_dense_buffers[minibatch].resize(config.dense.size());
+    MiniBatchScratch scratch(config);
     size_t start = first_example_of_minibatch(minibatch);
     size_t end = first_example_of_minibatch(minibatch + 1);
     for (size_t e = start; e < end; ++e) {
       status_of_minibatch[minibatch] = FastParseSerializedExample(
           serialized[e],
           (example_names.size() > 0 ? example_names[e] : "<unknown>"), e,
-          config, config_index, hasher, &fixed_dense_values,
+          config, config_index, hasher, &scratch, &fixed_dense_values,
           &varlen_dense_buffers[minibatch], &sparse_buffers[minibatch]);
       if (!status_of_minibatch[minibatch].ok()) break;
     }
@@ -1018,7 +1165,7 @@ Status FastParseExample(const Config& config,
           break;
         }
         case DT_STRING: {
-          std::move(buffer.bytes_list.begin(), buffer.bytes_list.end(),
+          CopyBlock(buffer.bytes_list.begin(), buffer.bytes_list.end(),
                     values->flat<string>().data() + offset);
           break;
         }
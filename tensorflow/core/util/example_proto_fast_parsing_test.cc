@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
 #include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/protobuf.h"
@@ -242,6 +243,51 @@ TEST(FastParse, SomeFeatures) {
   TestCorrectness(Serialize(example));
 }
 
+TEST(FastParse, PackedVarintRuns) {
+  Example example;
+  Int64List* int64_list =
+      (*example.mutable_features()->mutable_feature())["int64_list"]
+          .mutable_int64_list();
+  // Runs of single-byte varints interleaved with long ones.
+  for (int i = 0; i < 20; ++i) int64_list->add_value(i);
+  int64_list->add_value(127);
+  int64_list->add_value(128);
+  int64_list->add_value(-1);
+  int64_list->add_value(kint64max);
+  int64_list->add_value(kint64min);
+  for (int i = 0; i < 9; ++i) int64_list->add_value(100 + i);
+  int64_list->add_value(1LL << 35);
+  TestCorrectness(Serialize(example));
+}
+
+TEST(FastParse, PackedFloats) {
+  Example example;
+  FloatList* float_list =
+      (*example.mutable_features()->mutable_feature())["float_list"]
+          .mutable_float_list();
+  for (int i = 0; i < 100; ++i) float_list->add_value(i * 0.5f - 7.0f);
+  TestCorrectness(Serialize(example));
+}
+
+TEST(FastParse, TruncatedPackedVarint) {
+  Example example;
+  // Packed int64_list holding the single byte 0x80, which starts a varint
+  // but does not end it.
+  EXPECT_FALSE(TestFastParse(
+      "\x0a\x0e\x0a\x0c\x0a\x03\x61\x67\x65\x12\x05\x1a\x03\x0a\x01\x80",
+      &example));
+}
+
+TEST(FastParse, PackedFloatsWithPartialValue) {
+  Example example;
+  // Packed float_list of 3 bytes.
+  EXPECT_FALSE(TestFastParse(
+      string("\x0a\x10\x0a\x0e\x0a\x03\x61\x67\x65\x12\x07\x12\x05\x0a"
+             "\x03\x00\x00\x80",
+             18),
+      &example));
+}
+
 string RandStr(random::SimplePhilox* rng) {
   static const char key_char_lookup[] =
       "0123456789{}~`!@#$%^&*()"
@@ -371,6 +417,90 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(TestFastParseExample, StringsAndPackedValues) {
+  Example example1;
+  auto& fmap1 = *example1.mutable_features()->mutable_feature();
+  fmap1["dense_string"].mutable_bytes_list()->add_value("a");
+  fmap1["dense_string"].mutable_bytes_list()->add_value("bb");
+  fmap1["dense_float"].mutable_float_list()->add_value(1.5);
+  fmap1["dense_float"].mutable_float_list()->add_value(-2.5);
+  fmap1["varlen_int64"].mutable_int64_list()->add_value(300);
+  fmap1["sparse_string"].mutable_bytes_list()->add_value("x");
+  fmap1["sparse_string"].mutable_bytes_list()->add_value("yy");
+
+  Example example2;
+  auto& fmap2 = *example2.mutable_features()->mutable_feature();
+  fmap2["dense_string"].mutable_bytes_list()->add_value("ccc");
+  fmap2["dense_string"].mutable_bytes_list()->add_value("");
+  fmap2["dense_float"].mutable_float_list()->add_value(3);
+  fmap2["dense_float"].mutable_float_list()->add_value(4);
+  fmap2["varlen_int64"].mutable_int64_list()->add_value(-1);
+  fmap2["varlen_int64"].mutable_int64_list()->add_value(2);
+
+  std::vector<string> serialized = {Serialize(example1), Serialize(example2)};
+
+  FastParseExampleConfig config;
+  config.dense.push_back({"dense_string", DT_STRING, PartialTensorShape({2}),
+                          Tensor(DT_STRING, TensorShape({0})), false, 2});
+  config.dense.push_back({"dense_float", DT_FLOAT, PartialTensorShape({2}),
+                          Tensor(DT_FLOAT, TensorShape({0})), false, 2});
+  Tensor varlen_default(DT_INT64, TensorShape({}));
+  varlen_default.scalar<int64>()() = 7;
+  config.dense.push_back({"varlen_int64", DT_INT64, PartialTensorShape({-1}),
+                          varlen_default, true, 1});
+  config.sparse.push_back({"sparse_string", DT_STRING});
+
+  Result result;
+  TF_EXPECT_OK(FastParseExample(config, serialized, gtl::ArraySlice<string>(),
+                                nullptr, &result));
+
+  ASSERT_EQ(3, result.dense_values.size());
+  auto dense_string = result.dense_values[0].matrix<string>();
+  EXPECT_EQ("a", dense_string(0, 0));
+  EXPECT_EQ("bb", dense_string(0, 1));
+  EXPECT_EQ("ccc", dense_string(1, 0));
+  EXPECT_EQ("", dense_string(1, 1));
+  auto dense_float = result.dense_values[1].matrix<float>();
+  EXPECT_EQ(1.5, dense_float(0, 0));
+  EXPECT_EQ(-2.5, dense_float(0, 1));
+  EXPECT_EQ(3, dense_float(1, 0));
+  EXPECT_EQ(4, dense_float(1, 1));
+  auto varlen = result.dense_values[2].matrix<int64>();
+  ASSERT_EQ(2, result.dense_values[2].dim_size(1));
+  EXPECT_EQ(300, varlen(0, 0));
+  EXPECT_EQ(7, varlen(0, 1));
+  EXPECT_EQ(-1, varlen(1, 0));
+  EXPECT_EQ(2, varlen(1, 1));
+
+  ASSERT_EQ(1, result.sparse_values.size());
+  auto sparse_string = result.sparse_values[0].vec<string>();
+  ASSERT_EQ(2, sparse_string.size());
+  EXPECT_EQ("x", sparse_string(0));
+  EXPECT_EQ("yy", sparse_string(1));
+  auto sparse_shape = result.sparse_shapes[0].vec<int64>();
+  EXPECT_EQ(2, sparse_shape(0));
+  EXPECT_EQ(2, sparse_shape(1));
+}
+
+TEST(TestFastParseExample, WrongNumberOfPackedFloats) {
+  Example example;
+  auto& fmap = *example.mutable_features()->mutable_feature();
+  for (int i = 0; i < 3; ++i) {
+    fmap["dense_float"].mutable_float_list()->add_value(i);
+  }
+  std::vector<string> serialized = {Serialize(example)};
+
+  FastParseExampleConfig config;
+  config.dense.push_back({"dense_float", DT_FLOAT, PartialTensorShape({2}),
+                          Tensor(DT_FLOAT, TensorShape({0})), false, 2});
+  Result result;
+  Status status = FastParseExample(config, serialized,
+                                   gtl::ArraySlice<string>(), nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+  EXPECT_TRUE(StringPiece(status.error_message()).contains("Values size: 3"))
+      << status;
+}
+
 }  // namespace
 
 }  // namespace example
@@ -16,17 +16,26 @@ limitations under the License.
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/platform/platform.h"
+#if defined(PLATFORM_POSIX)
+#include <sys/mman.h>
+#endif
+
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb_text.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb_text.h"
 #include "tensorflow/core/framework/versions.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/gtl/stl_util.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
@@ -137,6 +146,19 @@ Status WriteTensor(const Tensor& val, FileOutputBuffer* out,
   return out->Append(StringPiece(buf, *bytes_written));
 }
 
+// Appends zeros to "out" until "*size" is a multiple of "alignment", and
+// updates "*size".
+Status PadAlignment(FileOutputBuffer* out, int alignment, int64* size) {
+  const int bytes_over = *size % alignment;
+  if (bytes_over == 0) {
+    return Status::OK();
+  }
+  const int bytes_to_write = alignment - bytes_over;
+  TF_RETURN_IF_ERROR(out->Append(string(bytes_to_write, '\0')));
+  *size += bytes_to_write;
+  return Status::OK();
+}
+
 // Serializes string tensor "val".  "bytes_written" is treated in the same
 // fashion as WriteTensor().
 //
@@ -238,10 +260,112 @@ bool IsFullSlice(const TensorSlice& slice_spec,
   }
 }
 
+// Checks the crc32c checksum stored in "entry" against "actual_crc32c", the
+// checksum of the restored bytes.
+Status VerifyChecksum(const BundleEntryProto& entry, uint32 actual_crc32c) {
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the restored bytes ", actual_crc32c);
+  }
+  return Status::OK();
+}
+
+// Runs fn(0), ..., fn(n - 1), concurrently on "pool" if it is not null, and
+// returns when they are all done.
+void RunConcurrently(thread::ThreadPool* pool, int64 n,
+                     const std::function<void(int64)>& fn) {
+  if (pool == nullptr || n <= 1) {
+    for (int64 i = 0; i < n; ++i) fn(i);
+    return;
+  }
+  BlockingCounter counter(n);
+  for (int64 i = 0; i < n; ++i) {
+    pool->Schedule([&fn, &counter, i]() {
+      fn(i);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+}
+
+// Backs a single tensor with the bytes at "data" in a mapped data file, and
+// releases the file (see BundleReader::MappedFile) once the tensor is
+// deallocated.
+class MappedTensorAllocator : public Allocator {
+ public:
+  // Takes ownership of a reference on "file".
+  MappedTensorAllocator(core::RefCounted* file, char* data, size_t num_bytes)
+      : file_(file), data_(data), num_bytes_(num_bytes) {}
+
+  string Name() override { return "MappedTensorAllocator"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    CHECK_EQ(reinterpret_cast<intptr_t>(data_) % alignment, 0);
+    CHECK_LE(num_bytes, num_bytes_);
+    return data_;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    DCHECK_EQ(ptr, data_);
+    file_->Unref();
+    delete this;
+  }
+
+ private:
+  core::RefCounted* const file_;
+  char* const data_;
+  const size_t num_bytes_;
+};
+
 }  // namespace
 
-BundleWriter::BundleWriter(Env* env, StringPiece prefix)
+// A copy-on-write mapping of a data file, shared by the tensors backed by it.
+class BundleReader::MappedFile : public core::RefCounted {
+ public:
+  // Returns nullptr if "filename" can not be mapped copy-on-write, in which
+  // case the tensors are read from it instead.
+  static MappedFile* Open(Env* env, const string& filename) {
+#if defined(PLATFORM_POSIX)
+    StringPiece scheme, host, path;
+    io::ParseURI(filename, &scheme, &host, &path);
+    if (!scheme.empty() && scheme != "file") return nullptr;
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    Status status = env->NewReadOnlyMemoryRegionFromFile(filename, &region);
+    if (!status.ok()) {
+      VLOG(1) << "Not mapping " << filename << ": " << status;
+      return nullptr;
+    }
+    // Local files are mapped privately, so a writable mapping is
+    // copy-on-write: written pages are copied, and the file is never modified.
+    if (region->length() == 0 ||
+        mprotect(const_cast<void*>(region->data()), region->length(),
+                 PROT_READ | PROT_WRITE) != 0) {
+      return nullptr;
+    }
+    return new MappedFile(std::move(region));
+#else
+    return nullptr;
+#endif
+  }
+
+  char* data() const {
+    return static_cast<char*>(const_cast<void*>(region_->data()));
+  }
+  uint64 length() const { return region_->length(); }
+
+ private:
+  explicit MappedFile(std::unique_ptr<ReadOnlyMemoryRegion> region)
+      : region_(std::move(region)) {}
+
+  const std::unique_ptr<ReadOnlyMemoryRegion> region_;
+};
+
+BundleWriter::BundleWriter(Env* env, StringPiece prefix,
+                           const Options& options)
     : env_(env),
+      options_(options),
       prefix_(prefix.ToString()),
       tmp_metadata_path_(strings::StrCat(MetaFilename(prefix_), ".tempstate",
                                          random::New64())),
@@ -249,6 +373,11 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix)
                                      random::New64())),
       out_(nullptr),
       size_(0) {
+  if (options_.data_alignment < 1) {
+    status_ = errors::InvalidArgument("Invalid data alignment: ",
+                                      options_.data_alignment);
+    return;
+  }
   status_ =
       env_->CreateDir(io::Dirname(prefix_).ToString());  // Ignores errors.
   const string filename = DataFilename(prefix_, 0, 1);
@@ -272,6 +401,11 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
     return status_;
   }
 
+  if (options_.data_alignment > 1) {
+    status_ = PadAlignment(out_.get(), options_.data_alignment, &size_);
+    if (!status_.ok()) return status_;
+  }
+
   BundleEntryProto* entry = &entries_[key_string];
   entry->set_dtype(val.dtype());
   val.shape().AsProto(entry->mutable_shape());
@@ -563,8 +697,13 @@ Status MergeBundles(Env* env, gtl::ArraySlice<string> prefixes,
 // Interface for reading a tensor bundle.
 
 BundleReader::BundleReader(Env* env, StringPiece prefix)
+    : BundleReader(env, prefix, Options()) {}
+
+BundleReader::BundleReader(Env* env, StringPiece prefix,
+                           const Options& options)
     : env_(env),
       prefix_(prefix.ToString()),
+      options_(options),
       metadata_(nullptr),
       table_(nullptr),
       iter_(nullptr) {
@@ -605,6 +744,9 @@ BundleReader::~BundleReader() {
   delete iter_;
   delete table_;
   gtl::STLDeleteValues(&data_);
+  for (const auto& p : mapped_data_) {
+    if (p.second != nullptr) p.second->Unref();
+  }
   gtl::STLDeleteValues(&tensor_slices_);
 }
 
@@ -629,17 +771,75 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return Status::OK();
 }
 
-Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
-  Tensor* ret = val;
+Status BundleReader::GetDataFile(int32 shard_id, RandomAccessFile** file) {
+  mutex_lock l(mu_);
+  RandomAccessFile*& data_file = data_[shard_id];
+  if (data_file == nullptr) {
+    std::unique_ptr<RandomAccessFile> opened;
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+        DataFilename(prefix_, shard_id, num_shards_), &opened));
+    data_file = opened.release();
+  }
+  *file = data_file;
+  return Status::OK();
+}
+
+bool BundleReader::GetMappedValue(const BundleEntryProto& entry, Tensor* val) {
+  if (!options_.use_mmap || !DataTypeCanUseMemcpy(entry.dtype()) ||
+      entry.size() == 0) {
+    return false;
+  }
+  const TensorShape stored_shape(entry.shape());
+  if (entry.size() !=
+      stored_shape.num_elements() * DataTypeSize(entry.dtype())) {
+    return false;  // PrepareValue() reports the invalid size.
+  }
+  MappedFile* file = nullptr;
+  {
+    mutex_lock l(mu_);
+    auto it = mapped_data_.find(entry.shard_id());
+    if (it == mapped_data_.end()) {
+      // Remembers the files which can not be mapped, too.
+      it = mapped_data_
+               .emplace(entry.shard_id(),
+                        MappedFile::Open(env_,
+                                         DataFilename(prefix_, entry.shard_id(),
+                                                      num_shards_)))
+               .first;
+    }
+    file = it->second;
+    if (file == nullptr) return false;
+    file->Ref();
+  }
+  char* data = file->data() + entry.offset();
+  if (entry.offset() + entry.size() > file->length() ||
+      reinterpret_cast<intptr_t>(data) % Allocator::kAllocatorAlignment != 0) {
+    // Read the tensor instead; a short file is reported by the read.
+    file->Unref();
+    return false;
+  }
+  *val = Tensor(new MappedTensorAllocator(file, data, entry.size()),
+                entry.dtype(), stored_shape);
+  return true;
+}
+
+Status BundleReader::PrepareValue(StringPiece key,
+                                  const BundleEntryProto& entry,
+                                  const Tensor& val, Tensor* ret,
+                                  bool* mapped) {
+  *mapped = false;
   const TensorShape stored_shape(TensorShape(entry.shape()));
-  if (val->NumElements() == 0) {
-    ret = new Tensor(entry.dtype(), stored_shape);
+  if (val.NumElements() == 0) {
+    *mapped = GetMappedValue(entry, ret);
+    if (!*mapped) *ret = Tensor(entry.dtype(), stored_shape);
+  } else {
+    *ret = val;
   }
 
   // Validates the "size" field.
   if (entry.dtype() != DT_STRING) {
     if (entry.size() != ret->TotalBytes()) {
-      return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+      return errors::DataLoss("Invalid size in bundle entry: key ", key,
                               "; stored size ", entry.size(),
                               "; expected size ", ret->TotalBytes());
     }
@@ -652,50 +852,46 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     const size_t lower_bound = ret->NumElements() + ret->TotalBytes() -
                                sizeof(string) * ret->NumElements();
     if (entry.size() < lower_bound) {
-      return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+      return errors::DataLoss("Invalid size in bundle entry: key ", key,
                               "; stored size ", entry.size(),
                               "; expected size is at least ", lower_bound);
     }
   }
+  return Status::OK();
+}
 
-  // Open the data file if not opened it.
-  std::unique_ptr<RandomAccessFile> file = nullptr;
-  std::unique_ptr<io::InputBuffer> buffered_file(data_[entry.shard_id()]);
-  if (buffered_file == nullptr) {
-    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
-        DataFilename(prefix_, entry.shard_id(), num_shards_), &file));
-    buffered_file.reset(
-        new io::InputBuffer(file.get(), 256 << 10 /* 256KB buffer */));
-  }
-  CHECK(buffered_file != nullptr);
+Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
+  Tensor ret;
+  bool mapped;
+  TF_RETURN_IF_ERROR(PrepareValue(key(), entry, *val, &ret, &mapped));
 
-  TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
   uint32 actual_crc32c = 0;
   if (DataTypeCanUseMemcpy(entry.dtype())) {
-    // Important: ReadInputByChunk() bounds the readahead as min(buffer, actual
-    // bytes needed).  This is critical when reading small tensors, so we don't
-    // rely on io::InputBuffer's blind buffering here.
-    char* backing_buffer = const_cast<char*>((ret->tensor_data().data()));
-    TF_RETURN_IF_ERROR(ReadInputByChunk(buffered_file->file(), entry.offset(),
-                                        entry.size(), 8 << 20 /* 8MB buffer */,
-                                        backing_buffer));
+    char* backing_buffer = GetBackingBuffer(ret);
+    if (!mapped) {
+      RandomAccessFile* file;
+      TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &file));
+      // Important: ReadInputByChunk() bounds the readahead as min(buffer,
+      // actual bytes needed).  This is critical when reading small tensors,
+      // so we don't rely on io::InputBuffer's blind buffering here.
+      TF_RETURN_IF_ERROR(ReadInputByChunk(file, entry.offset(), entry.size(),
+                                          8 << 20 /* 8MB buffer */,
+                                          backing_buffer));
+    }
     actual_crc32c = crc32c::Value(backing_buffer, entry.size());
   } else {
     // Relies on io::InputBuffer's buffering, because we issue many neighboring
     // reads for a single string tensor.
+    RandomAccessFile* file;
+    TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &file));
+    io::InputBuffer buffered_file(file, 256 << 10 /* 256KB buffer */);
     TF_RETURN_IF_ERROR(ReadStringTensor(
-        buffered_file.get(), ret->NumElements(), entry.offset(), entry.size(),
-        GetStringBackingBuffer(*ret), &actual_crc32c));
-  }
-  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
-    return errors::DataLoss(
-        "Checksum does not match: stored ",
-        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
-        " vs. calculated on the restored bytes ", actual_crc32c);
+        &buffered_file, ret.NumElements(), entry.offset(), entry.size(),
+        GetStringBackingBuffer(ret), &actual_crc32c));
   }
+  TF_RETURN_IF_ERROR(VerifyChecksum(entry, actual_crc32c));
 
-  *val = *ret;
-  if (ret != val) delete ret;
+  *val = ret;
   return Status::OK();
 }
 
@@ -713,6 +909,98 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMany(gtl::ArraySlice<string> keys,
+                                gtl::ArraySlice<Tensor*> vals) {
+  CHECK_EQ(keys.size(), vals.size());
+  // Non-partitioned tensors whose values remain to be read.
+  struct PendingValue {
+    BundleEntryProto entry;
+    Tensor* val;
+    Tensor ret;
+    bool mapped;
+    uint32 actual_crc32c = 0;
+  };
+  // A read of [begin, begin + size) of the data of a pending value.  String
+  // tensors are read (and checksummed) in one piece.
+  struct PendingRead {
+    PendingValue* value;
+    uint64 begin;
+    uint64 size;
+    Status status;
+  };
+  // Numeric tensors are read in pieces of this many bytes.
+  const uint64 kReadPieceSize = 16 << 20;
+
+  // The metadata table is only accessed from this thread.
+  std::vector<PendingValue> values(keys.size());
+  int64 num_values = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    CHECK(vals[i] != nullptr);
+    PendingValue* value = &values[num_values];
+    TF_RETURN_IF_ERROR(GetBundleEntryProto(keys[i], &value->entry));
+    if (!value->entry.slices().empty()) {
+      TF_RETURN_IF_ERROR(GetSliceValue(
+          keys[i], value->entry,
+          /* a full slice */
+          TensorSlice(TensorShape(value->entry.shape()).dims()), vals[i]));
+      continue;
+    }
+    TF_RETURN_IF_ERROR(PrepareValue(keys[i], value->entry, *vals[i],
+                                    &value->ret, &value->mapped));
+    value->val = vals[i];
+    ++num_values;
+  }
+  values.resize(num_values);
+
+  std::vector<PendingRead> reads;
+  for (PendingValue& value : values) {
+    if (value.mapped) continue;
+    const uint64 size = value.entry.size();
+    if (!DataTypeCanUseMemcpy(value.entry.dtype())) {
+      reads.push_back({&value, 0, size, Status::OK()});
+      continue;
+    }
+    for (uint64 begin = 0; begin < size; begin += kReadPieceSize) {
+      reads.push_back(
+          {&value, begin, std::min(kReadPieceSize, size - begin), Status::OK()});
+    }
+  }
+  RunConcurrently(options_.pool, reads.size(), [this, &reads](int64 i) {
+    PendingRead* read = &reads[i];
+    PendingValue* value = read->value;
+    RandomAccessFile* file;
+    read->status = GetDataFile(value->entry.shard_id(), &file);
+    if (!read->status.ok()) return;
+    if (DataTypeCanUseMemcpy(value->entry.dtype())) {
+      read->status = ReadInputByChunk(
+          file, value->entry.offset() + read->begin, read->size,
+          8 << 20 /* 8MB buffer */, GetBackingBuffer(value->ret) + read->begin);
+    } else {
+      io::InputBuffer buffered_file(file, 256 << 10 /* 256KB buffer */);
+      read->status = ReadStringTensor(
+          &buffered_file, value->ret.NumElements(), value->entry.offset(),
+          value->entry.size(), GetStringBackingBuffer(value->ret),
+          &value->actual_crc32c);
+    }
+  });
+  for (const PendingRead& read : reads) {
+    TF_RETURN_IF_ERROR(read.status);
+  }
+
+  RunConcurrently(options_.pool, values.size(), [&values](int64 i) {
+    PendingValue* value = &values[i];
+    if (DataTypeCanUseMemcpy(value->entry.dtype())) {
+      value->actual_crc32c =
+          crc32c::Value(GetBackingBuffer(value->ret), value->entry.size());
+    }
+  });
+  for (PendingValue& value : values) {
+    TF_RETURN_IF_ERROR(VerifyChecksum(value.entry, value.actual_crc32c));
+    *value.val = value.ret;
+  }
+  return Status::OK();
+}
+
 Status BundleReader::LookupTensorSlices(StringPiece key,
                                         std::vector<TensorSlice>* slices) {
   slices->clear();
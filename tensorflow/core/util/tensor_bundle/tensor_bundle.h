@@ -71,12 +71,15 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/io/table.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 #include "tensorflow/core/util/tensor_slice_set.h"
@@ -103,7 +106,18 @@ extern const char* const kHeaderEntryKey;
 // All threads accessing the same BundleWriter must synchronize.
 class BundleWriter {
  public:
-  BundleWriter(Env* env, StringPiece prefix);
+  struct Options {
+    Options() {}
+    // The data of each entry starts at a multiple of this many bytes in the
+    // data file, padded with zeros.  With Allocator::kAllocatorAlignment, the
+    // numeric tensors can be mapped by BundleReader (see
+    // BundleReader::Options::use_mmap).  The default of 1 packs the entries
+    // densely.
+    int data_alignment = 1;
+  };
+
+  BundleWriter(Env* env, StringPiece prefix,
+               const Options& options = Options());
   ~BundleWriter();
 
   // Adds the tensor "val" under key "key".
@@ -137,6 +151,7 @@ class BundleWriter {
 
  private:
   Env* const env_;  // Not owned.
+  const Options options_;
   const string prefix_;
   const string tmp_metadata_path_;
   const string tmp_data_path_;
@@ -170,7 +185,29 @@ Status MergeBundles(Env* env, gtl::ArraySlice<string> prefixes,
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
+  struct Options {
+    // If set, LookupMany() reads the tensors concurrently on this pool, and
+    // splits the reads of large tensors into several concurrent reads.
+    // Not owned.
+    thread::ThreadPool* pool = nullptr;
+
+    // If true, the numeric tensors allocated by the reader (see Lookup()) are
+    // backed by a copy-on-write mapping of their data file when it is on the
+    // local filesystem and their data is suitably aligned (see
+    // BundleWriter::Options::data_alignment), instead of being read into
+    // memory.  A page of the file is only copied into memory when the tensor
+    // is written to.
+    //
+    // The data files must then not be truncated or overwritten in place while
+    // such tensors are alive: reading a page past the new end of a file
+    // raises SIGBUS, and pages not copied yet may show the new contents.
+    // Replacing the files by renaming new ones over them, as checkpoint
+    // savers do, is safe.
+    bool use_mmap = false;
+  };
+
   BundleReader(Env* const env, StringPiece prefix);
+  BundleReader(Env* const env, StringPiece prefix, const Options& options);
   ~BundleReader();
 
   // Is ok() iff the reader construction is successful (completed the read of
@@ -207,6 +244,15 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensors keyed by "keys" into "vals", as Lookup() does for
+  // each of them.  With options.pool set, the values of the non-partitioned
+  // tensors are read and checksummed concurrently on the pool.
+  //
+  // On error, any of "vals" may contain nonsense data.
+  // REQUIRES: status().ok() && keys.size() == vals.size()
+  Status LookupMany(gtl::ArraySlice<string> keys,
+                    gtl::ArraySlice<Tensor*> vals) TF_MUST_USE_RESULT;
+
   // Looks up the slices of the tensor keyed by "key".  On OK, "slices"
   // is non-empty if and only if the tensor is a partitioned tensor.
   // REQUIRES: status().ok()
@@ -251,6 +297,25 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // The first half of GetValue(): validates "entry" against "val", and sets
+  // "*ret" to "val" or, if "val" is empty, to a new tensor of the stored
+  // dtype and shape.  Sets "*mapped" iff the new tensor is backed by a mapping
+  // of the data file and so already holds the stored value.
+  Status PrepareValue(StringPiece key, const BundleEntryProto& entry,
+                      const Tensor& val, Tensor* ret,
+                      bool* mapped) TF_MUST_USE_RESULT;
+
+  // Returns the data file of shard "shard_id" in "*file", opening it on first
+  // use.  The file is owned by the reader.  Thread-safe.
+  Status GetDataFile(int32 shard_id,
+                     RandomAccessFile** file) TF_MUST_USE_RESULT;
+
+  // Sets "*val" to a tensor backed by a mapping of the data of "entry", if
+  // options_.use_mmap allows it.  Returns false otherwise.
+  bool GetMappedValue(const BundleEntryProto& entry, Tensor* val);
+
+  class MappedFile;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -261,12 +326,18 @@ class BundleReader {
 
   Env* env_;  // Not owned.
   const string prefix_;
+  const Options options_;
 
   Status status_;
   RandomAccessFile* metadata_;  // Owned.
   table::Table* table_;
   table::Iterator* iter_;
-  std::unordered_map<int32, io::InputBuffer*> data_;
+
+  // Data files opened so far, and mappings of them, keyed by shard id.
+  // Guarded so that LookupMany() can open them from the pool threads.
+  mutex mu_;
+  std::unordered_map<int32, RandomAccessFile*> data_ GUARDED_BY(mu_);
+  std::unordered_map<int32, MappedFile*> mapped_data_ GUARDED_BY(mu_);
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
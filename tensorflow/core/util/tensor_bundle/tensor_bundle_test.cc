@@ -18,6 +18,8 @@ limitations under the License.
 #include <random>
 #include <vector>
 
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/framework/versions.pb.h"
@@ -581,6 +583,135 @@ TEST(TensorBundleTest, TruncatedTensorContents) {
   EXPECT_TRUE(errors::IsOutOfRange(reader.Lookup("key", &val)));
 }
 
+TEST(TensorBundleTest, LookupMany) {
+  // Larger than the pieces large tensors are read in.
+  const TensorShape large_shape({5, 1 << 20});
+  {
+    BundleWriter writer(Env::Default(), Prefix("many"));
+    TF_EXPECT_OK(writer.Add("float", Constant_2x3<float>(1.0)));
+    TF_EXPECT_OK(writer.Add("large", Constant<float>(2.0, large_shape)));
+    TF_EXPECT_OK(writer.Add("string", Constant_2x3<string>("foo")));
+    TF_EXPECT_OK(writer.AddSlice("part", TensorShape({4}),
+                                 TensorSlice::ParseOrDie("0,2"),
+                                 Constant<int32>(3, TensorShape({2}))));
+    TF_EXPECT_OK(writer.AddSlice("part", TensorShape({4}),
+                                 TensorSlice::ParseOrDie("2,2"),
+                                 Constant<int32>(3, TensorShape({2}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  thread::ThreadPool pool(Env::Default(), "lookup_many", 4);
+  for (thread::ThreadPool* pool_ptr : {static_cast<thread::ThreadPool*>(nullptr),
+                                       &pool}) {
+    BundleReader::Options options;
+    options.pool = pool_ptr;
+    BundleReader reader(Env::Default(), Prefix("many"), options);
+    TF_ASSERT_OK(reader.status());
+    Tensor float_val(DT_FLOAT, TensorShape({2, 3}));
+    Tensor large_val(DT_FLOAT, large_shape);
+    Tensor string_val;  // Allocated by the reader.
+    Tensor part_val(DT_INT32, TensorShape({4}));
+    TF_ASSERT_OK(reader.LookupMany({"float", "large", "string", "part"},
+                                   {&float_val, &large_val, &string_val,
+                                    &part_val}));
+    test::ExpectTensorEqual<float>(float_val, Constant_2x3<float>(1.0));
+    test::ExpectTensorEqual<float>(large_val,
+                                   Constant<float>(2.0, large_shape));
+    test::ExpectTensorEqual<string>(string_val, Constant_2x3<string>("foo"));
+    test::ExpectTensorEqual<int32>(part_val,
+                                   Constant<int32>(3, TensorShape({4})));
+
+    Tensor missing_val;
+    EXPECT_TRUE(errors::IsNotFound(
+        reader.LookupMany({"float", "missing"}, {&float_val, &missing_val})));
+  }
+}
+
+TEST(TensorBundleTest, Mmap) {
+  Env* env = Env::Default();
+  {
+    BundleWriter writer(env, Prefix("mmap"));
+    // The data of "a" starts at offset 0, hence is aligned.
+    TF_EXPECT_OK(writer.Add("a", Constant<float>(1.0, TensorShape({16}))));
+    TF_EXPECT_OK(writer.Add("b", Constant<int64>(2, TensorShape({3}))));
+    TF_EXPECT_OK(writer.Add("s", Constant_2x3<string>("bar")));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  string original_data;
+  const string datafile = DataFilename(Prefix("mmap"), 0, 1);
+  TF_ASSERT_OK(ReadFileToString(env, datafile, &original_data));
+
+  BundleReader::Options options;
+  options.use_mmap = true;
+  Tensor a, b, s;
+  {
+    BundleReader reader(env, Prefix("mmap"), options);
+    TF_ASSERT_OK(reader.status());
+    TF_ASSERT_OK(reader.Lookup("a", &a));
+    TF_ASSERT_OK(reader.LookupMany({"b", "s"}, {&b, &s}));
+  }
+  // "a" is backed by the data file; "s" can not be.
+  TensorDescription description;
+  a.FillDescription(&description);
+  EXPECT_EQ("MappedTensorAllocator",
+            description.allocation_description().allocator_name());
+  s.FillDescription(&description);
+  EXPECT_NE("MappedTensorAllocator",
+            description.allocation_description().allocator_name());
+
+  // The tensors outlive the reader.
+  test::ExpectTensorEqual<float>(a, Constant<float>(1.0, TensorShape({16})));
+  test::ExpectTensorEqual<int64>(b, Constant<int64>(2, TensorShape({3})));
+  test::ExpectTensorEqual<string>(s, Constant_2x3<string>("bar"));
+
+  // Writing to the tensors does not modify the checkpoint.
+  a.flat<float>().setConstant(5.0);
+  test::ExpectTensorEqual<float>(a, Constant<float>(5.0, TensorShape({16})));
+  string data;
+  TF_ASSERT_OK(ReadFileToString(env, datafile, &data));
+  EXPECT_EQ(original_data, data);
+
+  // Truncated files are still reported.
+  TF_ASSERT_OK(WriteStringToFile(
+      env, datafile, StringPiece(original_data.data(), 32)));
+  BundleReader reader(env, Prefix("mmap"), options);
+  TF_ASSERT_OK(reader.status());
+  Tensor truncated;
+  EXPECT_FALSE(reader.Lookup("a", &truncated).ok());
+}
+
+TEST(TensorBundleTest, DataAlignment) {
+  Env* env = Env::Default();
+  for (int alignment : {1, static_cast<int>(Allocator::kAllocatorAlignment)}) {
+    const string prefix = Prefix(strings::StrCat("aligned_", alignment));
+    {
+      BundleWriter::Options options;
+      options.data_alignment = alignment;
+      BundleWriter writer(env, prefix, options);
+      TF_EXPECT_OK(writer.Add("b", Constant<int8>(1, TensorShape({3}))));
+      TF_EXPECT_OK(writer.Add("a", Constant<float>(2.0, TensorShape({16}))));
+      TF_ASSERT_OK(writer.Finish());
+    }
+
+    BundleReader::Options options;
+    options.use_mmap = true;
+    BundleReader reader(env, prefix, options);
+    TF_ASSERT_OK(reader.status());
+    Tensor a, b;
+    TF_ASSERT_OK(reader.Lookup("a", &a));
+    TF_ASSERT_OK(reader.Lookup("b", &b));
+    test::ExpectTensorEqual<float>(a, Constant<float>(2.0, TensorShape({16})));
+    test::ExpectTensorEqual<int8>(b, Constant<int8>(1, TensorShape({3})));
+
+    // Without padding, "a" follows the 3 bytes of "b" and is read instead.
+    TensorDescription description;
+    a.FillDescription(&description);
+    EXPECT_EQ(alignment > 1,
+              description.allocation_description().allocator_name() ==
+                  "MappedTensorAllocator");
+  }
+}
+
 TEST(TensorBundleTest, HeaderEntry) {
   {
     BundleWriter writer(Env::Default(), Prefix("b"));
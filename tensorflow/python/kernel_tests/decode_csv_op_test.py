@@ -178,5 +178,30 @@ class DecodeCSVOpTest(test.TestCase):
         args, expected_err_re="Quoted field has to end with quote followed.*")
 
 
+  def testManyRecords(self):
+    # Enough records for the op to parse them on several threads.
+    n = 10000
+    args = {
+        "records": ["%d,%d.25,\"s%d\"\"\",%d" % (i, i, i, i) for i in range(n)],
+        "record_defaults": [[0], [0.0], [""], np.array([], dtype=np.int64)]
+    }
+
+    expected_out = [
+        list(range(n)), [i + 0.25 for i in range(n)],
+        [("s%d\"" % i).encode("ascii") for i in range(n)], list(range(n))
+    ]
+
+    self._test(args, expected_out)
+
+  def testFirstErrorIsReported(self):
+    records = ["%d" % i for i in range(10000)]
+    records[9000] = "x"
+    records[5000] = "y"
+    args = {"records": records, "record_defaults": [[0]]}
+
+    self._test(
+        args, expected_err_re="Field 0 in record 5000 is not a valid int32: y")
+
+
 if __name__ == "__main__":
   test.main()
@@ -31,6 +31,7 @@ from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import data_flow_ops
 from tensorflow.python.ops import embedding_ops
 from tensorflow.python.ops import gradient_checker
+from tensorflow.python.ops import gradients_impl
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import partitioned_variables
 from tensorflow.python.ops import state_ops
@@ -508,6 +509,50 @@ class EmbeddingLookupTest(test.TestCase):
             x, x_shape, y, y_shape, x_init_value=x_init_value)
       self.assertLess(err, 1e-3)
 
+  def testDedupIds(self):
+    vocab_size = 13
+    # Many more ids than distinct ids.
+    id_vals = np.random.randint(vocab_size, size=(6, 10))
+    for num_shards in [1, 5]:
+      for partition_strategy in ["mod", "div"]:
+        with self.test_session():
+          p, params, feed_dict = _EmbeddingParams(num_shards, vocab_size)
+          ids = constant_op.constant(id_vals, dtype=dtypes.int64)
+          embedding = embedding_ops.embedding_lookup(
+              p, ids, partition_strategy=partition_strategy, dedup_ids=True)
+          tf_result = embedding.eval(feed_dict=feed_dict)
+        np_result, _, _ = _EmbeddingResult(
+            params, id_vals.flatten(), num_shards, vocab_size,
+            partition_strategy=partition_strategy)
+        np_result = np_result.reshape(id_vals.shape + (10,))
+        self.assertAllEqual(np_result, tf_result)
+        self.assertShapeEqual(np_result, embedding)
+
+  def testGradientsDedupIds(self):
+    vocab_size = 9
+    id_vals = [0, 3, 3, 8, 0, 0, 5, 3]
+    for num_shards in [1, 3]:
+      with self.test_session():
+        ids = constant_op.constant(id_vals, shape=(2, 4), dtype=dtypes.int32)
+        x, params, _ = _EmbeddingParams(num_shards, vocab_size, shape=[2])
+        y = embedding_ops.embedding_lookup(x, ids, dedup_ids=True)
+        y_shape = [2, 4, 2]
+        x_name = [_PName(i) for i in range(num_shards)]
+        x_init_value = [params[x_n + ":0"] for x_n in x_name]
+        x_shape = [i.shape for i in x_init_value]
+        err = gradient_checker.compute_gradient_error(
+            x, x_shape, y, y_shape, x_init_value=x_init_value)
+        self.assertLess(err, 1e-4)
+        # The gradients of repeated ids are summed before they reach the
+        # shards, which get one row per distinct id.
+        num_indices = 0
+        for grad in gradients_impl.gradients(y, x):
+          self.assertIsInstance(grad, ops.IndexedSlices)
+          indices = grad.indices.eval()
+          self.assertEqual(len(set(indices)), len(indices))
+          num_indices += len(indices)
+        self.assertEqual(len(set(id_vals)), num_indices)
+
   def testConstructionNonSharded(self):
     with ops.Graph().as_default():
       p = variables.Variable(
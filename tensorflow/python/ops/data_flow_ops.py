@@ -1651,12 +1651,15 @@ class RecordInput(object):
                parallelism=1,
                shift_ratio=0,
                seed=0,
-               name=None):
+               name=None,
+               records_per_split=0,
+               prefetch_size=0):
     """Constructs a RecordInput Op.
 
     Args:
       file_pattern: File path to the dataset, possibly containing wildcards.
-        All matching files will be iterated over each epoch.
+        All matching files will be iterated over each epoch, except record
+        index sidecars, whose names end in ".tfindex".
       batch_size: How many records to return at a time.
       buffer_size: The maximum number of records the buffer will contain.  This
         _must_ be smaller than the total number of records in an epoch or
@@ -1667,6 +1670,11 @@ class RecordInput(object):
       seed: Specify the random number seed used by generator that randomizes
         records.
       name: Optional name for the operation.
+      records_per_split: If positive, files that have a record index sidecar
+        are split into runs of this many records, which are shuffled and read
+        concurrently like separate files.
+      prefetch_size: If positive, each reader thread reads up to this many
+        bytes ahead of the records being parsed on a background thread.
 
     Raises:
       ValueError: If one of the arguments is invalid.
@@ -1679,6 +1687,8 @@ class RecordInput(object):
     self._shift_ratio = shift_ratio
     self._seed = seed
     self._name = name
+    self._records_per_split = records_per_split
+    self._prefetch_size = prefetch_size
 
   def get_yield_op(self):
     """Add a node that yields a minibatch every time it is executed."""
@@ -1689,4 +1699,6 @@ class RecordInput(object):
         file_shuffle_shift_ratio=self._shift_ratio,
         batch_size=self._batch_size,
         file_random_seed=self._seed,
+        records_per_split=self._records_per_split,
+        prefetch_size=self._prefetch_size,
         name=self._name)
@@ -41,8 +41,29 @@ def _do_gather(params, ids, validate_indices=True, name=None):
       params, ids, name=name, validate_indices=validate_indices)
 
 
+@ops.RegisterGradient("DedupedEmbeddingGather")
+def _DedupedEmbeddingGatherGrad(op, grad):
+  """Gradient for the Gather that expands deduplicated embedding lookups.
+
+  The gradients of repeated ids are summed here, so that the lookup of the
+  unique ids gets one dense row of gradient per unique id, instead of
+  `IndexedSlices` with one row per original id.
+
+  Args:
+    op: The Gather of the looked up rows by the indices returned by Unique.
+    grad: The gradient with respect to the output of `op`.
+
+  Returns:
+    The gradients with respect to the rows and the indices.
+  """
+  rows, idx = op.inputs
+  rows_grad = math_ops.unsorted_segment_sum(grad, idx,
+                                            array_ops.shape(rows)[0])
+  return [rows_grad, None]
+
+
 def embedding_lookup(params, ids, partition_strategy="mod", name=None,
-                     validate_indices=True, max_norm=None):
+                     validate_indices=True, max_norm=None, dedup_ids=False):
   """Looks up `ids` in a list of embedding tensors.
 
   This function is used to perform parallel lookups on the list of
@@ -85,6 +106,12 @@ def embedding_lookup(params, ids, partition_strategy="mod", name=None,
     validate_indices: Whether or not to validate gather indices.
     max_norm: If not None, embedding values are l2-normalized to the value of
      max_norm.
+    dedup_ids: If True, each distinct id is looked up once, and the result is
+      expanded to the repeated ids locally.  This reduces the ids sent to and
+      the rows received from each partition of `params`, and the gradients
+      of repeated ids are summed before being sent back to the partitions.
+      Useful when `params` live on other tasks and `ids` have many
+      repetitions.
 
   Returns:
     A `Tensor` with the same type as the tensors in `params`.
@@ -112,6 +139,23 @@ def embedding_lookup(params, ids, partition_strategy="mod", name=None,
     if not any(isinstance(p, resource_variable_ops.ResourceVariable)
                for p in params):
       params = ops.convert_n_to_tensor_or_indexed_slices(params, name="params")
+    if dedup_ids:
+      ids = ops.convert_to_tensor(ids, name="ids")
+      unique_ids, unique_idx = array_ops.unique(array_ops.reshape(ids, [-1]))
+      rows = embedding_lookup(
+          params, unique_ids, partition_strategy=partition_strategy,
+          validate_indices=validate_indices, max_norm=max_norm)
+      with ops.get_default_graph().gradient_override_map(
+          {"Gather": "DedupedEmbeddingGather"}):
+        ret = array_ops.gather(rows, unique_idx)
+      # output shape = ids.shape + params[*].shape[1:]
+      ret = array_ops.reshape(
+          ret,
+          array_ops.concat(
+              [array_ops.shape(ids), array_ops.shape(rows)[1:]], 0),
+          name=name)
+      ret.set_shape(ids.get_shape().concatenate(rows.get_shape()[1:]))
+      return ret
     if np == 1:
       with ops.colocate_with(params[0]):
         return maybe_normalize(
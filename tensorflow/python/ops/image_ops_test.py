@@ -2382,6 +2382,69 @@ class JpegTest(test_util.TensorFlowTestCase):
                          [None, None, channels or None])
 
 
+class DecodeJpegBatchTest(test_util.TensorFlowTestCase):
+
+  def _path(self, filename):
+    return os.path.join("tensorflow/core/lib/jpeg/testdata", filename)
+
+  def testMatchesDecodeJpeg(self):
+    with self.test_session() as sess:
+      rgb = io_ops.read_file(self._path("jpeg_merge_test1.jpg"))
+      cmyk = io_ops.read_file(self._path("jpeg_merge_test1_cmyk.jpg"))
+      expected = [image_ops.decode_jpeg(rgb, channels=3),
+                  image_ops.decode_jpeg(cmyk, channels=3)]
+      batch = image_ops.decode_jpeg_batch(
+          array_ops.stack([rgb, cmyk]),
+          array_ops.zeros([0, 4], dtype=dtypes.int32))
+      self.assertEqual([2, None, None, 3], batch.get_shape().as_list())
+      expected, batch = sess.run([expected, batch])
+      self.assertEqual((2, 256, 128, 3), batch.shape)
+      self.assertAllEqual(expected[0], batch[0])
+      self.assertAllEqual(expected[1], batch[1])
+
+  def testCrop(self):
+    with self.test_session() as sess:
+      jpeg = io_ops.read_file(self._path("jpeg_merge_test1.jpg"))
+      image = image_ops.decode_jpeg(jpeg, channels=3)
+      windows = [[0, 0, 100, 60], [17, 33, 100, 60], [156, 68, 100, 60]]
+      batch = image_ops.decode_jpeg_batch(
+          array_ops.stack([jpeg] * len(windows)), windows)
+      image, batch = sess.run([image, batch])
+      self.assertEqual((3, 100, 60, 3), batch.shape)
+      for i, (y, x, h, w) in enumerate(windows):
+        self.assertAllEqual(image[y:y + h, x:x + w], batch[i])
+
+  def testCropWithRatio(self):
+    with self.test_session() as sess:
+      jpeg = io_ops.read_file(self._path("jpeg_merge_test1.jpg"))
+      image = image_ops.decode_jpeg(jpeg, channels=1, ratio=2)
+      batch = image_ops.decode_jpeg_batch(
+          array_ops.stack([jpeg]), [[10, 5, 50, 40]], channels=1, ratio=2)
+      image, batch = sess.run([image, batch])
+      self.assertEqual((1, 50, 40, 1), batch.shape)
+      self.assertAllEqual(image[10:60, 5:45], batch[0])
+
+  def testInvalidCrop(self):
+    with self.test_session():
+      jpeg = io_ops.read_file(self._path("jpeg_merge_test1.jpg"))
+      contents = array_ops.stack([jpeg, jpeg])
+      with self.assertRaisesOpError("same size"):
+        image_ops.decode_jpeg_batch(
+            contents, [[0, 0, 10, 10], [0, 0, 10, 11]]).eval()
+      with self.assertRaisesOpError("Invalid JPEG data for image 1"):
+        image_ops.decode_jpeg_batch(
+            contents, [[0, 0, 10, 10], [250, 0, 10, 10]]).eval()
+
+  def testDifferentSizes(self):
+    with self.test_session():
+      small = image_ops.encode_jpeg(array_ops.zeros([4, 4, 3], dtypes.uint8))
+      large = image_ops.encode_jpeg(array_ops.zeros([8, 4, 3], dtypes.uint8))
+      with self.assertRaisesOpError("differs from the shape of the batch"):
+        image_ops.decode_jpeg_batch(
+            array_ops.stack([small, large]),
+            array_ops.zeros([0, 4], dtype=dtypes.int32)).eval()
+
+
 class PngTest(test_util.TensorFlowTestCase):
 
   def testExisting(self):
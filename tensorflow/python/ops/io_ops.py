@@ -417,18 +417,21 @@ class TFRecordReader(ReaderBase):
   """
   # TODO(josh11b): Support serializing and restoring state.
 
-  def __init__(self, name=None, options=None):
+  def __init__(self, name=None, options=None, prefetch_size=0):
     """Create a TFRecordReader.
 
     Args:
       name: A name for the operation (optional).
       options: A TFRecordOptions object (optional).
+      prefetch_size: If positive, a background thread reads up to this many
+        bytes of uncompressed files ahead of the records being read.
     """
     compression_type = python_io.TFRecordOptions.get_compression_type_string(
         options)
 
     rr = gen_io_ops._tf_record_reader_v2(
-        name=name, compression_type=compression_type)
+        name=name, compression_type=compression_type,
+        prefetch_size=prefetch_size)
     super(TFRecordReader, self).__init__(rr)
 
 